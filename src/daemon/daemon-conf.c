@@ -99,6 +99,8 @@ static const pa_daemon_conf default_conf = {
     .default_fragment_size_msec = 25,
     .deferred_volume_safety_margin_usec = 8000,
     .deferred_volume_extra_delay_usec = 0,
+    .main_loop_watchdog_usec = 0,
+    .subscription_change_interval_msec = 0,
     .default_sample_spec = { .format = PA_SAMPLE_S16NE, .rate = 44100, .channels = 2 },
     .alternate_sample_rate = 48000,
     .default_channel_map = { .channels = 2, .map = { PA_CHANNEL_POSITION_LEFT, PA_CHANNEL_POSITION_RIGHT } },
@@ -552,6 +554,9 @@ int pa_daemon_conf_load(pa_daemon_conf *c, const char *filename) {
                                         pa_config_parse_unsigned, &c->deferred_volume_safety_margin_usec, NULL },
         { "deferred-volume-extra-delay-usec",
                                         pa_config_parse_int,      &c->deferred_volume_extra_delay_usec, NULL },
+        { "main-loop-watchdog-usec",    pa_config_parse_unsigned, &c->main_loop_watchdog_usec, NULL },
+        { "subscription-change-interval-msec",
+                                        pa_config_parse_unsigned, &c->subscription_change_interval_msec, NULL },
         { "nice-level",                 parse_nice_level,         c, NULL },
         { "disable-remixing",           pa_config_parse_bool,     &c->disable_remixing, NULL },
         { "enable-remixing",            pa_config_parse_not_bool, &c->disable_remixing, NULL },
@@ -759,6 +764,8 @@ char *pa_daemon_conf_dump(pa_daemon_conf *c) {
     pa_strbuf_printf(s, "enable-deferred-volume = %s\n", pa_yes_no(c->deferred_volume));
     pa_strbuf_printf(s, "deferred-volume-safety-margin-usec = %u\n", c->deferred_volume_safety_margin_usec);
     pa_strbuf_printf(s, "deferred-volume-extra-delay-usec = %d\n", c->deferred_volume_extra_delay_usec);
+    pa_strbuf_printf(s, "main-loop-watchdog-usec = %u\n", c->main_loop_watchdog_usec);
+    pa_strbuf_printf(s, "subscription-change-interval-msec = %u\n", c->subscription_change_interval_msec);
     pa_strbuf_printf(s, "shm-size-bytes = %lu\n", (unsigned long) c->shm_size);
     pa_strbuf_printf(s, "log-meta = %s\n", pa_yes_no(c->log_meta));
     pa_strbuf_printf(s, "log-time = %s\n", pa_yes_no(c->log_time));
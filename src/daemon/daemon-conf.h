@@ -129,6 +129,8 @@ typedef struct pa_daemon_conf {
     unsigned default_n_fragments, default_fragment_size_msec;
     unsigned deferred_volume_safety_margin_usec;
     int deferred_volume_extra_delay_usec;
+    unsigned main_loop_watchdog_usec;
+    unsigned subscription_change_interval_msec;
     pa_sample_spec default_sample_spec;
     uint32_t alternate_sample_rate;
     pa_channel_map default_channel_map;
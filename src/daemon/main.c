@@ -135,6 +135,38 @@ static void message_cb(pa_mainloop_api*a, pa_time_event*e, const struct timeval
 
 #endif
 
+/* Names the module or client a callback the main loop watchdog
+ * complained about belongs to */
+static char *watchdog_owner_cb(pa_mainloop *m, const char *object, void *event_userdata, void *userdata) {
+    pa_core *c = userdata;
+    pa_module *module;
+    pa_client *client;
+    uint32_t idx;
+
+    pa_assert(c);
+
+    if (!event_userdata)
+        return NULL;
+
+    PA_IDXSET_FOREACH(client, c->clients, idx)
+        if (client->userdata == event_userdata ||
+            (client->owns_event && client->owns_event(client, event_userdata)))
+            return pa_sprintf_malloc("client #%u (%s)", client->index,
+                                     pa_strnull(pa_proplist_gets(client->proplist, PA_PROP_APPLICATION_NAME)));
+
+    PA_IDXSET_FOREACH(module, c->modules, idx)
+        if (module->userdata == event_userdata)
+            return pa_sprintf_malloc("module #%u (%s)", module->index, module->name);
+
+    /* Fall back to the module the code is from */
+    if (object)
+        PA_IDXSET_FOREACH(module, c->modules, idx)
+            if (pa_startswith(object, module->name) && pa_streq(object + strlen(module->name), ".so"))
+                return pa_sprintf_malloc("module #%u (%s)", module->index, module->name);
+
+    return NULL;
+}
+
 static void signal_callback(pa_mainloop_api*m, pa_signal_event *e, int sig, void *userdata) {
     pa_log_info(_("Got signal %s."), pa_sig2str(sig));
 
@@ -1016,12 +1048,15 @@ int main(int argc, char *argv[]) {
     pa_memtrap_install();
 
     pa_assert_se(mainloop = pa_mainloop_new());
+    pa_mainloop_set_watchdog(mainloop, conf->main_loop_watchdog_usec);
 
     if (!(c = pa_core_new(pa_mainloop_get_api(mainloop), !conf->disable_shm, conf->shm_size))) {
         pa_log(_("pa_core_new() failed."));
         goto finish;
     }
 
+    pa_mainloop_set_watchdog_owner_callback(mainloop, watchdog_owner_cb, c);
+
     c->default_sample_spec = conf->default_sample_spec;
     c->alternate_sample_rate = conf->alternate_sample_rate;
     c->default_channel_map = conf->default_channel_map;
@@ -1031,6 +1066,7 @@ int main(int argc, char *argv[]) {
     c->deferred_volume_extra_delay_usec = conf->deferred_volume_extra_delay_usec;
     c->exit_idle_time = conf->exit_idle_time;
     c->scache_idle_time = conf->scache_idle_time;
+    pa_subscription_set_change_interval(c, (pa_usec_t) conf->subscription_change_interval_msec * PA_USEC_PER_MSEC);
     c->resample_method = conf->resample_method;
     c->realtime_priority = conf->realtime_priority;
     c->realtime_scheduling = !!conf->realtime_scheduling;
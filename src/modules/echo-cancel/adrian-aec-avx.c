@@ -0,0 +1,80 @@
+/***
+    This file is part of PulseAudio.
+
+    PulseAudio is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License,
+    or (at your option) any later version.
+
+    PulseAudio is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with PulseAudio; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+    USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulsecore/macro.h>
+#include <pulsecore/log.h>
+
+#include "adrian.h"
+
+/* This file is built with AVX_CFLAGS, the functions in here must only
+ * be called after the CPU and OS support for AVX has been verified.
+ * n must be a multiple of 16 and w must be 32-byte aligned. */
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX__)
+
+#include <immintrin.h>
+
+static float dotp_avx(const float *w, const float *x, int n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m128 s;
+    int i;
+
+    for (i = 0; i < n; i += 16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_load_ps(w + i), _mm256_loadu_ps(x + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_load_ps(w + i + 8), _mm256_loadu_ps(x + i + 8)));
+    }
+
+    s0 = _mm256_add_ps(s0, s1);
+    s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+
+    return _mm_cvtss_f32(s);
+}
+
+static void update_avx(float *w, const float *xf, float mikro_ef, int n) {
+    __m256 m = _mm256_set1_ps(mikro_ef);
+    int i;
+
+    for (i = 0; i < n; i += 16) {
+        _mm256_store_ps(w + i, _mm256_add_ps(_mm256_load_ps(w + i), _mm256_mul_ps(m, _mm256_loadu_ps(xf + i))));
+        _mm256_store_ps(w + i + 8, _mm256_add_ps(_mm256_load_ps(w + i + 8), _mm256_mul_ps(m, _mm256_loadu_ps(xf + i + 8))));
+    }
+}
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX__) */
+
+bool AEC_func_init_avx(pa_cpu_x86_flag_t flags, AEC_dotp_func_t *dotp, AEC_update_func_t *update) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX__)
+
+    if (flags & PA_CPU_X86_AVX) {
+        pa_log_info("Initialising AVX optimized NLMS functions.");
+        *dotp = dotp_avx;
+        *update = update_avx;
+        return true;
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX__) */
+
+    return false;
+}
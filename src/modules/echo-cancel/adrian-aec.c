@@ -22,6 +22,8 @@
 
 #include "adrian-aec.h"
 
+#include <pulsecore/log.h>
+
 #ifndef DISABLE_ORC
 #include "adrian-aec-orc-gen.h"
 #endif
@@ -31,12 +33,12 @@
 #endif
 
 /* Vector Dot Product */
-static REAL dotp(REAL a[], REAL b[])
+static float dotp(const float *a, const float *b, int n)
 {
   REAL sum0 = 0.0f, sum1 = 0.0f;
   int j;
 
-  for (j = 0; j < NLMS_LEN; j += 2) {
+  for (j = 0; j < n; j += 2) {
     // optimize: partial loop unrolling
     sum0 += a[j] * b[j];
     sum1 += a[j + 1] * b[j + 1];
@@ -44,15 +46,30 @@ static REAL dotp(REAL a[], REAL b[])
   return sum0 + sum1;
 }
 
-static REAL dotp_sse(REAL a[], REAL b[])
+/* Update tap weights (filter learning) */
+static void update(float *w, const float *xf, float mikro_ef, int n)
 {
+#ifdef DISABLE_ORC
+  int i;
+  for (i = 0; i < n; i += 2) {
+    // optimize: partial loop unrolling
+    w[i] += mikro_ef * xf[i];
+    w[i + 1] += mikro_ef * xf[i + 1];
+  }
+#else
+  update_tap_weights(w, xf, mikro_ef, n);
+#endif
+}
+
 #ifdef __SSE__
+static float dotp_sse(const float *a, const float *b, int n)
+{
   /* This is taken from speex's inner product implementation */
   int j;
   REAL sum;
   __m128 acc = _mm_setzero_ps();
 
-  for (j=0;j<NLMS_LEN;j+=8)
+  for (j=0;j<n;j+=8)
   {
     acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a+j), _mm_loadu_ps(b+j)));
     acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a+j+4), _mm_loadu_ps(b+j+4)));
@@ -62,13 +79,23 @@ static REAL dotp_sse(REAL a[], REAL b[])
   _mm_store_ss(&sum, acc);
 
   return sum;
-#else
-  return dotp(a, b);
-#endif
 }
 
+static void update_sse(float *w, const float *xf, float mikro_ef, int n)
+{
+  int j;
+  __m128 m = _mm_set1_ps(mikro_ef);
+
+  for (j=0;j<n;j+=8)
+  {
+    _mm_store_ps(w+j, _mm_add_ps(_mm_load_ps(w+j), _mm_mul_ps(m, _mm_loadu_ps(xf+j))));
+    _mm_store_ps(w+j+4, _mm_add_ps(_mm_load_ps(w+j+4), _mm_mul_ps(m, _mm_loadu_ps(xf+j+4))));
+  }
+}
+#endif
+
 
-AEC* AEC_init(int RATE, int have_vector)
+AEC* AEC_init(int RATE, const pa_cpu_info *cpu_info)
 {
   AEC *a = pa_xnew0(AEC, 1);
   a->j = NLMS_EXT;
@@ -86,14 +113,24 @@ AEC* AEC_init(int RATE, int have_vector)
 
   a->fdwdisplay = -1;
 
-  if (have_vector) {
-      /* Get a 16-byte aligned location */
-      a->w = (REAL *) (((uintptr_t) a->w_arr) - (((uintptr_t) a->w_arr) % 16) + 16);
+  /* Get a 32-byte aligned location, the vector functions need it */
+  a->w = (REAL *) (((uintptr_t) a->w_arr + 31) & ~((uintptr_t) 31));
+
+  a->dotp = dotp;
+  a->update = update;
+
+  if (cpu_info && cpu_info->cpu_type == PA_CPU_X86) {
+#ifdef HAVE_AVX
+    if (AEC_func_init_avx(cpu_info->flags.x86, &a->dotp, &a->update))
+      return a;
+#endif
+#ifdef __SSE__
+    if (cpu_info->flags.x86 & PA_CPU_X86_SSE) {
+      pa_log_info("Initialising SSE optimized NLMS functions.");
       a->dotp = dotp_sse;
-  } else {
-      /* We don't care about alignment, just use the array as-is */
-      a->w = a->w_arr;
-      a->dotp = dotp;
+      a->update = update_sse;
+    }
+#endif
   }
 
   return a;
@@ -192,7 +229,7 @@ static REAL AEC_nlms_pw(AEC *a, REAL d, REAL x_, float stepsize)
   // (mic signal - estimated mic signal from spk signal)
   e = d;
   if (a->hangover > 0) {
-    e -= a->dotp(a->w, a->x + a->j);
+    e -= a->dotp(a->w, a->x + a->j, NLMS_LEN);
   }
   ef = IIR1_highpass(a->Fe, e);     // pre-whitening of e
 
@@ -203,17 +240,8 @@ static REAL AEC_nlms_pw(AEC *a, REAL d, REAL x_, float stepsize)
     // calculate variable step size
     REAL mikro_ef = stepsize * ef / a->dotp_xf_xf;
 
-#ifdef DISABLE_ORC
     // update tap weights (filter learning)
-    int i;
-    for (i = 0; i < NLMS_LEN; i += 2) {
-      // optimize: partial loop unrolling
-      a->w[i] += mikro_ef * a->xf[i + a->j];
-      a->w[i + 1] += mikro_ef * a->xf[i + a->j + 1];
-    }
-#else
-    update_tap_weights(a->w, &a->xf[a->j], mikro_ef, NLMS_LEN);
-#endif
+    a->update(a->w, &a->xf[a->j], mikro_ef, NLMS_LEN);
   }
 
   if (--(a->j) < 0) {
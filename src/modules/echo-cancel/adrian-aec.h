@@ -22,6 +22,8 @@
 
 #include <pulsecore/macro.h>
 
+#include "adrian.h"
+
 #define WIDEB 2
 
 // use double if your CPU does software-emulation of float
@@ -292,8 +294,6 @@ public:
 // block size in taps to optimize DTD calculation
 #define DTD_LEN   16
 
-typedef struct AEC AEC;
-
 struct AEC {
   // Time domain Filters
   IIR_HP *acMic, *acSpk;        // DC-level remove Highpass)
@@ -308,8 +308,8 @@ struct AEC {
   // NLMS-pw
   REAL x[NLMS_LEN + NLMS_EXT];  // tap delayed loudspeaker signal
   REAL xf[NLMS_LEN + NLMS_EXT]; // pre-whitening tap delayed signal
-  REAL w_arr[NLMS_LEN + (16 / sizeof(REAL))]; // tap weights
-  REAL *w;                      // this will be a 16-byte aligned pointer into w_arr
+  REAL w_arr[NLMS_LEN + (32 / sizeof(REAL))]; // tap weights
+  REAL *w;                      // this will be a 32-byte aligned pointer into w_arr
   int j;                        // optimize: less memory copies
   double dotp_xf_xf;            // double to avoid loss of precision
   float delta;                  // noise floor to stabilize NLMS
@@ -327,7 +327,8 @@ struct AEC {
   float stepsize;
 
   // vfuncs that are picked based on processor features available
-  REAL (*dotp) (REAL[], REAL[]);
+  AEC_dotp_func_t dotp;
+  AEC_update_func_t update;
 };
 
 /* Double-Talk Detector
@@ -351,16 +352,6 @@ static  void AEC_leaky(AEC *a);
  */
 static  REAL AEC_nlms_pw(AEC *a, REAL d, REAL x_, float stepsize);
 
-AEC* AEC_init(int RATE, int have_vector);
-void AEC_done(AEC *a);
-
-/* Acoustic Echo Cancellation and Suppression of one sample
- * in   d:  microphone signal with echo
- * in   x:  loudspeaker signal
- * return:  echo cancelled microphone signal
- */
-  int AEC_doAEC(AEC *a, int d_, int x_);
-
 PA_GCC_UNUSED static  float AEC_getambient(AEC *a) {
     return a->dfast;
   }
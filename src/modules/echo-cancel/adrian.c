@@ -61,7 +61,7 @@ bool pa_adrian_ec_init(pa_core *c, pa_echo_canceller *ec,
                        pa_sample_spec *play_ss, pa_channel_map *play_map,
                        pa_sample_spec *out_ss, pa_channel_map *out_map,
                        uint32_t *nframes, const char *args) {
-    int rate, have_vector = 0;
+    int rate;
     uint32_t frame_size_ms;
     pa_modargs *ma;
 
@@ -84,11 +84,7 @@ bool pa_adrian_ec_init(pa_core *c, pa_echo_canceller *ec,
 
     pa_log_debug ("Using nframes %d, blocksize %u, channels %d, rate %d", *nframes, ec->params.priv.adrian.blocksize, out_ss->channels, out_ss->rate);
 
-    /* For now we only support SSE */
-    if (c->cpu_info.cpu_type == PA_CPU_X86 && (c->cpu_info.flags.x86 & PA_CPU_X86_SSE))
-        have_vector = 1;
-
-    ec->params.priv.adrian.aec = AEC_init(rate, have_vector);
+    ec->params.priv.adrian.aec = AEC_init(rate, &c->cpu_info);
     if (!ec->params.priv.adrian.aec)
         goto fail;
 
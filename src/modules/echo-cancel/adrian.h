@@ -23,10 +23,26 @@
     USA.
 ***/
 
+#include <pulsecore/cpu.h>
+
 /* Forward declarations */
 
 typedef struct AEC AEC;
 
-AEC* AEC_init(int RATE, int have_vector);
+/* NLMS kernels, n is a multiple of 16 and w is 32-byte aligned */
+typedef float (*AEC_dotp_func_t) (const float *w, const float *x, int n);
+typedef void (*AEC_update_func_t) (float *w, const float *xf, float mikro_ef, int n);
+
+AEC* AEC_init(int RATE, const pa_cpu_info *cpu_info);
 void AEC_done(AEC *a);
+
+/* Acoustic Echo Cancellation and Suppression of one sample
+ * in   d:  microphone signal with echo
+ * in   x:  loudspeaker signal
+ * return:  echo cancelled microphone signal
+ */
 int AEC_doAEC(AEC *a, int d_, int x_);
+
+#ifdef HAVE_AVX
+bool AEC_func_init_avx(pa_cpu_x86_flag_t flags, AEC_dotp_func_t *dotp, AEC_update_func_t *update);
+#endif
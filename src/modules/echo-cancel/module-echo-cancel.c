@@ -40,6 +40,7 @@
 #include <pulse/rtclock.h>
 
 #include <pulsecore/i18n.h>
+#include <pulsecore/asyncq.h>
 #include <pulsecore/atomic.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/namereg.h>
@@ -51,6 +52,7 @@
 #include <pulsecore/log.h>
 #include <pulsecore/rtpoll.h>
 #include <pulsecore/sample-util.h>
+#include <pulsecore/thread.h>
 #include <pulsecore/ltdl-helper.h>
 
 #include "module-echo-cancel-symdef.h"
@@ -74,6 +76,7 @@ PA_MODULE_USAGE(
           "channel_map=<channel map> "
           "aec_method=<implementation to use> "
           "aec_args=<parameters for the AEC engine> "
+          "aec_thread=<run the AEC engine in its own thread> "
           "save_aec=<save AEC data in /tmp> "
           "autoloaded=<set if this module is being loaded automatically> "
           "use_volume_sharing=<yes or no> "
@@ -142,6 +145,10 @@ static const pa_echo_canceller ec_table[] = {
 #define DEFAULT_ADJUST_TOLERANCE (5*PA_USEC_PER_MSEC)
 #define DEFAULT_SAVE_AEC false
 #define DEFAULT_AUTOLOADED false
+#define DEFAULT_AEC_THREAD false
+
+#define EC_THREAD_JOBS 16 /* must be a power of two */
+#define EC_STATS_INTERVAL (10*PA_USEC_PER_SEC)
 
 #define MEMBLOCKQ_MAXLENGTH (16*1024*1024)
 
@@ -176,6 +183,14 @@ static const pa_echo_canceller ec_table[] = {
  *    be before capture and the difference should not be bigger than one frame
  *    size. We would ideally like to resample the sink_input but most driver
  *    don't give enough accuracy to be able to do that right now.
+ *
+ * With aec_thread the canceller itself runs in a separate thread, so a slow
+ * engine doesn't stretch the source I/O thread's deadline. The source I/O
+ * thread still does the alignment, then copies every block into a job and
+ * hands it over through a lock-free queue. Finished jobs come back through a
+ * second queue. The result of every job is due one capture period later, when
+ * the next chunk is pushed. A job that misses this deadline is replaced by
+ * silence, so the source latency stays fixed.
  */
 
 struct userdata;
@@ -188,6 +203,36 @@ struct pa_echo_canceller_msg {
 PA_DEFINE_PRIVATE_CLASS(pa_echo_canceller_msg, pa_msgobject);
 #define PA_ECHO_CANCELLER_MSG(o) (pa_echo_canceller_msg_cast(o))
 
+typedef enum {
+    EC_JOB_RUN,
+    EC_JOB_PLAY,
+    EC_JOB_RECORD,
+} ec_job_type_t;
+
+/* A block of work for the canceller thread. The buffers are allocated once,
+ * jobs are reused in order. */
+struct ec_job {
+    ec_job_type_t type;
+    uint8_t *rdata, *pdata, *cdata;
+
+    bool set_drift;
+    float drift;
+
+    /* The capture volume as seen by the source I/O thread when the job was
+     * queued, and the volume the canceller asked for while running it. */
+    pa_cvolume volume;
+    bool set_volume;
+    pa_cvolume new_volume;
+
+    /* Written by the canceller thread */
+    pa_usec_t usec;
+
+    /* Only touched by the source I/O thread */
+    unsigned generation;
+    bool done;
+    bool expired;
+};
+
 struct snapshot {
     pa_usec_t sink_now;
     pa_usec_t sink_latency;
@@ -252,6 +297,25 @@ struct userdata {
 
     bool use_volume_sharing;
 
+    /* The canceller thread, if enabled */
+    pa_thread *ec_thread;
+    pa_asyncq *ec_jobs, *ec_done;
+    struct ec_job ec_job[EC_THREAD_JOBS];
+    struct ec_job ec_quit;
+    struct ec_job *ec_current; /* only used by the canceller thread */
+    unsigned ec_head, ec_tail; /* jobs in flight, source I/O thread */
+    unsigned ec_generation;
+    size_t ec_queued; /* capture bytes in flight */
+    bool ec_drift_pending;
+    float ec_drift;
+
+    /* Processing time statistics, source I/O thread */
+    struct {
+        pa_usec_t block_usec, total_usec, max_usec;
+        pa_usec_t last_report;
+        unsigned blocks, late;
+    } ec_stats;
+
     struct {
         pa_cvolume current_volume;
     } thread_info;
@@ -274,6 +338,7 @@ static const char* const valid_modargs[] = {
     "channel_map",
     "aec_method",
     "aec_args",
+    "aec_thread",
     "save_aec",
     "autoloaded",
     "use_volume_sharing",
@@ -419,7 +484,9 @@ static int source_process_msg_cb(pa_msgobject *o, int code, void *data, int64_t
                 /* Add the latency internal to our source output on top */
                 pa_bytes_to_usec(pa_memblockq_get_length(u->source_output->thread_info.delay_memblockq), &u->source_output->source->sample_spec) +
                 /* and the buffering we do on the source */
-                pa_bytes_to_usec(u->source_output_blocksize, &u->source_output->source->sample_spec);
+                pa_bytes_to_usec(u->source_output_blocksize, &u->source_output->source->sample_spec) +
+                /* and the blocks the canceller thread is working on */
+                pa_bytes_to_usec(u->ec_queued, &u->source_output->source->sample_spec);
 
             return 0;
 
@@ -707,6 +774,218 @@ static void do_resync(struct userdata *u) {
     apply_diff_time(u, diff_time);
 }
 
+/* Called from source I/O thread context. */
+static void ec_stats_add(struct userdata *u, pa_usec_t usec, bool block_done) {
+    u->ec_stats.block_usec += usec;
+
+    if (!block_done)
+        return;
+
+    u->ec_stats.total_usec += u->ec_stats.block_usec;
+    u->ec_stats.max_usec = PA_MAX(u->ec_stats.max_usec, u->ec_stats.block_usec);
+    u->ec_stats.blocks++;
+    u->ec_stats.block_usec = 0;
+}
+
+/* Called from source I/O thread context. */
+static void ec_stats_report(struct userdata *u) {
+    pa_usec_t now, block;
+
+    now = pa_rtclock_now();
+
+    if (u->ec_stats.last_report == 0)
+        u->ec_stats.last_report = now;
+
+    if (now - u->ec_stats.last_report < EC_STATS_INTERVAL || u->ec_stats.blocks == 0)
+        return;
+
+    block = pa_bytes_to_usec(u->source_output_blocksize, &u->source_output->sample_spec);
+
+    pa_log_debug("Canceller needed %llu usec on average and %llu usec at most for %llu usec blocks, %0.1f%% headroom, %u of %u blocks late",
+                 (unsigned long long) (u->ec_stats.total_usec / u->ec_stats.blocks),
+                 (unsigned long long) u->ec_stats.max_usec,
+                 (unsigned long long) block,
+                 100.0 * (1.0 - (double) u->ec_stats.max_usec / block),
+                 u->ec_stats.late, u->ec_stats.blocks + u->ec_stats.late);
+
+    u->ec_stats.total_usec = u->ec_stats.max_usec = 0;
+    u->ec_stats.blocks = u->ec_stats.late = 0;
+    u->ec_stats.last_report = now;
+}
+
+/* Forwards a block of canceled data, or silence if cdata is NULL, to the
+ * virtual source.
+ *
+ * Called from source I/O thread context. */
+static void post_canceled(struct userdata *u, const uint8_t *cdata, size_t length) {
+    pa_memchunk cchunk;
+    void *p;
+    int unused PA_GCC_UNUSED;
+
+    cchunk.index = 0;
+    cchunk.length = length;
+    cchunk.memblock = pa_memblock_new(u->source->core->mempool, cchunk.length);
+
+    p = pa_memblock_acquire(cchunk.memblock);
+    if (cdata)
+        memcpy(p, cdata, cchunk.length);
+    else
+        pa_silence_memory(p, cchunk.length, &u->source->sample_spec);
+    pa_memblock_release(cchunk.memblock);
+
+    if (cdata && u->save_aec && u->canceled_file)
+        unused = fwrite(cdata, 1, length, u->canceled_file);
+
+    pa_source_post(u->source, &cchunk);
+    pa_memblock_unref(cchunk.memblock);
+}
+
+/* Like the inline code, run() produces a block in the source format and
+ * record() one in the source output format */
+static size_t ec_job_out_length(struct userdata *u, struct ec_job *j) {
+    return j->type == EC_JOB_RUN ? u->source_blocksize : u->source_output_blocksize;
+}
+
+/* Runs the canceller on the jobs the source I/O thread hands us */
+static void ec_thread_func(void *userdata) {
+    struct userdata *u = userdata;
+    struct ec_job *j;
+
+    pa_log_debug("Echo canceller thread starting up");
+
+    if (u->core->realtime_scheduling)
+        pa_make_realtime(u->core->realtime_priority);
+
+    while ((j = pa_asyncq_pop(u->ec_jobs, true)) != &u->ec_quit) {
+        pa_usec_t start = pa_rtclock_now();
+
+        u->ec_current = j;
+
+        if (j->set_drift)
+            u->ec->set_drift(u->ec, j->drift);
+
+        switch (j->type) {
+            case EC_JOB_RUN:
+                u->ec->run(u->ec, j->rdata, j->pdata, j->cdata);
+                break;
+            case EC_JOB_PLAY:
+                u->ec->play(u->ec, j->pdata);
+                break;
+            case EC_JOB_RECORD:
+                u->ec->record(u->ec, j->rdata, j->cdata);
+                break;
+        }
+
+        u->ec_current = NULL;
+        j->usec = pa_rtclock_now() - start;
+
+        /* There are never more jobs in flight than fit in the queue */
+        pa_assert_se(pa_asyncq_push(u->ec_done, j, false) == 0);
+    }
+
+    pa_log_debug("Echo canceller thread shutting down");
+}
+
+/* Takes back the jobs the canceller thread finished and forwards their
+ * results, unless they already expired.
+ *
+ * Called from source I/O thread context. */
+static void ec_thread_collect(struct userdata *u) {
+    struct ec_job *j;
+
+    while ((j = pa_asyncq_pop(u->ec_done, false)))
+        j->done = true;
+
+    /* Jobs are finished in order */
+    while (u->ec_head != u->ec_tail && (j = &u->ec_job[u->ec_head % EC_THREAD_JOBS])->done) {
+
+        if (j->set_volume)
+            pa_echo_canceller_set_capture_volume(u->ec, &j->new_volume);
+
+        if (j->type == EC_JOB_PLAY)
+            ec_stats_add(u, j->usec, false);
+        else {
+            if (!j->expired) {
+                u->ec_queued -= u->source_output_blocksize;
+                post_canceled(u, j->cdata, ec_job_out_length(u, j));
+            }
+
+            ec_stats_add(u, j->usec, true);
+        }
+
+        u->ec_head++;
+    }
+}
+
+/* Gives up on the jobs in flight that are due, or all of them. If post is set
+ * their capture blocks are replaced by silence, so what follows keeps its
+ * place in the stream.
+ *
+ * Called from source I/O thread context. */
+static void ec_thread_expire(struct userdata *u, bool all, bool post) {
+    unsigned i;
+
+    for (i = u->ec_head; i != u->ec_tail; i++) {
+        struct ec_job *j = &u->ec_job[i % EC_THREAD_JOBS];
+
+        if (!all && j->generation == u->ec_generation)
+            break;
+
+        if (j->expired || j->type == EC_JOB_PLAY)
+            continue;
+
+        j->expired = true;
+        u->ec_queued -= u->source_output_blocksize;
+
+        if (post) {
+            post_canceled(u, NULL, ec_job_out_length(u, j));
+            u->ec_stats.late++;
+        }
+    }
+}
+
+/* Called from source I/O thread context. */
+static void ec_thread_submit(struct userdata *u, ec_job_type_t type, const uint8_t *rdata, const uint8_t *pdata) {
+    struct ec_job *j;
+
+    if (u->ec_tail - u->ec_head >= EC_THREAD_JOBS) {
+        /* The canceller thread is hopelessly behind, skip this block */
+        ec_thread_expire(u, true, true);
+
+        if (type != EC_JOB_PLAY) {
+            post_canceled(u, NULL, type == EC_JOB_RUN ? u->source_blocksize : u->source_output_blocksize);
+            u->ec_stats.late++;
+        }
+
+        return;
+    }
+
+    j = &u->ec_job[u->ec_tail % EC_THREAD_JOBS];
+    j->type = type;
+
+    if (type != EC_JOB_PLAY)
+        memcpy(j->rdata, rdata, u->source_output_blocksize);
+    if (type != EC_JOB_RECORD)
+        memcpy(j->pdata, pdata, u->sink_blocksize);
+
+    j->set_drift = u->ec_drift_pending;
+    j->drift = u->ec_drift;
+    u->ec_drift_pending = false;
+
+    j->volume = u->thread_info.current_volume;
+    j->set_volume = false;
+
+    j->generation = u->ec_generation;
+    j->done = false;
+    j->expired = false;
+
+    if (type != EC_JOB_PLAY)
+        u->ec_queued += u->source_output_blocksize;
+
+    pa_assert_se(pa_asyncq_push(u->ec_jobs, j, false) == 0);
+    u->ec_tail++;
+}
+
 /* 1. Calculate drift at this point, pass to canceller
  * 2. Push out playback samples in blocksize chunks
  * 3. Push out capture samples in blocksize chunks
@@ -720,6 +999,7 @@ static void do_push_drift_comp(struct userdata *u) {
     pa_memchunk rchunk, pchunk, cchunk;
     uint8_t *rdata, *pdata, *cdata;
     float drift;
+    pa_usec_t start;
     int unused PA_GCC_UNUSED;
 
     rlen = pa_memblockq_get_length(u->source_memblockq);
@@ -740,7 +1020,11 @@ static void do_push_drift_comp(struct userdata *u) {
     u->source_rem = rlen % u->source_output_blocksize;
 
     /* Now let the canceller work its drift compensation magic */
-    u->ec->set_drift(u->ec, drift);
+    if (u->ec_thread) {
+        u->ec_drift_pending = true;
+        u->ec_drift = drift;
+    } else
+        u->ec->set_drift(u->ec, drift);
 
     if (u->save_aec) {
         if (u->drift_file)
@@ -753,7 +1037,13 @@ static void do_push_drift_comp(struct userdata *u) {
         pdata = pa_memblock_acquire(pchunk.memblock);
         pdata += pchunk.index;
 
-        u->ec->play(u->ec, pdata);
+        if (u->ec_thread)
+            ec_thread_submit(u, EC_JOB_PLAY, NULL, pdata);
+        else {
+            start = pa_rtclock_now();
+            u->ec->play(u->ec, pdata);
+            ec_stats_add(u, pa_rtclock_now() - start, false);
+        }
 
         if (u->save_aec) {
             if (u->drift_file)
@@ -776,30 +1066,37 @@ static void do_push_drift_comp(struct userdata *u) {
         rdata = pa_memblock_acquire(rchunk.memblock);
         rdata += rchunk.index;
 
-        cchunk.index = 0;
-        cchunk.length = u->source_output_blocksize;
-        cchunk.memblock = pa_memblock_new(u->source->core->mempool, cchunk.length);
-        cdata = pa_memblock_acquire(cchunk.memblock);
-
-        u->ec->record(u->ec, rdata, cdata);
-
         if (u->save_aec) {
             if (u->drift_file)
                 fprintf(u->drift_file, "c %d\n", u->source_output_blocksize);
             if (u->captured_file)
                 unused = fwrite(rdata, 1, u->source_output_blocksize, u->captured_file);
-            if (u->canceled_file)
+        }
+
+        if (u->ec_thread)
+            ec_thread_submit(u, EC_JOB_RECORD, rdata, NULL);
+        else {
+            cchunk.index = 0;
+            cchunk.length = u->source_output_blocksize;
+            cchunk.memblock = pa_memblock_new(u->source->core->mempool, cchunk.length);
+            cdata = pa_memblock_acquire(cchunk.memblock);
+
+            start = pa_rtclock_now();
+            u->ec->record(u->ec, rdata, cdata);
+            ec_stats_add(u, pa_rtclock_now() - start, true);
+
+            if (u->save_aec && u->canceled_file)
                 unused = fwrite(cdata, 1, u->source_output_blocksize, u->canceled_file);
+
+            pa_memblock_release(cchunk.memblock);
+
+            pa_source_post(u->source, &cchunk);
+            pa_memblock_unref(cchunk.memblock);
         }
 
-        pa_memblock_release(cchunk.memblock);
         pa_memblock_release(rchunk.memblock);
-
         pa_memblock_unref(rchunk.memblock);
 
-        pa_source_post(u->source, &cchunk);
-        pa_memblock_unref(cchunk.memblock);
-
         pa_memblockq_drop(u->source_memblockq, u->source_output_blocksize);
         rlen -= u->source_output_blocksize;
     }
@@ -814,6 +1111,7 @@ static void do_push(struct userdata *u) {
     size_t rlen, plen;
     pa_memchunk rchunk, pchunk, cchunk;
     uint8_t *rdata, *pdata, *cdata;
+    pa_usec_t start;
     int unused PA_GCC_UNUSED;
 
     rlen = pa_memblockq_get_length(u->source_memblockq);
@@ -834,11 +1132,6 @@ static void do_push(struct userdata *u) {
         pdata = pa_memblock_acquire(pchunk.memblock);
         pdata += pchunk.index;
 
-        cchunk.index = 0;
-        cchunk.length = u->source_blocksize;
-        cchunk.memblock = pa_memblock_new(u->source->core->mempool, cchunk.length);
-        cdata = pa_memblock_acquire(cchunk.memblock);
-
         if (u->save_aec) {
             if (u->captured_file)
                 unused = fwrite(rdata, 1, u->source_output_blocksize, u->captured_file);
@@ -846,15 +1139,29 @@ static void do_push(struct userdata *u) {
                 unused = fwrite(pdata, 1, u->sink_blocksize, u->played_file);
         }
 
-        /* perform echo cancellation */
-        u->ec->run(u->ec, rdata, pdata, cdata);
+        if (u->ec_thread) {
+            /* the canceller thread hands the result back later */
+            ec_thread_submit(u, EC_JOB_RUN, rdata, pdata);
+            cchunk.memblock = NULL;
+        } else {
+            cchunk.index = 0;
+            cchunk.length = u->source_blocksize;
+            cchunk.memblock = pa_memblock_new(u->source->core->mempool, cchunk.length);
+            cdata = pa_memblock_acquire(cchunk.memblock);
+
+            /* perform echo cancellation */
+            start = pa_rtclock_now();
+            u->ec->run(u->ec, rdata, pdata, cdata);
+            ec_stats_add(u, pa_rtclock_now() - start, true);
+
+            if (u->save_aec) {
+                if (u->canceled_file)
+                    unused = fwrite(cdata, 1, u->source_blocksize, u->canceled_file);
+            }
 
-        if (u->save_aec) {
-            if (u->canceled_file)
-                unused = fwrite(cdata, 1, u->source_blocksize, u->canceled_file);
+            pa_memblock_release(cchunk.memblock);
         }
 
-        pa_memblock_release(cchunk.memblock);
         pa_memblock_release(pchunk.memblock);
         pa_memblock_release(rchunk.memblock);
 
@@ -873,8 +1180,10 @@ static void do_push(struct userdata *u) {
             plen = 0;
 
         /* forward the (echo-canceled) data to the virtual source */
-        pa_source_post(u->source, &cchunk);
-        pa_memblock_unref(cchunk.memblock);
+        if (cchunk.memblock) {
+            pa_source_post(u->source, &cchunk);
+            pa_memblock_unref(cchunk.memblock);
+        }
     }
 }
 
@@ -895,6 +1204,12 @@ static void source_output_push_cb(pa_source_output *o, const pa_memchunk *chunk)
 
     if (PA_UNLIKELY(u->source->thread_info.state != PA_SOURCE_RUNNING ||
                     u->sink->thread_info.state != PA_SINK_RUNNING)) {
+        if (u->ec_thread) {
+            /* forget about the blocks in flight */
+            ec_thread_collect(u);
+            ec_thread_expire(u, true, false);
+        }
+
         pa_source_post(u->source, chunk);
         return;
     }
@@ -912,6 +1227,13 @@ static void source_output_push_cb(pa_source_output *o, const pa_memchunk *chunk)
     if (rlen < u->source_output_blocksize)
         return;
 
+    /* The blocks we handed to the canceller thread last time are due now */
+    if (u->ec_thread) {
+        u->ec_generation++;
+        ec_thread_collect(u);
+        ec_thread_expire(u, false, true);
+    }
+
     /* See if we need to drop samples in order to sync */
     if (pa_atomic_cmpxchg (&u->request_resync, 1, 0)) {
         do_resync(u);
@@ -960,6 +1282,8 @@ static void source_output_push_cb(pa_source_output *o, const pa_memchunk *chunk)
         do_push_drift_comp(u);
     else
         do_push(u);
+
+    ec_stats_report(u);
 }
 
 /* Called from sink I/O thread context. */
@@ -1554,14 +1878,29 @@ static int canceller_process_msg_cb(pa_msgobject *o, int code, void *userdata, i
     return 0;
 }
 
-/* Called by the canceller, so source I/O thread context. */
+/* Called by the canceller, so source I/O thread or canceller thread context. */
 void pa_echo_canceller_get_capture_volume(pa_echo_canceller *ec, pa_cvolume *v) {
-    *v = ec->msg->userdata->thread_info.current_volume;
+    struct userdata *u = ec->msg->userdata;
+
+    if (u->ec_thread && pa_thread_self() == u->ec_thread)
+        *v = u->ec_current->volume;
+    else
+        *v = u->thread_info.current_volume;
 }
 
-/* Called by the canceller, so source I/O thread context. */
+/* Called by the canceller, so source I/O thread or canceller thread context.
+ * The canceller thread passes the request back to the source I/O thread with
+ * the job. */
 void pa_echo_canceller_set_capture_volume(pa_echo_canceller *ec, pa_cvolume *v) {
-    if (!pa_cvolume_equal(&ec->msg->userdata->thread_info.current_volume, v)) {
+    struct userdata *u = ec->msg->userdata;
+
+    if (u->ec_thread && pa_thread_self() == u->ec_thread) {
+        u->ec_current->set_volume = true;
+        u->ec_current->new_volume = *v;
+        return;
+    }
+
+    if (!pa_cvolume_equal(&u->thread_info.current_volume, v)) {
         pa_cvolume *vol = pa_xnewdup(pa_cvolume, v, 1);
 
         pa_asyncmsgq_post(pa_thread_mq_get()->outq, PA_MSGOBJECT(ec->msg), ECHO_CANCELLER_MESSAGE_SET_VOLUME, vol, 0, NULL,
@@ -1657,6 +1996,7 @@ int pa__init(pa_module*m) {
     pa_memchunk silence;
     uint32_t temp;
     uint32_t nframes = 0;
+    bool aec_thread = DEFAULT_AEC_THREAD;
 
     pa_assert(m);
 
@@ -1740,6 +2080,11 @@ int pa__init(pa_module*m) {
         goto fail;
     }
 
+    if (pa_modargs_get_value_boolean(ma, "aec_thread", &aec_thread) < 0) {
+        pa_log("Failed to parse aec_thread value");
+        goto fail;
+    }
+
     if (init_common(ma, u, &source_ss, &source_map) < 0)
         goto fail;
 
@@ -1770,6 +2115,29 @@ int pa__init(pa_module*m) {
     if (u->ec->params.drift_compensation)
         pa_assert(u->ec->set_drift);
 
+    if (aec_thread) {
+        unsigned i;
+
+        for (i = 0; i < EC_THREAD_JOBS; i++) {
+            u->ec_job[i].rdata = pa_xmalloc(u->source_output_blocksize);
+            u->ec_job[i].pdata = pa_xmalloc(u->sink_blocksize);
+            u->ec_job[i].cdata = pa_xmalloc(PA_MAX(u->source_blocksize, u->source_output_blocksize));
+        }
+
+        u->ec_jobs = pa_asyncq_new(EC_THREAD_JOBS);
+        u->ec_done = pa_asyncq_new(EC_THREAD_JOBS);
+
+        if (!u->ec_jobs || !u->ec_done) {
+            pa_log("Failed to create canceller thread queues");
+            goto fail;
+        }
+
+        if (!(u->ec_thread = pa_thread_new("echo-cancel", ec_thread_func, u))) {
+            pa_log("Failed to create canceller thread");
+            goto fail;
+        }
+    }
+
     /* Create source */
     pa_source_new_data_init(&source_data);
     source_data.driver = __FILE__;
@@ -2023,6 +2391,7 @@ int pa__get_n_used(pa_module *m) {
 /* Called from main context. */
 void pa__done(pa_module*m) {
     struct userdata *u;
+    unsigned i;
 
     pa_assert(m);
 
@@ -2062,6 +2431,23 @@ void pa__done(pa_module*m) {
     if (u->sink_memblockq)
         pa_memblockq_free(u->sink_memblockq);
 
+    /* Nothing queues jobs anymore, so we can take over the writing side */
+    if (u->ec_thread) {
+        pa_asyncq_push(u->ec_jobs, &u->ec_quit, true);
+        pa_thread_free(u->ec_thread);
+    }
+
+    if (u->ec_jobs)
+        pa_asyncq_free(u->ec_jobs, NULL);
+    if (u->ec_done)
+        pa_asyncq_free(u->ec_done, NULL);
+
+    for (i = 0; i < EC_THREAD_JOBS; i++) {
+        pa_xfree(u->ec_job[i].rdata);
+        pa_xfree(u->ec_job[i].pdata);
+        pa_xfree(u->ec_job[i].cdata);
+    }
+
     if (u->ec) {
         if (u->ec->done)
             u->ec->done(u->ec);
@@ -2101,6 +2487,8 @@ int main(int argc, char* argv[]) {
     char c;
     float drift;
     uint32_t nframes;
+    pa_usec_t start, run_usec = 0;
+    uint64_t n_bytes = 0;
 
     if (!getenv("MAKE_CHECK"))
         pa_log_set_level(PA_LOG_DEBUG);
@@ -2128,8 +2516,14 @@ int main(int argc, char* argv[]) {
     }
 
     u.core = pa_xnew0(pa_core, 1);
-    u.core->cpu_info.cpu_type = PA_CPU_X86;
-    u.core->cpu_info.flags.x86 |= PA_CPU_X86_SSE;
+    /* Same as the daemon, PULSE_NO_SIMD=1 benchmarks the plain C code */
+    u.core->cpu_info.cpu_type = PA_CPU_UNDEFINED;
+    if (!getenv("PULSE_NO_SIMD")) {
+        if (pa_cpu_init_x86(&u.core->cpu_info.flags.x86))
+            u.core->cpu_info.cpu_type = PA_CPU_X86;
+        if (pa_cpu_init_arm(&u.core->cpu_info.flags.arm))
+            u.core->cpu_info.cpu_type = PA_CPU_ARM;
+    }
 
     if (!(ma = pa_modargs_new(argc > 4 ? argv[4] : NULL, valid_modargs))) {
         pa_log("Failed to parse module arguments.");
@@ -2186,7 +2580,10 @@ int main(int argc, char* argv[]) {
                 goto fail;
             }
 
+            start = pa_rtclock_now();
             u.ec->run(u.ec, rdata, pdata, cdata);
+            run_usec += pa_rtclock_now() - start;
+            n_bytes += u.source_output_blocksize;
 
             unused = fwrite(cdata, u.source_blocksize, 1, u.canceled_file);
         }
@@ -2214,7 +2611,10 @@ int main(int argc, char* argv[]) {
                         goto fail;
                     }
 
+                    start = pa_rtclock_now();
                     u.ec->record(u.ec, rdata, cdata);
+                    run_usec += pa_rtclock_now() - start;
+                    n_bytes += i;
 
                     unused = fwrite(cdata, i, 1, u.canceled_file);
 
@@ -2231,7 +2631,9 @@ int main(int argc, char* argv[]) {
                         goto fail;
                     }
 
+                    start = pa_rtclock_now();
                     u.ec->play(u.ec, pdata);
+                    run_usec += pa_rtclock_now() - start;
 
                     break;
             }
@@ -2243,6 +2645,15 @@ int main(int argc, char* argv[]) {
             pa_log("All playback data was not consumed");
     }
 
+    if (n_bytes > 0) {
+        pa_usec_t audio_usec = pa_bytes_to_usec(n_bytes, &source_output_ss);
+
+        pa_log_info("Processed %0.1f s of audio in %0.3f s, %0.1f%% of real time, %0.1f us per block.",
+                    (double) audio_usec / PA_USEC_PER_SEC, (double) run_usec / PA_USEC_PER_SEC,
+                    audio_usec > 0 ? 100.0 * run_usec / audio_usec : 0.0,
+                    (double) run_usec * u.source_output_blocksize / n_bytes);
+    }
+
     u.ec->done(u.ec);
 
 out:
@@ -0,0 +1,251 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/dynarray.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "filter-graph.h"
+
+struct pa_filter_graph {
+    pa_sample_spec sample_spec;
+    unsigned max_frames;
+
+    pa_dynarray *nodes;
+
+    /* Two sets of planes the nodes ping-pong between */
+    float *scratch;
+    float *planes[2][PA_CHANNELS_MAX];
+};
+
+static const struct {
+    const char *name;
+    pa_filter_node_new_func_t new_func;
+} node_types[] = {
+    { "ladspa", pa_ladspa_node_new },
+};
+
+static const char* const node_valid_modargs[] = {
+    "type",
+    "name",
+    "plugin",
+    "label",
+    "control",
+    NULL
+};
+
+static void node_free(void *p) {
+    pa_filter_node *n = p;
+    char *name;
+
+    pa_assert(n);
+
+    name = n->name;
+    n->free(n);
+    pa_xfree(name);
+}
+
+pa_filter_graph *pa_filter_graph_new(const pa_sample_spec *ss, unsigned max_frames) {
+    pa_filter_graph *g;
+    unsigned i, c;
+
+    pa_assert(ss);
+    pa_assert(pa_sample_spec_valid(ss));
+    pa_assert(ss->format == PA_SAMPLE_FLOAT32NE);
+    pa_assert(max_frames > 0);
+
+    g = pa_xnew0(pa_filter_graph, 1);
+    g->sample_spec = *ss;
+    g->max_frames = max_frames;
+    g->nodes = pa_dynarray_new(node_free);
+
+    g->scratch = pa_xnew(float, 2 * ss->channels * max_frames);
+
+    for (i = 0; i < 2; i++)
+        for (c = 0; c < ss->channels; c++)
+            g->planes[i][c] = g->scratch + (i * ss->channels + c) * max_frames;
+
+    return g;
+}
+
+void pa_filter_graph_free(pa_filter_graph *g) {
+    pa_assert(g);
+
+    pa_dynarray_free(g->nodes);
+    pa_xfree(g->scratch);
+    pa_xfree(g);
+}
+
+static pa_filter_node *node_new_from_string(const char *args, const pa_sample_spec *ss, unsigned idx) {
+    pa_modargs *ma;
+    pa_filter_node *n = NULL;
+    const char *type;
+    unsigned i;
+
+    if (!(ma = pa_modargs_new(args, node_valid_modargs))) {
+        pa_log("Failed to parse arguments of filter node %u: %s", idx, args);
+        return NULL;
+    }
+
+    type = pa_modargs_get_value(ma, "type", "ladspa");
+
+    for (i = 0; i < PA_ELEMENTSOF(node_types); i++)
+        if (pa_streq(node_types[i].name, type))
+            break;
+
+    if (i >= PA_ELEMENTSOF(node_types)) {
+        pa_log("Unknown filter node type '%s'.", type);
+        goto finish;
+    }
+
+    if (!(n = node_types[i].new_func(ma, ss))) {
+        pa_log("Failed to create filter node %u.", idx);
+        goto finish;
+    }
+
+    if (!n->name) {
+        const char *name;
+
+        if ((name = pa_modargs_get_value(ma, "name", NULL)))
+            n->name = pa_xstrdup(name);
+        else
+            n->name = pa_sprintf_malloc("%s%u", type, idx);
+    }
+
+finish:
+    pa_modargs_free(ma);
+
+    return n;
+}
+
+pa_filter_graph *pa_filter_graph_new_from_string(const char *nodes, const pa_sample_spec *ss, unsigned max_frames) {
+    pa_filter_graph *g;
+    const char *state = NULL;
+    char *args;
+
+    pa_assert(nodes);
+
+    g = pa_filter_graph_new(ss, max_frames);
+
+    while ((args = pa_split(nodes, "|", &state))) {
+        pa_filter_node *n;
+
+        n = node_new_from_string(args, ss, pa_filter_graph_get_n_nodes(g));
+        pa_xfree(args);
+
+        if (!n) {
+            pa_filter_graph_free(g);
+            return NULL;
+        }
+
+        pa_filter_graph_append(g, n);
+    }
+
+    if (pa_filter_graph_get_n_nodes(g) <= 0) {
+        pa_log("No filter nodes specified.");
+        pa_filter_graph_free(g);
+        return NULL;
+    }
+
+    return g;
+}
+
+void pa_filter_graph_append(pa_filter_graph *g, pa_filter_node *n) {
+    pa_assert(g);
+    pa_assert(n);
+    pa_assert(n->process);
+    pa_assert(n->free);
+
+    if (!n->name)
+        n->name = pa_sprintf_malloc("node%u", pa_dynarray_size(g->nodes));
+
+    pa_dynarray_append(g->nodes, n);
+
+    pa_log_debug("Added filter node %s.", n->name);
+}
+
+unsigned pa_filter_graph_get_n_nodes(pa_filter_graph *g) {
+    pa_assert(g);
+
+    return pa_dynarray_size(g->nodes);
+}
+
+pa_filter_node *pa_filter_graph_get_node(pa_filter_graph *g, unsigned idx) {
+    pa_assert(g);
+    pa_assert(idx < pa_dynarray_size(g->nodes));
+
+    return pa_dynarray_get(g->nodes, idx);
+}
+
+/* Called from IO thread context */
+void pa_filter_graph_process(pa_filter_graph *g, float * const in[], float * const out[], unsigned n_frames) {
+    unsigned i, n_nodes;
+    float * const *src;
+
+    pa_assert(g);
+    pa_assert(in);
+    pa_assert(out);
+    pa_assert(n_frames <= g->max_frames);
+
+    n_nodes = pa_dynarray_size(g->nodes);
+
+    if (n_nodes == 0) {
+        unsigned c;
+
+        for (c = 0; c < g->sample_spec.channels; c++)
+            memcpy(out[c], in[c], n_frames * sizeof(float));
+
+        return;
+    }
+
+    /* The first node reads the input, the last one writes the output,
+     * everything in between goes through the scratch planes */
+    src = in;
+
+    for (i = 0; i < n_nodes; i++) {
+        pa_filter_node *n = pa_dynarray_get(g->nodes, i);
+        float * const *dst = i + 1 < n_nodes ? g->planes[i & 1] : out;
+
+        n->process(n, src, dst, n_frames);
+        src = dst;
+    }
+}
+
+/* Called from IO thread context */
+void pa_filter_graph_reset(pa_filter_graph *g) {
+    unsigned i;
+
+    pa_assert(g);
+
+    for (i = 0; i < pa_dynarray_size(g->nodes); i++) {
+        pa_filter_node *n = pa_dynarray_get(g->nodes, i);
+
+        if (n->reset)
+            n->reset(n);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef foofiltergraphhfoo
+#define foofiltergraphhfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <pulse/sample.h>
+
+#include <pulsecore/modargs.h>
+
+/* A filter graph runs a number of DSP nodes as plain function calls
+ * from a single sink input, instead of stacking one virtual sink per
+ * filter. All nodes work on planar float data and share the graph's
+ * scratch buffers. For now the graph is a linear chain and every node
+ * keeps the number of channels. */
+
+typedef struct pa_filter_node pa_filter_node;
+typedef struct pa_filter_graph pa_filter_graph;
+
+struct pa_filter_node {
+    /* Used in log messages, set by the graph if the node has none.
+     * Freed by the graph. */
+    char *name;
+
+    /* Processes n frames with one plane per channel from in to out.
+     * in and out never overlap. Called from IO thread context. */
+    void (*process) (pa_filter_node *n, float * const in[], float * const out[], unsigned n_frames);
+
+    /* Drops all history, e.g. after a rewind. Called from IO thread
+     * context, may be NULL. */
+    void (*reset) (pa_filter_node *n);
+
+    /* Frees the node except for the name, called from main context */
+    void (*free) (pa_filter_node *n);
+
+    void *userdata;
+};
+
+/* Creates a node from its arguments. The node type is picked with the
+ * "type" argument, see pa_filter_graph_new_from_string(). */
+typedef pa_filter_node* (*pa_filter_node_new_func_t) (pa_modargs *ma, const pa_sample_spec *ss);
+
+pa_filter_graph *pa_filter_graph_new(const pa_sample_spec *ss, unsigned max_frames);
+void pa_filter_graph_free(pa_filter_graph *g);
+
+/* Creates a graph from a list of node descriptions separated by
+ * '|'. Every description is a list of key=value pairs like module
+ * arguments, e.g.
+ *
+ *     type=ladspa plugin=amp label=amp_mono control=2 | plugin=delay label=delay_5s control=0.2,0.5
+ *
+ * The type defaults to "ladspa". */
+pa_filter_graph *pa_filter_graph_new_from_string(const char *nodes, const pa_sample_spec *ss, unsigned max_frames);
+
+/* The graph takes ownership of the node */
+void pa_filter_graph_append(pa_filter_graph *g, pa_filter_node *n);
+
+unsigned pa_filter_graph_get_n_nodes(pa_filter_graph *g);
+pa_filter_node *pa_filter_graph_get_node(pa_filter_graph *g, unsigned idx);
+
+/* Called from IO thread context, n_frames may not exceed max_frames */
+void pa_filter_graph_process(pa_filter_graph *g, float * const in[], float * const out[], unsigned n_frames);
+void pa_filter_graph_reset(pa_filter_graph *g);
+
+/* Node types */
+pa_filter_node *pa_ladspa_node_new(pa_modargs *ma, const pa_sample_spec *ss);
+
+#endif
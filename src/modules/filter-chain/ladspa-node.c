@@ -0,0 +1,314 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ltdl.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/ltdl-helper.h>
+#include <pulsecore/macro.h>
+
+#include "filter-graph.h"
+#include "../ladspa-util.h"
+
+/* Wraps a LADSPA plugin as a filter node. Like module-ladspa-sink we
+ * run as many instances of the plugin as needed to cover all channels,
+ * every instance processes as many channels as the plugin has audio
+ * ports. */
+
+struct ladspa_node {
+    pa_filter_node node;
+
+    lt_dlhandle dl;
+    const LADSPA_Descriptor *descriptor;
+
+    unsigned long n_ports, n_handles;
+    unsigned long input_port[PA_CHANNELS_MAX], output_port[PA_CHANNELS_MAX];
+    LADSPA_Handle handle[PA_CHANNELS_MAX];
+
+    LADSPA_Data *control;
+    unsigned long n_control;
+
+    /* We don't care about control out ports, they all write here */
+    LADSPA_Data control_out;
+};
+
+static void node_process(pa_filter_node *n, float * const in[], float * const out[], unsigned n_frames) {
+    struct ladspa_node *l = n->userdata;
+    unsigned long h, c;
+
+    for (h = 0; h < l->n_handles; h++) {
+        for (c = 0; c < l->n_ports; c++) {
+            l->descriptor->connect_port(l->handle[h], l->input_port[c], in[h * l->n_ports + c]);
+            l->descriptor->connect_port(l->handle[h], l->output_port[c], out[h * l->n_ports + c]);
+        }
+
+        l->descriptor->run(l->handle[h], n_frames);
+    }
+}
+
+static void node_reset(pa_filter_node *n) {
+    struct ladspa_node *l = n->userdata;
+    unsigned long h;
+
+    for (h = 0; h < l->n_handles; h++) {
+        if (l->descriptor->deactivate)
+            l->descriptor->deactivate(l->handle[h]);
+        if (l->descriptor->activate)
+            l->descriptor->activate(l->handle[h]);
+    }
+}
+
+static void node_free(pa_filter_node *n) {
+    struct ladspa_node *l = n->userdata;
+    unsigned long h;
+
+    for (h = 0; h < l->n_handles; h++) {
+        if (!l->handle[h])
+            continue;
+
+        if (l->descriptor->deactivate)
+            l->descriptor->deactivate(l->handle[h]);
+        l->descriptor->cleanup(l->handle[h]);
+    }
+
+    if (l->dl)
+        lt_dlclose(l->dl);
+
+    pa_xfree(l->control);
+    pa_xfree(l);
+}
+
+static int control_default(const LADSPA_PortRangeHint *hint, unsigned rate, LADSPA_Data *v) {
+    LADSPA_PortRangeHintDescriptor d = hint->HintDescriptor;
+    LADSPA_Data lower = hint->LowerBound, upper = hint->UpperBound;
+    double w;
+
+    if (!LADSPA_IS_HINT_HAS_DEFAULT(d))
+        return -1;
+
+    if (LADSPA_IS_HINT_SAMPLE_RATE(d)) {
+        lower *= (LADSPA_Data) rate;
+        upper *= (LADSPA_Data) rate;
+    }
+
+    switch (d & LADSPA_HINT_DEFAULT_MASK) {
+        case LADSPA_HINT_DEFAULT_MINIMUM: *v = lower; return 0;
+        case LADSPA_HINT_DEFAULT_MAXIMUM: *v = upper; return 0;
+        case LADSPA_HINT_DEFAULT_0: *v = 0; return 0;
+        case LADSPA_HINT_DEFAULT_1: *v = 1; return 0;
+        case LADSPA_HINT_DEFAULT_100: *v = 100; return 0;
+        case LADSPA_HINT_DEFAULT_440: *v = 440; return 0;
+        case LADSPA_HINT_DEFAULT_LOW: w = 0.25; break;
+        case LADSPA_HINT_DEFAULT_MIDDLE: w = 0.5; break;
+        case LADSPA_HINT_DEFAULT_HIGH: w = 0.75; break;
+        default: return -1;
+    }
+
+    if (LADSPA_IS_HINT_LOGARITHMIC(d))
+        *v = (LADSPA_Data) exp(log(lower) * (1 - w) + log(upper) * w);
+    else
+        *v = (LADSPA_Data) (lower * (1 - w) + upper * w);
+
+    return 0;
+}
+
+static int control_check(const LADSPA_PortRangeHint *hint, unsigned rate, double v) {
+    LADSPA_PortRangeHintDescriptor d = hint->HintDescriptor;
+    LADSPA_Data lower = hint->LowerBound, upper = hint->UpperBound;
+
+    if (LADSPA_IS_HINT_SAMPLE_RATE(d)) {
+        lower *= (LADSPA_Data) rate;
+        upper *= (LADSPA_Data) rate;
+    }
+
+    if (LADSPA_IS_HINT_BOUNDED_ABOVE(d) && v > upper) {
+        pa_log("Control value %f over upper bound %f.", v, upper);
+        return -1;
+    }
+
+    if (LADSPA_IS_HINT_BOUNDED_BELOW(d) && v < lower) {
+        pa_log("Control value %f below lower bound %f.", v, lower);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Reads the comma separated control values, empty entries select the
+ * plugin's default. */
+static int parse_controls(struct ladspa_node *l, const char *cdata, unsigned rate) {
+    const LADSPA_Descriptor *d = l->descriptor;
+    const char *state = NULL;
+    unsigned long p, h = 0;
+
+    if (l->n_control <= 0)
+        return 0;
+
+    l->control = pa_xnew0(LADSPA_Data, l->n_control);
+
+    for (p = 0; p < d->PortCount; p++) {
+        char *k = NULL;
+        double f;
+
+        if (!LADSPA_IS_PORT_CONTROL(d->PortDescriptors[p]) || LADSPA_IS_PORT_OUTPUT(d->PortDescriptors[p]))
+            continue;
+
+        if (cdata)
+            k = pa_split(cdata, ",", &state);
+
+        if (!k || !*k) {
+            pa_xfree(k);
+
+            if (control_default(&d->PortRangeHints[p], rate, &l->control[h]) < 0) {
+                pa_log("No value for control port %s and the plugin defines no default.", d->PortNames[p]);
+                return -1;
+            }
+        } else {
+            if (pa_atod(k, &f) < 0) {
+                pa_log("Failed to parse control value '%s'.", k);
+                pa_xfree(k);
+                return -1;
+            }
+
+            pa_xfree(k);
+
+            if (control_check(&d->PortRangeHints[p], rate, f) < 0)
+                return -1;
+
+            l->control[h] = LADSPA_IS_HINT_INTEGER(d->PortRangeHints[p].HintDescriptor) ? roundf((float) f) : (LADSPA_Data) f;
+        }
+
+        pa_log_debug("Binding %f to port %s", l->control[h], d->PortNames[p]);
+        h++;
+    }
+
+    if (cdata) {
+        char *k;
+
+        if ((k = pa_split(cdata, ",", &state))) {
+            pa_log("Too many control values passed, %lu expected.", l->n_control);
+            pa_xfree(k);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+pa_filter_node *pa_ladspa_node_new(pa_modargs *ma, const pa_sample_spec *ss) {
+    struct ladspa_node *l;
+    const char *plugin, *label;
+    const LADSPA_Descriptor *d;
+    unsigned long p, h, n_inputs = 0, n_outputs = 0;
+
+    pa_assert(ma);
+    pa_assert(ss);
+
+    pa_assert_cc(sizeof(LADSPA_Data) == sizeof(float));
+
+    if (!(plugin = pa_modargs_get_value(ma, "plugin", NULL))) {
+        pa_log("Missing LADSPA plugin name");
+        return NULL;
+    }
+
+    if (!(label = pa_modargs_get_value(ma, "label", NULL))) {
+        pa_log("Missing LADSPA plugin label");
+        return NULL;
+    }
+
+    l = pa_xnew0(struct ladspa_node, 1);
+    l->node.process = node_process;
+    l->node.reset = node_reset;
+    l->node.free = node_free;
+    l->node.userdata = l;
+
+    if (!(d = pa_ladspa_load(plugin, label, &l->dl)))
+        goto fail;
+
+    l->descriptor = d;
+
+    for (p = 0; p < d->PortCount; p++) {
+        if (LADSPA_IS_PORT_AUDIO(d->PortDescriptors[p])) {
+            if (LADSPA_IS_PORT_INPUT(d->PortDescriptors[p]) && n_inputs < PA_CHANNELS_MAX)
+                l->input_port[n_inputs++] = p;
+            else if (LADSPA_IS_PORT_OUTPUT(d->PortDescriptors[p]) && n_outputs < PA_CHANNELS_MAX)
+                l->output_port[n_outputs++] = p;
+        } else if (LADSPA_IS_PORT_CONTROL(d->PortDescriptors[p]) && LADSPA_IS_PORT_INPUT(d->PortDescriptors[p]))
+            l->n_control++;
+    }
+
+    if (n_inputs == 0 || n_inputs != n_outputs) {
+        pa_log("Plugin %s needs to have the same number of audio inputs and outputs, has %lu and %lu.", d->Label, n_inputs, n_outputs);
+        goto fail;
+    }
+
+    if (ss->channels % n_inputs != 0) {
+        pa_log("Cannot handle %u channels with a plugin that has %lu audio ports.", ss->channels, n_inputs);
+        goto fail;
+    }
+
+    l->n_ports = n_inputs;
+
+    if (parse_controls(l, pa_modargs_get_value(ma, "control", NULL), ss->rate) < 0)
+        goto fail;
+
+    l->n_handles = ss->channels / l->n_ports;
+
+    for (h = 0; h < l->n_handles; h++) {
+        unsigned long c = 0;
+
+        if (!(l->handle[h] = d->instantiate(d, ss->rate))) {
+            pa_log("Failed to instantiate plugin %s with label %s", plugin, d->Label);
+            goto fail;
+        }
+
+        for (p = 0; p < d->PortCount; p++) {
+            if (!LADSPA_IS_PORT_CONTROL(d->PortDescriptors[p]))
+                continue;
+
+            if (LADSPA_IS_PORT_OUTPUT(d->PortDescriptors[p]))
+                d->connect_port(l->handle[h], p, &l->control_out);
+            else
+                d->connect_port(l->handle[h], p, &l->control[c++]);
+        }
+
+        if (d->activate)
+            d->activate(l->handle[h]);
+    }
+
+    pa_log_debug("LADSPA node %s (%s): %lu instances with %lu ports each, %lu controls.",
+                 d->Label, d->Name, l->n_handles, l->n_ports, l->n_control);
+
+    return &l->node;
+
+fail:
+    node_free(&l->node);
+    return NULL;
+}
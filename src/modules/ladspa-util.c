@@ -0,0 +1,103 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/ltdl-helper.h>
+#include <pulsecore/macro.h>
+
+#include "ladspa-util.h"
+
+static lt_dlhandle open_plugin(const char *plugin) {
+    const char *e, *state = NULL;
+    char *dir;
+    lt_dlhandle dl = NULL;
+
+    /* Paths are used as they are */
+    if (strchr(plugin, '/'))
+        return lt_dlopenext(plugin);
+
+    if (!(e = getenv("LADSPA_PATH")))
+        e = LADSPA_PATH;
+
+    /* Try every directory on our own rather than replacing the global
+     * ltdl search path, which would race with other modules being
+     * loaded at the same time */
+    while (!dl && (dir = pa_split(e, ":", &state))) {
+        char *fn;
+
+        fn = pa_sprintf_malloc("%s" PA_PATH_SEP "%s", dir, plugin);
+        dl = lt_dlopenext(fn);
+
+        pa_xfree(fn);
+        pa_xfree(dir);
+    }
+
+    /* Finally, try the default search path of ltdl */
+    if (!dl)
+        dl = lt_dlopenext(plugin);
+
+    return dl;
+}
+
+const LADSPA_Descriptor *pa_ladspa_load(const char *plugin, const char *label, lt_dlhandle *dl) {
+    LADSPA_Descriptor_Function descriptor_func;
+    const LADSPA_Descriptor *d;
+    unsigned long i;
+
+    pa_assert(plugin);
+    pa_assert(label);
+    pa_assert(dl);
+
+    if (!(*dl = open_plugin(plugin))) {
+        pa_log("Failed to load LADSPA plugin: %s", lt_dlerror());
+        return NULL;
+    }
+
+    if (!(descriptor_func = (LADSPA_Descriptor_Function) pa_load_sym(*dl, NULL, "ladspa_descriptor"))) {
+        pa_log("LADSPA module lacks ladspa_descriptor() symbol.");
+        goto fail;
+    }
+
+    for (i = 0;; i++) {
+
+        if (!(d = descriptor_func(i))) {
+            pa_log("Failed to find plugin label '%s' in plugin '%s'.", label, plugin);
+            goto fail;
+        }
+
+        if (pa_streq(d->Label, label))
+            return d;
+    }
+
+fail:
+    lt_dlclose(*dl);
+    *dl = NULL;
+
+    return NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef fooladspautilhfoo
+#define fooladspautilhfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <ltdl.h>
+
+#include "ladspa.h"
+
+/* Loads the LADSPA plugin library 'plugin' and returns the descriptor
+ * of the plugin with the specified label. Plugin names without a
+ * directory are looked up in $LADSPA_PATH, or in LADSPA_PATH as set at
+ * compile time. On success the library handle is returned in *dl and
+ * has to be closed with lt_dlclose() by the caller. */
+const LADSPA_Descriptor *pa_ladspa_load(const char *plugin, const char *label, lt_dlhandle *dl);
+
+#endif
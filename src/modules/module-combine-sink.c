@@ -30,6 +30,7 @@
 #include <pulse/timeval.h>
 #include <pulse/xmalloc.h>
 
+#include <pulsecore/atomic.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/module.h>
 #include <pulsecore/llist.h>
@@ -70,6 +71,16 @@ PA_MODULE_USAGE(
 
 #define DEFAULT_ADJUST_TIME_USEC (10*PA_USEC_PER_SEC)
 
+/* How many times per adjust_time the IO thread corrects the rates */
+#define ADJUST_STEPS 10
+
+/* Must be a power of two */
+#define RING_CHUNKS 1024
+
+/* How often the sink thread tries to read an output's timing while
+ * the output's thread keeps updating it */
+#define MAX_TIMING_READ_TRIES 100
+
 #define BLOCK_USEC (PA_USEC_PER_MSEC * 200)
 
 static const char* const valid_modargs[] = {
@@ -85,6 +96,16 @@ static const char* const valid_modargs[] = {
     NULL
 };
 
+/* Lock-free ring of rendered chunks from the sink thread to one
+ * output. The sink thread is the only one writing write_idx, the
+ * output's thread the only one writing read_idx. The indexes are free
+ * running and wrap around. */
+struct chunk_ring {
+    pa_memchunk chunks[RING_CHUNKS];
+    pa_atomic_t read_idx, write_idx;
+    pa_atomic_t length;
+};
+
 struct output {
     struct userdata *userdata;
 
@@ -92,15 +113,34 @@ struct output {
     pa_sink_input *sink_input;
     bool ignore_state_change;
 
-    pa_asyncmsgq *inq,    /* Message queue from the sink thread to this sink input */
-                 *outq;   /* Message queue from this sink input to the sink thread */
-    pa_rtpoll_item *inq_rtpoll_item_read, *inq_rtpoll_item_write;
+    pa_asyncmsgq *outq;   /* Message queue from this sink input to the sink thread */
     pa_rtpoll_item *outq_rtpoll_item_read, *outq_rtpoll_item_write;
 
+    /* Rendered data from the sink thread to this sink input */
+    struct chunk_ring ring;
+
+    /* Whether this output's sink is opened, mirrored from the main
+     * thread. While it isn't, the sink thread passes no data to the
+     * output and sets flush, which makes the output's thread drop
+     * whatever is still queued the next time it asks for data. */
+    pa_atomic_t sink_opened;
+    pa_atomic_t flush;
+
     pa_memblockq *memblockq;
 
-    /* For communication of the stream latencies to the main thread */
+    /* Latency of the data this sink input already took out of the
+     * ring, measured by its thread whenever it pops. timing_seq is
+     * odd while an update is in progress. */
+    pa_atomic_t timing_seq;
+    pa_usec_t timing_timestamp, timing_latency, timing_sink_latency;
+
+    /* Managed by the sink thread */
     pa_usec_t total_latency;
+    bool total_latency_valid;
+
+    /* The rate picked by the sink thread, applied by this sink input's
+     * thread and mirrored to the main thread */
+    pa_atomic_t rate;
 
     /* For communication of the stream parameters to the sink thread */
     pa_atomic_t max_request;
@@ -141,6 +181,7 @@ struct userdata {
         bool in_null_mode;
         pa_smoother *smoother;
         uint64_t counter;
+        pa_usec_t adjust_timestamp;
     } thread_info;
 };
 
@@ -148,44 +189,114 @@ enum {
     SINK_MESSAGE_ADD_OUTPUT = PA_SINK_MESSAGE_MAX,
     SINK_MESSAGE_REMOVE_OUTPUT,
     SINK_MESSAGE_NEED,
-    SINK_MESSAGE_UPDATE_LATENCY,
     SINK_MESSAGE_UPDATE_MAX_REQUEST,
     SINK_MESSAGE_UPDATE_REQUESTED_LATENCY
 };
 
-enum {
-    SINK_INPUT_MESSAGE_POST = PA_SINK_INPUT_MESSAGE_MAX,
-};
-
 static void output_disable(struct output *o);
 static void output_enable(struct output *o);
 static void output_free(struct output *o);
 static int output_create_sink_input(struct output *o);
 
-static void adjust_rates(struct userdata *u) {
+/* Called from the sink thread */
+static bool chunk_ring_push(struct chunk_ring *r, const pa_memchunk *chunk) {
+    unsigned w;
+
+    w = (unsigned) pa_atomic_load(&r->write_idx);
+
+    if (w - (unsigned) pa_atomic_load(&r->read_idx) >= RING_CHUNKS)
+        return false;
+
+    r->chunks[w & (RING_CHUNKS - 1)] = *chunk;
+    pa_memblock_ref(chunk->memblock);
+
+    pa_atomic_add(&r->length, (int) chunk->length);
+    pa_atomic_store(&r->write_idx, (int) (w + 1));
+
+    return true;
+}
+
+/* Called from the output's thread, or from main context while neither
+ * of the threads accesses the ring */
+static bool chunk_ring_pop(struct chunk_ring *r, pa_memchunk *chunk) {
+    unsigned i;
+
+    i = (unsigned) pa_atomic_load(&r->read_idx);
+
+    if (i == (unsigned) pa_atomic_load(&r->write_idx))
+        return false;
+
+    *chunk = r->chunks[i & (RING_CHUNKS - 1)];
+
+    pa_atomic_sub(&r->length, (int) chunk->length);
+    pa_atomic_store(&r->read_idx, (int) (i + 1));
+
+    return true;
+}
+
+/* Called from the output's thread */
+static void output_set_timing(struct output *o, pa_usec_t timestamp, pa_usec_t latency, pa_usec_t sink_latency) {
+    pa_atomic_inc(&o->timing_seq);
+    o->timing_timestamp = timestamp;
+    o->timing_latency = latency;
+    o->timing_sink_latency = sink_latency;
+    pa_atomic_inc(&o->timing_seq);
+}
+
+/* Called from the sink thread. Returns false if no consistent values
+ * could be read, because the output's thread kept updating them. */
+static bool output_get_timing(struct output *o, pa_usec_t *timestamp, pa_usec_t *latency, pa_usec_t *sink_latency) {
+    unsigned tries;
+    int seq;
+
+    for (tries = 0; tries < MAX_TIMING_READ_TRIES; tries++) {
+        if ((seq = pa_atomic_load(&o->timing_seq)) & 1)
+            continue;
+
+        *timestamp = o->timing_timestamp;
+        *latency = o->timing_latency;
+        *sink_latency = o->timing_sink_latency;
+
+        if (pa_atomic_load(&o->timing_seq) == seq)
+            return true;
+    }
+
+    return false;
+}
+
+/* Called from IO thread context. The total latency of an output is
+ * what is queued in its ring plus what its sink input reported when
+ * it last took data out of the ring, minus the time that passed since
+ * then. The latencies of all outputs are taken at the same time, so
+ * the jumps caused by rendering a new block cancel out when comparing
+ * them. */
+static void adjust_rates(struct userdata *u, pa_usec_t now) {
     struct output *o;
     pa_usec_t max_sink_latency = 0, min_total_latency = (pa_usec_t) -1, target_latency, avg_total_latency = 0;
+    pa_usec_t x, y;
     uint32_t base_rate;
-    uint32_t idx;
     unsigned n = 0;
 
     pa_assert(u);
-    pa_sink_assert_ref(u->sink);
-
-    if (pa_idxset_size(u->outputs) <= 0)
-        return;
+    pa_sink_assert_io_context(u->sink);
 
-    if (!PA_SINK_IS_OPENED(pa_sink_get_state(u->sink)))
-        return;
+    PA_LLIST_FOREACH(o, u->thread_info.active_outputs) {
+        pa_usec_t timestamp, latency, sink_latency;
 
-    PA_IDXSET_FOREACH(o, u->outputs, idx) {
-        pa_usec_t sink_latency;
+        /* Skip outputs that did not ask for data lately, e.g. because
+         * their sink is suspended, and the ones we could not read this
+         * time */
+        o->total_latency_valid =
+            output_get_timing(o, &timestamp, &latency, &sink_latency) &&
+            timestamp > 0 && timestamp + u->adjust_time > now;
 
-        if (!o->sink_input || !PA_SINK_IS_OPENED(pa_sink_get_state(o->sink)))
+        if (!o->total_latency_valid)
             continue;
 
-        o->total_latency = pa_sink_input_get_latency(o->sink_input, &sink_latency);
-        o->total_latency += sink_latency;
+        o->total_latency = pa_bytes_to_usec((uint64_t) pa_atomic_load(&o->ring.length), &u->sink->sample_spec);
+
+        if (timestamp + latency > now)
+            o->total_latency += timestamp + latency - now;
 
         if (sink_latency > max_sink_latency)
             max_sink_latency = sink_latency;
@@ -196,8 +307,6 @@ static void adjust_rates(struct userdata *u) {
         avg_total_latency += o->total_latency;
         n++;
 
-        pa_log_debug("[%s] total=%0.2fms sink=%0.2fms ", o->sink->name, (double) o->total_latency / PA_USEC_PER_MSEC, (double) sink_latency / PA_USEC_PER_MSEC);
-
         if (o->total_latency > 10*PA_USEC_PER_SEC)
             pa_log_warn("[%s] Total latency of output is very high (%0.2fms), most likely the audio timing in one of your drivers is broken.", o->sink->name, (double) o->total_latency / PA_USEC_PER_MSEC);
     }
@@ -209,38 +318,71 @@ static void adjust_rates(struct userdata *u) {
 
     target_latency = max_sink_latency > min_total_latency ? max_sink_latency : min_total_latency;
 
-    pa_log_info("[%s] avg total latency is %0.2f msec.", u->sink->name, (double) avg_total_latency / PA_USEC_PER_MSEC);
-    pa_log_info("[%s] target latency is %0.2f msec.", u->sink->name, (double) target_latency / PA_USEC_PER_MSEC);
-
     base_rate = u->sink->sample_spec.rate;
 
-    PA_IDXSET_FOREACH(o, u->outputs, idx) {
+    PA_LLIST_FOREACH(o, u->thread_info.active_outputs) {
         uint32_t new_rate = base_rate;
-        uint32_t current_rate = o->sink_input->sample_spec.rate;
+        uint32_t current_rate = (uint32_t) pa_atomic_load(&o->rate);
 
-        if (!o->sink_input || !PA_SINK_IS_OPENED(pa_sink_get_state(o->sink)))
+        if (!o->total_latency_valid)
             continue;
 
         if (o->total_latency != target_latency)
             new_rate += (uint32_t) (((double) o->total_latency - (double) target_latency) / (double) u->adjust_time * (double) new_rate);
 
         if (new_rate < (uint32_t) (base_rate*0.8) || new_rate > (uint32_t) (base_rate*1.25)) {
-            pa_log_warn("[%s] sample rates too different, not adjusting (%u vs. %u).", o->sink_input->sink->name, base_rate, new_rate);
+            pa_log_warn("[%s] sample rates too different, not adjusting (%u vs. %u).", o->sink->name, base_rate, new_rate);
             new_rate = base_rate;
         } else {
             if (base_rate < new_rate + 20 && new_rate < base_rate + 20)
               new_rate = base_rate;
             /* Do the adjustment in small steps; 2‰ can be considered inaudible */
-            if (new_rate < (uint32_t) (current_rate*0.998) || new_rate > (uint32_t) (current_rate*1.002)) {
-                pa_log_info("[%s] new rate of %u Hz not within 2‰ of %u Hz, forcing smaller adjustment", o->sink_input->sink->name, new_rate, current_rate);
+            if (new_rate < (uint32_t) (current_rate*0.998) || new_rate > (uint32_t) (current_rate*1.002))
                 new_rate = PA_CLAMP(new_rate, (uint32_t) (current_rate*0.998), (uint32_t) (current_rate*1.002));
-            }
-            pa_log_info("[%s] new rate is %u Hz; ratio is %0.3f; latency is %0.2f msec.", o->sink_input->sink->name, new_rate, (double) new_rate / base_rate, (double) o->total_latency / PA_USEC_PER_MSEC);
         }
-        pa_sink_input_set_rate(o->sink_input, new_rate);
+
+        if (new_rate != current_rate) {
+            pa_log_debug("[%s] new rate is %u Hz; ratio is %0.3f; latency is %0.2f msec, target %0.2f msec.", o->sink->name, new_rate,
+                         (double) new_rate / base_rate, (double) o->total_latency / PA_USEC_PER_MSEC, (double) target_latency / PA_USEC_PER_MSEC);
+            pa_atomic_store(&o->rate, (int) new_rate);
+        }
     }
 
-    pa_asyncmsgq_send(u->sink->asyncmsgq, PA_MSGOBJECT(u->sink), SINK_MESSAGE_UPDATE_LATENCY, NULL, (int64_t) avg_total_latency, NULL);
+    /* Update the smoother with the average latency of the outputs */
+    x = pa_rtclock_now();
+    y = pa_bytes_to_usec(u->thread_info.counter, &u->sink->sample_spec);
+
+    if (y > avg_total_latency)
+        y -= avg_total_latency;
+    else
+        y = 0;
+
+    pa_smoother_put(u->thread_info.smoother, x, y);
+}
+
+/* Called from main context. The rates are picked in the IO thread,
+ * here we only make them visible to clients. */
+static void update_rates(struct userdata *u) {
+    struct output *o;
+    uint32_t idx;
+
+    pa_assert(u);
+    pa_sink_assert_ref(u->sink);
+
+    PA_IDXSET_FOREACH(o, u->outputs, idx) {
+        uint32_t rate;
+
+        if (!o->sink_input || !PA_SINK_INPUT_IS_LINKED(o->sink_input->state))
+            continue;
+
+        rate = (uint32_t) pa_atomic_load(&o->rate);
+
+        if (rate == o->sink_input->sample_spec.rate)
+            continue;
+
+        pa_log_info("[%s] new rate is %u Hz; ratio is %0.3f.", o->sink->name, rate, (double) rate / u->sink->sample_spec.rate);
+        pa_sink_input_set_rate(o->sink_input, rate);
+    }
 }
 
 static void time_callback(pa_mainloop_api *a, pa_time_event *e, const struct timeval *t, void *userdata) {
@@ -250,7 +392,7 @@ static void time_callback(pa_mainloop_api *a, pa_time_event *e, const struct tim
     pa_assert(a);
     pa_assert(u->time_event == e);
 
-    adjust_rates(u);
+    update_rates(u);
 
     if (pa_sink_get_state(u->sink) == PA_SINK_SUSPENDED) {
         u->core->mainloop->time_free(e);
@@ -323,6 +465,19 @@ static void thread_func(void *userdata) {
 
             pa_rtpoll_set_timer_absolute(u->rtpoll, u->thread_info.timestamp);
             u->thread_info.in_null_mode = true;
+        } else if (u->sink->thread_info.state == PA_SINK_RUNNING && u->adjust_time > 0) {
+            pa_usec_t now;
+
+            /* Correct the rates a few times per adjust_time */
+            now = pa_rtclock_now();
+
+            if (u->thread_info.adjust_timestamp <= now) {
+                adjust_rates(u, now);
+                u->thread_info.adjust_timestamp = now + u->adjust_time / ADJUST_STEPS;
+            }
+
+            pa_rtpoll_set_timer_absolute(u->rtpoll, u->thread_info.adjust_timestamp);
+            u->thread_info.in_null_mode = false;
         } else {
             pa_rtpoll_set_timer_disabled(u->rtpoll);
             u->thread_info.in_null_mode = false;
@@ -350,41 +505,60 @@ finish:
 
 /* Called from I/O thread context */
 static void render_memblock(struct userdata *u, struct output *o, size_t length) {
+    struct output *j;
+    pa_memchunk chunk;
+
     pa_assert(u);
     pa_assert(o);
 
     /* We are run by the sink thread, on behalf of an output (o). The
-     * output is waiting for us, hence it is safe to access its
-     * mainblockq and asyncmsgq directly. */
+     * output is waiting for us and will take the data out of its ring
+     * when we return. */
 
     /* If we are not running, we cannot produce any data */
     if (!pa_atomic_load(&u->thread_info.running))
         return;
 
-    /* Maybe there's some data in the requesting output's queue
-     * now? */
-    while (pa_asyncmsgq_process_one(o->inq) > 0)
-        ;
-
-    /* Ok, now let's prepare some data if we really have to */
-    while (!pa_memblockq_is_readable(o->memblockq)) {
-        struct output *j;
-        pa_memchunk chunk;
+    /* Maybe another output made us render in the meantime */
+    if (pa_atomic_load(&o->ring.length) > 0)
+        return;
 
-        /* Render data! */
-        pa_sink_render(u->sink, length, &chunk);
+    /* Render data! */
+    pa_sink_render(u->sink, length, &chunk);
 
-        u->thread_info.counter += chunk.length;
+    u->thread_info.counter += chunk.length;
 
-        /* OK, let's send this data to the other threads */
-        PA_LLIST_FOREACH(j, u->thread_info.active_outputs) {
-            if (j == o)
-                continue;
+    /* OK, let's pass this data to all outputs */
+    PA_LLIST_FOREACH(j, u->thread_info.active_outputs) {
 
-            pa_asyncmsgq_post(j->inq, PA_MSGOBJECT(j->sink_input), SINK_INPUT_MESSAGE_POST, NULL, 0, &chunk, NULL);
+        /* Don't queue data for a suspended sink, it would be played
+         * late once the sink resumes */
+        if (!pa_atomic_load(&j->sink_opened)) {
+            pa_atomic_store(&j->flush, 1);
+            continue;
         }
 
-        /* And place it directly into the requesting output's queue */
+        if (!chunk_ring_push(&j->ring, &chunk))
+            pa_log_debug("[%s] Ring full, dropping %lu bytes.", j->sink->name, (unsigned long) chunk.length);
+    }
+
+    pa_memblock_unref(chunk.memblock);
+}
+
+/* Called from I/O thread context */
+static void drain_ring(struct output *o) {
+    pa_memchunk chunk;
+
+    /* Our sink was not opened for a while, drop the stale data */
+    if (pa_atomic_cmpxchg(&o->flush, 1, 0)) {
+        while (chunk_ring_pop(&o->ring, &chunk))
+            pa_memblock_unref(chunk.memblock);
+
+        pa_memblockq_flush_write(o->memblockq, true);
+        return;
+    }
+
+    while (chunk_ring_pop(&o->ring, &chunk)) {
         pa_memblockq_push_align(o->memblockq, &chunk);
         pa_memblock_unref(chunk.memblock);
     }
@@ -396,28 +570,38 @@ static void request_memblock(struct output *o, size_t length) {
     pa_sink_input_assert_ref(o->sink_input);
     pa_sink_assert_ref(o->userdata->sink);
 
-    /* If another thread already prepared some data we received
-     * the data over the asyncmsgq, hence let's first process
-     * it. */
-    while (pa_asyncmsgq_process_one(o->inq) > 0)
-        ;
+    /* If another output already made the sink thread render some
+     * data, it is waiting in our ring */
+    drain_ring(o);
 
     /* Check whether we're now readable */
     if (pa_memblockq_is_readable(o->memblockq))
         return;
 
     /* OK, we need to prepare new data, but only if the sink is actually running */
-    if (pa_atomic_load(&o->userdata->thread_info.running))
+    if (pa_atomic_load(&o->userdata->thread_info.running)) {
         pa_asyncmsgq_send(o->outq, PA_MSGOBJECT(o->userdata->sink), SINK_MESSAGE_NEED, o, (int64_t) length, NULL);
+        drain_ring(o);
+    }
 }
 
 /* Called from I/O thread context */
 static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk) {
     struct output *o;
+    uint32_t rate;
+    pa_usec_t latency, sink_latency;
 
     pa_sink_input_assert_ref(i);
     pa_assert_se(o = i->userdata);
 
+    /* Pick up the rate the sink thread chose for us */
+    rate = (uint32_t) pa_atomic_load(&o->rate);
+
+    if (rate != i->thread_info.sample_spec.rate && i->thread_info.resampler) {
+        i->thread_info.sample_spec.rate = rate;
+        pa_resampler_set_input_rate(i->thread_info.resampler, rate);
+    }
+
     /* If necessary, get some new data */
     request_memblock(o, nbytes);
 
@@ -431,8 +615,16 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     if (pa_memblockq_peek(o->memblockq, chunk) < 0)
         return -1;
 
+    /* Tell the sink thread how long it takes until the data we hold
+     * is played, the chunk we return included */
+    latency = pa_bytes_to_usec(pa_memblockq_get_length(o->memblockq), &o->userdata->sink->sample_spec) +
+        pa_bytes_to_usec(pa_memblockq_get_length(i->thread_info.render_memblockq), &i->sink->sample_spec);
+
     pa_memblockq_drop(o->memblockq, chunk->length);
 
+    sink_latency = pa_sink_get_latency_within_thread(i->sink);
+    output_set_timing(o, pa_rtclock_now(), latency + sink_latency, sink_latency);
+
     return 0;
 }
 
@@ -500,13 +692,8 @@ static void sink_input_attach_cb(pa_sink_input *i) {
     pa_sink_input_assert_ref(i);
     pa_assert_se(o = i->userdata);
 
-    /* Set up the queue from the sink thread to us */
-    pa_assert(!o->inq_rtpoll_item_read && !o->outq_rtpoll_item_write);
-
-    o->inq_rtpoll_item_read = pa_rtpoll_item_new_asyncmsgq_read(
-            i->sink->thread_info.rtpoll,
-            PA_RTPOLL_LATE,  /* This one is not that important, since we check for data in _peek() anyway. */
-            o->inq);
+    /* Set up the queue from us to the sink thread */
+    pa_assert(!o->outq_rtpoll_item_write);
 
     o->outq_rtpoll_item_write = pa_rtpoll_item_new_asyncmsgq_write(
             i->sink->thread_info.rtpoll,
@@ -531,11 +718,6 @@ static void sink_input_detach_cb(pa_sink_input *i) {
     pa_sink_input_assert_ref(i);
     pa_assert_se(o = i->userdata);
 
-    if (o->inq_rtpoll_item_read) {
-        pa_rtpoll_item_free(o->inq_rtpoll_item_read);
-        o->inq_rtpoll_item_read = NULL;
-    }
-
     if (o->outq_rtpoll_item_write) {
         pa_rtpoll_item_free(o->outq_rtpoll_item_write);
         o->outq_rtpoll_item_write = NULL;
@@ -563,21 +745,13 @@ static int sink_input_process_msg(pa_msgobject *obj, int code, void *data, int64
         case PA_SINK_INPUT_MESSAGE_GET_LATENCY: {
             pa_usec_t *r = data;
 
-            *r = pa_bytes_to_usec(pa_memblockq_get_length(o->memblockq), &o->sink_input->sample_spec);
+            *r = pa_bytes_to_usec(pa_memblockq_get_length(o->memblockq) + (size_t) pa_atomic_load(&o->ring.length),
+                                  &o->sink_input->sample_spec);
 
             /* Fall through, the default handler will add in the extra
              * latency added by the resampler */
             break;
         }
-
-        case SINK_INPUT_MESSAGE_POST:
-
-            if (PA_SINK_IS_OPENED(o->sink_input->sink->thread_info.state))
-                pa_memblockq_push_align(o->memblockq, chunk);
-            else
-                pa_memblockq_flush_write(o->memblockq, true);
-
-            return 0;
     }
 
     return pa_sink_input_process_msg(obj, code, data, offset, chunk);
@@ -608,7 +782,7 @@ static void unsuspend(struct userdata *u) {
     PA_IDXSET_FOREACH(o, u->outputs, idx)
         output_enable(o);
 
-    if (!u->time_event)
+    if (!u->time_event && u->adjust_time > 0)
         u->time_event = pa_core_rttime_new(u->core, pa_rtclock_now() + u->adjust_time, time_callback, u);
 
     pa_log_info("Resumed successfully...");
@@ -703,16 +877,12 @@ static void output_add_within_thread(struct output *o) {
 
     PA_LLIST_PREPEND(struct output, o->userdata->thread_info.active_outputs, o);
 
-    pa_assert(!o->outq_rtpoll_item_read && !o->inq_rtpoll_item_write);
+    pa_assert(!o->outq_rtpoll_item_read);
 
     o->outq_rtpoll_item_read = pa_rtpoll_item_new_asyncmsgq_read(
             o->userdata->rtpoll,
             PA_RTPOLL_EARLY-1,  /* This item is very important */
             o->outq);
-    o->inq_rtpoll_item_write = pa_rtpoll_item_new_asyncmsgq_write(
-            o->userdata->rtpoll,
-            PA_RTPOLL_EARLY,
-            o->inq);
 }
 
 /* Called from thread context of the io thread */
@@ -726,11 +896,6 @@ static void output_remove_within_thread(struct output *o) {
         pa_rtpoll_item_free(o->outq_rtpoll_item_read);
         o->outq_rtpoll_item_read = NULL;
     }
-
-    if (o->inq_rtpoll_item_write) {
-        pa_rtpoll_item_free(o->inq_rtpoll_item_write);
-        o->inq_rtpoll_item_write = NULL;
-    }
 }
 
 /* Called from thread context of the io thread */
@@ -784,21 +949,6 @@ static int sink_process_msg(pa_msgobject *o, int code, void *data, int64_t offse
             render_memblock(u, (struct output*) data, (size_t) offset);
             return 0;
 
-        case SINK_MESSAGE_UPDATE_LATENCY: {
-            pa_usec_t x, y, latency = (pa_usec_t) offset;
-
-            x = pa_rtclock_now();
-            y = pa_bytes_to_usec(u->thread_info.counter, &u->sink->sample_spec);
-
-            if (y > latency)
-                y -= latency;
-            else
-                y = 0;
-
-            pa_smoother_put(u->thread_info.smoother, x, y);
-            return 0;
-        }
-
         case SINK_MESSAGE_UPDATE_MAX_REQUEST:
             update_max_request(u);
             break;
@@ -898,8 +1048,8 @@ static struct output *output_new(struct userdata *u, pa_sink *sink) {
 
     o = pa_xnew0(struct output, 1);
     o->userdata = u;
-    o->inq = pa_asyncmsgq_new(0);
     o->outq = pa_asyncmsgq_new(0);
+    pa_atomic_store(&o->rate, (int) u->sink->sample_spec.rate);
     o->sink = sink;
     o->memblockq = pa_memblockq_new(
             "module-combine-sink output memblockq",
@@ -925,19 +1075,11 @@ static void output_free(struct output *o) {
     output_disable(o);
     update_description(o->userdata);
 
-    if (o->inq_rtpoll_item_read)
-        pa_rtpoll_item_free(o->inq_rtpoll_item_read);
-    if (o->inq_rtpoll_item_write)
-        pa_rtpoll_item_free(o->inq_rtpoll_item_write);
-
     if (o->outq_rtpoll_item_read)
         pa_rtpoll_item_free(o->outq_rtpoll_item_read);
     if (o->outq_rtpoll_item_write)
         pa_rtpoll_item_free(o->outq_rtpoll_item_write);
 
-    if (o->inq)
-        pa_asyncmsgq_unref(o->inq);
-
     if (o->outq)
         pa_asyncmsgq_unref(o->outq);
 
@@ -962,6 +1104,8 @@ static void output_enable(struct output *o) {
 
     if (output_create_sink_input(o) >= 0) {
 
+        pa_atomic_store(&o->sink_opened, PA_SINK_IS_OPENED(pa_sink_get_state(o->sink)));
+
         if (pa_sink_get_state(o->sink) != PA_SINK_INIT) {
 
             /* First we register the output. That means that the sink
@@ -982,6 +1126,8 @@ static void output_enable(struct output *o) {
 
 /* Called from main context */
 static void output_disable(struct output *o) {
+    pa_memchunk chunk;
+
     pa_assert(o);
 
     if (!o->sink_input)
@@ -999,10 +1145,17 @@ static void output_disable(struct output *o) {
     pa_sink_input_unref(o->sink_input);
     o->sink_input = NULL;
 
-    /* Finally, drop all queued data */
+    /* Finally, drop all queued data. Neither thread touches the ring
+     * anymore. */
+    while (chunk_ring_pop(&o->ring, &chunk))
+        pa_memblock_unref(chunk.memblock);
+
     pa_memblockq_flush_write(o->memblockq, true);
-    pa_asyncmsgq_flush(o->inq, false);
     pa_asyncmsgq_flush(o->outq, false);
+    pa_atomic_store(&o->flush, 0);
+    pa_atomic_store(&o->timing_seq, 0);
+    o->timing_timestamp = 0;
+    pa_atomic_store(&o->rate, (int) o->userdata->sink->sample_spec.rate);
 }
 
 /* Called from main context */
@@ -1119,6 +1272,8 @@ static pa_hook_result_t sink_state_changed_hook_cb(pa_core *c, pa_sink *s, struc
     if (!(o = find_output(u, s)))
         return PA_HOOK_OK;
 
+    pa_atomic_store(&o->sink_opened, PA_SINK_IS_OPENED(pa_sink_get_state(s)));
+
     /* This state change might be triggered because we are creating a
      * stream here, in that case we don't want to create it a second
      * time here and enter a loop */
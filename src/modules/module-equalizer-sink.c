@@ -37,15 +37,10 @@
 #include <string.h>
 #include <stdint.h>
 
-//#undef __SSE2__
-#ifdef __SSE2__
-#include <xmmintrin.h>
-#include <emmintrin.h>
-#endif
-
 #include <fftw3.h>
 
 #include <pulse/xmalloc.h>
+#include <pulse/rtclock.h>
 #include <pulse/timeval.h>
 
 #include <pulsecore/core-rtclock.h>
@@ -82,10 +77,25 @@ PA_MODULE_USAGE(
           "channel_map=<channel map> "
           "autoloaded=<set if this module is being loaded automatically> "
           "use_volume_sharing=<yes or no> "
+          "mode=<ola or partitioned> "
+          "partition_size=<frames per partition in partitioned mode> "
          ));
 
 #define MEMBLOCKQ_MAXLENGTH (16*1024*1024)
 #define DEFAULT_AUTOLOADED false
+#define DEFAULT_WINDOW_SIZE 15999
+#define DEFAULT_PARTITION_SIZE 256
+#define STATS_INTERVAL 10 /* seconds of audio between two reports */
+
+enum filter_mode {
+    /* Linear phase STFT with overlap-add, the hop size is half the
+     * window, so the latency grows with the filter resolution */
+    FILTER_MODE_OLA,
+    /* Minimum phase FIR split into uniform partitions, run with
+     * overlap-save in the frequency domain. The latency is one
+     * partition, independent of the filter length */
+    FILTER_MODE_PARTITIONED,
+};
 
 struct userdata {
     pa_module *module;
@@ -94,6 +104,7 @@ struct userdata {
     bool autoloaded;
 
     size_t channels;
+    enum filter_mode mode;
     size_t fft_size;//length (res) of fft
     size_t window_size;/*
                         *sliding window size
@@ -109,14 +120,35 @@ struct userdata {
     size_t input_buffer_max;
     //message
     float *W;//windowing function (time domain)
-    float *work_buffer, **input, **overlap_accum;
+    float *work_buffer, **input, **overlap_accum;//work_buffer and output_window hold all channels
+    size_t spectrum_stride;//complex values between two channels' spectra
     fftwf_complex *output_window;
-    fftwf_plan forward_plan, inverse_plan;
+    fftwf_plan forward_plan, inverse_plan;//batched over all channels
     //size_t samplings;
 
     float **Xs;
     float ***Hs;//thread updatable copies of the freq response filters (magnitude based)
     pa_aupdate **a_H;
+
+    /* partitioned mode, R is the partition size */
+    size_t n_partitions;
+    fftwf_complex ***Ps;//partition spectra, updated together with Hs
+    fftwf_complex *fdl;//frequency domain delay line, n_partitions slots of all channels
+    size_t fdl_pos;
+    float *block_in, *block_out;
+    fftwf_complex *block_acc;
+    fftwf_plan block_forward_plan, block_inverse_plan;//batched over all channels
+
+    /* main thread only, turns Hs into Ps */
+    float *design_buffer, *design_block;
+    fftwf_complex *design_spectrum;
+    fftwf_plan design_forward_plan, design_inverse_plan, design_block_plan;
+
+    /* per period processing statistics */
+    size_t latency;//algorithmic latency in frames
+    size_t stats_periods, stats_frames;
+    pa_usec_t stats_usec, stats_max_usec;
+
     pa_memblockq *input_q;
     char *output_buffer;
     size_t output_buffer_length;
@@ -141,6 +173,8 @@ static const char* const valid_modargs[] = {
     "channel_map",
     "autoloaded",
     "use_volume_sharing",
+    "mode",
+    "partition_size",
     NULL
 };
 
@@ -239,6 +273,62 @@ static void alloc_input_buffers(struct userdata *u, size_t min_buffer_length) {
     u->input_buffer_max = min_buffer_length;
 }
 
+/* Called from main context, between pa_aupdate_write_begin() and
+ * pa_aupdate_write_end() of the channel. Derives the partitions of the
+ * filter Hs[c][a_i] for the partitioned mode. The filter only defines
+ * magnitudes, so we pick the minimum phase response (real cepstrum
+ * method) to keep the group delay low, truncate it to the partitioned
+ * length and transform every partition. */
+static void update_partitions(struct userdata *u, size_t c, unsigned a_i) {
+    const size_t N = u->fft_size, B = u->R, L = u->n_partitions * B;
+    float X, *H, *h = u->design_buffer;
+    fftwf_complex *P;
+
+    if (u->mode != FILTER_MODE_PARTITIONED)
+        return;
+
+    X = u->Xs[c][a_i];
+    H = u->Hs[c][a_i];
+    P = u->Ps[c][a_i];
+
+    //log magnitude, H has the fft gain divided out
+    for (size_t k = 0; k < FILTER_SIZE(u); ++k) {
+        u->design_spectrum[k][0] = logf(PA_MAX(X * H[k] * N, 1e-7f));
+        u->design_spectrum[k][1] = 0;
+    }
+    fftwf_execute(u->design_inverse_plan);
+
+    //fold the real cepstrum onto the causal side
+    h[0] /= N;
+    for (size_t n = 1; n < N / 2; ++n)
+        h[n] *= 2.0f / N;
+    h[N / 2] /= N;
+    memset(h + N / 2 + 1, 0, (N / 2 - 1) * sizeof(float));
+    fftwf_execute(u->design_forward_plan);
+
+    for (size_t k = 0; k < FILTER_SIZE(u); ++k) {
+        float m = expf(u->design_spectrum[k][0]), phi = u->design_spectrum[k][1];
+        u->design_spectrum[k][0] = m * cosf(phi);
+        u->design_spectrum[k][1] = m * sinf(phi);
+    }
+    fftwf_execute(u->design_inverse_plan);
+
+    //truncate to the partitioned length, fade out over the last partition
+    for (size_t n = 0; n < B; ++n)
+        h[L - B + n] *= .5f * (1 + cosf(M_PI * (n + 1) / B));
+
+    for (size_t p = 0; p < u->n_partitions; ++p) {
+        fftwf_complex *dst = P + p * u->spectrum_stride;
+
+        //the overlap-save frame is 2B long, scale for both transforms
+        for (size_t n = 0; n < B; ++n)
+            u->design_block[n] = h[p * B + n] / (N * 2 * B);
+        memset(u->design_block + B, 0, B * sizeof(float));
+
+        fftwf_execute_dft_r2c(u->design_block_plan, u->design_block, dst);
+    }
+}
+
 /* Called from I/O thread context */
 static int sink_process_msg_cb(pa_msgobject *o, int code, void *data, int64_t offset, pa_memchunk *chunk) {
     struct userdata *u = PA_SINK(o)->userdata;
@@ -349,158 +439,118 @@ static void sink_set_mute_cb(pa_sink *s) {
     pa_sink_input_set_mute(u->sink_input, s->muted, s->save_muted);
 }
 
-#if 1
-//reference implementation
+//use a linear-phase sliding STFT and overlap-add method
+//the transforms run on all channels at once
 static void dsp_logic(
-    float * restrict dst,//used as a temp array too, needs to be fft_length!
-    float * restrict src,/*input data w/ overlap at start,
-                               *automatically cycled in routine
-                               */
-    float * restrict overlap,
-    const float X,//multiplier
-    const float * restrict H,//The freq. magnitude scalers filter
-    const float * restrict W,//The windowing function
-    fftwf_complex * restrict output_window,//The transformed windowed src
+    size_t offset,//of the window in the input buffers
+    uint8_t *output,//interleaved, R frames
     struct userdata *u) {
+    size_t fs = pa_frame_size(&u->sink->sample_spec);
+    unsigned a_i;
+
+    for(size_t c = 0; c < u->channels; ++c) {
+        float *dst = u->work_buffer + c * u->fft_size;
+        const float *src = u->input[c] + offset;
 
-    //use a linear-phase sliding STFT and overlap-add method (for each channel)
-    //window the data
-    for(size_t j = 0; j < u->window_size; ++j) {
-        dst[j] = X * W[j] * src[j];
+        //window the data
+        for(size_t j = 0; j < u->window_size; ++j)
+            dst[j] = u->W[j] * src[j];
+        //zero pad the remaining fft window
+        memset(dst + u->window_size, 0, (u->fft_size - u->window_size) * sizeof(float));
     }
-    //zero pad the remaining fft window
-    memset(dst + u->window_size, 0, (u->fft_size - u->window_size) * sizeof(float));
+
     //Processing is done here!
     //do fft
-    fftwf_execute_dft_r2c(u->forward_plan, dst, output_window);
-    //perform filtering
-    for(size_t j = 0; j < FILTER_SIZE(u); ++j) {
-        u->output_window[j][0] *= H[j];
-        u->output_window[j][1] *= H[j];
+    fftwf_execute(u->forward_plan);
+
+    //perform filtering, the multiplier is linear so we apply it here too
+    for(size_t c = 0; c < u->channels; ++c) {
+        fftwf_complex *w = u->output_window + c * u->spectrum_stride;
+        const float *H;
+        float X;
+
+        a_i = pa_aupdate_read_begin(u->a_H[c]);
+        X = u->Xs[c][a_i];
+        H = u->Hs[c][a_i];
+        for(size_t j = 0; j < FILTER_SIZE(u); ++j) {
+            w[j][0] *= X * H[j];
+            w[j][1] *= X * H[j];
+        }
+        pa_aupdate_read_end(u->a_H[c]);
     }
+
     //inverse fft
-    fftwf_execute_dft_c2r(u->inverse_plan, output_window, dst);
-    ////debug: tests overlapping add
-    ////and negates ALL PREVIOUS processing
-    ////yields a perfect reconstruction if COLA is held
-    //for(size_t j = 0; j < u->window_size; ++j) {
-    //    u->work_buffer[j] = u->W[j] * u->input[c][j];
-    //}
-
-    //overlap add and preserve overlap component from this window (linear phase)
-    for(size_t j = 0; j < u->overlap_size; ++j) {
-        u->work_buffer[j] += overlap[j];
-        overlap[j] = dst[u->R + j];
-    }
-    ////debug: tests if basic buffering works
-    ////shouldn't modify the signal AT ALL (beyond roundoff)
-    //for(size_t j = 0; j < u->window_size;++j) {
-    //    u->work_buffer[j] = u->input[c][j];
-    //}
+    fftwf_execute(u->inverse_plan);
 
-    //preserve the needed input for the next window's overlap
-    memmove(src, src + u->R,
-        (u->samples_gathered - u->R) * sizeof(float)
-    );
-}
-#else
-typedef float v4sf __attribute__ ((__aligned__(v_size * sizeof(float))));
-typedef union float_vector {
-    float f[v_size];
-    v4sf v;
-    __m128 m;
-} float_vector_t;
-
-//regardless of sse enabled, the loops in here assume
-//16 byte aligned addresses and memory allocations divisible by v_size
-static void dsp_logic(
-    float * restrict dst,//used as a temp array too, needs to be fft_length!
-    float * restrict src,/*input data w/ overlap at start,
-                               *automatically cycled in routine
-                               */
-    float * restrict overlap,//The size of the overlap
-    const float X,//multiplier
-    const float * restrict H,//The freq. magnitude scalers filter
-    const float * restrict W,//The windowing function
-    fftwf_complex * restrict output_window,//The transformed windowed src
-    struct userdata *u) {//Collection of constants
-    const size_t overlap_size = PA_ROUND_UP(u->overlap_size, v_size);
-    float_vector_t x;
-    x.f[0] = x.f[1] = x.f[2] = x.f[3] = X;
-
-    //assert(u->samples_gathered >= u->R);
-    //use a linear-phase sliding STFT and overlap-add method
-    for(size_t j = 0; j < u->window_size; j += v_size) {
-        //dst[j] = W[j] * src[j];
-        float_vector_t *d = (float_vector_t*) (dst + j);
-        float_vector_t *w = (float_vector_t*) (W + j);
-        float_vector_t *s = (float_vector_t*) (src + j);
-//#if __SSE2__
-        d->m = _mm_mul_ps(x.m, _mm_mul_ps(w->m, s->m));
-//        d->v = x->v * w->v * s->v;
-//#endif
-    }
-    //zero pad the remaining fft window
-    memset(dst + u->window_size, 0, (u->fft_size - u->window_size) * sizeof(float));
+    for(size_t c = 0; c < u->channels; ++c) {
+        float *dst = u->work_buffer + c * u->fft_size;
+        float *overlap = u->overlap_accum[c];
 
-    //Processing is done here!
-    //do fft
-    fftwf_execute_dft_r2c(u->forward_plan, dst, output_window);
-    //perform filtering - purely magnitude based
-    for(size_t j = 0; j < FILTER_SIZE; j += v_size / 2) {
-        //output_window[j][0]*=H[j];
-        //output_window[j][1]*=H[j];
-        float_vector_t *d = (float_vector_t*)( ((float *) output_window) + 2 * j);
-        float_vector_t h;
-        h.f[0] = h.f[1] = H[j];
-        h.f[2] = h.f[3] = H[j + 1];
-//#if __SSE2__
-        d->m = _mm_mul_ps(d->m, h.m);
-//#else
-//        d->v = d->v * h.v;
-//#endif
+        //overlap add and preserve overlap component from this window (linear phase)
+        for(size_t j = 0; j < u->overlap_size; ++j) {
+            dst[j] += overlap[j];
+            overlap[j] = dst[u->R + j];
+        }
+
+        if (u->first_iteration) {
+            /* The windowing function will make the audio ramped in, as a cheap fix we can
+             * undo the windowing (for non-zero window values)
+             */
+            for(size_t i = 0; i < u->overlap_size; ++i) {
+                dst[i] = u->W[i] <= FLT_EPSILON ? dst[i] : dst[i] / u->W[i];
+            }
+        }
+        pa_sample_clamp(PA_SAMPLE_FLOAT32NE, output + c * sizeof(float), fs, dst, sizeof(float), u->R);
     }
+}
 
-    //inverse fft
-    fftwf_execute_dft_c2r(u->inverse_plan, output_window, dst);
-
-    ////debug: tests overlapping add
-    ////and negates ALL PREVIOUS processing
-    ////yields a perfect reconstruction if COLA is held
-    //for(size_t j = 0; j < u->window_size; ++j) {
-    //    dst[j] = W[j] * src[j];
-    //}
-
-    //overlap add and preserve overlap component from this window (linear phase)
-    for(size_t j = 0; j < overlap_size; j += v_size) {
-        //dst[j]+=overlap[j];
-        //overlap[j]+=dst[j+R];
-        float_vector_t *d = (float_vector_t*)(dst + j);
-        float_vector_t *o = (float_vector_t*)(overlap + j);
-//#if __SSE2__
-        d->m = _mm_add_ps(d->m, o->m);
-        o->m = ((float_vector_t*)(dst + u->R + j))->m;
-//#else
-//        d->v = d->v + o->v;
-//        o->v = ((float_vector_t*)(dst + u->R + j))->v;
-//#endif
-    }
-    //memcpy(overlap, dst+u->R, u->overlap_size * sizeof(float)); //overlap preserve (debug)
-    //zero out the bit beyond the real overlap so we don't add garbage next iteration
-    memset(overlap + u->overlap_size, 0, overlap_size - u->overlap_size);
-
-    ////debug: tests if basic buffering works
-    ////shouldn't modify the signal AT ALL (beyond roundoff)
-    //for(size_t j = 0; j < u->window_size; ++j) {
-    //    dst[j] = src[j];
-    //}
+/* acc += x * h for n complex values */
+static void complex_mac(fftwf_complex * restrict acc, const fftwf_complex * restrict x, const fftwf_complex * restrict h, size_t n) {
+    for(size_t k = 0; k < n; ++k) {
+        acc[k][0] += x[k][0] * h[k][0] - x[k][1] * h[k][1];
+        acc[k][1] += x[k][0] * h[k][1] + x[k][1] * h[k][0];
+    }
+}
 
-    //preserve the needed input for the next window's overlap
-    memmove(src, src + u->R,
-        (u->samples_gathered - u->R) * sizeof(float)
-    );
+//uniformly partitioned overlap-save, one partition (R frames) per call
+static void dsp_logic_partitioned(
+    size_t offset,//of the 2R frame in the input buffers
+    uint8_t *output,//interleaved, R frames
+    struct userdata *u) {
+    size_t fs = pa_frame_size(&u->sink->sample_spec);
+    const size_t B = u->R, S = u->spectrum_stride, slot_size = u->channels * S;
+    fftwf_complex *slot = u->fdl + u->fdl_pos * slot_size;
+    unsigned a_i;
+
+    for(size_t c = 0; c < u->channels; ++c)
+        memcpy(u->block_in + c * 2 * B, u->input[c] + offset, 2 * B * sizeof(float));
+
+    //the newest spectra of all channels go straight into the delay line
+    fftwf_execute_dft_r2c(u->block_forward_plan, u->block_in, slot);
+
+    for(size_t c = 0; c < u->channels; ++c) {
+        fftwf_complex *acc = u->block_acc + c * S;
+        const fftwf_complex *P;
+
+        memset(acc, 0, S * sizeof(fftwf_complex));
+
+        a_i = pa_aupdate_read_begin(u->a_H[c]);
+        P = u->Ps[c][a_i];
+        for(size_t p = 0, i = u->fdl_pos; p < u->n_partitions; ++p) {
+            complex_mac(acc, u->fdl + i * slot_size + c * S, P + p * S, B + 1);
+            i = i == 0 ? u->n_partitions - 1 : i - 1;
+        }
+        pa_aupdate_read_end(u->a_H[c]);
+    }
+
+    fftwf_execute(u->block_inverse_plan);
+
+    //the second half of the frame is free of circular wrap-around
+    for(size_t c = 0; c < u->channels; ++c)
+        pa_sample_clamp(PA_SAMPLE_FLOAT32NE, output + c * sizeof(float), fs, u->block_out + c * 2 * B + B, sizeof(float), B);
+
+    u->fdl_pos = (u->fdl_pos + 1) % u->n_partitions;
 }
-#endif
 
 static void flatten_to_memblockq(struct userdata *u) {
     size_t mbs = pa_mempool_block_size_max(u->sink->core->mempool);
@@ -523,8 +573,6 @@ static void flatten_to_memblockq(struct userdata *u) {
 
 static void process_samples(struct userdata *u) {
     size_t fs = pa_frame_size(&(u->sink->sample_spec));
-    unsigned a_i;
-    float *H, X;
     size_t iterations, offset;
     pa_assert(u->samples_gathered >= u->window_size);
     iterations = (u->samples_gathered - u->overlap_size) / u->R;
@@ -538,43 +586,51 @@ static void process_samples(struct userdata *u) {
 
     for(size_t iter = 0; iter < iterations; ++iter) {
         offset = iter * u->R * fs;
-        for(size_t c = 0;c < u->channels; c++) {
-            a_i = pa_aupdate_read_begin(u->a_H[c]);
-            X = u->Xs[c][a_i];
-            H = u->Hs[c][a_i];
-            dsp_logic(
-                u->work_buffer,
-                u->input[c],
-                u->overlap_accum[c],
-                X,
-                H,
-                u->W,
-                u->output_window,
-                u
-            );
-            pa_aupdate_read_end(u->a_H[c]);
-            if (u->first_iteration) {
-                /* The windowing function will make the audio ramped in, as a cheap fix we can
-                 * undo the windowing (for non-zero window values)
-                 */
-                for(size_t i = 0; i < u->overlap_size; ++i) {
-                    u->work_buffer[i] = u->W[i] <= FLT_EPSILON ? u->work_buffer[i] : u->work_buffer[i] / u->W[i];
-                }
-            }
-            pa_sample_clamp(PA_SAMPLE_FLOAT32NE, (uint8_t *) (((float *)u->output_buffer) + c) + offset, fs, u->work_buffer, sizeof(float), u->R);
-        }
+        if (u->mode == FILTER_MODE_PARTITIONED)
+            dsp_logic_partitioned(iter * u->R, (uint8_t *) u->output_buffer + offset, u);
+        else
+            dsp_logic(iter * u->R, (uint8_t *) u->output_buffer + offset, u);
         if (u->first_iteration) {
             u->first_iteration = false;
         }
-        u->samples_gathered -= u->R;
     }
+    u->samples_gathered -= iterations * u->R;
+
+    //preserve the needed input for the next window's overlap
+    for(size_t c = 0; c < u->channels; ++c)
+        memmove(u->input[c], u->input[c] + iterations * u->R, u->samples_gathered * sizeof(float));
+
     flatten_to_memblockq(u);
 }
 
+/* Called from I/O thread context */
+static void update_stats(struct userdata *u, pa_usec_t usec, size_t frames) {
+    u->stats_periods++;
+    u->stats_frames += frames;
+    u->stats_usec += usec;
+    u->stats_max_usec = PA_MAX(u->stats_max_usec, usec);
+
+    if (u->stats_frames < STATS_INTERVAL * u->sink->sample_spec.rate)
+        return;
+
+    pa_log_debug("%s mode: %zu periods, %llu usec CPU per period on average, %llu usec at most, %0.2f%% of real time, latency %0.2f ms",
+                 u->mode == FILTER_MODE_PARTITIONED ? "Partitioned" : "OLA",
+                 u->stats_periods,
+                 (unsigned long long) (u->stats_usec / u->stats_periods),
+                 (unsigned long long) u->stats_max_usec,
+                 100.0 * u->stats_usec / pa_bytes_to_usec(u->stats_frames * pa_frame_size(&u->sink->sample_spec), &u->sink->sample_spec),
+                 (double) pa_bytes_to_usec(u->latency * pa_frame_size(&u->sink->sample_spec), &u->sink->sample_spec) / PA_USEC_PER_MSEC);
+
+    u->stats_periods = u->stats_frames = 0;
+    u->stats_usec = u->stats_max_usec = 0;
+}
+
 static void input_buffer(struct userdata *u, pa_memchunk *in) {
     size_t fs = pa_frame_size(&(u->sink->sample_spec));
     size_t samples = in->length/fs;
-    float *src = pa_memblock_acquire_chunk(in);
+    bool planar = pa_memblock_is_planar(in->memblock);
+    void *p = pa_memblock_acquire(in->memblock);
+    float *src = (float *) ((uint8_t *) p + in->index);
     pa_assert(u->samples_gathered + samples <= u->input_buffer_max);
     for(size_t c = 0; c < u->channels; c++) {
         //buffer with an offset after the overlap from previous
@@ -582,7 +638,11 @@ static void input_buffer(struct userdata *u, pa_memchunk *in) {
         pa_assert_se(
             u->input[c] + u->samples_gathered + samples <= u->input[c] + u->input_buffer_max
         );
-        pa_sample_clamp(PA_SAMPLE_FLOAT32NE, u->input[c] + u->samples_gathered, sizeof(float), src + c, fs, samples);
+        //a filter in front of us may hand us the channels separately
+        if (planar)
+            pa_sample_clamp(PA_SAMPLE_FLOAT32NE, u->input[c] + u->samples_gathered, sizeof(float), pa_planar_channel(p, in, &u->sink->sample_spec, c), sizeof(float), samples);
+        else
+            pa_sample_clamp(PA_SAMPLE_FLOAT32NE, u->input[c] + u->samples_gathered, sizeof(float), src + c, fs, samples);
     }
     u->samples_gathered += samples;
     pa_memblock_release(in->memblock);
@@ -593,7 +653,7 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     struct userdata *u;
     size_t fs, target_samples;
     size_t mbs;
-    //struct timeval start, end;
+    pa_usec_t start;
     pa_memchunk tchunk;
 
     pa_sink_input_assert_ref(i);
@@ -618,7 +678,7 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     //mbs = PA_MAX(mbs, u->R);
     //target_samples = PA_MAX(target_samples, mbs);
     //pa_log_debug("target samples: %ld", target_samples);
-    if (u->first_iteration) {
+    if (u->first_iteration && u->mode == FILTER_MODE_OLA) {
         //allocate request_size
         target_samples = PA_MAX(target_samples, u->window_size);
     }else{
@@ -626,6 +686,13 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
         target_samples += u->overlap_size;
     }
     alloc_input_buffers(u, target_samples);
+    if (u->first_iteration && u->mode == FILTER_MODE_PARTITIONED) {
+        //overlap-save starts from silence, no ramp to undo
+        for (size_t c = 0; c < u->channels; ++c)
+            pa_memzero(u->input[c], u->overlap_size * sizeof(float));
+        u->samples_gathered = u->overlap_size;
+        u->first_iteration = false;
+    }
     //pa_log_debug("post target samples: %ld", target_samples);
     chunk->memblock = NULL;
 
@@ -664,11 +731,10 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
 
     pa_assert(u->fft_size >= u->window_size);
     pa_assert(u->R < u->window_size);
-    //pa_rtclock_get(&start);
+    start = pa_rtclock_now();
     /* process a block */
     process_samples(u);
-    //pa_rtclock_get(&end);
-    //pa_log_debug("Took %0.6f seconds to process", (double) pa_timeval_diff(&end, &start) / PA_USEC_PER_SEC);
+    update_stats(u, pa_rtclock_now() - start, u->output_buffer_length / fs);
 END:
     pa_assert_se(pa_memblockq_peek(u->output_q, chunk) >= 0);
     pa_assert(chunk->memblock);
@@ -995,6 +1061,7 @@ static const char* load_profile(struct userdata *u, size_t channel, char *name)
             u->Xs[channel][a_i] = profile[0];
             memcpy(u->Hs[channel][a_i], profile + 1, FILTER_SIZE(u) * sizeof(float));
             fix_filter(u->Hs[channel][a_i], u->fft_size);
+            update_partitions(u, channel, a_i);
             pa_aupdate_write_end(u->a_H[channel]);
             pa_xfree(u->base_profiles[channel]);
             u->base_profiles[channel] = pa_xstrdup(name);
@@ -1035,6 +1102,7 @@ static void load_state(struct userdata *u) {
                 H = state + c * CHANNEL_PROFILE_SIZE(u) + 1;
                 u->Xs[c][a_i] = state[c * CHANNEL_PROFILE_SIZE(u)];
                 memcpy(u->Hs[c][a_i], H, FILTER_SIZE(u) * sizeof(float));
+                update_partitions(u, c, a_i);
                 pa_aupdate_write_end(u->a_H[c]);
             }
             unpack(((char *)value.data) + FILTER_STATE_SIZE(u) * sizeof(float), value.size - FILTER_STATE_SIZE(u) * sizeof(float), &names, &n_profs);
@@ -1093,6 +1161,7 @@ int pa__init(pa_module*m) {
     float *H;
     unsigned a_i;
     bool use_volume_sharing = true;
+    uint32_t partition_size;
 
     pa_assert(m);
 
@@ -1121,17 +1190,41 @@ int pa__init(pa_module*m) {
         goto fail;
     }
 
+    if ((z = pa_modargs_get_value(ma, "mode", NULL)) && !pa_streq(z, "ola") && !pa_streq(z, "partitioned")) {
+        pa_log("mode= expects ola or partitioned");
+        goto fail;
+    }
+
+    partition_size = DEFAULT_PARTITION_SIZE;
+    if (pa_modargs_get_value_u32(ma, "partition_size", &partition_size) < 0 ||
+        partition_size < 32 || partition_size > DEFAULT_WINDOW_SIZE / 2 || (partition_size & (partition_size - 1))) {
+        pa_log("partition_size= expects a power of two between 32 and %u", DEFAULT_WINDOW_SIZE / 2);
+        goto fail;
+    }
+
     u = pa_xnew0(struct userdata, 1);
     u->module = m;
     m->userdata = u;
 
     u->channels = ss.channels;
+    u->mode = z && pa_streq(z, "partitioned") ? FILTER_MODE_PARTITIONED : FILTER_MODE_OLA;
     u->fft_size = pow(2, ceil(log(ss.rate) / log(2)));//probably unstable near corner cases of powers of 2
     pa_log_debug("fft size: %zd", u->fft_size);
-    u->window_size = 15999;
-    if (u->window_size % 2 == 0)
-        u->window_size--;
-    u->R = (u->window_size + 1) / 2;
+    if (u->mode == FILTER_MODE_PARTITIONED) {
+        //overlap-save frames of two partitions, the filter keeps the resolution of the OLA window
+        u->R = partition_size;
+        u->window_size = 2 * u->R;
+        u->n_partitions = PA_CLAMP((DEFAULT_WINDOW_SIZE + u->R) / u->R, (size_t) 1, u->fft_size / 2 / u->R);
+        u->spectrum_stride = PA_ROUND_UP(u->R + 1, v_size);
+        u->latency = u->R;
+    } else {
+        u->window_size = DEFAULT_WINDOW_SIZE;
+        if (u->window_size % 2 == 0)
+            u->window_size--;
+        u->R = (u->window_size + 1) / 2;
+        u->spectrum_stride = PA_ROUND_UP(FILTER_SIZE(u), v_size);
+        u->latency = u->window_size;
+    }
     u->overlap_size = u->window_size - u->R;
     u->samples_gathered = 0;
     u->input_buffer_max = 0;
@@ -1147,22 +1240,63 @@ int pa__init(pa_module*m) {
             u->Hs[c][i] = alloc(FILTER_SIZE(u), sizeof(float));
     }
 
-    u->W = alloc(u->window_size, sizeof(float));
-    u->work_buffer = alloc(u->fft_size, sizeof(float));
     u->input = pa_xnew0(float *, u->channels);
     u->overlap_accum = pa_xnew0(float *, u->channels);
     for (c = 0; c < u->channels; ++c) {
         u->a_H[c] = pa_aupdate_new();
         u->input[c] = NULL;
-        u->overlap_accum[c] = alloc(u->overlap_size, sizeof(float));
     }
-    u->output_window = alloc(FILTER_SIZE(u), sizeof(fftwf_complex));
-    u->forward_plan = fftwf_plan_dft_r2c_1d(u->fft_size, u->work_buffer, u->output_window, FFTW_ESTIMATE);
-    u->inverse_plan = fftwf_plan_dft_c2r_1d(u->fft_size, u->output_window, u->work_buffer, FFTW_ESTIMATE);
 
-    hanning_window(u->W, u->window_size);
+    if (u->mode == FILTER_MODE_PARTITIONED) {
+        int n = 2 * u->R;
+
+        u->Ps = pa_xnew0(fftwf_complex **, u->channels);
+        for (c = 0; c < u->channels; ++c) {
+            u->Ps[c] = pa_xnew0(fftwf_complex *, 2);
+            for (i = 0; i < 2; ++i)
+                u->Ps[c][i] = alloc(u->n_partitions * u->spectrum_stride, sizeof(fftwf_complex));
+        }
+
+        u->fdl = alloc(u->n_partitions * u->channels * u->spectrum_stride, sizeof(fftwf_complex));
+        u->block_in = alloc(u->channels * 2 * u->R, sizeof(float));
+        u->block_out = alloc(u->channels * 2 * u->R, sizeof(float));
+        u->block_acc = alloc(u->channels * u->spectrum_stride, sizeof(fftwf_complex));
+        u->block_forward_plan = fftwf_plan_many_dft_r2c(1, &n, u->channels,
+                                                        u->block_in, NULL, 1, 2 * u->R,
+                                                        u->fdl, NULL, 1, u->spectrum_stride, FFTW_ESTIMATE);
+        u->block_inverse_plan = fftwf_plan_many_dft_c2r(1, &n, u->channels,
+                                                        u->block_acc, NULL, 1, u->spectrum_stride,
+                                                        u->block_out, NULL, 1, 2 * u->R, FFTW_ESTIMATE);
+
+        u->design_buffer = alloc(u->fft_size, sizeof(float));
+        u->design_spectrum = alloc(FILTER_SIZE(u), sizeof(fftwf_complex));
+        u->design_block = alloc(2 * u->R, sizeof(float));
+        u->design_forward_plan = fftwf_plan_dft_r2c_1d(u->fft_size, u->design_buffer, u->design_spectrum, FFTW_ESTIMATE);
+        u->design_inverse_plan = fftwf_plan_dft_c2r_1d(u->fft_size, u->design_spectrum, u->design_buffer, FFTW_ESTIMATE);
+        u->design_block_plan = fftwf_plan_dft_r2c_1d(n, u->design_block, u->Ps[0][0], FFTW_ESTIMATE);
+    } else {
+        int n = u->fft_size;
+
+        u->W = alloc(u->window_size, sizeof(float));
+        for (c = 0; c < u->channels; ++c)
+            u->overlap_accum[c] = alloc(u->overlap_size, sizeof(float));
+        u->work_buffer = alloc(u->channels * u->fft_size, sizeof(float));
+        u->output_window = alloc(u->channels * u->spectrum_stride, sizeof(fftwf_complex));
+        u->forward_plan = fftwf_plan_many_dft_r2c(1, &n, u->channels,
+                                                  u->work_buffer, NULL, 1, u->fft_size,
+                                                  u->output_window, NULL, 1, u->spectrum_stride, FFTW_ESTIMATE);
+        u->inverse_plan = fftwf_plan_many_dft_c2r(1, &n, u->channels,
+                                                  u->output_window, NULL, 1, u->spectrum_stride,
+                                                  u->work_buffer, NULL, 1, u->fft_size, FFTW_ESTIMATE);
+
+        hanning_window(u->W, u->window_size);
+    }
     u->first_iteration = true;
 
+    pa_log_info("Using %s mode, %zu frames per period, algorithmic latency %0.2f ms.",
+                u->mode == FILTER_MODE_PARTITIONED ? "partitioned" : "OLA", u->R,
+                (double) pa_bytes_to_usec(u->latency * pa_frame_size(&ss), &ss) / PA_USEC_PER_MSEC);
+
     u->base_profiles = pa_xnew0(char *, u->channels);
     for (c = 0; c < u->channels; ++c)
         u->base_profiles[c] = pa_xstrdup("default");
@@ -1221,6 +1355,7 @@ int pa__init(pa_module*m) {
     u->output_buffer_max_length = 0;
 
     pa_sink_set_asyncmsgq(u->sink, master->asyncmsgq);
+    pa_sink_set_accept_planar(u->sink, true);
     //pa_sink_set_fixed_latency(u->sink, pa_bytes_to_usec(u->R*fs, &ss));
 
     /* Create sink input */
@@ -1271,6 +1406,7 @@ int pa__init(pa_module*m) {
             H[i] = 1.0 / sqrtf(2.0f);
 
         fix_filter(H, u->fft_size);
+        update_partitions(u, c, a_i);
         pa_aupdate_write_end(u->a_H[c]);
     }
 
@@ -1338,9 +1474,28 @@ void pa__done(pa_module*m) {
     pa_memblockq_free(u->output_q);
     pa_memblockq_free(u->input_q);
 
-    fftwf_destroy_plan(u->inverse_plan);
-    fftwf_destroy_plan(u->forward_plan);
+    if (u->inverse_plan)
+        fftwf_destroy_plan(u->inverse_plan);
+    if (u->forward_plan)
+        fftwf_destroy_plan(u->forward_plan);
+    if (u->block_inverse_plan)
+        fftwf_destroy_plan(u->block_inverse_plan);
+    if (u->block_forward_plan)
+        fftwf_destroy_plan(u->block_forward_plan);
+    if (u->design_block_plan)
+        fftwf_destroy_plan(u->design_block_plan);
+    if (u->design_inverse_plan)
+        fftwf_destroy_plan(u->design_inverse_plan);
+    if (u->design_forward_plan)
+        fftwf_destroy_plan(u->design_forward_plan);
     pa_xfree(u->output_window);
+    pa_xfree(u->fdl);
+    pa_xfree(u->block_in);
+    pa_xfree(u->block_out);
+    pa_xfree(u->block_acc);
+    pa_xfree(u->design_buffer);
+    pa_xfree(u->design_spectrum);
+    pa_xfree(u->design_block);
     for (c = 0; c < u->channels; ++c) {
         pa_aupdate_free(u->a_H[c]);
         pa_xfree(u->overlap_accum[c]);
@@ -1359,6 +1514,14 @@ void pa__done(pa_module*m) {
     }
     pa_xfree(u->Xs);
     pa_xfree(u->Hs);
+    if (u->Ps) {
+        for (c = 0; c < u->channels; ++c) {
+            for (size_t i = 0; i < 2; ++i)
+                pa_xfree(u->Ps[c][i]);
+            pa_xfree(u->Ps[c]);
+        }
+        pa_xfree(u->Ps);
+    }
 
     pa_xfree(u);
 }
@@ -1849,9 +2012,11 @@ void equalizer_handle_seed_filter(DBusConnection *conn, DBusMessage *msg, void *
             float *H_p = u->Hs[c][b_i];
             u->Xs[c][b_i] = preamp;
             memcpy(H_p, H, FILTER_SIZE(u) * sizeof(float));
+            update_partitions(u, c, b_i);
             pa_aupdate_write_end(u->a_H[c]);
         }
     }
+    update_partitions(u, r_channel, a_i);
     pa_aupdate_write_end(u->a_H[r_channel]);
     pa_xfree(ys);
 
@@ -1999,9 +2164,11 @@ static void set_filter(struct userdata *u, size_t channel, double *H_, double pr
             unsigned b_i = pa_aupdate_write_begin(u->a_H[c]);
             u->Xs[c][b_i] = u->Xs[r_channel][a_i];
             memcpy(u->Hs[c][b_i], u->Hs[r_channel][a_i], FILTER_SIZE(u) * sizeof(float));
+            update_partitions(u, c, b_i);
             pa_aupdate_write_end(u->a_H[c]);
         }
     }
+    update_partitions(u, r_channel, a_i);
     pa_aupdate_write_end(u->a_H[r_channel]);
 }
 
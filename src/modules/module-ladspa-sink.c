@@ -47,7 +47,7 @@
 #endif
 
 #include "module-ladspa-sink-symdef.h"
-#include "ladspa.h"
+#include "ladspa-util.h"
 
 PA_MODULE_AUTHOR("Lennart Poettering");
 PA_MODULE_DESCRIPTION(_("Virtual LADSPA sink"));
@@ -82,6 +82,7 @@ struct userdata {
     LADSPA_Handle handle[PA_CHANNELS_MAX];
     unsigned long max_ladspaport_count, input_count, output_count, channels;
     LADSPA_Data **input, **output;
+    unsigned long input_ladspaport[PA_CHANNELS_MAX], output_ladspaport[PA_CHANNELS_MAX];
     size_t block_size;
     LADSPA_Data *control;
     long unsigned n_control;
@@ -441,9 +442,11 @@ static void sink_set_mute_cb(pa_sink *s) {
 static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk) {
     struct userdata *u;
     float *src, *dst;
+    void *p;
     size_t fs;
     unsigned n, h, c;
     pa_memchunk tchunk;
+    bool planar_in, planar_out;
 
     pa_sink_input_assert_ref(i);
     pa_assert(chunk);
@@ -468,21 +471,49 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
 
     pa_assert(n > 0);
 
+    /* If another filter feeds us or we feed another filter the plugin
+     * reads from or writes to the channel planes directly, otherwise
+     * we (de)interleave through our own port buffers. */
+    planar_in = pa_memblock_is_planar(tchunk.memblock);
+    planar_out = pa_sink_input_pop_planar(i);
+
     chunk->index = 0;
     chunk->length = n*fs;
-    chunk->memblock = pa_memblock_new(i->sink->core->mempool, chunk->length);
+    if (planar_out)
+        chunk->memblock = pa_planar_memblock_new(i->sink->core->mempool, chunk->length, &i->sample_spec);
+    else
+        chunk->memblock = pa_memblock_new(i->sink->core->mempool, chunk->length);
 
     pa_memblockq_drop(u->memblockq, chunk->length);
 
-    src = pa_memblock_acquire_chunk(&tchunk);
+    p = pa_memblock_acquire(tchunk.memblock);
     dst = pa_memblock_acquire(chunk->memblock);
+    src = (float*) ((uint8_t*) p + tchunk.index);
 
     for (h = 0; h < (u->channels / u->max_ladspaport_count); h++) {
-        for (c = 0; c < u->input_count; c++)
-            pa_sample_clamp(PA_SAMPLE_FLOAT32NE, u->input[c], sizeof(float), src+ h*u->max_ladspaport_count + c, u->channels*sizeof(float), n);
+        for (c = 0; c < u->input_count; c++) {
+            unsigned ch = h*u->max_ladspaport_count + c;
+
+            if (planar_in)
+                u->descriptor->connect_port(u->handle[h], u->input_ladspaport[c], pa_planar_channel(p, &tchunk, &i->sample_spec, ch));
+            else {
+                pa_sample_clamp(PA_SAMPLE_FLOAT32NE, u->input[c], sizeof(float), src + ch, u->channels*sizeof(float), n);
+                u->descriptor->connect_port(u->handle[h], u->input_ladspaport[c], u->input[c]);
+            }
+        }
+
+        for (c = 0; c < u->output_count; c++) {
+            unsigned ch = h*u->max_ladspaport_count + c;
+
+            u->descriptor->connect_port(u->handle[h], u->output_ladspaport[c],
+                                        planar_out ? pa_planar_channel(dst, chunk, &i->sample_spec, ch) : u->output[c]);
+        }
+
         u->descriptor->run(u->handle[h], n);
-        for (c = 0; c < u->output_count; c++)
-            pa_sample_clamp(PA_SAMPLE_FLOAT32NE, dst + h*u->max_ladspaport_count + c, u->channels*sizeof(float), u->output[c], sizeof(float), n);
+
+        if (!planar_out)
+            for (c = 0; c < u->output_count; c++)
+                pa_sample_clamp(PA_SAMPLE_FLOAT32NE, dst + h*u->max_ladspaport_count + c, u->channels*sizeof(float), u->output[c], sizeof(float), n);
     }
 
     pa_memblock_release(tchunk.memblock);
@@ -949,16 +980,14 @@ int pa__init(pa_module*m) {
     pa_sample_spec ss;
     pa_channel_map map;
     pa_modargs *ma;
-    char *t;
     pa_sink *master;
     pa_sink_input_new_data sink_input_data;
     pa_sink_new_data sink_data;
     const char *plugin, *label, *input_ladspaport_map, *output_ladspaport_map;
-    LADSPA_Descriptor_Function descriptor_func;
     unsigned long input_ladspaport[PA_CHANNELS_MAX], output_ladspaport[PA_CHANNELS_MAX];
-    const char *e, *cdata;
+    const char *cdata;
     const LADSPA_Descriptor *d;
-    unsigned long p, h, j, n_control, c;
+    unsigned long p, h, n_control, c;
 
     pa_assert(m);
 
@@ -1010,36 +1039,8 @@ int pa__init(pa_module*m) {
     u->output = NULL;
     u->ss = ss;
 
-    if (!(e = getenv("LADSPA_PATH")))
-        e = LADSPA_PATH;
-
-    /* FIXME: This is not exactly thread safe */
-    t = pa_xstrdup(lt_dlgetsearchpath());
-    lt_dlsetsearchpath(e);
-    m->dl = lt_dlopenext(plugin);
-    lt_dlsetsearchpath(t);
-    pa_xfree(t);
-
-    if (!m->dl) {
-        pa_log("Failed to load LADSPA plugin: %s", lt_dlerror());
+    if (!(d = pa_ladspa_load(plugin, label, &m->dl)))
         goto fail;
-    }
-
-    if (!(descriptor_func = (LADSPA_Descriptor_Function) pa_load_sym(m->dl, NULL, "ladspa_descriptor"))) {
-        pa_log("LADSPA module lacks ladspa_descriptor() symbol.");
-        goto fail;
-    }
-
-    for (j = 0;; j++) {
-
-        if (!(d = descriptor_func(j))) {
-            pa_log("Failed to find plugin label '%s' in plugin '%s'.", label, plugin);
-            goto fail;
-        }
-
-        if (pa_streq(d->Label, label))
-            break;
-    }
 
     u->descriptor = d;
 
@@ -1144,6 +1145,9 @@ int pa__init(pa_module*m) {
         }
     }
 
+    memcpy(u->input_ladspaport, input_ladspaport, sizeof(input_ladspaport));
+    memcpy(u->output_ladspaport, output_ladspaport, sizeof(output_ladspaport));
+
     u->block_size = pa_frame_align(pa_mempool_block_size_max(m->core->mempool), &ss);
 
     /* Create buffers */
@@ -1252,6 +1256,7 @@ int pa__init(pa_module*m) {
     u->sink->userdata = u;
 
     pa_sink_set_asyncmsgq(u->sink, master->asyncmsgq);
+    pa_sink_set_accept_planar(u->sink, true);
 
     /* Create sink input */
     pa_sink_input_new_data_init(&sink_input_data);
@@ -25,9 +25,11 @@
 #endif
 
 #include <stdio.h>
+#include <math.h>
 
 #include <pulse/xmalloc.h>
 
+#include <pulsecore/atomic.h>
 #include <pulsecore/sink-input.h>
 #include <pulsecore/module.h>
 #include <pulsecore/modargs.h>
@@ -48,6 +50,7 @@ PA_MODULE_USAGE(
         "source=<source to connect to> "
         "sink=<sink to connect to> "
         "adjust_time=<how often to readjust rates in s> "
+        "adjust_mode=<timer or pi> "
         "latency_msec=<latency in ms> "
         "format=<sample format> "
         "rate=<sample rate> "
@@ -65,6 +68,13 @@ PA_MODULE_USAGE(
 
 #define DEFAULT_ADJUST_TIME_USEC (10*PA_USEC_PER_SEC)
 
+/* Time constant of the low pass on the queue length in PI mode */
+#define PI_FILTER_USEC (PA_USEC_PER_SEC)
+
+/* The PI controller never moves the rate further away than this, which
+ * is enough for any sane clock drift */
+#define PI_MAX_DEVIATION 0.005
+
 struct userdata {
     pa_core *core;
     pa_module *module;
@@ -80,6 +90,10 @@ struct userdata {
     pa_time_event *time_event;
     pa_usec_t adjust_time;
 
+    /* Instead of the timer, adjust the rate with a PI controller in
+     * the sink input's thread whenever it pops */
+    bool adjust_pi;
+
     int64_t recv_counter;
     int64_t send_counter;
 
@@ -101,12 +115,26 @@ struct userdata {
         size_t min_memblockq_length;
         size_t max_request;
     } latency_snapshot;
+
+    /* Written by the source output's thread in PI mode */
+    pa_atomic_t source_latency;
+
+    /* The rate the PI controller picked, mirrored to the main thread */
+    pa_atomic_t pi_rate;
+
+    /* PI controller state, owned by the sink input's thread */
+    struct {
+        pa_usec_t timestamp;
+        double error;
+        double integral;
+    } pi;
 };
 
 static const char* const valid_modargs[] = {
     "source",
     "sink",
     "adjust_time",
+    "adjust_mode",
     "latency_msec",
     "format",
     "rate",
@@ -230,6 +258,24 @@ static void adjust_rates(struct userdata *u) {
     pa_core_rttime_restart(u->core, u->time_event, pa_rtclock_now() + u->adjust_time);
 }
 
+/* Called from main context. In PI mode the rate is picked by the sink
+ * input's thread, here we only make it visible to clients. */
+static void update_pi_rate(struct userdata *u) {
+    uint32_t rate;
+
+    pa_assert(u);
+    pa_assert_ctl_context();
+
+    rate = (uint32_t) pa_atomic_load(&u->pi_rate);
+
+    if (rate != u->sink_input->sample_spec.rate) {
+        pa_log_debug("[%s] PI controller changed the sampling rate to %lu Hz.", u->sink_input->sink->name, (unsigned long) rate);
+        pa_sink_input_set_rate(u->sink_input, rate);
+    }
+
+    pa_core_rttime_restart(u->core, u->time_event, pa_rtclock_now() + u->adjust_time);
+}
+
 /* Called from main context */
 static void time_callback(pa_mainloop_api *a, pa_time_event *e, const struct timeval *t, void *userdata) {
     struct userdata *u = userdata;
@@ -238,7 +284,10 @@ static void time_callback(pa_mainloop_api *a, pa_time_event *e, const struct tim
     pa_assert(a);
     pa_assert(u->time_event == e);
 
-    adjust_rates(u);
+    if (u->adjust_pi)
+        update_pi_rate(u);
+    else
+        adjust_rates(u);
 }
 
 /* Called from main context */
@@ -290,6 +339,9 @@ static void source_output_push_cb(pa_source_output *o, const pa_memchunk *chunk)
 
     pa_asyncmsgq_post(u->asyncmsgq, PA_MSGOBJECT(u->sink_input), SINK_INPUT_MESSAGE_POST, NULL, 0, chunk, NULL);
     u->send_counter += (int64_t) chunk->length;
+
+    if (u->adjust_pi)
+        pa_atomic_store(&u->source_latency, (int) pa_source_get_latency_within_thread(o->source));
 }
 
 /* Called from input thread context */
@@ -455,6 +507,68 @@ static void update_min_memblockq_length(struct userdata *u) {
         u->min_memblockq_length = length;
 }
 
+/* Called from output thread context. Keeps the queue at the length
+ * that makes the total latency match the requested one. The queue
+ * length is low pass filtered, since it jumps with every chunk the
+ * source pushes. The controller is critically damped and settles
+ * within a few adjust_time. The integral part ends up holding the
+ * clock drift between source and sink. */
+static void adjust_rate_pi(struct userdata *u) {
+    pa_sink_input *i = u->sink_input;
+    pa_usec_t now, queued, other, target;
+    double dt, kp, ki, deviation;
+    uint32_t base_rate, new_rate;
+
+    pa_assert(u);
+    pa_sink_input_assert_io_context(i);
+
+    now = pa_rtclock_now();
+
+    queued = pa_bytes_to_usec(pa_memblockq_get_length(u->memblockq), &i->sample_spec) +
+        pa_bytes_to_usec(pa_memblockq_get_length(i->thread_info.render_memblockq), &i->sink->sample_spec);
+
+    /* Whatever latency the devices add, keep at least some data queued */
+    other = (pa_usec_t) pa_atomic_load(&u->source_latency) + pa_sink_get_latency_within_thread(i->sink);
+    target = u->latency > other ? u->latency - other : 0;
+    target = PA_MAX(target, u->latency / 4);
+
+    /* Start over with the filter after a pause, but keep the integral,
+     * the drift did not change */
+    if (u->pi.timestamp == 0 || now < u->pi.timestamp || now - u->pi.timestamp > PI_FILTER_USEC) {
+        u->pi.error = ((double) queued - (double) target) / PA_USEC_PER_SEC;
+        u->pi.timestamp = now;
+        return;
+    }
+
+    dt = (double) (now - u->pi.timestamp) / PA_USEC_PER_SEC;
+    u->pi.timestamp = now;
+
+    u->pi.error += (((double) queued - (double) target) / PA_USEC_PER_SEC - u->pi.error) * dt * PA_USEC_PER_SEC / PI_FILTER_USEC;
+
+    kp = 2.0 * PA_USEC_PER_SEC / u->adjust_time;
+    ki = kp * kp / 4.0;
+
+    deviation = kp * u->pi.error + u->pi.integral + ki * u->pi.error * dt;
+
+    /* Don't wind up while we are at the limit */
+    if (deviation > PI_MAX_DEVIATION)
+        deviation = PI_MAX_DEVIATION;
+    else if (deviation < -PI_MAX_DEVIATION)
+        deviation = -PI_MAX_DEVIATION;
+    else
+        u->pi.integral += ki * u->pi.error * dt;
+
+    /* More data queued than we want means we need to consume faster */
+    base_rate = u->source_output->sample_spec.rate;
+    new_rate = (uint32_t) lrint(base_rate * (1.0 + deviation));
+
+    if (new_rate != i->thread_info.sample_spec.rate && i->thread_info.resampler) {
+        i->thread_info.sample_spec.rate = new_rate;
+        pa_resampler_set_input_rate(i->thread_info.resampler, new_rate);
+        pa_atomic_store(&u->pi_rate, (int) new_rate);
+    }
+}
+
 /* Called from output thread context */
 static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk) {
     struct userdata *u;
@@ -479,6 +593,9 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
 
     update_min_memblockq_length(u);
 
+    if (u->adjust_pi && u->adjust_time > 0)
+        adjust_rate_pi(u);
+
     return 0;
 }
 
@@ -581,7 +698,7 @@ static int sink_input_process_msg_cb(pa_msgobject *obj, int code, void *data, in
 
             pa_assert_ctl_context();
 
-            if (u->time_event)
+            if (u->time_event && !u->adjust_pi)
                 adjust_rates(u);
             return 0;
         }
@@ -832,6 +949,13 @@ int pa__init(pa_module *m) {
     else
         u->adjust_time = DEFAULT_ADJUST_TIME_USEC;
 
+    if ((n = pa_modargs_get_value(ma, "adjust_mode", NULL)) && !pa_streq(n, "timer") && !pa_streq(n, "pi")) {
+        pa_log("Invalid adjust_mode, expected timer or pi.");
+        goto fail;
+    }
+
+    u->adjust_pi = n && pa_streq(n, "pi");
+
     pa_sink_input_new_data_init(&sink_input_data);
     sink_input_data.driver = __FILE__;
     sink_input_data.module = m;
@@ -884,6 +1008,8 @@ int pa__init(pa_module *m) {
     ss = u->sink_input->sample_spec;
     map = u->sink_input->channel_map;
 
+    pa_atomic_store(&u->pi_rate, (int) ss.rate);
+
     u->sink_input->parent.process_msg = sink_input_process_msg_cb;
     u->sink_input->pop = sink_input_pop_cb;
     u->sink_input->process_rewind = sink_input_process_rewind_cb;
@@ -238,8 +238,7 @@ int pa__init(pa_module*m) {
     pa_source_set_latency_range(u->source, 0, MAX_LATENCY_USEC);
     u->block_usec = u->source->thread_info.max_latency;
 
-    u->source->thread_info.max_rewind =
-        pa_usec_to_bytes(u->block_usec, &u->source->sample_spec);
+    pa_source_set_max_rewind(u->source, pa_usec_to_bytes(u->block_usec, &u->source->sample_spec));
 
     if (!(u->thread = pa_thread_new("null-source", thread_func, u))) {
         pa_log("Failed to create thread.");
@@ -111,7 +111,7 @@
 #  define TCPWRAP_SERVICE "pulseaudio-native"
 #  define IPV4_PORT PA_NATIVE_DEFAULT_PORT
 #  define UNIX_SOCKET PA_NATIVE_DEFAULT_UNIX_SOCKET
-#  define MODULE_ARGUMENTS_COMMON "cookie", "auth-cookie", "auth-cookie-enabled", "auth-anonymous",
+#  define MODULE_ARGUMENTS_COMMON "cookie", "auth-cookie", "auth-cookie-enabled", "auth-anonymous", "io-threads",
 
 #  ifdef USE_TCP_SOCKETS
 #    include "module-native-protocol-tcp-symdef.h"
@@ -135,6 +135,7 @@
                   "auth-cookie=<path to cookie file> "
                   "auth-cookie-enabled=<enable cookie authentication?> "
                   AUTH_USAGE
+                  "io-threads=<number of threads doing the socket I/O, 0 for the main loop> "
                   SOCKET_USAGE);
 #elif defined(USE_PROTOCOL_ESOUND)
 #  include <pulsecore/protocol-esound.h>
@@ -1430,6 +1430,9 @@ static void start_subscribe(struct userdata *u) {
 #endif
                         );
 
+    if (u->version >= 29)
+        pa_tagstruct_put_boolean(t, false); /* with_info */
+
     pa_pstream_send_tagstruct(u->pstream, t);
 }
 
@@ -68,6 +68,8 @@ PA_MODULE_LOAD_ONCE(false);
 PA_MODULE_USAGE(
         "sink=<name of the sink> "
         "sap_address=<multicast address to listen on> "
+        "latency_msec=<playout delay in ms> "
+        "adaptive_latency=<size the playout delay from the measured jitter, up to latency_msec?> "
 );
 
 #define SAP_PORT 9875
@@ -78,9 +80,15 @@ PA_MODULE_USAGE(
 #define RATE_UPDATE_INTERVAL (5*PA_USEC_PER_SEC)
 #define LATENCY_USEC (500*PA_USEC_PER_MSEC)
 
+/* With adaptive latency we keep this many times the interarrival jitter
+ * queued on top of the sink latency and one packet */
+#define JITTER_FACTOR 4
+
 static const char* const valid_modargs[] = {
     "sink",
     "sap_address",
+    "latency_msec",
+    "adaptive_latency",
     NULL
 };
 
@@ -110,6 +118,15 @@ struct session {
     pa_usec_t last_latency;
     double estimated_rate;
     double avg_estimated_rate;
+
+    /* Adaptive playout delay, only used from the I/O thread */
+    bool adaptive_latency;
+    pa_usec_t max_latency;
+    bool have_arrival;
+    pa_usec_t last_arrival;
+    uint32_t last_rtp_timestamp;
+    pa_usec_t packet_usec;
+    double jitter;
 };
 
 struct userdata {
@@ -122,6 +139,8 @@ struct userdata {
     pa_time_event *check_death_event;
 
     char *sink_name;
+    pa_usec_t latency;
+    bool adaptive_latency;
 
     PA_LLIST_HEAD(struct session, sessions);
     pa_hashmap *by_origin;
@@ -202,36 +221,50 @@ static void sink_input_suspend_within_thread(pa_sink_input* i, bool b) {
         s->first_packet = false;
 }
 
-/* Called from I/O thread context */
-static int rtpoll_work_cb(pa_rtpoll_item *i) {
-    pa_memchunk chunk;
-    int64_t k, j, delta;
-    struct timeval now = { 0, 0 };
-    struct session *s;
-    struct pollfd *p;
+/* Called from I/O thread context. Estimates the interarrival jitter as
+ * described in RFC 3550, section 6.4.1. */
+static void update_jitter(struct session *s, pa_usec_t arrival) {
+    double d;
 
-    pa_assert_se(s = pa_rtpoll_item_get_userdata(i));
+    if (s->have_arrival) {
+        d = (double) arrival - (double) s->last_arrival -
+            (double) (int32_t) (s->rtp_context.timestamp - s->last_rtp_timestamp) * PA_USEC_PER_SEC / s->sdp_info.sample_spec.rate;
 
-    p = pa_rtpoll_item_get_pollfd(i, NULL);
-
-    if (p->revents & (POLLERR|POLLNVAL|POLLHUP|POLLOUT)) {
-        pa_log("poll() signalled bad revents.");
-        return -1;
+        s->jitter += (fabs(d) - s->jitter) / 16;
     }
 
-    if ((p->revents & POLLIN) == 0)
-        return 0;
+    s->have_arrival = true;
+    s->last_arrival = arrival;
+    s->last_rtp_timestamp = s->rtp_context.timestamp;
+}
 
-    p->revents = 0;
+/* Called from I/O thread context. Grows the playout delay immediately
+ * when the jitter increases, but shrinks it only slowly. The rate
+ * adjustment then moves the queue towards the new delay. After an
+ * underrun the queue prebuffers the new delay. */
+static void update_intended_latency(struct session *s) {
+    pa_usec_t target;
 
-    if (pa_rtp_recv(&s->rtp_context, &chunk, s->userdata->module->core->mempool, &now) < 0)
-        return 0;
+    target = s->sink_latency + s->packet_usec + (pa_usec_t) (JITTER_FACTOR * s->jitter);
+    target = PA_CLAMP(target, s->sink_latency * 2, s->max_latency);
+
+    if (target > s->intended_latency)
+        s->intended_latency = target;
+    else
+        s->intended_latency -= (s->intended_latency - target) / 4;
+
+    pa_memblockq_set_prebuf(s->memblockq, pa_usec_to_bytes(s->intended_latency - s->sink_latency, &s->sink_input->sample_spec));
+
+    pa_log_debug("Interarrival jitter %0.2f ms, playout delay %0.2f ms", s->jitter / PA_USEC_PER_MSEC, (double) s->intended_latency / PA_USEC_PER_MSEC);
+}
+
+/* Called from I/O thread context. Returns true if the packet was queued. */
+static bool session_push(struct session *s, pa_memchunk *chunk, struct timeval *now) {
+    int64_t k, j, delta;
 
     if (s->sdp_info.payload != s->rtp_context.payload ||
-        !PA_SINK_IS_OPENED(s->sink_input->sink->thread_info.state)) {
-        pa_memblock_unref(chunk.memblock);
-        return 0;
-    }
+        !PA_SINK_IS_OPENED(s->sink_input->sink->thread_info.state))
+        return false;
 
     if (!s->first_packet) {
         s->first_packet = true;
@@ -242,10 +275,8 @@ static int rtpoll_work_cb(pa_rtpoll_item *i) {
         if (s->ssrc == s->userdata->module->core->cookie)
             pa_log_warn("Detected RTP packet loop!");
     } else {
-        if (s->ssrc != s->rtp_context.ssrc) {
-            pa_memblock_unref(chunk.memblock);
-            return 0;
-        }
+        if (s->ssrc != s->rtp_context.ssrc)
+            return false;
     }
 
     /* Check whether there was a timestamp overflow */
@@ -259,27 +290,78 @@ static int rtpoll_work_cb(pa_rtpoll_item *i) {
 
     pa_memblockq_seek(s->memblockq, delta * (int64_t) s->rtp_context.frame_size, PA_SEEK_RELATIVE, true);
 
-    if (now.tv_sec == 0) {
+    if (now->tv_sec == 0) {
         PA_ONCE_BEGIN {
             pa_log_warn("Using artificial time instead of timestamp");
         } PA_ONCE_END;
-        pa_rtclock_get(&now);
+        pa_rtclock_get(now);
     } else
-        pa_rtclock_from_wallclock(&now);
+        pa_rtclock_from_wallclock(now);
+
+    if (s->adaptive_latency) {
+        update_jitter(s, pa_timeval_load(now));
+        s->packet_usec = pa_bytes_to_usec(chunk->length, &s->sink_input->sample_spec);
+    }
 
-    if (pa_memblockq_push(s->memblockq, &chunk) < 0) {
+    if (pa_memblockq_push(s->memblockq, chunk) < 0) {
         pa_log_warn("Queue overrun");
-        pa_memblockq_seek(s->memblockq, (int64_t) chunk.length, PA_SEEK_RELATIVE, true);
+        pa_memblockq_seek(s->memblockq, (int64_t) chunk->length, PA_SEEK_RELATIVE, true);
     }
 
 /*     pa_log("blocks in q: %u", pa_memblockq_get_nblocks(s->memblockq)); */
 
-    pa_memblock_unref(chunk.memblock);
-
     /* The next timestamp we expect */
-    s->offset = s->rtp_context.timestamp + (uint32_t) (chunk.length / s->rtp_context.frame_size);
+    s->offset = s->rtp_context.timestamp + (uint32_t) (chunk->length / s->rtp_context.frame_size);
 
-    pa_atomic_store(&s->timestamp, (int) now.tv_sec);
+    pa_atomic_store(&s->timestamp, (int) now->tv_sec);
+
+    return true;
+}
+
+/* Called from I/O thread context */
+static int rtpoll_work_cb(pa_rtpoll_item *i) {
+    struct timeval now = { 0, 0 };
+    struct session *s;
+    struct pollfd *p;
+    bool pushed = false;
+
+    pa_assert_se(s = pa_rtpoll_item_get_userdata(i));
+
+    p = pa_rtpoll_item_get_pollfd(i, NULL);
+
+    if (p->revents & (POLLERR|POLLNVAL|POLLHUP|POLLOUT)) {
+        pa_log("poll() signalled bad revents.");
+        return -1;
+    }
+
+    if ((p->revents & POLLIN) == 0)
+        return 0;
+
+    p->revents = 0;
+
+    /* Take everything that is queued on the socket, the packets are read
+     * in batches */
+    for (;;) {
+        pa_memchunk chunk;
+        struct timeval tstamp = { 0, 0 };
+        int r;
+
+        if ((r = pa_rtp_recv(&s->rtp_context, &chunk, s->userdata->module->core->mempool, &tstamp)) == 0)
+            break;
+
+        if (r < 0)
+            continue;
+
+        if (session_push(s, &chunk, &tstamp)) {
+            now = tstamp;
+            pushed = true;
+        }
+
+        pa_memblock_unref(chunk.memblock);
+    }
+
+    if (!pushed)
+        return 0;
 
     if (s->last_rate_update + RATE_UPDATE_INTERVAL < pa_timeval_load(&now)) {
         pa_usec_t wi, ri, render_delay, sink_delay = 0, latency;
@@ -290,6 +372,9 @@ static int rtpoll_work_cb(pa_rtpoll_item *i) {
 
         pa_log_debug("Updating sample rate");
 
+        if (s->adaptive_latency)
+            update_intended_latency(s);
+
         wi = pa_bytes_to_usec((uint64_t) pa_memblockq_get_write_index(s->memblockq), &s->sink_input->sample_spec);
         ri = pa_bytes_to_usec((uint64_t) pa_memblockq_get_read_index(s->memblockq), &s->sink_input->sample_spec);
 
@@ -508,9 +593,10 @@ static struct session *session_new(struct userdata *u, const pa_sdp_info *sdp_in
     s->first_packet = false;
     s->sdp_info = *sdp_info;
     s->rtpoll_item = NULL;
-    s->intended_latency = LATENCY_USEC;
+    s->intended_latency = u->latency;
+    s->adaptive_latency = u->adaptive_latency;
     s->last_rate_update = pa_timeval_load(&now);
-    s->last_latency = LATENCY_USEC;
+    s->last_latency = u->latency;
     s->estimated_rate = (double) sink->sample_spec.rate;
     s->avg_estimated_rate = (double) sink->sample_spec.rate;
     pa_atomic_store(&s->timestamp, (int) now.tv_sec);
@@ -562,6 +648,8 @@ static struct session *session_new(struct userdata *u, const pa_sdp_info *sdp_in
     if (s->intended_latency < s->sink_latency*2)
         s->intended_latency = s->sink_latency*2;
 
+    s->max_latency = s->intended_latency;
+
     s->memblockq = pa_memblockq_new(
             "module-rtp-recv memblockq",
             0,
@@ -694,6 +782,8 @@ int pa__init(pa_module*m) {
     struct sockaddr *sa;
     socklen_t salen;
     const char *sap_address;
+    uint32_t latency_msec;
+    bool adaptive_latency = false;
     int fd = -1;
 
     pa_assert(m);
@@ -703,6 +793,17 @@ int pa__init(pa_module*m) {
         goto fail;
     }
 
+    latency_msec = LATENCY_USEC / PA_USEC_PER_MSEC;
+    if (pa_modargs_get_value_u32(ma, "latency_msec", &latency_msec) < 0 || latency_msec < 1 || latency_msec > 300000) {
+        pa_log("Invalid latency specification");
+        goto fail;
+    }
+
+    if (pa_modargs_get_value_boolean(ma, "adaptive_latency", &adaptive_latency) < 0) {
+        pa_log("Failed to parse \"adaptive_latency\" parameter.");
+        goto fail;
+    }
+
     sap_address = pa_modargs_get_value(ma, "sap_address", DEFAULT_SAP_ADDRESS);
 
     if (inet_pton(AF_INET, sap_address, &sa4.sin_addr) > 0) {
@@ -729,6 +830,8 @@ int pa__init(pa_module*m) {
     u->module = m;
     u->core = m->core;
     u->sink_name = pa_xstrdup(pa_modargs_get_value(ma, "sink", NULL));
+    u->latency = (pa_usec_t) latency_msec * PA_USEC_PER_MSEC;
+    u->adaptive_latency = adaptive_latency;
 
     u->sap_event = m->core->mainloop->io_new(m->core->mainloop, fd, PA_IO_EVENT_INPUT, sap_event_cb, u);
     pa_sap_context_init_recv(&u->sap_context, fd);
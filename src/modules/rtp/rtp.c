@@ -27,11 +27,6 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
-
-#ifdef HAVE_SYS_FILIO_H
-#include <sys/filio.h>
-#endif
 
 #ifdef HAVE_SYS_UIO_H
 #include <sys/uio.h>
@@ -57,15 +52,105 @@ pa_rtp_context* pa_rtp_context_init_send(pa_rtp_context *c, int fd, uint32_t ssr
     c->frame_size = frame_size;
 
     pa_memchunk_reset(&c->memchunk);
+    c->packets_block = NULL;
+    c->n_packets = c->packet_idx = 0;
 
     return c;
 }
 
 #define MAX_IOVECS 16
 
+/* Received packets are read into slots of this size, the size is
+ * doubled whenever a packet doesn't fit */
+#define SLOT_SIZE_DEFAULT 2048
+#define SLOT_SIZE_MAX (64*1024)
+
+#if defined(HAVE_SENDMMSG) || defined(HAVE_RECVMMSG)
+typedef struct mmsghdr packet_msg;
+#else
+typedef struct packet_msg {
+    struct msghdr msg_hdr;
+    unsigned msg_len;
+} packet_msg;
+#endif
+
+/* Returns how many of the n packets were sent, or -1 if not even the
+ * first one was */
+static int send_packets(int fd, packet_msg *m, unsigned n) {
+    unsigned i = 0;
+
+#ifdef HAVE_SENDMMSG
+    while (i < n) {
+        int r;
+
+        /* On a partial send the error is reported by the next call */
+        if ((r = sendmmsg(fd, m + i, n - i, MSG_DONTWAIT)) < 0)
+            return i > 0 ? (int) i : -1;
+
+        i += (unsigned) r;
+    }
+#else
+    for (; i < n; i++) {
+        ssize_t r;
+
+        if ((r = sendmsg(fd, &m[i].msg_hdr, MSG_DONTWAIT)) < 0)
+            return i > 0 ? (int) i : -1;
+
+        m[i].msg_len = (unsigned) r;
+    }
+#endif
+
+    return (int) n;
+}
+
+/* Returns how many packets were received, or -1 on error */
+static int recv_packets(int fd, packet_msg *m, unsigned n) {
+#ifdef HAVE_RECVMMSG
+    return recvmmsg(fd, m, n, MSG_DONTWAIT, NULL);
+#else
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        ssize_t r;
+
+        if ((r = recvmsg(fd, &m[i].msg_hdr, MSG_DONTWAIT)) < 0)
+            return i > 0 ? (int) i : -1;
+
+        m[i].msg_len = (unsigned) r;
+    }
+
+    return (int) n;
+#endif
+}
+
+static int flush_packets(pa_rtp_context *c, packet_msg *m, pa_memblock *mb[][MAX_IOVECS], unsigned n) {
+    unsigned i, j;
+    int k, err;
+
+    k = send_packets(c->fd, m, n);
+    err = errno;
+
+    for (i = 0; i < n; i++)
+        for (j = 1; j < m[i].msg_hdr.msg_iovlen; j++) {
+            pa_memblock_release(mb[i][j]);
+            pa_memblock_unref(mb[i][j]);
+        }
+
+    if (k < (int) n) {
+        if (err != EAGAIN && err != EINTR) /* If the queue is full, just ignore it */
+            pa_log("sendmsg() failed: %s", pa_cstrerror(err));
+        return -1;
+    }
+
+    return 0;
+}
+
 int pa_rtp_send(pa_rtp_context *c, size_t size, pa_memblockq *q) {
-    struct iovec iov[MAX_IOVECS];
-    pa_memblock* mb[MAX_IOVECS];
+    struct iovec iov[PA_RTP_BATCH_MAX][MAX_IOVECS];
+    pa_memblock* mb[PA_RTP_BATCH_MAX][MAX_IOVECS];
+    uint32_t header[PA_RTP_BATCH_MAX][3];
+    packet_msg m[PA_RTP_BATCH_MAX];
+    unsigned n_packets = 0;
     int iov_idx = 1;
     size_t n = 0;
 
@@ -88,9 +173,9 @@ int pa_rtp_send(pa_rtp_context *c, size_t size, pa_memblockq *q) {
 
             pa_assert(chunk.memblock);
 
-            iov[iov_idx].iov_base = pa_memblock_acquire_chunk(&chunk);
-            iov[iov_idx].iov_len = k;
-            mb[iov_idx] = chunk.memblock;
+            iov[n_packets][iov_idx].iov_base = pa_memblock_acquire_chunk(&chunk);
+            iov[n_packets][iov_idx].iov_len = k;
+            mb[n_packets][iov_idx] = chunk.memblock;
             iov_idx ++;
 
             n += k;
@@ -100,47 +185,35 @@ int pa_rtp_send(pa_rtp_context *c, size_t size, pa_memblockq *q) {
         pa_assert(n % c->frame_size == 0);
 
         if (r < 0 || n >= size || iov_idx >= MAX_IOVECS) {
-            uint32_t header[3];
-            struct msghdr m;
-            ssize_t k;
-            int i;
+            bool done = r < 0 || pa_memblockq_get_length(q) < size;
 
             if (n > 0) {
-                header[0] = htonl(((uint32_t) 2 << 30) | ((uint32_t) c->payload << 16) | ((uint32_t) c->sequence));
-                header[1] = htonl(c->timestamp);
-                header[2] = htonl(c->ssrc);
-
-                iov[0].iov_base = (void*)header;
-                iov[0].iov_len = sizeof(header);
+                header[n_packets][0] = htonl(((uint32_t) 2 << 30) | ((uint32_t) c->payload << 16) | ((uint32_t) c->sequence));
+                header[n_packets][1] = htonl(c->timestamp);
+                header[n_packets][2] = htonl(c->ssrc);
 
-                m.msg_name = NULL;
-                m.msg_namelen = 0;
-                m.msg_iov = iov;
-                m.msg_iovlen = (size_t) iov_idx;
-                m.msg_control = NULL;
-                m.msg_controllen = 0;
-                m.msg_flags = 0;
+                iov[n_packets][0].iov_base = (void*)header[n_packets];
+                iov[n_packets][0].iov_len = sizeof(header[n_packets]);
 
-                k = sendmsg(c->fd, &m, MSG_DONTWAIT);
-
-                for (i = 1; i < iov_idx; i++) {
-                    pa_memblock_release(mb[i]);
-                    pa_memblock_unref(mb[i]);
-                }
+                pa_zero(m[n_packets]);
+                m[n_packets].msg_hdr.msg_iov = iov[n_packets];
+                m[n_packets].msg_hdr.msg_iovlen = (size_t) iov_idx;
 
+                n_packets++;
                 c->sequence++;
-            } else
-                k = 0;
+            }
 
             c->timestamp += (unsigned) (n/c->frame_size);
 
-            if (k < 0) {
-                if (errno != EAGAIN && errno != EINTR) /* If the queue is full, just ignore it */
-                    pa_log("sendmsg() failed: %s", pa_cstrerror(errno));
-                return -1;
+            /* Hand the packets to the kernel in as few calls as possible */
+            if (n_packets >= PA_RTP_BATCH_MAX || (done && n_packets > 0)) {
+                if (flush_packets(c, m, mb, n_packets) < 0)
+                    return -1;
+
+                n_packets = 0;
             }
 
-            if (r < 0 || pa_memblockq_get_length(q) < size)
+            if (done)
                 break;
 
             n = 0;
@@ -157,81 +230,142 @@ pa_rtp_context* pa_rtp_context_init_recv(pa_rtp_context *c, int fd, size_t frame
     c->fd = fd;
     c->frame_size = frame_size;
 
+    c->slot_size = SLOT_SIZE_DEFAULT;
+    c->packets_block = NULL;
+    c->n_packets = c->packet_idx = 0;
+
     pa_memchunk_reset(&c->memchunk);
     return c;
 }
 
-int pa_rtp_recv(pa_rtp_context *c, pa_memchunk *chunk, pa_mempool *pool, struct timeval *tstamp) {
-    int size;
-    struct msghdr m;
-    struct cmsghdr *cm;
-    struct iovec iov;
-    uint32_t header;
-    unsigned cc;
-    ssize_t r;
-    uint8_t aux[1024];
-    bool found_tstamp = false;
-
-    pa_assert(c);
-    pa_assert(chunk);
-
-    pa_memchunk_reset(chunk);
-
-    if (ioctl(c->fd, FIONREAD, &size) < 0) {
-        pa_log_warn("FIONREAD failed: %s", pa_cstrerror(errno));
-        goto fail;
+/* Reads as many packets as are queued on the socket, up to
+ * PA_RTP_BATCH_MAX, into the unused part of the current memblock. Returns
+ * the number of packets read. */
+static int recv_batch(pa_rtp_context *c, pa_mempool *pool) {
+    packet_msg m[PA_RTP_BATCH_MAX];
+    struct iovec iov[PA_RTP_BATCH_MAX];
+    uint8_t aux[PA_RTP_BATCH_MAX][128];
+    uint8_t *d;
+    unsigned n, i;
+    int r;
+
+    if (c->packets_block) {
+        pa_memblock_unref(c->packets_block);
+        c->packets_block = NULL;
     }
 
-    if (size <= 0)
-        return 0;
-
-    if (c->memchunk.length < (unsigned) size) {
-        size_t l;
+    c->n_packets = c->packet_idx = 0;
 
+    if (c->memchunk.length < c->slot_size) {
         if (c->memchunk.memblock)
             pa_memblock_unref(c->memchunk.memblock);
 
-        l = PA_MAX((size_t) size, pa_mempool_block_size_max(pool));
-
-        c->memchunk.memblock = pa_memblock_new(pool, l);
+        c->memchunk.memblock = pa_memblock_new(pool, PA_MAX(c->slot_size, pa_mempool_block_size_max(pool)));
         c->memchunk.index = 0;
         c->memchunk.length = pa_memblock_get_length(c->memchunk.memblock);
     }
 
-    pa_assert(c->memchunk.length >= (size_t) size);
+    n = (unsigned) PA_MIN((size_t) PA_RTP_BATCH_MAX, c->memchunk.length / c->slot_size);
+    pa_assert(n > 0);
 
-    chunk->memblock = pa_memblock_ref(c->memchunk.memblock);
-    chunk->index = c->memchunk.index;
+    d = pa_memblock_acquire_chunk(&c->memchunk);
 
-    iov.iov_base = pa_memblock_acquire_chunk(chunk);
-    iov.iov_len = (size_t) size;
+    for (i = 0; i < n; i++) {
+        iov[i].iov_base = d + i * c->slot_size;
+        iov[i].iov_len = c->slot_size;
 
-    m.msg_name = NULL;
-    m.msg_namelen = 0;
-    m.msg_iov = &iov;
-    m.msg_iovlen = 1;
-    m.msg_control = aux;
-    m.msg_controllen = sizeof(aux);
-    m.msg_flags = 0;
+        pa_zero(m[i]);
+        m[i].msg_hdr.msg_iov = &iov[i];
+        m[i].msg_hdr.msg_iovlen = 1;
+        m[i].msg_hdr.msg_control = aux[i];
+        m[i].msg_hdr.msg_controllen = sizeof(aux[i]);
+    }
 
-    r = recvmsg(c->fd, &m, 0);
-    pa_memblock_release(chunk->memblock);
+    r = recv_packets(c->fd, m, n);
+    pa_memblock_release(c->memchunk.memblock);
 
-    if (r != size) {
+    if (r <= 0) {
         if (r < 0 && errno != EAGAIN && errno != EINTR)
-            pa_log_warn("recvmsg() failed: %s", r < 0 ? pa_cstrerror(errno) : "size mismatch");
+            pa_log_warn("recvmsg() failed: %s", pa_cstrerror(errno));
+
+        return 0;
+    }
+
+    for (i = 0; i < (unsigned) r; i++) {
+        struct cmsghdr *cm;
+        bool found_tstamp = false;
+
+        if (m[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            pa_log_warn("RTP packet larger than %lu bytes, dropped.", (unsigned long) c->slot_size);
+            continue;
+        }
+
+        c->packets[c->n_packets].index = c->memchunk.index + i * c->slot_size;
+        c->packets[c->n_packets].length = m[i].msg_len;
+
+        for (cm = CMSG_FIRSTHDR(&m[i].msg_hdr); cm; cm = CMSG_NXTHDR(&m[i].msg_hdr, cm))
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMP) {
+                memcpy(&c->packets[c->n_packets].tstamp, CMSG_DATA(cm), sizeof(struct timeval));
+                found_tstamp = true;
+                break;
+            }
+
+        if (!found_tstamp) {
+            pa_log_warn("Couldn't find SCM_TIMESTAMP data in auxiliary recvmsg() data!");
+            pa_zero(c->packets[c->n_packets].tstamp);
+        }
 
-        goto fail;
+        c->n_packets++;
     }
 
+    /* Make room for the next packets that were too large */
+    for (i = 0; i < (unsigned) r; i++)
+        if ((m[i].msg_hdr.msg_flags & MSG_TRUNC) && c->slot_size < SLOT_SIZE_MAX) {
+            c->slot_size = PA_MIN(c->slot_size * 2, (size_t) SLOT_SIZE_MAX);
+            break;
+        }
+
+    c->packets_block = pa_memblock_ref(c->memchunk.memblock);
+
+    c->memchunk.index += (size_t) r * c->slot_size;
+    c->memchunk.length -= (size_t) r * c->slot_size;
+
+    if (c->memchunk.length <= 0) {
+        pa_memblock_unref(c->memchunk.memblock);
+        pa_memchunk_reset(&c->memchunk);
+    }
+
+    return r;
+}
+
+int pa_rtp_recv(pa_rtp_context *c, pa_memchunk *chunk, pa_mempool *pool, struct timeval *tstamp) {
+    uint32_t header;
+    unsigned cc, idx;
+    size_t size;
+    uint8_t *d;
+
+    pa_assert(c);
+    pa_assert(chunk);
+
+    pa_memchunk_reset(chunk);
+
+    while (c->packet_idx >= c->n_packets)
+        if (recv_batch(c, pool) <= 0)
+            return 0;
+
+    idx = c->packet_idx++;
+    size = c->packets[idx].length;
+
     if (size < 12) {
         pa_log_warn("RTP packet too short.");
-        goto fail;
+        return -1;
     }
 
-    memcpy(&header, iov.iov_base, sizeof(uint32_t));
-    memcpy(&c->timestamp, (uint8_t*) iov.iov_base + 4, sizeof(uint32_t));
-    memcpy(&c->ssrc, (uint8_t*) iov.iov_base + 8, sizeof(uint32_t));
+    d = (uint8_t*) pa_memblock_acquire(c->packets_block) + c->packets[idx].index;
+    memcpy(&header, d, sizeof(uint32_t));
+    memcpy(&c->timestamp, d + 4, sizeof(uint32_t));
+    memcpy(&c->ssrc, d + 8, sizeof(uint32_t));
+    pa_memblock_release(c->packets_block);
 
     header = ntohl(header);
     c->timestamp = ntohl(c->timestamp);
@@ -239,63 +373,40 @@ int pa_rtp_recv(pa_rtp_context *c, pa_memchunk *chunk, pa_mempool *pool, struct
 
     if ((header >> 30) != 2) {
         pa_log_warn("Unsupported RTP version.");
-        goto fail;
+        return -1;
     }
 
     if ((header >> 29) & 1) {
         pa_log_warn("RTP padding not supported.");
-        goto fail;
+        return -1;
     }
 
     if ((header >> 28) & 1) {
         pa_log_warn("RTP header extensions not supported.");
-        goto fail;
+        return -1;
     }
 
     cc = (header >> 24) & 0xF;
     c->payload = (uint8_t) ((header >> 16) & 127U);
     c->sequence = (uint16_t) (header & 0xFFFFU);
 
-    if (12 + cc*4 > (unsigned) size) {
+    if (12 + cc*4 > size) {
         pa_log_warn("RTP packet too short. (CSRC)");
-        goto fail;
+        return -1;
     }
 
-    chunk->index += 12 + cc*4;
-    chunk->length = (size_t) size - 12 + cc*4;
-
-    if (chunk->length % c->frame_size != 0) {
+    if ((size - 12 - cc*4) % c->frame_size != 0) {
         pa_log_warn("Bad RTP packet size.");
-        goto fail;
-    }
-
-    c->memchunk.index = chunk->index + chunk->length;
-    c->memchunk.length = pa_memblock_get_length(c->memchunk.memblock) - c->memchunk.index;
-
-    if (c->memchunk.length <= 0) {
-        pa_memblock_unref(c->memchunk.memblock);
-        pa_memchunk_reset(&c->memchunk);
-    }
-
-    for (cm = CMSG_FIRSTHDR(&m); cm; cm = CMSG_NXTHDR(&m, cm))
-        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMP) {
-            memcpy(tstamp, CMSG_DATA(cm), sizeof(struct timeval));
-            found_tstamp = true;
-            break;
-        }
-
-    if (!found_tstamp) {
-        pa_log_warn("Couldn't find SCM_TIMESTAMP data in auxiliary recvmsg() data!");
-        pa_zero(*tstamp);
+        return -1;
     }
 
-    return 0;
+    chunk->memblock = pa_memblock_ref(c->packets_block);
+    chunk->index = c->packets[idx].index + 12 + cc*4;
+    chunk->length = size - 12 - cc*4;
 
-fail:
-    if (chunk->memblock)
-        pa_memblock_unref(chunk->memblock);
+    *tstamp = c->packets[idx].tstamp;
 
-    return -1;
+    return 1;
 }
 
 uint8_t pa_rtp_payload_from_sample_spec(const pa_sample_spec *ss) {
@@ -378,6 +489,9 @@ void pa_rtp_context_destroy(pa_rtp_context *c) {
 
     if (c->memchunk.memblock)
         pa_memblock_unref(c->memchunk.memblock);
+
+    if (c->packets_block)
+        pa_memblock_unref(c->packets_block);
 }
 
 const char* pa_rtp_format_to_string(pa_sample_format_t f) {
@@ -24,10 +24,14 @@
 
 #include <inttypes.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <pulsecore/memblockq.h>
 #include <pulsecore/memchunk.h>
 
+/* How many packets we send or receive with a single system call */
+#define PA_RTP_BATCH_MAX 16
+
 typedef struct pa_rtp_context {
     int fd;
     uint16_t sequence;
@@ -37,6 +41,17 @@ typedef struct pa_rtp_context {
     size_t frame_size;
 
     pa_memchunk memchunk;
+
+    /* Receiving: packets read by the last batch that have not been
+     * returned yet. They all live in packets_block. */
+    size_t slot_size;
+    pa_memblock *packets_block;
+    unsigned n_packets, packet_idx;
+    struct {
+        size_t index;
+        size_t length;
+        struct timeval tstamp;
+    } packets[PA_RTP_BATCH_MAX];
 } pa_rtp_context;
 
 pa_rtp_context* pa_rtp_context_init_send(pa_rtp_context *c, int fd, uint32_t ssrc, uint8_t payload, size_t frame_size);
@@ -46,6 +61,11 @@ pa_rtp_context* pa_rtp_context_init_send(pa_rtp_context *c, int fd, uint32_t ssr
 int pa_rtp_send(pa_rtp_context *c, size_t size, pa_memblockq *q);
 
 pa_rtp_context* pa_rtp_context_init_recv(pa_rtp_context *c, int fd, size_t frame_size);
+
+/* Returns 1 and fills in chunk if a packet was received, 0 if there are
+ * no more packets queued on the socket and a negative value if a bad
+ * packet was skipped. Packets are read from the socket in batches, so
+ * call this until it returns 0. */
 int pa_rtp_recv(pa_rtp_context *c, pa_memchunk *chunk, pa_mempool *pool, struct timeval *tstamp);
 
 void pa_rtp_context_destroy(pa_rtp_context *c);
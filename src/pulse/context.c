@@ -111,6 +111,9 @@ static void reset_callbacks(pa_context *c) {
     c->subscribe_callback = NULL;
     c->subscribe_userdata = NULL;
 
+    c->subscribe_info_callback = NULL;
+    c->subscribe_info_userdata = NULL;
+
     c->event_callback = NULL;
     c->event_userdata = NULL;
 
@@ -199,6 +202,16 @@ static void context_unlink(pa_context *c) {
         s = n;
     }
 
+    if (c->object_cache) {
+        pa_object_cache_free(c->object_cache);
+        c->object_cache = NULL;
+    }
+
+    if (c->timing_page) {
+        pa_timing_page_free(c->timing_page);
+        c->timing_page = NULL;
+    }
+
     while (c->operations)
         pa_operation_cancel(c->operations);
 
@@ -408,6 +421,24 @@ int pa_context_handle_error(pa_context *c, uint32_t command, pa_tagstruct *t, bo
     return 0;
 }
 
+static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
+
+static void send_client_name(pa_context *c) {
+    pa_tagstruct *t;
+    uint32_t tag;
+
+    t = pa_tagstruct_command(c, PA_COMMAND_SET_CLIENT_NAME, &tag);
+
+    if (c->version >= 13) {
+        pa_init_proplist(c->proplist);
+        pa_tagstruct_put_proplist(t, c->proplist);
+    } else
+        pa_tagstruct_puts(t, pa_proplist_gets(c->proplist, PA_PROP_APPLICATION_NAME));
+
+    pa_pstream_send_tagstruct(c->pstream, t);
+    pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, setup_complete_callback, c, NULL);
+}
+
 static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_context *c = userdata;
 
@@ -424,7 +455,6 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
 
     switch(c->state) {
         case PA_CONTEXT_AUTHORIZING: {
-            pa_tagstruct *reply;
             bool shm_on_remote = false;
 
             if (pa_tagstruct_getu32(t, &c->version) < 0 ||
@@ -449,6 +479,14 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
 
             pa_log_debug("Protocol version: remote %u, local %u", c->version, PA_PROTOCOL_VERSION);
 
+            /* The client name went out in the format of version 13, and
+             * anything else that was sent already in that of our own */
+            if (c->fast_connect && (c->version < 13 || (c->pipelined && c->version < PA_PROTOCOL_VERSION))) {
+                pa_log_debug("Server too old for the requests sent before its version was known.");
+                pa_context_fail(c, PA_ERR_VERSION);
+                goto finish;
+            }
+
             /* Enable shared memory support if possible */
             if (c->do_shm)
                 if (c->version < 10 || (c->version >= 13 && !shm_on_remote))
@@ -470,16 +508,9 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
             pa_log_debug("Negotiated SHM: %s", pa_yes_no(c->do_shm));
             pa_pstream_enable_shm(c->pstream, c->do_shm);
 
-            reply = pa_tagstruct_command(c, PA_COMMAND_SET_CLIENT_NAME, &tag);
-
-            if (c->version >= 13) {
-                pa_init_proplist(c->proplist);
-                pa_tagstruct_put_proplist(reply, c->proplist);
-            } else
-                pa_tagstruct_puts(reply, pa_proplist_gets(c->proplist, PA_PROP_APPLICATION_NAME));
-
-            pa_pstream_send_tagstruct(c->pstream, reply);
-            pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, setup_complete_callback, c, NULL);
+            /* With fast connect the name is on its way already */
+            if (!c->fast_connect)
+                send_client_name(c);
 
             pa_context_set_state(c, PA_CONTEXT_SETTING_NAME);
             break;
@@ -558,6 +589,14 @@ static void setup_context(pa_context *c, pa_iochannel *io) {
 
     pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, setup_complete_callback, c, NULL);
 
+    /* Don't wait for the server's version, assume it's at least ours.
+     * The reply to AUTH tells whether that was right. */
+    c->pipelined = false;
+    if (c->fast_connect) {
+        c->version = PA_PROTOCOL_VERSION;
+        send_client_name(c);
+    }
+
     pa_context_set_state(c, PA_CONTEXT_AUTHORIZING);
 
     pa_context_unref(c);
@@ -875,7 +914,7 @@ int pa_context_connect(
 
     PA_CHECK_VALIDITY(c, !pa_detect_fork(), PA_ERR_FORKED);
     PA_CHECK_VALIDITY(c, c->state == PA_CONTEXT_UNCONNECTED, PA_ERR_BADSTATE);
-    PA_CHECK_VALIDITY(c, !(flags & ~(PA_CONTEXT_NOAUTOSPAWN|PA_CONTEXT_NOFAIL)), PA_ERR_INVALID);
+    PA_CHECK_VALIDITY(c, !(flags & ~(PA_CONTEXT_NOAUTOSPAWN|PA_CONTEXT_NOFAIL|PA_CONTEXT_FAST_CONNECT)), PA_ERR_INVALID);
     PA_CHECK_VALIDITY(c, !server || *server, PA_ERR_INVALID);
 
     if (server)
@@ -886,6 +925,7 @@ int pa_context_connect(
     pa_context_ref(c);
 
     c->no_fail = !!(flags & PA_CONTEXT_NOFAIL);
+    c->fast_connect = !!(flags & PA_CONTEXT_FAST_CONNECT);
     c->server_specified = !!server;
     pa_assert(!c->server_list);
 
@@ -1247,6 +1287,22 @@ uint32_t pa_context_get_server_protocol_version(pa_context *c) {
     return c->version;
 }
 
+bool pa_context_accepts_requests(pa_context *c) {
+    pa_assert(c);
+
+    if (c->state == PA_CONTEXT_READY)
+        return true;
+
+    return c->fast_connect && (c->state == PA_CONTEXT_AUTHORIZING || c->state == PA_CONTEXT_SETTING_NAME);
+}
+
+void pa_context_request_sent(pa_context *c) {
+    pa_assert(c);
+
+    if (c->state != PA_CONTEXT_READY)
+        c->pipelined = true;
+}
+
 pa_tagstruct *pa_tagstruct_command(pa_context *c, uint32_t command, uint32_t *tag) {
     pa_tagstruct *t;
 
@@ -119,14 +119,17 @@ typedef enum pa_context_flags {
     /**< Flag to pass when no specific options are needed (used to avoid casting)  \since 0.9.19 */
     PA_CONTEXT_NOAUTOSPAWN = 0x0001U,
     /**< Disabled autospawning of the PulseAudio daemon if required */
-    PA_CONTEXT_NOFAIL = 0x0002U
+    PA_CONTEXT_NOFAIL = 0x0002U,
     /**< Don't fail if the daemon is not available when pa_context_connect() is called, instead enter PA_CONTEXT_CONNECTING state and wait for the daemon to appear.  \since 0.9.15 */
+    PA_CONTEXT_FAST_CONNECT = 0x0004U
+    /**< Send the client name along with the authentication instead of waiting for the reply, and allow connecting streams and playing samples as soon as the context enters PA_CONTEXT_AUTHORIZING. These requests then go out in one burst with the connection setup. They are encoded for the protocol version of the client library, so if the server turns out to be older, the context fails with PA_ERR_VERSION and the application should connect again without this flag. \since 5.0 */
 } pa_context_flags_t;
 
 /** \cond fulldocs */
 /* Allow clients to check with #ifdef for those flags */
 #define PA_CONTEXT_NOAUTOSPAWN PA_CONTEXT_NOAUTOSPAWN
 #define PA_CONTEXT_NOFAIL PA_CONTEXT_NOFAIL
+#define PA_CONTEXT_FAST_CONNECT PA_CONTEXT_FAST_CONNECT
 /** \endcond */
 
 /** Direction bitfield - while we currently do not expose anything bidirectional,
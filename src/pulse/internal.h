@@ -43,6 +43,7 @@
 #include <pulsecore/hashmap.h>
 #include <pulsecore/refcnt.h>
 #include <pulsecore/time-smoother.h>
+#include <pulsecore/timing-page.h>
 #ifdef HAVE_DBUS
 #include <pulsecore/dbus-util.h>
 #endif
@@ -51,6 +52,18 @@
 
 #define DEFAULT_TIMEOUT (30)
 
+/* The facilities the object cache keeps */
+#define PA_OBJECT_CACHE_MASK                    \
+    (PA_SUBSCRIPTION_MASK_SINK|                 \
+     PA_SUBSCRIPTION_MASK_SOURCE|               \
+     PA_SUBSCRIPTION_MASK_SINK_INPUT|           \
+     PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT|        \
+     PA_SUBSCRIPTION_MASK_CLIENT|               \
+     PA_SUBSCRIPTION_MASK_CARD)
+
+typedef struct pa_object_cache pa_object_cache;
+typedef struct pa_timing_page_request pa_timing_page_request;
+
 struct pa_context {
     PA_REFCNT_DECLARE;
 
@@ -80,15 +93,29 @@ struct pa_context {
     void *state_userdata;
     pa_context_subscribe_cb_t subscribe_callback;
     void *subscribe_userdata;
+    pa_context_subscribe_info_cb_t subscribe_info_callback;
+    void *subscribe_info_userdata;
     pa_context_event_cb_t event_callback;
     void *event_userdata;
 
+    /* What the application subscribed to, the object cache might
+     * need more */
+    pa_subscription_mask_t subscribe_mask;
+    bool subscribe_with_info;
+
+    pa_object_cache *object_cache;
+
+    /* Timing data of our playback streams, published by the server */
+    pa_timing_page *timing_page;
+
     pa_mempool *mempool;
 
     bool is_local:1;
     bool do_shm:1;
     bool server_specified:1;
     bool no_fail:1;
+    bool fast_connect:1;
+    bool pipelined:1;
     bool do_autospawn:1;
     bool use_rtclock:1;
     bool filter_added:1;
@@ -155,6 +182,7 @@ struct pa_stream {
     bool corked:1;
     bool timing_info_valid:1;
     bool auto_timing_update_requested:1;
+    bool timing_page_synced:1;
 
     uint32_t channel;
     uint32_t syncid;
@@ -196,6 +224,15 @@ struct pa_stream {
 
     pa_smoother *smoother;
 
+    /* Where the server publishes our timing data, PA_INVALID_INDEX if
+     * it doesn't. Only used after a timing update round trip that
+     * nothing has invalidated since. */
+    uint32_t timing_slot;
+    uint32_t timing_page_not_before;
+    /* When the server took the data in timing_info, our rtclock */
+    pa_usec_t timing_info_at;
+    PA_LLIST_HEAD(pa_timing_page_request, timing_page_requests);
+
     /* Callbacks */
     pa_stream_notify_cb_t state_callback;
     void *state_userdata;
@@ -243,6 +280,20 @@ struct pa_operation {
 void pa_command_request(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 void pa_command_stream_killed(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 void pa_command_subscribe_event(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
+int pa_context_dispatch_subscribe_info(pa_context *c, pa_subscription_event_type_t e, uint32_t idx, pa_tagstruct *t);
+int pa_context_skip_info_record(pa_context *c, pa_subscription_event_type_t facility, pa_tagstruct *t);
+pa_operation* pa_context_update_subscription(pa_context *c, pa_context_success_cb_t cb, void *userdata);
+
+void pa_object_cache_free(pa_object_cache *cache);
+void pa_object_cache_event(pa_object_cache *cache, pa_subscription_event_type_t e, uint32_t idx, pa_tagstruct *t);
+
+/* Answers an introspection request from the cache if it can, by
+ * passing the records to the reply callback of the request from the
+ * main loop. Returns NULL if the request needs to go to the server. If
+ * idx is PA_INVALID_INDEX and name is NULL all objects are returned,
+ * so requests for the default device must not be passed here. */
+pa_operation* pa_object_cache_lookup(pa_context *c, pa_subscription_event_type_t facility, uint32_t idx, const char *name,
+                                     pa_pdispatch_cb_t internal_cb, pa_operation_cb_t cb, void *userdata);
 void pa_command_overflow_or_underflow(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 void pa_command_stream_suspended(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 void pa_command_stream_moved(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
@@ -263,6 +314,15 @@ void pa_context_fail(pa_context *c, int error);
 int pa_context_set_error(pa_context *c, int error);
 void pa_context_set_state(pa_context *c, pa_context_state_t st);
 int pa_context_handle_error(pa_context *c, uint32_t command, pa_tagstruct *t, bool fail);
+
+/* True if requests may be sent: once the context is ready, and with
+ * PA_CONTEXT_FAST_CONNECT already while it is being set up. In the
+ * latter case the request is encoded before we know the version of the
+ * server. Callers report every request they sent with
+ * pa_context_request_sent(), which remembers that so that the setup
+ * can check the version. */
+bool pa_context_accepts_requests(pa_context *c);
+void pa_context_request_sent(pa_context *c);
 pa_operation* pa_context_send_simple_command(pa_context *c, uint32_t command, void (*internal_callback)(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata), void (*cb)(void), void *userdata);
 
 void pa_stream_set_state(pa_stream *s, pa_stream_state_t st);
@@ -134,144 +134,161 @@ pa_operation* pa_context_get_server_info(pa_context *c, pa_server_info_cb_t cb,
 
 /*** Sink Info ***/
 
-static void context_get_sink_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
-    pa_operation *o = userdata;
-    int eol = 1;
-    pa_sink_info i;
+static void sink_info_free(pa_sink_info *i) {
     uint32_t j;
 
-    pa_assert(pd);
-    pa_assert(o);
-    pa_assert(PA_REFCNT_VALUE(o) >= 1);
-
-    /* For safety in case someone use fail: outside the while loop below */
-    pa_zero(i);
+    if (i->formats) {
+        for (j = 0; j < i->n_formats; j++)
+            pa_format_info_free(i->formats[j]);
+        pa_xfree(i->formats);
+    }
+    if (i->ports) {
+        pa_xfree(i->ports[0]);
+        pa_xfree(i->ports);
+    }
+    pa_proplist_free(i->proplist);
+}
 
-    if (!o->context)
-        goto finish;
+/* Reads one record as sent in the replies to GET_SINK_INFO(_LIST) and,
+ * since version 29, with subscription events. The record needs to be
+ * freed with sink_info_free() even if reading it fails. */
+static int sink_info_read(pa_context *c, pa_tagstruct *t, pa_sink_info *i) {
+    uint32_t j;
+    bool mute;
+    uint32_t flags;
+    uint32_t state;
+    const char *ap = NULL;
+
+    pa_zero(*i);
+    i->proplist = pa_proplist_new();
+    i->base_volume = PA_VOLUME_NORM;
+    i->n_volume_steps = PA_VOLUME_NORM+1;
+    mute = false;
+    state = PA_SINK_INVALID_STATE;
+    i->card = PA_INVALID_INDEX;
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_gets(t, &i->description) < 0 ||
+        pa_tagstruct_get_sample_spec(t, &i->sample_spec) < 0 ||
+        pa_tagstruct_get_channel_map(t, &i->channel_map) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_get_cvolume(t, &i->volume) < 0 ||
+        pa_tagstruct_get_boolean(t, &mute) < 0 ||
+        pa_tagstruct_getu32(t, &i->monitor_source) < 0 ||
+        pa_tagstruct_gets(t, &i->monitor_source_name) < 0 ||
+        pa_tagstruct_get_usec(t, &i->latency) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        pa_tagstruct_getu32(t, &flags) < 0 ||
+        (c->version >= 13 &&
+         (pa_tagstruct_get_proplist(t, i->proplist) < 0 ||
+          pa_tagstruct_get_usec(t, &i->configured_latency) < 0)) ||
+        (c->version >= 15 &&
+         (pa_tagstruct_get_volume(t, &i->base_volume) < 0 ||
+          pa_tagstruct_getu32(t, &state) < 0 ||
+          pa_tagstruct_getu32(t, &i->n_volume_steps) < 0 ||
+          pa_tagstruct_getu32(t, &i->card) < 0)) ||
+        (c->version >= 16 &&
+         (pa_tagstruct_getu32(t, &i->n_ports)))) {
+
+        return -1;
+    }
 
-    if (command != PA_COMMAND_REPLY) {
-        if (pa_context_handle_error(o->context, command, t, false) < 0)
-            goto finish;
+    if (c->version >= 16) {
+        if (i->n_ports > 0) {
+            i->ports = pa_xnew(pa_sink_port_info*, i->n_ports+1);
+            i->ports[0] = pa_xnew(pa_sink_port_info, i->n_ports);
 
-        eol = -1;
-    } else {
+            for (j = 0; j < i->n_ports; j++) {
+                i->ports[j] = &i->ports[0][j];
 
-        while (!pa_tagstruct_eof(t)) {
-            bool mute;
-            uint32_t flags;
-            uint32_t state;
-            const char *ap = NULL;
+                if (pa_tagstruct_gets(t, &i->ports[j]->name) < 0 ||
+                    pa_tagstruct_gets(t, &i->ports[j]->description) < 0 ||
+                    pa_tagstruct_getu32(t, &i->ports[j]->priority) < 0) {
 
-            pa_zero(i);
-            i.proplist = pa_proplist_new();
-            i.base_volume = PA_VOLUME_NORM;
-            i.n_volume_steps = PA_VOLUME_NORM+1;
-            mute = false;
-            state = PA_SINK_INVALID_STATE;
-            i.card = PA_INVALID_INDEX;
+                    return -1;
+                }
 
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_gets(t, &i.description) < 0 ||
-                pa_tagstruct_get_sample_spec(t, &i.sample_spec) < 0 ||
-                pa_tagstruct_get_channel_map(t, &i.channel_map) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_get_cvolume(t, &i.volume) < 0 ||
-                pa_tagstruct_get_boolean(t, &mute) < 0 ||
-                pa_tagstruct_getu32(t, &i.monitor_source) < 0 ||
-                pa_tagstruct_gets(t, &i.monitor_source_name) < 0 ||
-                pa_tagstruct_get_usec(t, &i.latency) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                pa_tagstruct_getu32(t, &flags) < 0 ||
-                (o->context->version >= 13 &&
-                 (pa_tagstruct_get_proplist(t, i.proplist) < 0 ||
-                  pa_tagstruct_get_usec(t, &i.configured_latency) < 0)) ||
-                (o->context->version >= 15 &&
-                 (pa_tagstruct_get_volume(t, &i.base_volume) < 0 ||
-                  pa_tagstruct_getu32(t, &state) < 0 ||
-                  pa_tagstruct_getu32(t, &i.n_volume_steps) < 0 ||
-                  pa_tagstruct_getu32(t, &i.card) < 0)) ||
-                (o->context->version >= 16 &&
-                 (pa_tagstruct_getu32(t, &i.n_ports)))) {
-
-                goto fail;
+                i->ports[j]->available = PA_PORT_AVAILABLE_UNKNOWN;
+                if (c->version >= 24) {
+                    uint32_t av;
+                    if (pa_tagstruct_getu32(t, &av) < 0 || av > PA_PORT_AVAILABLE_YES)
+                        return -1;
+                    i->ports[j]->available = av;
+                }
             }
 
-            if (o->context->version >= 16) {
-                if (i.n_ports > 0) {
-                    i.ports = pa_xnew(pa_sink_port_info*, i.n_ports+1);
-                    i.ports[0] = pa_xnew(pa_sink_port_info, i.n_ports);
+            i->ports[j] = NULL;
+        }
 
-                    for (j = 0; j < i.n_ports; j++) {
-                        i.ports[j] = &i.ports[0][j];
+        if (pa_tagstruct_gets(t, &ap) < 0)
+            return -1;
 
-                        if (pa_tagstruct_gets(t, &i.ports[j]->name) < 0 ||
-                            pa_tagstruct_gets(t, &i.ports[j]->description) < 0 ||
-                            pa_tagstruct_getu32(t, &i.ports[j]->priority) < 0) {
+        if (ap) {
+            for (j = 0; j < i->n_ports; j++)
+                if (pa_streq(i->ports[j]->name, ap)) {
+                    i->active_port = i->ports[j];
+                    break;
+                }
+        }
+    }
 
-                            goto fail;
-                        }
+    if (c->version >= 21) {
+        uint8_t n_formats;
+        if (pa_tagstruct_getu8(t, &n_formats) < 0 || n_formats < 1)
+            return -1;
 
-                        i.ports[j]->available = PA_PORT_AVAILABLE_UNKNOWN;
-                        if (o->context->version >= 24) {
-                            uint32_t av;
-                            if (pa_tagstruct_getu32(t, &av) < 0 || av > PA_PORT_AVAILABLE_YES)
-                                goto fail;
-                            i.ports[j]->available = av;
-                        }
-                    }
+        i->formats = pa_xnew0(pa_format_info*, n_formats);
 
-                    i.ports[j] = NULL;
-                }
+        for (j = 0; j < n_formats; j++) {
+            i->n_formats++;
+            i->formats[j] = pa_format_info_new();
+
+            if (pa_tagstruct_get_format_info(t, i->formats[j]) < 0)
+                return -1;
+        }
+    }
 
-                if (pa_tagstruct_gets(t, &ap) < 0)
-                    goto fail;
+    i->mute = (int) mute;
+    i->flags = (pa_sink_flags_t) flags;
+    i->state = (pa_sink_state_t) state;
 
-                if (ap) {
-                    for (j = 0; j < i.n_ports; j++)
-                        if (pa_streq(i.ports[j]->name, ap)) {
-                            i.active_port = i.ports[j];
-                            break;
-                        }
-                }
-            }
+    return 0;
+}
+
+static void context_get_sink_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_operation *o = userdata;
+    int eol = 1;
 
-            if (o->context->version >= 21) {
-                uint8_t n_formats;
-                if (pa_tagstruct_getu8(t, &n_formats) < 0 || n_formats < 1)
-                    goto fail;
+    pa_assert(pd);
+    pa_assert(o);
+    pa_assert(PA_REFCNT_VALUE(o) >= 1);
 
-                i.formats = pa_xnew0(pa_format_info*, n_formats);
+    if (!o->context)
+        goto finish;
 
-                for (j = 0; j < n_formats; j++) {
-                    i.n_formats++;
-                    i.formats[j] = pa_format_info_new();
+    if (command != PA_COMMAND_REPLY) {
+        if (pa_context_handle_error(o->context, command, t, false) < 0)
+            goto finish;
 
-                    if (pa_tagstruct_get_format_info(t, i.formats[j]) < 0)
-                        goto fail;
-                }
-            }
+        eol = -1;
+    } else {
 
-            i.mute = (int) mute;
-            i.flags = (pa_sink_flags_t) flags;
-            i.state = (pa_sink_state_t) state;
+        while (!pa_tagstruct_eof(t)) {
+            pa_sink_info i;
+
+            if (sink_info_read(o->context, t, &i) < 0) {
+                pa_context_fail(o->context, PA_ERR_PROTOCOL);
+                sink_info_free(&i);
+                goto finish;
+            }
 
             if (o->callback) {
                 pa_sink_info_cb_t cb = (pa_sink_info_cb_t) o->callback;
                 cb(o->context, &i, 0, o->userdata);
             }
 
-            if (i.formats) {
-                for (j = 0; j < i.n_formats; j++)
-                    pa_format_info_free(i.formats[j]);
-                pa_xfree(i.formats);
-            }
-            if (i.ports) {
-                pa_xfree(i.ports[0]);
-                pa_xfree(i.ports);
-            }
-            pa_proplist_free(i.proplist);
+            sink_info_free(&i);
         }
     }
 
@@ -283,28 +300,20 @@ static void context_get_sink_info_callback(pa_pdispatch *pd, uint32_t command, u
 finish:
     pa_operation_done(o);
     pa_operation_unref(o);
-    return;
+}
 
-fail:
-    pa_assert(i.proplist);
+pa_operation* pa_context_get_sink_info_list(pa_context *c, pa_sink_info_cb_t cb, void *userdata) {
+    pa_operation *o;
 
-    pa_context_fail(o->context, PA_ERR_PROTOCOL);
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
 
-    if (i.formats) {
-        for (j = 0; j < i.n_formats; j++)
-            pa_format_info_free(i.formats[j]);
-        pa_xfree(i.formats);
-    }
-    if (i.ports) {
-        pa_xfree(i.ports[0]);
-        pa_xfree(i.ports);
-    }
-    pa_proplist_free(i.proplist);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
 
-    goto finish;
-}
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SINK, PA_INVALID_INDEX, NULL, context_get_sink_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
 
-pa_operation* pa_context_get_sink_info_list(pa_context *c, pa_sink_info_cb_t cb, void *userdata) {
     return pa_context_send_simple_command(c, PA_COMMAND_GET_SINK_INFO_LIST, context_get_sink_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
@@ -320,6 +329,10 @@ pa_operation* pa_context_get_sink_info_by_index(pa_context *c, uint32_t idx, pa_
     PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
 
+    /* PA_INVALID_INDEX means the default sink, which only the server knows */
+    if (idx != PA_INVALID_INDEX && (o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SINK, idx, NULL, context_get_sink_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SINK_INFO, &tag);
@@ -344,6 +357,10 @@ pa_operation* pa_context_get_sink_info_by_name(pa_context *c, const char *name,
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, !name || *name, PA_ERR_INVALID);
 
+    /* No name means the default sink, which only the server knows */
+    if (name && (o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SINK, PA_INVALID_INDEX, name, context_get_sink_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SINK_INFO, &tag);
@@ -407,144 +424,161 @@ pa_operation* pa_context_set_sink_port_by_name(pa_context *c, const char *name,
 
 /*** Source info ***/
 
-static void context_get_source_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
-    pa_operation *o = userdata;
-    int eol = 1;
-    pa_source_info i;
+static void source_info_free(pa_source_info *i) {
     uint32_t j;
 
-    pa_assert(pd);
-    pa_assert(o);
-    pa_assert(PA_REFCNT_VALUE(o) >= 1);
-
-    /* For safety in case someone use fail: outside the while loop below */
-    pa_zero(i);
+    if (i->formats) {
+        for (j = 0; j < i->n_formats; j++)
+            pa_format_info_free(i->formats[j]);
+        pa_xfree(i->formats);
+    }
+    if (i->ports) {
+        pa_xfree(i->ports[0]);
+        pa_xfree(i->ports);
+    }
+    pa_proplist_free(i->proplist);
+}
 
-    if (!o->context)
-        goto finish;
+/* Reads one record as sent in the replies to GET_SOURCE_INFO(_LIST) and,
+ * since version 29, with subscription events. The record needs to be
+ * freed with source_info_free() even if reading it fails. */
+static int source_info_read(pa_context *c, pa_tagstruct *t, pa_source_info *i) {
+    uint32_t j;
+    bool mute;
+    uint32_t flags;
+    uint32_t state;
+    const char *ap;
+
+    pa_zero(*i);
+    i->proplist = pa_proplist_new();
+    i->base_volume = PA_VOLUME_NORM;
+    i->n_volume_steps = PA_VOLUME_NORM+1;
+    mute = false;
+    state = PA_SOURCE_INVALID_STATE;
+    i->card = PA_INVALID_INDEX;
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_gets(t, &i->description) < 0 ||
+        pa_tagstruct_get_sample_spec(t, &i->sample_spec) < 0 ||
+        pa_tagstruct_get_channel_map(t, &i->channel_map) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_get_cvolume(t, &i->volume) < 0 ||
+        pa_tagstruct_get_boolean(t, &mute) < 0 ||
+        pa_tagstruct_getu32(t, &i->monitor_of_sink) < 0 ||
+        pa_tagstruct_gets(t, &i->monitor_of_sink_name) < 0 ||
+        pa_tagstruct_get_usec(t, &i->latency) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        pa_tagstruct_getu32(t, &flags) < 0 ||
+        (c->version >= 13 &&
+         (pa_tagstruct_get_proplist(t, i->proplist) < 0 ||
+          pa_tagstruct_get_usec(t, &i->configured_latency) < 0)) ||
+        (c->version >= 15 &&
+         (pa_tagstruct_get_volume(t, &i->base_volume) < 0 ||
+          pa_tagstruct_getu32(t, &state) < 0 ||
+          pa_tagstruct_getu32(t, &i->n_volume_steps) < 0 ||
+          pa_tagstruct_getu32(t, &i->card) < 0)) ||
+        (c->version >= 16 &&
+         (pa_tagstruct_getu32(t, &i->n_ports)))) {
+
+        return -1;
+    }
 
-    if (command != PA_COMMAND_REPLY) {
-        if (pa_context_handle_error(o->context, command, t, false) < 0)
-            goto finish;
+    if (c->version >= 16) {
+        if (i->n_ports > 0) {
+            i->ports = pa_xnew(pa_source_port_info*, i->n_ports+1);
+            i->ports[0] = pa_xnew(pa_source_port_info, i->n_ports);
 
-        eol = -1;
-    } else {
+            for (j = 0; j < i->n_ports; j++) {
+                i->ports[j] = &i->ports[0][j];
 
-        while (!pa_tagstruct_eof(t)) {
-            bool mute;
-            uint32_t flags;
-            uint32_t state;
-            const char *ap;
+                if (pa_tagstruct_gets(t, &i->ports[j]->name) < 0 ||
+                    pa_tagstruct_gets(t, &i->ports[j]->description) < 0 ||
+                    pa_tagstruct_getu32(t, &i->ports[j]->priority) < 0) {
 
-            pa_zero(i);
-            i.proplist = pa_proplist_new();
-            i.base_volume = PA_VOLUME_NORM;
-            i.n_volume_steps = PA_VOLUME_NORM+1;
-            mute = false;
-            state = PA_SOURCE_INVALID_STATE;
-            i.card = PA_INVALID_INDEX;
+                    return -1;
+                }
 
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_gets(t, &i.description) < 0 ||
-                pa_tagstruct_get_sample_spec(t, &i.sample_spec) < 0 ||
-                pa_tagstruct_get_channel_map(t, &i.channel_map) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_get_cvolume(t, &i.volume) < 0 ||
-                pa_tagstruct_get_boolean(t, &mute) < 0 ||
-                pa_tagstruct_getu32(t, &i.monitor_of_sink) < 0 ||
-                pa_tagstruct_gets(t, &i.monitor_of_sink_name) < 0 ||
-                pa_tagstruct_get_usec(t, &i.latency) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                pa_tagstruct_getu32(t, &flags) < 0 ||
-                (o->context->version >= 13 &&
-                 (pa_tagstruct_get_proplist(t, i.proplist) < 0 ||
-                  pa_tagstruct_get_usec(t, &i.configured_latency) < 0)) ||
-                (o->context->version >= 15 &&
-                 (pa_tagstruct_get_volume(t, &i.base_volume) < 0 ||
-                  pa_tagstruct_getu32(t, &state) < 0 ||
-                  pa_tagstruct_getu32(t, &i.n_volume_steps) < 0 ||
-                  pa_tagstruct_getu32(t, &i.card) < 0)) ||
-                (o->context->version >= 16 &&
-                 (pa_tagstruct_getu32(t, &i.n_ports)))) {
-
-                goto fail;
+                i->ports[j]->available = PA_PORT_AVAILABLE_UNKNOWN;
+                if (c->version >= 24) {
+                    uint32_t av;
+                    if (pa_tagstruct_getu32(t, &av) < 0 || av > PA_PORT_AVAILABLE_YES)
+                        return -1;
+                    i->ports[j]->available = av;
+                }
             }
 
-            if (o->context->version >= 16) {
-                if (i.n_ports > 0) {
-                    i.ports = pa_xnew(pa_source_port_info*, i.n_ports+1);
-                    i.ports[0] = pa_xnew(pa_source_port_info, i.n_ports);
+            i->ports[j] = NULL;
+        }
 
-                    for (j = 0; j < i.n_ports; j++) {
-                        i.ports[j] = &i.ports[0][j];
+        if (pa_tagstruct_gets(t, &ap) < 0)
+            return -1;
 
-                        if (pa_tagstruct_gets(t, &i.ports[j]->name) < 0 ||
-                            pa_tagstruct_gets(t, &i.ports[j]->description) < 0 ||
-                            pa_tagstruct_getu32(t, &i.ports[j]->priority) < 0) {
+        if (ap) {
+            for (j = 0; j < i->n_ports; j++)
+                if (pa_streq(i->ports[j]->name, ap)) {
+                    i->active_port = i->ports[j];
+                    break;
+                }
+        }
+    }
 
-                            goto fail;
-                        }
+    if (c->version >= 22) {
+        uint8_t n_formats;
+        if (pa_tagstruct_getu8(t, &n_formats) < 0 || n_formats < 1)
+            return -1;
 
-                        i.ports[j]->available = PA_PORT_AVAILABLE_UNKNOWN;
-                        if (o->context->version >= 24) {
-                            uint32_t av;
-                            if (pa_tagstruct_getu32(t, &av) < 0 || av > PA_PORT_AVAILABLE_YES)
-                                goto fail;
-                            i.ports[j]->available = av;
-                        }
-                    }
+        i->formats = pa_xnew0(pa_format_info*, n_formats);
 
-                    i.ports[j] = NULL;
-                }
+        for (j = 0; j < n_formats; j++) {
+            i->n_formats++;
+            i->formats[j] = pa_format_info_new();
 
-                if (pa_tagstruct_gets(t, &ap) < 0)
-                    goto fail;
+            if (pa_tagstruct_get_format_info(t, i->formats[j]) < 0)
+                return -1;
+        }
+    }
 
-                if (ap) {
-                    for (j = 0; j < i.n_ports; j++)
-                        if (pa_streq(i.ports[j]->name, ap)) {
-                            i.active_port = i.ports[j];
-                            break;
-                        }
-                }
-            }
+    i->mute = (int) mute;
+    i->flags = (pa_source_flags_t) flags;
+    i->state = (pa_source_state_t) state;
 
-            if (o->context->version >= 22) {
-                uint8_t n_formats;
-                if (pa_tagstruct_getu8(t, &n_formats) < 0 || n_formats < 1)
-                    goto fail;
+    return 0;
+}
 
-                i.formats = pa_xnew0(pa_format_info*, n_formats);
+static void context_get_source_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_operation *o = userdata;
+    int eol = 1;
 
-                for (j = 0; j < n_formats; j++) {
-                    i.n_formats++;
-                    i.formats[j] = pa_format_info_new();
+    pa_assert(pd);
+    pa_assert(o);
+    pa_assert(PA_REFCNT_VALUE(o) >= 1);
 
-                    if (pa_tagstruct_get_format_info(t, i.formats[j]) < 0)
-                        goto fail;
-                }
-            }
+    if (!o->context)
+        goto finish;
 
-            i.mute = (int) mute;
-            i.flags = (pa_source_flags_t) flags;
-            i.state = (pa_source_state_t) state;
+    if (command != PA_COMMAND_REPLY) {
+        if (pa_context_handle_error(o->context, command, t, false) < 0)
+            goto finish;
+
+        eol = -1;
+    } else {
+
+        while (!pa_tagstruct_eof(t)) {
+            pa_source_info i;
+
+            if (source_info_read(o->context, t, &i) < 0) {
+                pa_context_fail(o->context, PA_ERR_PROTOCOL);
+                source_info_free(&i);
+                goto finish;
+            }
 
             if (o->callback) {
                 pa_source_info_cb_t cb = (pa_source_info_cb_t) o->callback;
                 cb(o->context, &i, 0, o->userdata);
             }
 
-            if (i.formats) {
-                for (j = 0; j < i.n_formats; j++)
-                    pa_format_info_free(i.formats[j]);
-                pa_xfree(i.formats);
-            }
-            if (i.ports) {
-                pa_xfree(i.ports[0]);
-                pa_xfree(i.ports);
-            }
-            pa_proplist_free(i.proplist);
+            source_info_free(&i);
         }
     }
 
@@ -556,28 +590,20 @@ static void context_get_source_info_callback(pa_pdispatch *pd, uint32_t command,
 finish:
     pa_operation_done(o);
     pa_operation_unref(o);
-    return;
+}
 
-fail:
-    pa_assert(i.proplist);
+pa_operation* pa_context_get_source_info_list(pa_context *c, pa_source_info_cb_t cb, void *userdata) {
+    pa_operation *o;
 
-    pa_context_fail(o->context, PA_ERR_PROTOCOL);
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
 
-    if (i.formats) {
-        for (j = 0; j < i.n_formats; j++)
-            pa_format_info_free(i.formats[j]);
-        pa_xfree(i.formats);
-    }
-    if (i.ports) {
-        pa_xfree(i.ports[0]);
-        pa_xfree(i.ports);
-    }
-    pa_proplist_free(i.proplist);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
 
-    goto finish;
-}
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SOURCE, PA_INVALID_INDEX, NULL, context_get_source_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
 
-pa_operation* pa_context_get_source_info_list(pa_context *c, pa_source_info_cb_t cb, void *userdata) {
     return pa_context_send_simple_command(c, PA_COMMAND_GET_SOURCE_INFO_LIST, context_get_source_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
@@ -593,6 +619,10 @@ pa_operation* pa_context_get_source_info_by_index(pa_context *c, uint32_t idx, p
     PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
 
+    /* PA_INVALID_INDEX means the default source, which only the server knows */
+    if (idx != PA_INVALID_INDEX && (o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SOURCE, idx, NULL, context_get_source_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SOURCE_INFO, &tag);
@@ -617,6 +647,10 @@ pa_operation* pa_context_get_source_info_by_name(pa_context *c, const char *name
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, !name || *name, PA_ERR_INVALID);
 
+    /* No name means the default source, which only the server knows */
+    if (name && (o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SOURCE, PA_INVALID_INDEX, name, context_get_source_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SOURCE_INFO, &tag);
@@ -680,6 +714,29 @@ pa_operation* pa_context_set_source_port_by_name(pa_context *c, const char *name
 
 /*** Client info ***/
 
+static void client_info_free(pa_client_info *i) {
+    pa_proplist_free(i->proplist);
+}
+
+/* Reads one record as sent in the replies to GET_CLIENT_INFO(_LIST) and,
+ * since version 29, with subscription events. The record needs to be
+ * freed with client_info_free() even if reading it fails. */
+static int client_info_read(pa_context *c, pa_tagstruct *t, pa_client_info *i) {
+    pa_zero(*i);
+    i->proplist = pa_proplist_new();
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        (c->version >= 13 && pa_tagstruct_get_proplist(t, i->proplist) < 0)) {
+
+        return -1;
+    }
+
+    return 0;
+}
+
 static void context_get_client_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_operation *o = userdata;
     int eol = 1;
@@ -701,17 +758,9 @@ static void context_get_client_info_callback(pa_pdispatch *pd, uint32_t command,
         while (!pa_tagstruct_eof(t)) {
             pa_client_info i;
 
-            pa_zero(i);
-            i.proplist = pa_proplist_new();
-
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                (o->context->version >= 13 && pa_tagstruct_get_proplist(t, i.proplist) < 0)) {
-
+            if (client_info_read(o->context, t, &i) < 0) {
                 pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                pa_proplist_free(i.proplist);
+                client_info_free(&i);
                 goto finish;
             }
 
@@ -720,7 +769,7 @@ static void context_get_client_info_callback(pa_pdispatch *pd, uint32_t command,
                 cb(o->context, &i, 0, o->userdata);
             }
 
-            pa_proplist_free(i.proplist);
+            client_info_free(&i);
         }
     }
 
@@ -747,6 +796,9 @@ pa_operation* pa_context_get_client_info(pa_context *c, uint32_t idx, pa_client_
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, idx != PA_INVALID_INDEX, PA_ERR_INVALID);
 
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_CLIENT, idx, NULL, context_get_client_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_CLIENT_INFO, &tag);
@@ -758,6 +810,17 @@ pa_operation* pa_context_get_client_info(pa_context *c, uint32_t idx, pa_client_
 }
 
 pa_operation* pa_context_get_client_info_list(pa_context *c, pa_client_info_cb_t cb, void *userdata) {
+    pa_operation *o;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_CLIENT, PA_INVALID_INDEX, NULL, context_get_client_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     return pa_context_send_simple_command(c, PA_COMMAND_GET_CLIENT_INFO_LIST, context_get_client_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
@@ -857,10 +920,64 @@ static int fill_card_port_info(pa_context *context, pa_tagstruct* t, pa_card_inf
     return 0;
 }
 
+/* Reads one record as sent in the replies to GET_CARD_INFO(_LIST). The
+ * record needs to be freed with card_info_free() even if reading it
+ * fails. */
+static int card_info_read(pa_context *c, pa_tagstruct *t, pa_card_info *i) {
+    uint32_t j;
+    const char*ap;
+
+    pa_zero(*i);
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        pa_tagstruct_getu32(t, &i->n_profiles) < 0)
+        return -1;
+
+    if (i->n_profiles > 0) {
+        i->profiles = pa_xnew0(pa_card_profile_info, i->n_profiles+1);
+
+        for (j = 0; j < i->n_profiles; j++) {
+
+            if (pa_tagstruct_gets(t, &i->profiles[j].name) < 0 ||
+                pa_tagstruct_gets(t, &i->profiles[j].description) < 0 ||
+                pa_tagstruct_getu32(t, &i->profiles[j].n_sinks) < 0 ||
+                pa_tagstruct_getu32(t, &i->profiles[j].n_sources) < 0 ||
+                pa_tagstruct_getu32(t, &i->profiles[j].priority) < 0)
+                return -1;
+        }
+
+        /* Terminate with an extra NULL entry, just to make sure */
+        i->profiles[j].name = NULL;
+        i->profiles[j].description = NULL;
+    }
+
+    i->proplist = pa_proplist_new();
+
+    if (pa_tagstruct_gets(t, &ap) < 0 ||
+        pa_tagstruct_get_proplist(t, i->proplist) < 0)
+        return -1;
+
+    if (ap) {
+        for (j = 0; j < i->n_profiles; j++)
+            if (pa_streq(i->profiles[j].name, ap)) {
+                i->active_profile = &i->profiles[j];
+                break;
+            }
+    }
+
+    if (c->version >= 26)
+        if (fill_card_port_info(c, t, i) < 0)
+            return -1;
+
+    return 0;
+}
+
 static void context_get_card_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_operation *o = userdata;
     int eol = 1;
-    pa_card_info i;
 
     pa_assert(pd);
     pa_assert(o);
@@ -877,70 +994,14 @@ static void context_get_card_info_callback(pa_pdispatch *pd, uint32_t command, u
     } else {
 
         while (!pa_tagstruct_eof(t)) {
-            uint32_t j;
-            const char*ap;
-
-            pa_zero(i);
-
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                pa_tagstruct_getu32(t, &i.n_profiles) < 0) {
-
-                pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                card_info_free(&i);
-                goto finish;
-            }
-
-            if (i.n_profiles > 0) {
-                i.profiles = pa_xnew0(pa_card_profile_info, i.n_profiles+1);
-
-                for (j = 0; j < i.n_profiles; j++) {
-
-                    if (pa_tagstruct_gets(t, &i.profiles[j].name) < 0 ||
-                        pa_tagstruct_gets(t, &i.profiles[j].description) < 0 ||
-                        pa_tagstruct_getu32(t, &i.profiles[j].n_sinks) < 0 ||
-                        pa_tagstruct_getu32(t, &i.profiles[j].n_sources) < 0 ||
-                        pa_tagstruct_getu32(t, &i.profiles[j].priority) < 0) {
-
-                        pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                        card_info_free(&i);
-                        goto finish;
-                    }
-                }
-
-                /* Terminate with an extra NULL entry, just to make sure */
-                i.profiles[j].name = NULL;
-                i.profiles[j].description = NULL;
-            }
-
-            i.proplist = pa_proplist_new();
-
-            if (pa_tagstruct_gets(t, &ap) < 0 ||
-                pa_tagstruct_get_proplist(t, i.proplist) < 0) {
+            pa_card_info i;
 
+            if (card_info_read(o->context, t, &i) < 0) {
                 pa_context_fail(o->context, PA_ERR_PROTOCOL);
                 card_info_free(&i);
                 goto finish;
             }
 
-            if (ap) {
-                for (j = 0; j < i.n_profiles; j++)
-                    if (pa_streq(i.profiles[j].name, ap)) {
-                        i.active_profile = &i.profiles[j];
-                        break;
-                    }
-            }
-
-            if (o->context->version >= 26) {
-                if (fill_card_port_info(o->context, t, &i) < 0) {
-                    pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                    card_info_free(&i);
-                    goto finish;
-                }
-            }
-
             if (o->callback) {
                 pa_card_info_cb_t cb = (pa_card_info_cb_t) o->callback;
                 cb(o->context, &i, 0, o->userdata);
@@ -974,6 +1035,9 @@ pa_operation* pa_context_get_card_info_by_index(pa_context *c, uint32_t idx, pa_
     PA_CHECK_VALIDITY_RETURN_NULL(c, idx != PA_INVALID_INDEX, PA_ERR_INVALID);
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 15, PA_ERR_NOTSUPPORTED);
 
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_CARD, idx, NULL, context_get_card_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_CARD_INFO, &tag);
@@ -999,6 +1063,10 @@ pa_operation* pa_context_get_card_info_by_name(pa_context *c, const char*name, p
     PA_CHECK_VALIDITY_RETURN_NULL(c, !name || *name, PA_ERR_INVALID);
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 15, PA_ERR_NOTSUPPORTED);
 
+    /* No name means the default card, which only the server knows */
+    if (name && (o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_CARD, PA_INVALID_INDEX, name, context_get_card_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_CARD_INFO, &tag);
@@ -1011,8 +1079,18 @@ pa_operation* pa_context_get_card_info_by_name(pa_context *c, const char*name, p
 }
 
 pa_operation* pa_context_get_card_info_list(pa_context *c, pa_card_info_cb_t cb, void *userdata) {
+    pa_operation *o;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 15, PA_ERR_NOTSUPPORTED);
 
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_CARD, PA_INVALID_INDEX, NULL, context_get_card_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     return pa_context_send_simple_command(c, PA_COMMAND_GET_CARD_INFO_LIST, context_get_card_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
@@ -1153,6 +1231,51 @@ pa_operation* pa_context_get_module_info_list(pa_context *c, pa_module_info_cb_t
 
 /*** Sink input info ***/
 
+static void sink_input_info_free(pa_sink_input_info *i) {
+    pa_proplist_free(i->proplist);
+    pa_format_info_free(i->format);
+}
+
+/* Reads one record as sent in the replies to GET_SINK_INPUT_INFO(_LIST) and,
+ * since version 29, with subscription events. The record needs to be
+ * freed with sink_input_info_free() even if reading it fails. */
+static int sink_input_info_read(pa_context *c, pa_tagstruct *t, pa_sink_input_info *i) {
+    bool mute = false, corked = false, has_volume = false, volume_writable = true;
+
+    pa_zero(*i);
+    i->proplist = pa_proplist_new();
+    i->format = pa_format_info_new();
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_getu32(t, &i->client) < 0 ||
+        pa_tagstruct_getu32(t, &i->sink) < 0 ||
+        pa_tagstruct_get_sample_spec(t, &i->sample_spec) < 0 ||
+        pa_tagstruct_get_channel_map(t, &i->channel_map) < 0 ||
+        pa_tagstruct_get_cvolume(t, &i->volume) < 0 ||
+        pa_tagstruct_get_usec(t, &i->buffer_usec) < 0 ||
+        pa_tagstruct_get_usec(t, &i->sink_usec) < 0 ||
+        pa_tagstruct_gets(t, &i->resample_method) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        (c->version >= 11 && pa_tagstruct_get_boolean(t, &mute) < 0) ||
+        (c->version >= 13 && pa_tagstruct_get_proplist(t, i->proplist) < 0) ||
+        (c->version >= 19 && pa_tagstruct_get_boolean(t, &corked) < 0) ||
+        (c->version >= 20 && (pa_tagstruct_get_boolean(t, &has_volume) < 0 ||
+                              pa_tagstruct_get_boolean(t, &volume_writable) < 0)) ||
+        (c->version >= 21 && pa_tagstruct_get_format_info(t, i->format) < 0)) {
+
+        return -1;
+    }
+
+    i->mute = (int) mute;
+    i->corked = (int) corked;
+    i->has_volume = (int) has_volume;
+    i->volume_writable = (int) volume_writable;
+
+    return 0;
+}
+
 static void context_get_sink_input_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_operation *o = userdata;
     int eol = 1;
@@ -1173,49 +1296,19 @@ static void context_get_sink_input_info_callback(pa_pdispatch *pd, uint32_t comm
 
         while (!pa_tagstruct_eof(t)) {
             pa_sink_input_info i;
-            bool mute = false, corked = false, has_volume = false, volume_writable = true;
-
-            pa_zero(i);
-            i.proplist = pa_proplist_new();
-            i.format = pa_format_info_new();
-
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_getu32(t, &i.client) < 0 ||
-                pa_tagstruct_getu32(t, &i.sink) < 0 ||
-                pa_tagstruct_get_sample_spec(t, &i.sample_spec) < 0 ||
-                pa_tagstruct_get_channel_map(t, &i.channel_map) < 0 ||
-                pa_tagstruct_get_cvolume(t, &i.volume) < 0 ||
-                pa_tagstruct_get_usec(t, &i.buffer_usec) < 0 ||
-                pa_tagstruct_get_usec(t, &i.sink_usec) < 0 ||
-                pa_tagstruct_gets(t, &i.resample_method) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                (o->context->version >= 11 && pa_tagstruct_get_boolean(t, &mute) < 0) ||
-                (o->context->version >= 13 && pa_tagstruct_get_proplist(t, i.proplist) < 0) ||
-                (o->context->version >= 19 && pa_tagstruct_get_boolean(t, &corked) < 0) ||
-                (o->context->version >= 20 && (pa_tagstruct_get_boolean(t, &has_volume) < 0 ||
-                                               pa_tagstruct_get_boolean(t, &volume_writable) < 0)) ||
-                (o->context->version >= 21 && pa_tagstruct_get_format_info(t, i.format) < 0)) {
 
+            if (sink_input_info_read(o->context, t, &i) < 0) {
                 pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                pa_proplist_free(i.proplist);
-                pa_format_info_free(i.format);
+                sink_input_info_free(&i);
                 goto finish;
             }
 
-            i.mute = (int) mute;
-            i.corked = (int) corked;
-            i.has_volume = (int) has_volume;
-            i.volume_writable = (int) volume_writable;
-
             if (o->callback) {
                 pa_sink_input_info_cb_t cb = (pa_sink_input_info_cb_t) o->callback;
                 cb(o->context, &i, 0, o->userdata);
             }
 
-            pa_proplist_free(i.proplist);
-            pa_format_info_free(i.format);
+            sink_input_info_free(&i);
         }
     }
 
@@ -1242,6 +1335,9 @@ pa_operation* pa_context_get_sink_input_info(pa_context *c, uint32_t idx, pa_sin
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, idx != PA_INVALID_INDEX, PA_ERR_INVALID);
 
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT, idx, NULL, context_get_sink_input_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SINK_INPUT_INFO, &tag);
@@ -1253,11 +1349,67 @@ pa_operation* pa_context_get_sink_input_info(pa_context *c, uint32_t idx, pa_sin
 }
 
 pa_operation* pa_context_get_sink_input_info_list(pa_context *c, void (*cb)(pa_context *c, const pa_sink_input_info*i, int is_last, void *userdata), void *userdata) {
+    pa_operation *o;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT, PA_INVALID_INDEX, NULL, context_get_sink_input_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     return pa_context_send_simple_command(c, PA_COMMAND_GET_SINK_INPUT_INFO_LIST, context_get_sink_input_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
 /*** Source output info ***/
 
+static void source_output_info_free(pa_source_output_info *i) {
+    pa_proplist_free(i->proplist);
+    pa_format_info_free(i->format);
+}
+
+/* Reads one record as sent in the replies to GET_SOURCE_OUTPUT_INFO(_LIST) and,
+ * since version 29, with subscription events. The record needs to be
+ * freed with source_output_info_free() even if reading it fails. */
+static int source_output_info_read(pa_context *c, pa_tagstruct *t, pa_source_output_info *i) {
+    bool mute = false, corked = false, has_volume = false, volume_writable = true;
+
+    pa_zero(*i);
+    i->proplist = pa_proplist_new();
+    i->format = pa_format_info_new();
+
+    if (pa_tagstruct_getu32(t, &i->index) < 0 ||
+        pa_tagstruct_gets(t, &i->name) < 0 ||
+        pa_tagstruct_getu32(t, &i->owner_module) < 0 ||
+        pa_tagstruct_getu32(t, &i->client) < 0 ||
+        pa_tagstruct_getu32(t, &i->source) < 0 ||
+        pa_tagstruct_get_sample_spec(t, &i->sample_spec) < 0 ||
+        pa_tagstruct_get_channel_map(t, &i->channel_map) < 0 ||
+        pa_tagstruct_get_usec(t, &i->buffer_usec) < 0 ||
+        pa_tagstruct_get_usec(t, &i->source_usec) < 0 ||
+        pa_tagstruct_gets(t, &i->resample_method) < 0 ||
+        pa_tagstruct_gets(t, &i->driver) < 0 ||
+        (c->version >= 13 && pa_tagstruct_get_proplist(t, i->proplist) < 0) ||
+        (c->version >= 19 && pa_tagstruct_get_boolean(t, &corked) < 0) ||
+        (c->version >= 22 && (pa_tagstruct_get_cvolume(t, &i->volume) < 0 ||
+                              pa_tagstruct_get_boolean(t, &mute) < 0 ||
+                              pa_tagstruct_get_boolean(t, &has_volume) < 0 ||
+                              pa_tagstruct_get_boolean(t, &volume_writable) < 0 ||
+                              pa_tagstruct_get_format_info(t, i->format) < 0))) {
+
+        return -1;
+    }
+
+    i->mute = (int) mute;
+    i->corked = (int) corked;
+    i->has_volume = (int) has_volume;
+    i->volume_writable = (int) volume_writable;
+
+    return 0;
+}
+
 static void context_get_source_output_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_operation *o = userdata;
     int eol = 1;
@@ -1278,49 +1430,19 @@ static void context_get_source_output_info_callback(pa_pdispatch *pd, uint32_t c
 
         while (!pa_tagstruct_eof(t)) {
             pa_source_output_info i;
-            bool mute = false, corked = false, has_volume = false, volume_writable = true;
-
-            pa_zero(i);
-            i.proplist = pa_proplist_new();
-            i.format = pa_format_info_new();
-
-            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
-                pa_tagstruct_gets(t, &i.name) < 0 ||
-                pa_tagstruct_getu32(t, &i.owner_module) < 0 ||
-                pa_tagstruct_getu32(t, &i.client) < 0 ||
-                pa_tagstruct_getu32(t, &i.source) < 0 ||
-                pa_tagstruct_get_sample_spec(t, &i.sample_spec) < 0 ||
-                pa_tagstruct_get_channel_map(t, &i.channel_map) < 0 ||
-                pa_tagstruct_get_usec(t, &i.buffer_usec) < 0 ||
-                pa_tagstruct_get_usec(t, &i.source_usec) < 0 ||
-                pa_tagstruct_gets(t, &i.resample_method) < 0 ||
-                pa_tagstruct_gets(t, &i.driver) < 0 ||
-                (o->context->version >= 13 && pa_tagstruct_get_proplist(t, i.proplist) < 0) ||
-                (o->context->version >= 19 && pa_tagstruct_get_boolean(t, &corked) < 0) ||
-                (o->context->version >= 22 && (pa_tagstruct_get_cvolume(t, &i.volume) < 0 ||
-                                               pa_tagstruct_get_boolean(t, &mute) < 0 ||
-                                               pa_tagstruct_get_boolean(t, &has_volume) < 0 ||
-                                               pa_tagstruct_get_boolean(t, &volume_writable) < 0 ||
-                                               pa_tagstruct_get_format_info(t, i.format) < 0))) {
 
+            if (source_output_info_read(o->context, t, &i) < 0) {
                 pa_context_fail(o->context, PA_ERR_PROTOCOL);
-                pa_proplist_free(i.proplist);
-                pa_format_info_free(i.format);
+                source_output_info_free(&i);
                 goto finish;
             }
 
-            i.mute = (int) mute;
-            i.corked = (int) corked;
-            i.has_volume = (int) has_volume;
-            i.volume_writable = (int) volume_writable;
-
             if (o->callback) {
                 pa_source_output_info_cb_t cb = (pa_source_output_info_cb_t) o->callback;
                 cb(o->context, &i, 0, o->userdata);
             }
 
-            pa_proplist_free(i.proplist);
-            pa_format_info_free(i.format);
+            source_output_info_free(&i);
         }
     }
 
@@ -1347,6 +1469,9 @@ pa_operation* pa_context_get_source_output_info(pa_context *c, uint32_t idx, pa_
     PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(c, idx != PA_INVALID_INDEX, PA_ERR_INVALID);
 
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, idx, NULL, context_get_source_output_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_GET_SOURCE_OUTPUT_INFO, &tag);
@@ -1358,6 +1483,17 @@ pa_operation* pa_context_get_source_output_info(pa_context *c, uint32_t idx, pa_
 }
 
 pa_operation* pa_context_get_source_output_info_list(pa_context *c,  pa_source_output_info_cb_t cb, void *userdata) {
+    pa_operation *o;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+
+    if ((o = pa_object_cache_lookup(c, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, PA_INVALID_INDEX, NULL, context_get_source_output_info_callback, (pa_operation_cb_t) cb, userdata)))
+        return o;
+
     return pa_context_send_simple_command(c, PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST, context_get_source_output_info_callback, (pa_operation_cb_t) cb, userdata);
 }
 
@@ -2155,3 +2291,220 @@ pa_operation* pa_context_suspend_source_by_index(pa_context *c, uint32_t idx, in
 
     return o;
 }
+
+/*** Filtered lists ***/
+
+pa_info_filter* pa_info_filter_init(pa_info_filter *f) {
+    pa_assert(f);
+
+    f->fields = PA_INFO_FIELD_ALL;
+    f->owner_module = PA_INVALID_INDEX;
+    f->client = PA_INVALID_INDEX;
+    f->device = PA_INVALID_INDEX;
+    f->property = NULL;
+    f->value = NULL;
+
+    return f;
+}
+
+static pa_operation* get_info_list_filtered(pa_context *c, uint32_t list_command, const pa_info_filter *f, pa_pdispatch_cb_t internal_cb, pa_operation_cb_t cb, void *userdata) {
+    pa_tagstruct *t;
+    pa_operation *o;
+    uint32_t tag;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, f, PA_ERR_INVALID);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, (f->fields & ~PA_INFO_FIELD_ALL) == 0, PA_ERR_INVALID);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !f->property || pa_proplist_key_valid(f->property), PA_ERR_INVALID);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !f->value || f->property, PA_ERR_INVALID);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 29, PA_ERR_NOTSUPPORTED);
+
+    o = pa_operation_new(c, NULL, cb, userdata);
+
+    t = pa_tagstruct_command(c, PA_COMMAND_GET_FILTERED_INFO_LIST, &tag);
+    pa_tagstruct_putu32(t, list_command);
+    pa_tagstruct_putu32(t, f->fields);
+    pa_tagstruct_putu32(t, f->owner_module);
+    pa_tagstruct_putu32(t, f->client);
+    pa_tagstruct_putu32(t, f->device);
+    pa_tagstruct_puts(t, f->property);
+    pa_tagstruct_puts(t, f->value);
+    pa_pstream_send_tagstruct(c->pstream, t);
+    pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, internal_cb, pa_operation_ref(o), (pa_free_cb_t) pa_operation_unref);
+
+    return o;
+}
+
+pa_operation* pa_context_get_sink_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_sink_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_SINK_INFO_LIST, f, context_get_sink_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+pa_operation* pa_context_get_source_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_source_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_SOURCE_INFO_LIST, f, context_get_source_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+pa_operation* pa_context_get_client_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_client_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_CLIENT_INFO_LIST, f, context_get_client_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+pa_operation* pa_context_get_card_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_card_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_CARD_INFO_LIST, f, context_get_card_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+pa_operation* pa_context_get_sink_input_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_sink_input_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_SINK_INPUT_INFO_LIST, f, context_get_sink_input_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+pa_operation* pa_context_get_source_output_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_source_output_info_cb_t cb, void *userdata) {
+    return get_info_list_filtered(c, PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST, f, context_get_source_output_info_callback, (pa_operation_cb_t) cb, userdata);
+}
+
+/*** Subscription events with info records ***/
+
+int pa_context_dispatch_subscribe_info(pa_context *c, pa_subscription_event_type_t e, uint32_t idx, pa_tagstruct *t) {
+    int r = 0;
+
+    pa_assert(c);
+    pa_assert(c->subscribe_info_callback);
+    pa_assert(t);
+
+    /* Removals and all facilities besides the ones below come without a record */
+    if (pa_tagstruct_eof(t)) {
+        c->subscribe_info_callback(c, e, idx, NULL, c->subscribe_info_userdata);
+        return 0;
+    }
+
+    switch (e & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SINK: {
+            pa_sink_info i;
+
+            if (sink_info_read(c, t, &i) < 0 || !pa_tagstruct_eof(t))
+                r = -1;
+            else
+                c->subscribe_info_callback(c, e, idx, &i, c->subscribe_info_userdata);
+
+            sink_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SOURCE: {
+            pa_source_info i;
+
+            if (source_info_read(c, t, &i) < 0 || !pa_tagstruct_eof(t))
+                r = -1;
+            else
+                c->subscribe_info_callback(c, e, idx, &i, c->subscribe_info_userdata);
+
+            source_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT: {
+            pa_sink_input_info i;
+
+            if (sink_input_info_read(c, t, &i) < 0 || !pa_tagstruct_eof(t))
+                r = -1;
+            else
+                c->subscribe_info_callback(c, e, idx, &i, c->subscribe_info_userdata);
+
+            sink_input_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT: {
+            pa_source_output_info i;
+
+            if (source_output_info_read(c, t, &i) < 0 || !pa_tagstruct_eof(t))
+                r = -1;
+            else
+                c->subscribe_info_callback(c, e, idx, &i, c->subscribe_info_userdata);
+
+            source_output_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_CLIENT: {
+            pa_client_info i;
+
+            if (client_info_read(c, t, &i) < 0 || !pa_tagstruct_eof(t))
+                r = -1;
+            else
+                c->subscribe_info_callback(c, e, idx, &i, c->subscribe_info_userdata);
+
+            client_info_free(&i);
+            break;
+        }
+
+        default:
+            r = -1;
+            break;
+    }
+
+    return r;
+}
+
+int pa_context_skip_info_record(pa_context *c, pa_subscription_event_type_t facility, pa_tagstruct *t) {
+    int r = -1;
+
+    pa_assert(c);
+    pa_assert(t);
+
+    switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SINK: {
+            pa_sink_info i;
+
+            r = sink_info_read(c, t, &i);
+            sink_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SOURCE: {
+            pa_source_info i;
+
+            r = source_info_read(c, t, &i);
+            source_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT: {
+            pa_sink_input_info i;
+
+            r = sink_input_info_read(c, t, &i);
+            sink_input_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT: {
+            pa_source_output_info i;
+
+            r = source_output_info_read(c, t, &i);
+            source_output_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_CLIENT: {
+            pa_client_info i;
+
+            r = client_info_read(c, t, &i);
+            client_info_free(&i);
+            break;
+        }
+
+        case PA_SUBSCRIPTION_EVENT_CARD: {
+            pa_card_info i;
+
+            r = card_info_read(c, t, &i);
+            card_info_free(&i);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return r;
+}
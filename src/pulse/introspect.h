@@ -136,6 +136,27 @@
  * either pa_context_get_client_info() or pa_context_get_client_info_list().
  * The information structure is called pa_client_info.
  *
+ * \subsection filter_subsec Filtered Queries
+ *
+ * Applications that only need some of the objects, or only some of
+ * their fields, can use the pa_context_get_*_info_list_filtered()
+ * functions with a pa_info_filter. The server then only sends the
+ * matching objects, and leaves out the property lists, ports and
+ * latencies unless they are requested. The latter also saves the
+ * server from asking the audio threads for the latencies.
+ *
+ * \subsection cache_subsec Object Cache
+ *
+ * Applications that query the same objects over and over again can
+ * have them cached locally with pa_context_enable_object_cache(). The
+ * cache holds the sinks, sources, sink inputs, source outputs, clients
+ * and cards and is kept up to date through subscription events. Once it
+ * is populated the query functions for these objects are answered from
+ * the cache without a round trip to the server. The callbacks are still
+ * called asynchronously from the main loop. Queries the cache cannot
+ * answer, e.g. for objects that just changed and whose new state has
+ * not arrived yet, go to the server as usual.
+ *
  * \section ctrl_sec Control
  *
  * Some parts of the server are only possible to read, but most can also be
@@ -633,6 +654,105 @@ pa_operation* pa_context_stat(pa_context *c, pa_stat_info_cb_t cb, void *userdat
 
 /** @} */
 
+/** @{ \name Object Cache */
+
+/** Keep a local copy of the sinks, sources, sink inputs, source
+ * outputs, clients and cards of the server and answer queries for them
+ * from it. The callback is called once the cache is populated. \since 5.0 */
+pa_operation* pa_context_enable_object_cache(pa_context *c, pa_context_success_cb_t cb, void *userdata);
+
+/** Drop the object cache again, all queries go to the server
+ * afterwards. \since 5.0 */
+void pa_context_disable_object_cache(pa_context *c);
+
+/** Return a counter that is changed whenever the contents of the
+ * object cache change, or 0 if the cache is not enabled or not
+ * populated yet. Comparing it with an earlier value tells whether data
+ * derived from the cache needs to be refreshed. \since 5.0 */
+uint32_t pa_context_get_object_cache_generation(pa_context *c);
+
+/** @} */
+
+/** @{ \name Filtered Queries */
+
+/** Parts of the info structures that are expensive to send or to
+ * collect. Fields that are not requested are left empty, all others
+ * are always filled in. \since 5.0 */
+typedef enum pa_info_field_mask {
+    PA_INFO_FIELD_PROPLIST = 0x0001U,
+    /**< The property lists, otherwise they are empty */
+
+    PA_INFO_FIELD_PORTS = 0x0002U,
+    /**< The ports of sinks, sources and cards, otherwise there are
+     * none and no active port */
+
+    PA_INFO_FIELD_LATENCY = 0x0004U,
+    /**< The current and configured latencies of sinks, sources, sink
+     * inputs and source outputs, otherwise they are 0. The server needs
+     * to ask the audio threads for these. */
+
+    PA_INFO_FIELD_ALL = 0x0007U
+    /**< All of the above */
+} pa_info_field_mask_t;
+
+/** \cond fulldocs */
+#define PA_INFO_FIELD_PROPLIST PA_INFO_FIELD_PROPLIST
+#define PA_INFO_FIELD_PORTS PA_INFO_FIELD_PORTS
+#define PA_INFO_FIELD_LATENCY PA_INFO_FIELD_LATENCY
+#define PA_INFO_FIELD_ALL PA_INFO_FIELD_ALL
+/** \endcond */
+
+/** Selects the objects and fields returned by the
+ * pa_context_get_*_info_list_filtered() functions. Initialize it with
+ * pa_info_filter_init() before setting the members you need. \since 5.0 */
+typedef struct pa_info_filter {
+    pa_info_field_mask_t fields;
+    /**< Which of the optional fields to fill in */
+
+    uint32_t owner_module;
+    /**< Only objects owned by this module, or PA_INVALID_INDEX */
+
+    uint32_t client;
+    /**< Only sink inputs and source outputs of this client, or
+     * PA_INVALID_INDEX */
+
+    uint32_t device;
+    /**< Only sink inputs connected to this sink, source outputs
+     * connected to this source, or sinks and sources of this card, or
+     * PA_INVALID_INDEX */
+
+    const char *property;
+    /**< Only objects that have this property set, or NULL */
+
+    const char *value;
+    /**< Only objects whose property is set to this string, or NULL
+     * for any value */
+} pa_info_filter;
+
+/** Initialize the filter so that it matches all objects and requests
+ * all fields, and return a pointer to it. \since 5.0 */
+pa_info_filter* pa_info_filter_init(pa_info_filter *f);
+
+/** Get the sinks that match the filter \since 5.0 */
+pa_operation* pa_context_get_sink_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_sink_info_cb_t cb, void *userdata);
+
+/** Get the sources that match the filter \since 5.0 */
+pa_operation* pa_context_get_source_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_source_info_cb_t cb, void *userdata);
+
+/** Get the clients that match the filter \since 5.0 */
+pa_operation* pa_context_get_client_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_client_info_cb_t cb, void *userdata);
+
+/** Get the cards that match the filter \since 5.0 */
+pa_operation* pa_context_get_card_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_card_info_cb_t cb, void *userdata);
+
+/** Get the sink inputs that match the filter \since 5.0 */
+pa_operation* pa_context_get_sink_input_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_sink_input_info_cb_t cb, void *userdata);
+
+/** Get the source outputs that match the filter \since 5.0 */
+pa_operation* pa_context_get_source_output_info_list_filtered(pa_context *c, const pa_info_filter *f, pa_source_output_info_cb_t cb, void *userdata);
+
+/** @} */
+
 /** @{ \name Cached Samples */
 
 /** Stores information about sample cache entries. Please note that this structure
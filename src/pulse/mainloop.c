@@ -30,12 +30,17 @@
 #include <fcntl.h>
 #include <errno.h>
 
+#ifdef HAVE_DLADDR
+#include <dlfcn.h>
+#endif
+
 #ifndef HAVE_PIPE
 #include <pulsecore/pipe.h>
 #endif
 
 #include <pulse/rtclock.h>
 #include <pulse/timeval.h>
+#include <pulse/util.h>
 #include <pulse/xmalloc.h>
 
 #include <pulsecore/poll.h>
@@ -94,6 +99,21 @@ struct pa_defer_event {
     PA_LLIST_FIELDS(pa_defer_event);
 };
 
+/* Callback durations are sorted into power-of-two buckets, the first
+ * one covering everything below WATCHDOG_BUCKET_BASE usec */
+#define WATCHDOG_BUCKET_BASE 16
+#define WATCHDOG_BUCKETS 16
+
+/* How often the histogram is logged while the main loop is running */
+#define WATCHDOG_DUMP_INTERVAL (60 * PA_USEC_PER_SEC)
+
+enum {
+    WATCHDOG_IO,
+    WATCHDOG_TIME,
+    WATCHDOG_DEFER,
+    WATCHDOG_MAX
+};
+
 struct pa_mainloop {
     PA_LLIST_HEAD(pa_io_event, io_events);
     PA_LLIST_HEAD(pa_time_event, time_events);
@@ -129,6 +149,14 @@ struct pa_mainloop {
     pa_poll_func poll_func;
     void *poll_func_userdata;
     int poll_func_ret;
+
+    pa_usec_t watchdog_threshold;
+    unsigned watchdog_histogram[WATCHDOG_MAX][WATCHDOG_BUCKETS];
+    unsigned watchdog_n_slow[WATCHDOG_MAX];
+    pa_usec_t watchdog_max[WATCHDOG_MAX];
+    pa_usec_t watchdog_next_dump;
+    pa_mainloop_watchdog_owner_cb_t watchdog_owner_callback;
+    void *watchdog_owner_userdata;
 };
 
 static short map_flags_to_libc(pa_io_event_flags_t flags) {
@@ -568,9 +596,53 @@ static void cleanup_defer_events(pa_mainloop *m, bool force) {
     pa_assert(m->defer_events_please_scan == 0);
 }
 
+static const char *watchdog_type_to_string(unsigned type) {
+    static const char * const table[WATCHDOG_MAX] = {
+        [WATCHDOG_IO] = "io",
+        [WATCHDOG_TIME] = "time",
+        [WATCHDOG_DEFER] = "defer"
+    };
+
+    pa_assert(type < WATCHDOG_MAX);
+
+    return table[type];
+}
+
+static void watchdog_dump(pa_mainloop *m, pa_log_level_t level) {
+    unsigned t, b;
+
+    pa_assert(m);
+
+    if (m->watchdog_threshold <= 0)
+        return;
+
+    for (t = 0; t < WATCHDOG_MAX; t++) {
+        char buf[512] = "";
+        size_t l = 0;
+
+        for (b = 0; b < WATCHDOG_BUCKETS && l < sizeof(buf); b++) {
+            if (m->watchdog_histogram[t][b] <= 0)
+                continue;
+
+            if (b == WATCHDOG_BUCKETS - 1)
+                l += pa_snprintf(buf + l, sizeof(buf) - l, " >=%uus:%u",
+                                 WATCHDOG_BUCKET_BASE << (b - 1), m->watchdog_histogram[t][b]);
+            else
+                l += pa_snprintf(buf + l, sizeof(buf) - l, " <%uus:%u",
+                                 WATCHDOG_BUCKET_BASE << b, m->watchdog_histogram[t][b]);
+        }
+
+        pa_logl(level, "Main loop %s callbacks: %u slow, max %0.2f ms, histogram:%s",
+                watchdog_type_to_string(t), m->watchdog_n_slow[t],
+                (double) m->watchdog_max[t] / PA_USEC_PER_MSEC, buf);
+    }
+}
+
 void pa_mainloop_free(pa_mainloop *m) {
     pa_assert(m);
 
+    watchdog_dump(m, PA_LOG_INFO);
+
     cleanup_io_events(m, true);
     cleanup_defer_events(m, true);
     cleanup_time_events(m, true);
@@ -634,9 +706,86 @@ static void rebuild_pollfds(pa_mainloop *m) {
     m->rebuild_pollfds = false;
 }
 
+static pa_usec_t watchdog_begin(pa_mainloop *m) {
+    if (m->watchdog_threshold <= 0)
+        return 0;
+
+    return pa_rtclock_now();
+}
+
+/* Figure out which shared object (i.e. which module) the callback
+ * lives in. Most callbacks are static functions, hence we print the
+ * offset into the object so that addr2line can resolve it. The owner
+ * callback, if set, names the module or client behind it. */
+static void watchdog_describe(pa_mainloop *m, char *buf, size_t l, const void *callback, void *userdata) {
+    const char *object = NULL;
+    char *owner = NULL;
+    size_t n;
+#ifdef HAVE_DLADDR
+    Dl_info info;
+
+    if (dladdr(callback, &info) && info.dli_fname) {
+        object = pa_path_get_filename(info.dli_fname);
+
+        if (info.dli_sname && info.dli_saddr == callback)
+            n = pa_snprintf(buf, l, "%s:%s() userdata=%p", object, info.dli_sname, userdata);
+        else
+            n = pa_snprintf(buf, l, "%s+0x%lx userdata=%p", object,
+                            (unsigned long) ((const char*) callback - (const char*) info.dli_fbase), userdata);
+    } else
+#endif
+        n = pa_snprintf(buf, l, "%p userdata=%p", callback, userdata);
+
+    if (m->watchdog_owner_callback)
+        owner = m->watchdog_owner_callback(m, object, userdata, m->watchdog_owner_userdata);
+
+    if (owner) {
+        pa_snprintf(buf + n, l - n, " owner=%s", owner);
+        pa_xfree(owner);
+    }
+}
+
+static void watchdog_end(pa_mainloop *m, unsigned type, const void *callback, void *userdata, pa_usec_t begin) {
+    pa_usec_t now, d;
+    unsigned b;
+
+    if (begin <= 0)
+        return;
+
+    now = pa_rtclock_now();
+    d = now - begin;
+
+    for (b = 0; b < WATCHDOG_BUCKETS - 1; b++)
+        if (d < ((pa_usec_t) WATCHDOG_BUCKET_BASE << b))
+            break;
+
+    m->watchdog_histogram[type][b]++;
+
+    if (d > m->watchdog_max[type])
+        m->watchdog_max[type] = d;
+
+    if (d >= m->watchdog_threshold) {
+        char t[256];
+
+        m->watchdog_n_slow[type]++;
+
+        watchdog_describe(m, t, sizeof(t), callback, userdata);
+        pa_log_warn("Main loop %s callback %s took %0.2f ms, blocking all other event sources.",
+                    watchdog_type_to_string(type), t, (double) d / PA_USEC_PER_MSEC);
+    }
+
+    if (now >= m->watchdog_next_dump) {
+        if (m->watchdog_next_dump > 0)
+            watchdog_dump(m, PA_LOG_DEBUG);
+
+        m->watchdog_next_dump = now + WATCHDOG_DUMP_INTERVAL;
+    }
+}
+
 static unsigned dispatch_pollfds(pa_mainloop *m) {
     pa_io_event *e;
     unsigned r = 0, k;
+    pa_usec_t begin;
 
     pa_assert(m->poll_func_ret > 0);
 
@@ -653,7 +802,9 @@ static unsigned dispatch_pollfds(pa_mainloop *m) {
         pa_assert(e->pollfd->fd == e->fd);
         pa_assert(e->callback);
 
+        begin = watchdog_begin(m);
         e->callback(&m->api, e, e->fd, map_flags_from_libc(e->pollfd->revents), e->userdata);
+        watchdog_end(m, WATCHDOG_IO, (const void*) e->callback, e->userdata, begin);
         e->pollfd->revents = 0;
         r++;
         k--;
@@ -665,6 +816,7 @@ static unsigned dispatch_pollfds(pa_mainloop *m) {
 static unsigned dispatch_defer(pa_mainloop *m) {
     pa_defer_event *e;
     unsigned r = 0;
+    pa_usec_t begin;
 
     if (m->n_enabled_defer_events <= 0)
         return 0;
@@ -678,7 +830,9 @@ static unsigned dispatch_defer(pa_mainloop *m) {
             continue;
 
         pa_assert(e->callback);
+        begin = watchdog_begin(m);
         e->callback(&m->api, e, e->userdata);
+        watchdog_end(m, WATCHDOG_DEFER, (const void*) e->callback, e->userdata, begin);
         r++;
     }
 
@@ -751,12 +905,15 @@ static unsigned dispatch_timeout(pa_mainloop *m) {
 
         if (e->time <= now) {
             struct timeval tv;
+            pa_usec_t begin;
             pa_assert(e->callback);
 
             /* Disable time event */
             mainloop_time_restart(e, NULL);
 
+            begin = watchdog_begin(m);
             e->callback(&m->api, e, pa_timeval_rtstore(&tv, e->time, e->use_rtclock), e->userdata);
+            watchdog_end(m, WATCHDOG_TIME, (const void*) e->callback, e->userdata, begin);
 
             r++;
         }
@@ -978,6 +1135,20 @@ void pa_mainloop_set_poll_func(pa_mainloop *m, pa_poll_func poll_func, void *use
     m->poll_func_userdata = userdata;
 }
 
+void pa_mainloop_set_watchdog(pa_mainloop *m, pa_usec_t threshold) {
+    pa_assert(m);
+
+    m->watchdog_threshold = threshold;
+    m->watchdog_next_dump = 0;
+}
+
+void pa_mainloop_set_watchdog_owner_callback(pa_mainloop *m, pa_mainloop_watchdog_owner_cb_t cb, void *userdata) {
+    pa_assert(m);
+
+    m->watchdog_owner_callback = cb;
+    m->watchdog_owner_userdata = userdata;
+}
+
 bool pa_mainloop_is_our_api(pa_mainloop_api *m) {
     pa_assert(m);
 
@@ -25,6 +25,7 @@
 
 #include <pulse/mainloop-api.h>
 #include <pulse/cdecl.h>
+#include <pulse/sample.h>
 
 PA_C_DECL_BEGIN
 
@@ -128,6 +129,26 @@ typedef int (*pa_poll_func)(struct pollfd *ufds, unsigned long nfds, int timeout
 /** Change the poll() implementation */
 void pa_mainloop_set_poll_func(pa_mainloop *m, pa_poll_func poll_func, void *userdata);
 
+/** Enable the dispatch watchdog. Every io, time and defer callback
+ * is timed and sorted into a histogram, and callbacks that take
+ * longer than the specified threshold are logged together with the
+ * shared object they belong to. The histogram is logged every minute
+ * at debug level, and when the main loop is freed. Pass 0 to disable the watchdog, which is the
+ * default. \since 5.0 */
+void pa_mainloop_set_watchdog(pa_mainloop *m, pa_usec_t threshold);
+
+/** Watchdog callback that names the owner of a slow callback, e.g.
+ * the module or client it belongs to. object is the file name of the
+ * shared object the callback lives in, or NULL if that is not known,
+ * event_userdata the userdata the event was created with. Returns a
+ * string allocated with pa_xmalloc(), or NULL if the owner is not
+ * known. \since 5.0 */
+typedef char* (*pa_mainloop_watchdog_owner_cb_t)(pa_mainloop *m, const char *object, void *event_userdata, void *userdata);
+
+/** Set the callback the watchdog uses to name the owners of slow
+ * callbacks in its reports. \since 5.0 */
+void pa_mainloop_set_watchdog_owner_callback(pa_mainloop *m, pa_mainloop_watchdog_owner_cb_t cb, void *userdata);
+
 PA_C_DECL_END
 
 #endif
@@ -0,0 +1,590 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulse/xmalloc.h>
+#include <pulse/fork-detect.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/hashmap.h>
+#include <pulsecore/idxset.h>
+#include <pulsecore/llist.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/pstream-util.h>
+#include <pulsecore/refcnt.h>
+
+#include "internal.h"
+#include "introspect.h"
+
+/* The object cache keeps the records the server sends in reply to
+ * GET_*_INFO in their serialized form, one per object. It is filled
+ * with the *_LIST commands once and then follows the subscription
+ * events: with protocol version 29 and newer the events carry the
+ * record, otherwise we ask for it. Requests that can be answered from
+ * the cache get the records passed to their usual reply callback from
+ * the main loop, the same way as if the server had sent them. */
+
+#define N_FACILITIES (PA_SUBSCRIPTION_EVENT_CARD+1)
+
+struct entry {
+    uint32_t index;
+    char *name;
+    uint8_t *data;
+    size_t length;
+
+    /* We asked the server for a fresh record */
+    bool stale;
+};
+
+struct facility {
+    /* Objects by index and, if names are unique, by name */
+    pa_hashmap *entries;
+    pa_hashmap *entries_by_name;
+    unsigned n_stale;
+    bool ready;
+};
+
+/* A reply to GET_*_INFO(_LIST) we are waiting for */
+struct request {
+    pa_object_cache *cache;
+    pa_subscription_event_type_t facility;
+
+    /* PA_INVALID_INDEX for the list */
+    uint32_t index;
+};
+
+/* A request answered from the cache that still needs to be dispatched */
+struct lookup {
+    pa_object_cache *cache;
+    pa_operation *operation;
+    pa_pdispatch_cb_t callback;
+    uint8_t *data;
+    size_t length;
+    pa_defer_event *defer_event;
+
+    PA_LLIST_FIELDS(struct lookup);
+};
+
+struct pa_object_cache {
+    PA_REFCNT_DECLARE;
+
+    /* NULL once the cache is disabled and only waits for the
+     * outstanding replies */
+    pa_context *context;
+
+    struct facility facilities[N_FACILITIES];
+    unsigned n_pending_lists;
+    uint32_t generation;
+
+    /* Completes when all lists arrived */
+    pa_operation *populate;
+
+    PA_LLIST_HEAD(struct lookup, lookups);
+};
+
+static const struct {
+    pa_subscription_event_type_t facility;
+    uint32_t command, list_command;
+
+    /* Whether GET_*_INFO takes a name, which is unique */
+    bool has_name;
+
+    /* Servers older than this don't know the object type */
+    uint32_t min_version;
+} cached_facilities[] = {
+    { PA_SUBSCRIPTION_EVENT_SINK, PA_COMMAND_GET_SINK_INFO, PA_COMMAND_GET_SINK_INFO_LIST, true, 0 },
+    { PA_SUBSCRIPTION_EVENT_SOURCE, PA_COMMAND_GET_SOURCE_INFO, PA_COMMAND_GET_SOURCE_INFO_LIST, true, 0 },
+    { PA_SUBSCRIPTION_EVENT_SINK_INPUT, PA_COMMAND_GET_SINK_INPUT_INFO, PA_COMMAND_GET_SINK_INPUT_INFO_LIST, false, 0 },
+    { PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, PA_COMMAND_GET_SOURCE_OUTPUT_INFO, PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST, false, 0 },
+    { PA_SUBSCRIPTION_EVENT_CLIENT, PA_COMMAND_GET_CLIENT_INFO, PA_COMMAND_GET_CLIENT_INFO_LIST, false, 0 },
+    { PA_SUBSCRIPTION_EVENT_CARD, PA_COMMAND_GET_CARD_INFO, PA_COMMAND_GET_CARD_INFO_LIST, true, 15 },
+};
+
+static unsigned find_cached_facility(pa_subscription_event_type_t facility) {
+    unsigned i;
+
+    for (i = 0; i < PA_ELEMENTSOF(cached_facilities); i++)
+        if (cached_facilities[i].facility == facility)
+            return i;
+
+    return (unsigned) -1;
+}
+
+static void entry_free(struct entry *e) {
+    pa_assert(e);
+
+    pa_xfree(e->name);
+    pa_xfree(e->data);
+    pa_xfree(e);
+}
+
+static void lookup_free(struct lookup *l) {
+    pa_assert(l);
+
+    PA_LLIST_REMOVE(struct lookup, l->cache->lookups, l);
+
+    if (l->defer_event)
+        l->cache->context->mainloop->defer_free(l->defer_event);
+
+    if (l->operation)
+        pa_operation_unref(l->operation);
+
+    pa_xfree(l->data);
+    pa_xfree(l);
+}
+
+static pa_object_cache *object_cache_ref(pa_object_cache *cache) {
+    pa_assert(cache);
+    pa_assert(PA_REFCNT_VALUE(cache) >= 1);
+
+    PA_REFCNT_INC(cache);
+    return cache;
+}
+
+static void object_cache_unref(pa_object_cache *cache) {
+    pa_assert(cache);
+    pa_assert(PA_REFCNT_VALUE(cache) >= 1);
+
+    if (PA_REFCNT_DEC(cache) > 0)
+        return;
+
+    pa_assert(!cache->context);
+    pa_xfree(cache);
+}
+
+static void request_free(struct request *r) {
+    pa_assert(r);
+
+    object_cache_unref(r->cache);
+    pa_xfree(r);
+}
+
+static void remove_entry(pa_object_cache *cache, pa_subscription_event_type_t facility, uint32_t idx) {
+    struct facility *f = &cache->facilities[facility];
+    struct entry *e;
+
+    if (!(e = pa_hashmap_remove(f->entries, PA_UINT32_TO_PTR(idx))))
+        return;
+
+    if (f->entries_by_name && e->name && pa_hashmap_get(f->entries_by_name, e->name) == e)
+        pa_hashmap_remove(f->entries_by_name, e->name);
+
+    if (e->stale)
+        f->n_stale--;
+
+    entry_free(e);
+    cache->generation++;
+}
+
+/* Stores a record that has already been checked */
+static void put_entry(pa_object_cache *cache, pa_subscription_event_type_t facility, const uint8_t *data, size_t length) {
+    struct facility *f = &cache->facilities[facility];
+    pa_tagstruct *t;
+    struct entry *e;
+    const char *name = NULL;
+
+    e = pa_xnew0(struct entry, 1);
+    e->data = pa_xmemdup(data, length);
+    e->length = length;
+
+    /* All records start with the index and the name */
+    t = pa_tagstruct_new(e->data, e->length);
+    pa_assert_se(pa_tagstruct_getu32(t, &e->index) == 0);
+    pa_assert_se(pa_tagstruct_gets(t, &name) == 0);
+    e->name = pa_xstrdup(name);
+    pa_tagstruct_free(t);
+
+    remove_entry(cache, facility, e->index);
+
+    pa_assert_se(pa_hashmap_put(f->entries, PA_UINT32_TO_PTR(e->index), e) == 0);
+
+    /* Names are unique, if another object had this name before it has
+     * been renamed since */
+    if (f->entries_by_name && e->name) {
+        pa_hashmap_remove(f->entries_by_name, e->name);
+        pa_assert_se(pa_hashmap_put(f->entries_by_name, e->name, e) == 0);
+    }
+
+    cache->generation++;
+}
+
+static void populate_done(pa_object_cache *cache, bool success) {
+    pa_operation *o;
+
+    if (!(o = cache->populate))
+        return;
+
+    cache->populate = NULL;
+
+    if (o->callback) {
+        pa_context_success_cb_t cb = (pa_context_success_cb_t) o->callback;
+        cb(o->context, success, o->userdata);
+    }
+
+    pa_operation_done(o);
+    pa_operation_unref(o);
+}
+
+static void request_reply_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    struct request *r = userdata;
+    pa_object_cache *cache = r->cache;
+    pa_context *c = cache->context;
+    struct facility *f = &cache->facilities[r->facility];
+
+    pa_assert(pd);
+
+    /* Disabled in the meantime */
+    if (!c)
+        return;
+
+    if (command != PA_COMMAND_REPLY) {
+        if (pa_context_handle_error(c, command, t, false) < 0)
+            return;
+
+        if (r->index == PA_INVALID_INDEX)
+            populate_done(cache, false);
+        else
+            /* The object is gone already, the removal event is on its way */
+            remove_entry(cache, r->facility, r->index);
+
+        return;
+    }
+
+    while (!pa_tagstruct_eof(t)) {
+        const uint8_t *data;
+        size_t length, left;
+
+        data = pa_tagstruct_unread_data(t, &length);
+
+        if (pa_context_skip_info_record(c, r->facility, t) < 0) {
+            pa_context_fail(c, PA_ERR_PROTOCOL);
+            return;
+        }
+
+        pa_tagstruct_unread_data(t, &left);
+        put_entry(cache, r->facility, data, length - left);
+    }
+
+    if (r->index == PA_INVALID_INDEX) {
+        f->ready = true;
+
+        pa_assert(cache->n_pending_lists > 0);
+        if (--cache->n_pending_lists <= 0)
+            populate_done(cache, true);
+    }
+}
+
+static void send_request(pa_object_cache *cache, pa_subscription_event_type_t facility, uint32_t idx) {
+    pa_context *c = cache->context;
+    unsigned i = find_cached_facility(facility);
+    struct request *r;
+    pa_tagstruct *t;
+    uint32_t tag;
+
+    pa_assert(i < PA_ELEMENTSOF(cached_facilities));
+
+    if (idx == PA_INVALID_INDEX)
+        t = pa_tagstruct_command(c, cached_facilities[i].list_command, &tag);
+    else {
+        t = pa_tagstruct_command(c, cached_facilities[i].command, &tag);
+        pa_tagstruct_putu32(t, idx);
+        if (cached_facilities[i].has_name)
+            pa_tagstruct_puts(t, NULL);
+    }
+
+    pa_pstream_send_tagstruct(c->pstream, t);
+
+    r = pa_xnew(struct request, 1);
+    r->cache = object_cache_ref(cache);
+    r->facility = facility;
+    r->index = idx;
+
+    pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, request_reply_callback, r, (pa_free_cb_t) request_free);
+}
+
+void pa_object_cache_event(pa_object_cache *cache, pa_subscription_event_type_t e, uint32_t idx, pa_tagstruct *t) {
+    pa_subscription_event_type_t facility = e & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+    struct facility *f;
+    struct entry *entry;
+    pa_tagstruct *record;
+    const uint8_t *data;
+    size_t length;
+
+    pa_assert(cache);
+    pa_assert(cache->context);
+    pa_assert(t);
+
+    if (find_cached_facility(facility) >= PA_ELEMENTSOF(cached_facilities))
+        return;
+
+    if ((e & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+        remove_entry(cache, facility, idx);
+        return;
+    }
+
+    f = &cache->facilities[facility];
+
+    /* The record, if there is one, is all that is left in the event. We
+     * leave it to be read by the subscription callback. */
+    data = pa_tagstruct_unread_data(t, &length);
+
+    if (length > 0) {
+        record = pa_tagstruct_new(data, length);
+
+        if (pa_context_skip_info_record(cache->context, facility, record) < 0 || !pa_tagstruct_eof(record)) {
+            pa_tagstruct_free(record);
+            pa_context_fail(cache->context, PA_ERR_PROTOCOL);
+            return;
+        }
+
+        pa_tagstruct_free(record);
+        put_entry(cache, facility, data, length);
+        return;
+    }
+
+    /* A reply we are already waiting for will be at least as recent as
+     * this event */
+    if ((entry = pa_hashmap_get(f->entries, PA_UINT32_TO_PTR(idx))) && entry->stale)
+        return;
+
+    if (!entry) {
+        /* A placeholder so that lookups of the object go to the server
+         * until the record arrives */
+        entry = pa_xnew0(struct entry, 1);
+        entry->index = idx;
+        pa_assert_se(pa_hashmap_put(f->entries, PA_UINT32_TO_PTR(idx), entry) == 0);
+    }
+
+    entry->stale = true;
+    f->n_stale++;
+    cache->generation++;
+
+    send_request(cache, facility, idx);
+}
+
+static void lookup_defer_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata) {
+    struct lookup *l = userdata;
+    pa_context *c = l->cache->context;
+    pa_pdispatch_cb_t cb = l->callback;
+    pa_operation *o = l->operation;
+    pa_tagstruct *t;
+
+    l->operation = NULL;
+    t = l->data ? pa_tagstruct_new(l->data, l->length) : pa_tagstruct_new(NULL, 0);
+
+    /* Unlink first, the callback might disable the cache */
+    PA_LLIST_REMOVE(struct lookup, l->cache->lookups, l);
+    m->defer_free(l->defer_event);
+
+    /* Takes over our reference to the operation */
+    cb(c->pdispatch, PA_COMMAND_REPLY, 0, t, o);
+
+    pa_tagstruct_free(t);
+    pa_xfree(l->data);
+    pa_xfree(l);
+}
+
+pa_operation* pa_object_cache_lookup(pa_context *c, pa_subscription_event_type_t facility, uint32_t idx, const char *name,
+                                     pa_pdispatch_cb_t internal_cb, pa_operation_cb_t cb, void *userdata) {
+    pa_object_cache *cache;
+    struct facility *f;
+    struct entry *e;
+    struct lookup *l;
+    pa_operation *o;
+    void *state;
+
+    pa_assert(c);
+    pa_assert(internal_cb);
+
+    if (!(cache = c->object_cache) || pa_detect_fork() || c->state != PA_CONTEXT_READY)
+        return NULL;
+
+    f = &cache->facilities[facility];
+
+    if (!f->ready)
+        return NULL;
+
+    l = pa_xnew0(struct lookup, 1);
+
+    if (idx != PA_INVALID_INDEX || name) {
+        if (idx != PA_INVALID_INDEX)
+            e = pa_hashmap_get(f->entries, PA_UINT32_TO_PTR(idx));
+        else
+            e = f->entries_by_name ? pa_hashmap_get(f->entries_by_name, name) : NULL;
+
+        /* Let the server handle errors and objects we know nothing
+         * recent about */
+        if (!e || e->stale) {
+            pa_xfree(l);
+            return NULL;
+        }
+
+        l->data = pa_xmemdup(e->data, e->length);
+        l->length = e->length;
+
+    } else {
+        uint8_t *p;
+
+        if (f->n_stale > 0) {
+            pa_xfree(l);
+            return NULL;
+        }
+
+        PA_HASHMAP_FOREACH(e, f->entries, state)
+            l->length += e->length;
+
+        if (l->length > 0) {
+            p = l->data = pa_xmalloc(l->length);
+
+            PA_HASHMAP_FOREACH(e, f->entries, state) {
+                memcpy(p, e->data, e->length);
+                p += e->length;
+            }
+        }
+    }
+
+    o = pa_operation_new(c, NULL, cb, userdata);
+
+    l->cache = cache;
+    l->operation = pa_operation_ref(o);
+    l->callback = internal_cb;
+    l->defer_event = c->mainloop->defer_new(c->mainloop, lookup_defer_cb, l);
+    PA_LLIST_PREPEND(struct lookup, cache->lookups, l);
+
+    return o;
+}
+
+void pa_object_cache_free(pa_object_cache *cache) {
+    unsigned i;
+
+    pa_assert(cache);
+    pa_assert(cache->context);
+
+    /* The server will never answer the lookups we were going to
+     * serve, don't leave their operations running */
+    while (cache->lookups) {
+        if (cache->lookups->operation)
+            pa_operation_cancel(cache->lookups->operation);
+
+        lookup_free(cache->lookups);
+    }
+
+    if (cache->populate) {
+        pa_operation_cancel(cache->populate);
+        pa_operation_unref(cache->populate);
+        cache->populate = NULL;
+    }
+
+    for (i = 0; i < PA_ELEMENTSOF(cached_facilities); i++) {
+        struct facility *f = &cache->facilities[cached_facilities[i].facility];
+
+        if (f->entries_by_name)
+            pa_hashmap_free(f->entries_by_name, NULL);
+
+        pa_hashmap_free(f->entries, (pa_free_cb_t) entry_free);
+    }
+
+    /* Replies that are still on their way keep a reference */
+    cache->context = NULL;
+    object_cache_unref(cache);
+}
+
+pa_operation* pa_context_enable_object_cache(pa_context *c, pa_context_success_cb_t cb, void *userdata) {
+    pa_object_cache *cache;
+    pa_operation *o;
+    unsigned i;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !c->object_cache, PA_ERR_EXIST);
+
+    cache = pa_xnew0(pa_object_cache, 1);
+    PA_REFCNT_INIT(cache);
+    cache->context = c;
+    cache->generation = 1;
+    PA_LLIST_HEAD_INIT(struct lookup, cache->lookups);
+
+    for (i = 0; i < PA_ELEMENTSOF(cached_facilities); i++) {
+        struct facility *f = &cache->facilities[cached_facilities[i].facility];
+
+        f->entries = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+        if (cached_facilities[i].has_name)
+            f->entries_by_name = pa_hashmap_new(pa_idxset_string_hash_func, pa_idxset_string_compare_func);
+    }
+
+    c->object_cache = cache;
+
+    o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
+    cache->populate = pa_operation_ref(o);
+
+    /* Subscribe first, so that we don't miss any changes that happen
+     * while the lists are on their way */
+    pa_operation_unref(pa_context_update_subscription(c, NULL, NULL));
+
+    /* Facilities the server doesn't know stay unready, so lookups
+     * go to the server and fail there as they always did */
+    for (i = 0; i < PA_ELEMENTSOF(cached_facilities); i++) {
+        if (c->version < cached_facilities[i].min_version)
+            continue;
+
+        send_request(cache, cached_facilities[i].facility, PA_INVALID_INDEX);
+        cache->n_pending_lists++;
+    }
+
+    return o;
+}
+
+void pa_context_disable_object_cache(pa_context *c) {
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    if (!c->object_cache)
+        return;
+
+    pa_object_cache_free(c->object_cache);
+    c->object_cache = NULL;
+
+    if (c->state == PA_CONTEXT_READY)
+        pa_operation_unref(pa_context_update_subscription(c, NULL, NULL));
+}
+
+uint32_t pa_context_get_object_cache_generation(pa_context *c) {
+    unsigned i;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    if (!c->object_cache)
+        return 0;
+
+    for (i = 0; i < PA_ELEMENTSOF(cached_facilities); i++)
+        if (c->version >= cached_facilities[i].min_version &&
+            !c->object_cache->facilities[cached_facilities[i].facility].ready)
+            return 0;
+
+    return c->object_cache->generation;
+}
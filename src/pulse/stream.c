@@ -53,6 +53,16 @@
 #define SMOOTHER_HISTORY_TIME (5000*PA_USEC_PER_MSEC)
 #define SMOOTHER_MIN_HISTORY (4)
 
+/* A timing update answered from the timing page. It is completed from
+ * a defer event, so that no callbacks are called from within
+ * pa_stream_update_timing_info() */
+struct pa_timing_page_request {
+    pa_stream *stream;
+    pa_operation *operation;
+    pa_defer_event *defer_event;
+    PA_LLIST_FIELDS(pa_timing_page_request);
+};
+
 pa_stream *pa_stream_new(pa_context *c, const char *name, const pa_sample_spec *ss, const pa_channel_map *map) {
     return pa_stream_new_with_proplist(c, name, ss, map, NULL);
 }
@@ -194,6 +204,12 @@ static pa_stream *pa_stream_new_with_proplist_internal(
     s->auto_timing_update_requested = false;
     s->auto_timing_interval_usec = AUTO_TIMING_INTERVAL_START_USEC;
 
+    s->timing_page_synced = false;
+    s->timing_slot = PA_INVALID_INDEX;
+    s->timing_page_not_before = 0;
+    s->timing_info_at = 0;
+    PA_LLIST_HEAD_INIT(pa_timing_page_request, s->timing_page_requests);
+
     reset_callbacks(s);
 
     s->smoother = NULL;
@@ -238,6 +254,15 @@ pa_stream *pa_stream_new_extended(
     return pa_stream_new_with_proplist_internal(c, name, NULL, NULL, formats, n_formats, p);
 }
 
+static void timing_page_request_free(pa_timing_page_request *r) {
+    pa_assert(r);
+
+    PA_LLIST_REMOVE(pa_timing_page_request, r->stream->timing_page_requests, r);
+    r->stream->mainloop->defer_free(r->defer_event);
+    pa_operation_unref(r->operation);
+    pa_xfree(r);
+}
+
 static void stream_unlink(pa_stream *s) {
     pa_operation *o, *n;
     pa_assert(s);
@@ -247,6 +272,9 @@ static void stream_unlink(pa_stream *s) {
 
     /* Detach from context */
 
+    while (s->timing_page_requests)
+        timing_page_request_free(s->timing_page_requests);
+
     /* Unref all operation objects that point to us */
     for (o = s->context->operations; o; o = n) {
         n = o->next;
@@ -380,6 +408,13 @@ static void request_auto_timing_update(pa_stream *s, bool force) {
     pa_assert(s);
     pa_assert(PA_REFCNT_VALUE(s) >= 1);
 
+    /* Something happened that the timing page might not reflect yet,
+     * go to the server until it answered a request sent after this */
+    if (force && s->context) {
+        s->timing_page_synced = false;
+        s->timing_page_not_before = s->context->ctag;
+    }
+
     if (!(s->flags & PA_STREAM_AUTO_TIMING_UPDATE))
         return;
 
@@ -1143,6 +1178,23 @@ void pa_create_stream_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag,
         }
     }
 
+    if (s->context->version >= 29 && s->direction == PA_STREAM_PLAYBACK) {
+        uint32_t page_id;
+
+        if (pa_tagstruct_getu32(t, &page_id) < 0 ||
+            pa_tagstruct_getu32(t, &s->timing_slot) < 0) {
+            pa_context_fail(s->context, PA_ERR_PROTOCOL);
+            goto finish;
+        }
+
+        /* All streams of a connection share one page */
+        if (s->timing_slot != PA_INVALID_INDEX && !s->context->timing_page)
+            s->context->timing_page = pa_timing_page_attach(page_id);
+
+        if (!s->context->timing_page || pa_timing_page_get_id(s->context->timing_page) != page_id)
+            s->timing_slot = PA_INVALID_INDEX;
+    }
+
     if (!pa_tagstruct_eof(t)) {
         pa_context_fail(s->context, PA_ERR_PROTOCOL);
         goto finish;
@@ -1217,7 +1269,7 @@ static int create_stream(
 
     PA_CHECK_VALIDITY(s->context, s->context->version >= 12 || !(flags & PA_STREAM_VARIABLE_RATE), PA_ERR_NOTSUPPORTED);
     PA_CHECK_VALIDITY(s->context, s->context->version >= 13 || !(flags & PA_STREAM_PEAK_DETECT), PA_ERR_NOTSUPPORTED);
-    PA_CHECK_VALIDITY(s->context, s->context->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    PA_CHECK_VALIDITY(s->context, pa_context_accepts_requests(s->context), PA_ERR_BADSTATE);
     /* Although some of the other flags are not supported on older
      * version, we don't check for them here, because it doesn't hurt
      * when they are passed but actually not supported. This makes
@@ -1374,6 +1426,7 @@ static int create_stream(
     }
 
     pa_pstream_send_tagstruct(s->context->pstream, t);
+    pa_context_request_sent(s->context);
     pa_pdispatch_register_reply(s->context->pdispatch, tag, DEFAULT_TIMEOUT, pa_create_stream_callback, s, NULL);
 
     pa_stream_set_state(s, PA_STREAM_CREATING);
@@ -1768,6 +1821,54 @@ static pa_usec_t calc_time(pa_stream *s, bool ignore_transport) {
     return usec;
 }
 
+/* Update smoother if we're not corked */
+static void update_smoother(pa_stream *s) {
+    pa_timing_info *i = &s->timing_info;
+    pa_usec_t u, x;
+
+    if (!s->smoother || s->corked)
+        return;
+
+    u = x = pa_rtclock_now() - i->transport_usec;
+
+    if (s->direction == PA_STREAM_PLAYBACK && s->context->version >= 13) {
+        pa_usec_t su;
+
+        /* If we weren't playing then it will take some time
+         * until the audio will actually come out through the
+         * speakers. Since we follow that timing here, we need
+         * to try to fix this up */
+
+        su = pa_bytes_to_usec((uint64_t) i->since_underrun, &s->sample_spec);
+
+        if (su < i->sink_usec)
+            x += i->sink_usec - su;
+    }
+
+    if (!i->playing)
+        pa_smoother_pause(s->smoother, x);
+
+    /* Update the smoother */
+    if ((s->direction == PA_STREAM_PLAYBACK && !i->read_index_corrupt) ||
+        (s->direction == PA_STREAM_RECORD && !i->write_index_corrupt))
+        pa_smoother_put(s->smoother, u, calc_time(s, true));
+
+    if (i->playing)
+        pa_smoother_resume(s->smoother, x, true);
+}
+
+static void timing_update_complete(pa_operation *o) {
+    o->stream->auto_timing_update_requested = false;
+
+    if (o->stream->latency_update_callback)
+        o->stream->latency_update_callback(o->stream, o->stream->latency_update_userdata);
+
+    if (o->callback && o->stream && o->stream->state == PA_STREAM_READY) {
+        pa_stream_success_cb_t cb = (pa_stream_success_cb_t) o->callback;
+        cb(o->stream, o->stream->timing_info_valid, o->userdata);
+    }
+}
+
 static void stream_get_timing_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_operation *o = userdata;
     struct timeval local, remote, now;
@@ -1785,6 +1886,7 @@ static void stream_get_timing_info_callback(pa_pdispatch *pd, uint32_t command,
     i = &o->stream->timing_info;
 
     o->stream->timing_info_valid = false;
+    o->stream->timing_page_synced = false;
     i->write_index_corrupt = true;
     i->read_index_corrupt = true;
 
@@ -1905,52 +2007,77 @@ static void stream_get_timing_info_callback(pa_pdispatch *pd, uint32_t command,
                 i->read_index -= (int64_t) pa_memblockq_get_length(o->stream->record_memblockq);
         }
 
-        /* Update smoother if we're not corked */
-        if (o->stream->smoother && !o->stream->corked) {
-            pa_usec_t u, x;
+        /* We know where we are, the timing page can take over */
+        if (o->stream->timing_slot != PA_INVALID_INDEX &&
+            tag >= o->stream->timing_page_not_before &&
+            !i->read_index_corrupt && !i->write_index_corrupt)
+            o->stream->timing_page_synced = true;
 
-            u = x = pa_rtclock_now() - i->transport_usec;
+        o->stream->timing_info_at = pa_rtclock_now() - pa_timeval_diff(&now, &i->timestamp);
 
-            if (o->stream->direction == PA_STREAM_PLAYBACK && o->context->version >= 13) {
-                pa_usec_t su;
+        update_smoother(o->stream);
+    }
 
-                /* If we weren't playing then it will take some time
-                 * until the audio will actually come out through the
-                 * speakers. Since we follow that timing here, we need
-                 * to try to fix this up */
+    timing_update_complete(o);
 
-                su = pa_bytes_to_usec((uint64_t) i->since_underrun, &o->stream->sample_spec);
+finish:
 
-                if (su < i->sink_usec)
-                    x += i->sink_usec - su;
-            }
+    pa_operation_done(o);
+    pa_operation_unref(o);
+}
 
-            if (!i->playing)
-                pa_smoother_pause(o->stream->smoother, x);
+/* Updates the timing info from what the server published in the
+ * timing page. The write index is left alone, we keep track of it
+ * ourselves and the server doesn't know about the data still on its
+ * way. */
+static int update_timing_info_from_page(pa_stream *s) {
+    pa_timing_info *i = &s->timing_info;
+    pa_timing_snapshot snapshot;
+    pa_usec_t now;
 
-            /* Update the smoother */
-            if ((o->stream->direction == PA_STREAM_PLAYBACK && !i->read_index_corrupt) ||
-                (o->stream->direction == PA_STREAM_RECORD && !i->write_index_corrupt))
-                pa_smoother_put(o->stream->smoother, u, calc_time(o->stream, true));
+    pa_assert(s->timing_info_valid);
 
-            if (i->playing)
-                pa_smoother_resume(o->stream->smoother, x, true);
-        }
-    }
+    if (!s->context->timing_page ||
+        pa_timing_page_read(s->context->timing_page, s->timing_slot, s->channel, &snapshot) < 0)
+        return -1;
 
-    o->stream->auto_timing_update_requested = false;
+    /* Not newer than what we have */
+    if (snapshot.timestamp <= s->timing_info_at)
+        return 0;
 
-    if (o->stream->latency_update_callback)
-        o->stream->latency_update_callback(o->stream, o->stream->latency_update_userdata);
+    now = pa_rtclock_now();
 
-    if (o->callback && o->stream && o->stream->state == PA_STREAM_READY) {
-        pa_stream_success_cb_t cb = (pa_stream_success_cb_t) o->callback;
-        cb(o->stream, o->stream->timing_info_valid, o->userdata);
-    }
+    i->sink_usec = snapshot.sink_usec;
+    i->source_usec = 0;
+    i->read_index = snapshot.read_index;
+    i->playing = (int) snapshot.playing;
+    i->since_underrun = (int64_t) (snapshot.playing ? snapshot.playing_for : snapshot.underrun_for);
 
-finish:
+    /* Same machine, same clock */
+    i->transport_usec = now > snapshot.timestamp ? now - snapshot.timestamp : 0;
+    i->synchronized_clocks = true;
+    pa_gettimeofday(&i->timestamp);
+    pa_timeval_sub(&i->timestamp, i->transport_usec);
+
+    s->timing_info_at = snapshot.timestamp;
+
+    update_smoother(s);
+
+    return 0;
+}
+
+static void timing_page_defer_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata) {
+    pa_timing_page_request *r = userdata;
+    pa_operation *o;
+
+    o = pa_operation_ref(r->operation);
+    timing_page_request_free(r);
+
+    if (o->stream && o->state == PA_OPERATION_RUNNING) {
+        timing_update_complete(o);
+        pa_operation_done(o);
+    }
 
-    pa_operation_done(o);
     pa_operation_unref(o);
 }
 
@@ -1968,6 +2095,20 @@ pa_operation* pa_stream_update_timing_info(pa_stream *s, pa_stream_success_cb_t
     PA_CHECK_VALIDITY_RETURN_NULL(s->context, s->state == PA_STREAM_READY, PA_ERR_BADSTATE);
     PA_CHECK_VALIDITY_RETURN_NULL(s->context, s->direction != PA_STREAM_UPLOAD, PA_ERR_BADSTATE);
 
+    if (s->timing_page_synced && update_timing_info_from_page(s) >= 0) {
+        pa_timing_page_request *r;
+
+        o = pa_operation_new(s->context, s, (pa_operation_cb_t) cb, userdata);
+
+        r = pa_xnew(pa_timing_page_request, 1);
+        r->stream = s;
+        r->operation = pa_operation_ref(o);
+        r->defer_event = s->mainloop->defer_new(s->mainloop, timing_page_defer_cb, r);
+        PA_LLIST_PREPEND(pa_timing_page_request, s->timing_page_requests, r);
+
+        return o;
+    }
+
     if (s->direction == PA_STREAM_PLAYBACK) {
         /* Find a place to store the write_index correction data for this entry */
         cidx = (s->current_write_index_correction + 1) % PA_MAX_WRITE_INDEX_CORRECTIONS;
@@ -45,8 +45,29 @@ void pa_command_subscribe_event(pa_pdispatch *pd, uint32_t command, uint32_t tag
     pa_context_ref(c);
 
     if (pa_tagstruct_getu32(t, &e) < 0 ||
-        pa_tagstruct_getu32(t, &idx) < 0 ||
-        !pa_tagstruct_eof(t)) {
+        pa_tagstruct_getu32(t, &idx) < 0) {
+        pa_context_fail(c, PA_ERR_PROTOCOL);
+        goto finish;
+    }
+
+    if (c->object_cache) {
+        pa_object_cache_event(c->object_cache, e, idx, t);
+
+        /* Only the cache asked for this one */
+        if (!(c->subscribe_mask & (1 << (e & PA_SUBSCRIPTION_EVENT_FACILITY_MASK))))
+            goto finish;
+    }
+
+    /* Since protocol version 29 the event may be followed by the info
+     * record of the object, if the client asked for it */
+    if (c->subscribe_info_callback) {
+        if (pa_context_dispatch_subscribe_info(c, e, idx, t) < 0)
+            pa_context_fail(c, PA_ERR_PROTOCOL);
+
+        goto finish;
+    }
+
+    if (c->version < 29 && !pa_tagstruct_eof(t)) {
         pa_context_fail(c, PA_ERR_PROTOCOL);
         goto finish;
     }
@@ -58,26 +79,60 @@ finish:
     pa_context_unref(c);
 }
 
-pa_operation* pa_context_subscribe(pa_context *c, pa_subscription_mask_t m, pa_context_success_cb_t cb, void *userdata) {
+/* The server keeps one subscription per connection, so this sends what
+ * the application and the object cache need together */
+pa_operation* pa_context_update_subscription(pa_context *c, pa_context_success_cb_t cb, void *userdata) {
+    pa_subscription_mask_t m = c->subscribe_mask;
+    bool with_info = c->subscribe_with_info;
     pa_operation *o;
     pa_tagstruct *t;
     uint32_t tag;
 
     pa_assert(c);
-    pa_assert(PA_REFCNT_VALUE(c) >= 1);
 
-    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    if (c->object_cache) {
+        m |= PA_OBJECT_CACHE_MASK;
+        with_info = c->version >= 29;
+    }
 
     o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
 
     t = pa_tagstruct_command(c, PA_COMMAND_SUBSCRIBE, &tag);
     pa_tagstruct_putu32(t, m);
+    if (c->version >= 29)
+        pa_tagstruct_put_boolean(t, with_info);
     pa_pstream_send_tagstruct(c->pstream, t);
     pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, pa_context_simple_ack_callback, pa_operation_ref(o), (pa_free_cb_t) pa_operation_unref);
 
     return o;
 }
 
+static pa_operation* context_subscribe(pa_context *c, pa_subscription_mask_t m, bool with_info, pa_context_success_cb_t cb, void *userdata) {
+    c->subscribe_mask = m;
+    c->subscribe_with_info = with_info;
+
+    return pa_context_update_subscription(c, cb, userdata);
+}
+
+pa_operation* pa_context_subscribe(pa_context *c, pa_subscription_mask_t m, pa_context_success_cb_t cb, void *userdata) {
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+
+    return context_subscribe(c, m, false, cb, userdata);
+}
+
+pa_operation* pa_context_subscribe_with_info(pa_context *c, pa_subscription_mask_t m, pa_context_success_cb_t cb, void *userdata) {
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 29, PA_ERR_NOTSUPPORTED);
+
+    return context_subscribe(c, m, true, cb, userdata);
+}
+
 void pa_context_set_subscribe_callback(pa_context *c, pa_context_subscribe_cb_t cb, void *userdata) {
     pa_assert(c);
     pa_assert(PA_REFCNT_VALUE(c) >= 1);
@@ -88,3 +143,14 @@ void pa_context_set_subscribe_callback(pa_context *c, pa_context_subscribe_cb_t
     c->subscribe_callback = cb;
     c->subscribe_userdata = userdata;
 }
+
+void pa_context_set_subscribe_info_callback(pa_context *c, pa_context_subscribe_info_cb_t cb, void *userdata) {
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+    if (c->state == PA_CONTEXT_TERMINATED || c->state == PA_CONTEXT_FAILED)
+        return;
+
+    c->subscribe_info_callback = cb;
+    c->subscribe_info_userdata = userdata;
+}
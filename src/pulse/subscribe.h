@@ -80,6 +80,26 @@ pa_operation* pa_context_subscribe(pa_context *c, pa_subscription_mask_t m, pa_c
 /** Set the context specific call back function that is called whenever the state of the daemon changes */
 void pa_context_set_subscribe_callback(pa_context *c, pa_context_subscribe_cb_t cb, void *userdata);
 
+/** Subscription event callback prototype for events that may carry the
+ * state of the object. For new and changed sinks, sources, sink inputs,
+ * source outputs and clients info points to the pa_sink_info,
+ * pa_source_info, pa_sink_input_info, pa_source_output_info or
+ * pa_client_info of the object, as it was when the event was sent. For
+ * all other events info is NULL. The data is only valid during the
+ * callback. \since 5.0 */
+typedef void (*pa_context_subscribe_info_cb_t)(pa_context *c, pa_subscription_event_type_t t, uint32_t idx, const void *info, void *userdata);
+
+/** Enable event notification like pa_context_subscribe(), but ask the
+ * server to attach the state of the object to the events, so that
+ * there is no need to query it again. Requires a server that
+ * implements protocol version 29 or newer. \since 5.0 */
+pa_operation* pa_context_subscribe_with_info(pa_context *c, pa_subscription_mask_t m, pa_context_success_cb_t cb, void *userdata);
+
+/** Set the call back function that is called for events with the state
+ * of the object attached. If set, it is called instead of the one set
+ * with pa_context_set_subscribe_callback(). \since 5.0 */
+void pa_context_set_subscribe_info_callback(pa_context *c, pa_context_subscribe_info_cb_t cb, void *userdata);
+
 PA_C_DECL_END
 
 #endif
@@ -34,6 +34,7 @@
 #include <pulsecore/macro.h>
 #include <pulsecore/mutex.h>
 #include <pulsecore/flist.h>
+#include <pulsecore/atomic.h>
 
 #include "asyncmsgq.h"
 
@@ -57,6 +58,7 @@ struct pa_asyncmsgq {
     pa_mutex *mutex; /* only for the writer side */
 
     struct asyncmsgq_item *current;
+    pa_atomic_t batch;
 };
 
 pa_asyncmsgq *pa_asyncmsgq_new(unsigned size) {
@@ -68,6 +70,7 @@ pa_asyncmsgq *pa_asyncmsgq_new(unsigned size) {
     pa_assert_se(a->asyncq = pa_asyncq_new(size));
     pa_assert_se(a->mutex = pa_mutex_new(false, true));
     a->current = NULL;
+    pa_atomic_store(&a->batch, false);
 
     return a;
 }
@@ -355,3 +358,15 @@ bool pa_asyncmsgq_dispatching(pa_asyncmsgq *a) {
 
     return !!a->current;
 }
+
+void pa_asyncmsgq_set_batch(pa_asyncmsgq *a, bool b) {
+    pa_assert(PA_REFCNT_VALUE(a) > 0);
+
+    pa_atomic_store(&a->batch, b);
+}
+
+bool pa_asyncmsgq_get_batch(pa_asyncmsgq *a) {
+    pa_assert(PA_REFCNT_VALUE(a) > 0);
+
+    return !!pa_atomic_load(&a->batch);
+}
@@ -68,6 +68,11 @@ int pa_asyncmsgq_process_one(pa_asyncmsgq *a);
 
 void pa_asyncmsgq_flush(pa_asyncmsgq *a, bool run);
 
+/* When set, the rtpoll reader handles all queued messages before
+ * returning to the thread's main loop, instead of just one */
+void pa_asyncmsgq_set_batch(pa_asyncmsgq *a, bool b);
+bool pa_asyncmsgq_get_batch(pa_asyncmsgq *a);
+
 /* For the reading side */
 int pa_asyncmsgq_read_fd(pa_asyncmsgq *q);
 int pa_asyncmsgq_read_before_poll(pa_asyncmsgq *a);
@@ -381,6 +381,14 @@ static int pa_cli_command_stat(pa_core *c, pa_tokenizer *t, pa_strbuf *buf, bool
                      (unsigned) pa_atomic_load(&mstat->n_exported),
                      pa_bytes_snprint(bytes, sizeof(bytes), (unsigned) pa_atomic_load(&mstat->exported_size)));
 
+    pa_strbuf_printf(buf, "Subscription events queued: %u (at most %u), dispatched: %llu, merged: %llu, dropped: %llu, delayed: %llu.\n",
+                     c->subscription_stats.n_queued,
+                     c->subscription_stats.max_queued,
+                     (unsigned long long) c->subscription_stats.n_dispatched,
+                     (unsigned long long) c->subscription_stats.n_merged,
+                     (unsigned long long) c->subscription_stats.n_dropped,
+                     (unsigned long long) c->subscription_stats.n_delayed);
+
     pa_strbuf_printf(buf, "Total sample cache size: %s.\n",
                      pa_bytes_snprint(bytes, sizeof(bytes), (unsigned) pa_scache_total_size(c)));
 
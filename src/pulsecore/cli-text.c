@@ -250,6 +250,7 @@ char *pa_sink_list_to_string(pa_core *c) {
             v[PA_VOLUME_SNPRINT_VERBOSE_MAX],
             cm[PA_CHANNEL_MAP_SNPRINT_MAX], *t;
         const char *cmn;
+        pa_sink_rewind_stats rewind_stats;
 
         cmn = pa_channel_map_to_pretty_name(&sink->channel_map);
 
@@ -329,6 +330,15 @@ char *pa_sink_list_to_string(pa_core *c) {
                     "\tfixed latency: %0.2f ms\n",
                     (double) pa_sink_get_fixed_latency(sink) / PA_USEC_PER_MSEC);
 
+        pa_sink_get_rewind_stats(sink, &rewind_stats);
+        pa_strbuf_printf(
+                s,
+                "\trewinds: %llu (%llu KiB re-rendered); rewind requests: %llu (%llu coalesced)\n",
+                (unsigned long long) rewind_stats.n_rewinds,
+                (unsigned long long) rewind_stats.rewound_bytes / 1024,
+                (unsigned long long) rewind_stats.n_requests,
+                (unsigned long long) rewind_stats.n_coalesced);
+
         if (sink->card)
             pa_strbuf_printf(s, "\tcard: %u <%s>\n", sink->card->index, sink->card->name);
         if (sink->module)
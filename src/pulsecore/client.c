@@ -74,6 +74,7 @@ pa_client *pa_client_new(pa_core *core, pa_client_new_data *data) {
     c->userdata = NULL;
     c->kill = NULL;
     c->send_event = NULL;
+    c->owns_event = NULL;
 
     pa_assert_se(pa_idxset_put(core->clients, c, &c->index) >= 0);
 
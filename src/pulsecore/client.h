@@ -50,6 +50,10 @@ struct pa_client {
     void (*kill)(pa_client *c);
 
     void (*send_event)(pa_client *c, const char *name, pa_proplist *data);
+
+    /* Returns true if a main loop event with this userdata belongs to
+     * the connection of this client. May be NULL. */
+    bool (*owns_event)(pa_client *c, void *event_userdata);
 };
 
 typedef struct pa_client_new_data {
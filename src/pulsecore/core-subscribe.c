@@ -25,10 +25,14 @@
 
 #include <stdio.h>
 
+#include <pulse/rtclock.h>
 #include <pulse/xmalloc.h>
 
+#include <pulsecore/core-util.h>
+#include <pulsecore/hashmap.h>
 #include <pulsecore/log.h>
 #include <pulsecore/macro.h>
+#include <pulsecore/tagstruct.h>
 
 #include "core-subscribe.h"
 
@@ -44,6 +48,7 @@ struct pa_subscription {
     bool dead;
 
     pa_subscription_cb_t callback;
+    pa_subscription_packet_cb_t packet_callback;
     void *userdata;
     pa_subscription_mask_t mask;
 
@@ -56,11 +61,42 @@ struct pa_subscription_event {
     pa_subscription_event_type_t type;
     uint32_t index;
 
+    /* Facility and index, the key in subscription_events_by_object */
+    uint64_t object;
+
+    /* The event queued before this one for the same object */
+    pa_subscription_event *object_prev;
+
+    /* Set for change events on the delayed queue */
+    bool delayed;
+    pa_usec_t not_before;
+
     PA_LLIST_FIELDS(pa_subscription_event);
 };
 
+struct change_time {
+    uint64_t object;
+    pa_usec_t dispatched;
+};
+
 static void sched_event(pa_core *c);
 
+static uint64_t object_id(pa_subscription_event_type_t t, uint32_t idx) {
+    return ((uint64_t) (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) << 32) | idx;
+}
+
+static unsigned object_hash_func(const void *p) {
+    uint64_t o = *(const uint64_t*) p;
+
+    return (unsigned) (o ^ (o >> 32) * 31);
+}
+
+static int object_compare_func(const void *a, const void *b) {
+    uint64_t oa = *(const uint64_t*) a, ob = *(const uint64_t*) b;
+
+    return oa < ob ? -1 : (oa > ob ? 1 : 0);
+}
+
 /* Allocate a new subscription object for the given subscription mask. Use the specified callback function and user data */
 pa_subscription* pa_subscription_new(pa_core *c, pa_subscription_mask_t m, pa_subscription_cb_t callback, void *userdata) {
     pa_subscription *s;
@@ -73,6 +109,28 @@ pa_subscription* pa_subscription_new(pa_core *c, pa_subscription_mask_t m, pa_su
     s->core = c;
     s->dead = false;
     s->callback = callback;
+    s->packet_callback = NULL;
+    s->userdata = userdata;
+    s->mask = m;
+
+    PA_LLIST_PREPEND(pa_subscription, c->subscriptions, s);
+    return s;
+}
+
+/* Like pa_subscription_new(), but the callback also gets the event
+ * serialized for the native protocol */
+pa_subscription* pa_subscription_new_packet(pa_core *c, pa_subscription_mask_t m, pa_subscription_packet_cb_t callback, void *userdata) {
+    pa_subscription *s;
+
+    pa_assert(c);
+    pa_assert(m);
+    pa_assert(callback);
+
+    s = pa_xnew(pa_subscription, 1);
+    s->core = c;
+    s->dead = false;
+    s->callback = NULL;
+    s->packet_callback = callback;
     s->userdata = userdata;
     s->mask = m;
 
@@ -98,13 +156,40 @@ static void free_subscription(pa_subscription *s) {
 }
 
 static void free_event(pa_subscription_event *s) {
+    pa_subscription_event *latest, *i;
+
     pa_assert(s);
     pa_assert(s->core);
 
-    if (!s->next)
-        s->core->subscription_event_last = s->prev;
+    /* Unlink the event from the chain of events for its object */
+    pa_assert_se(latest = pa_hashmap_get(s->core->subscription_events_by_object, &s->object));
+
+    if (latest == s) {
+        pa_hashmap_remove(s->core->subscription_events_by_object, &s->object);
+
+        if (s->object_prev)
+            pa_assert_se(pa_hashmap_put(s->core->subscription_events_by_object, &s->object_prev->object, s->object_prev) == 0);
+    } else {
+        for (i = latest; i; i = i->object_prev)
+            if (i->object_prev == s) {
+                i->object_prev = s->object_prev;
+                break;
+            }
+    }
+
+    if (s->delayed) {
+        if (!s->next)
+            s->core->subscription_delayed_last = s->prev;
+
+        PA_LLIST_REMOVE(pa_subscription_event, s->core->subscription_delayed_queue, s);
+    } else {
+        if (!s->next)
+            s->core->subscription_event_last = s->prev;
 
-    PA_LLIST_REMOVE(pa_subscription_event, s->core->subscription_event_queue, s);
+        PA_LLIST_REMOVE(pa_subscription_event, s->core->subscription_event_queue, s);
+    }
+
+    s->core->subscription_stats.n_queued--;
     pa_xfree(s);
 }
 
@@ -118,10 +203,28 @@ void pa_subscription_free_all(pa_core *c) {
     while (c->subscription_event_queue)
         free_event(c->subscription_event_queue);
 
+    while (c->subscription_delayed_queue)
+        free_event(c->subscription_delayed_queue);
+
+    if (c->subscription_events_by_object) {
+        pa_hashmap_free(c->subscription_events_by_object, NULL);
+        c->subscription_events_by_object = NULL;
+    }
+
+    if (c->subscription_change_times) {
+        pa_hashmap_free(c->subscription_change_times, pa_xfree);
+        c->subscription_change_times = NULL;
+    }
+
     if (c->subscription_defer_event) {
         c->mainloop->defer_free(c->subscription_defer_event);
         c->subscription_defer_event = NULL;
     }
+
+    if (c->subscription_time_event) {
+        c->mainloop->time_free(c->subscription_time_event);
+        c->subscription_time_event = NULL;
+    }
 }
 
 #ifdef DEBUG
@@ -152,10 +255,46 @@ static void dump_event(const char * prefix, pa_subscription_event*e) {
 }
 #endif
 
+/* Remembers when a change event was last dispatched for an object. The
+ * entry goes away with the object, see forget_change_time(). */
+static void update_change_time(pa_core *c, pa_subscription_event *e, pa_usec_t now) {
+    struct change_time *t;
+
+    if ((e->type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_CHANGE || c->subscription_change_interval <= 0)
+        return;
+
+    if (!c->subscription_change_times)
+        c->subscription_change_times = pa_hashmap_new(object_hash_func, object_compare_func);
+
+    if (!(t = pa_hashmap_get(c->subscription_change_times, &e->object))) {
+        t = pa_xnew(struct change_time, 1);
+        t->object = e->object;
+        pa_assert_se(pa_hashmap_put(c->subscription_change_times, &t->object, t) == 0);
+    }
+
+    t->dispatched = now;
+}
+
+static pa_packet *event_packet_new(pa_subscription_event *e) {
+    pa_tagstruct *t;
+    uint8_t *data;
+    size_t length;
+
+    t = pa_tagstruct_new(NULL, 0);
+    pa_tagstruct_putu32(t, PA_COMMAND_SUBSCRIBE_EVENT);
+    pa_tagstruct_putu32(t, (uint32_t) -1);
+    pa_tagstruct_putu32(t, e->type);
+    pa_tagstruct_putu32(t, e->index);
+
+    pa_assert_se(data = pa_tagstruct_free_data(t, &length));
+    return pa_packet_new_dynamic(data, length);
+}
+
 /* Deferred callback for dispatching subscription events */
 static void defer_cb(pa_mainloop_api *m, pa_defer_event *de, void *userdata) {
     pa_core *c = userdata;
     pa_subscription *s;
+    pa_usec_t now;
 
     pa_assert(c->mainloop == m);
     pa_assert(c);
@@ -163,20 +302,37 @@ static void defer_cb(pa_mainloop_api *m, pa_defer_event *de, void *userdata) {
 
     c->mainloop->defer_enable(c->subscription_defer_event, 0);
 
+    now = pa_rtclock_now();
+
     /* Dispatch queued events */
 
     while (c->subscription_event_queue) {
         pa_subscription_event *e = c->subscription_event_queue;
+        pa_packet *packet = NULL;
 
         for (s = c->subscriptions; s; s = s->next) {
 
-            if (!s->dead && pa_subscription_match_flags(s->mask, e->type))
+            if (s->dead || !pa_subscription_match_flags(s->mask, e->type))
+                continue;
+
+            if (s->packet_callback) {
+                /* Serialize the event only once for all clients */
+                if (!packet)
+                    packet = event_packet_new(e);
+
+                s->packet_callback(c, e->type, e->index, packet, s->userdata);
+            } else
                 s->callback(c, e->type, e->index, s->userdata);
         }
 
+        if (packet)
+            pa_packet_unref(packet);
+
 #ifdef DEBUG
         dump_event("Dispatched", e);
 #endif
+        c->subscription_stats.n_dispatched++;
+        update_change_time(c, e, now);
         free_event(e);
     }
 
@@ -203,54 +359,163 @@ static void sched_event(pa_core *c) {
     c->mainloop->defer_enable(c->subscription_defer_event, 1);
 }
 
+/* Moves the delayed change events that are due to the dispatch queue */
+static void time_cb(pa_mainloop_api *m, pa_time_event *te, const struct timeval *tv, void *userdata) {
+    pa_core *c = userdata;
+    pa_subscription_event *e, *n;
+    pa_usec_t now, next = 0;
+
+    pa_assert(c);
+    pa_assert(c->subscription_time_event == te);
+
+    now = pa_rtclock_now();
+
+    for (e = c->subscription_delayed_queue; e; e = n) {
+        n = e->next;
+
+        if (e->not_before > now) {
+            if (next <= 0 || e->not_before < next)
+                next = e->not_before;
+            continue;
+        }
+
+        if (!e->next)
+            c->subscription_delayed_last = e->prev;
+
+        PA_LLIST_REMOVE(pa_subscription_event, c->subscription_delayed_queue, e);
+        e->delayed = false;
+
+        PA_LLIST_INSERT_AFTER(pa_subscription_event, c->subscription_event_queue, c->subscription_event_last, e);
+        c->subscription_event_last = e;
+    }
+
+    if (next > 0)
+        pa_core_rttime_restart(c, te, next);
+
+    if (c->subscription_event_queue)
+        sched_event(c);
+}
+
+static void sched_delayed(pa_core *c, pa_usec_t when) {
+    pa_subscription_event *e;
+
+    pa_assert(c);
+
+    if (!c->subscription_time_event) {
+        c->subscription_time_event = pa_core_rttime_new(c, when, time_cb, c);
+        return;
+    }
+
+    /* Only move the timer forward if nothing else is due earlier */
+    for (e = c->subscription_delayed_queue; e; e = e->next)
+        if (e->not_before < when)
+            return;
+
+    pa_core_rttime_restart(c, c->subscription_time_event, when);
+}
+
+static void forget_change_time(pa_core *c, uint64_t object) {
+    struct change_time *t;
+
+    if (c->subscription_change_times && (t = pa_hashmap_remove(c->subscription_change_times, &object)))
+        pa_xfree(t);
+}
+
+/* Returns when the next change event of the object may be dispatched,
+ * 0 if right away */
+static pa_usec_t change_not_before(pa_core *c, uint64_t object) {
+    struct change_time *t;
+    pa_usec_t now;
+
+    if (c->subscription_change_interval <= 0 || !c->subscription_change_times)
+        return 0;
+
+    if (!(t = pa_hashmap_get(c->subscription_change_times, &object)))
+        return 0;
+
+    now = pa_rtclock_now();
+
+    if (t->dispatched + c->subscription_change_interval <= now)
+        return 0;
+
+    return t->dispatched + c->subscription_change_interval;
+}
+
 /* Append a new subscription event to the subscription event queue and schedule a main loop event */
 void pa_subscription_post(pa_core *c, pa_subscription_event_type_t t, uint32_t idx) {
-    pa_subscription_event *e;
+    pa_subscription_event *e, *latest;
+    uint64_t object;
+    pa_usec_t not_before = 0;
     pa_assert(c);
 
+    object = object_id(t, idx);
+
+    /* Whether or not anyone gets to know, the object is gone */
+    if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+        forget_change_time(c, object);
+
     /* No need for queuing subscriptions of no one is listening */
     if (!c->subscriptions)
         return;
 
-    if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_NEW) {
-        pa_subscription_event *i, *n;
+    if (!c->subscription_events_by_object)
+        c->subscription_events_by_object = pa_hashmap_new(object_hash_func, object_compare_func);
 
-        /* Check for duplicates */
-        for (i = c->subscription_event_last; i; i = n) {
-            n = i->prev;
+    latest = pa_hashmap_get(c->subscription_events_by_object, &object);
 
-            /* not the same object type */
-            if (((t ^ i->type) & PA_SUBSCRIPTION_EVENT_FACILITY_MASK))
-                continue;
+    if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+        /* This object is being removed, hence there is no point in
+         * keeping the old events regarding this entry in the queue. */
 
-            /* not the same object */
-            if (i->index != idx)
-                continue;
+        while (latest) {
+            pa_subscription_event *prev = latest->object_prev;
 
-            if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                /* This object is being removed, hence there is no
-                 * point in keeping the old events regarding this
-                 * entry in the queue. */
+            free_event(latest);
+            c->subscription_stats.n_dropped++;
+            pa_log_debug("Dropped redundant event due to remove event.");
 
-                free_event(i);
-                pa_log_debug("Dropped redundant event due to remove event.");
-                continue;
-            }
+            latest = prev;
+        }
 
-            if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_CHANGE) {
-                /* This object has changed. If a "new" or "change" event for
-                 * this object is still in the queue we can exit. */
+    } else if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_CHANGE) {
+        /* This object has changed. If a "new" or "change" event for this
+         * object is still in the queue we can exit. */
 
-                pa_log_debug("Dropped redundant event due to change event.");
-                return;
-            }
+        if (latest) {
+            c->subscription_stats.n_merged++;
+            pa_log_debug("Dropped redundant event due to change event.");
+            return;
         }
+
+        not_before = change_not_before(c, object);
     }
 
     e = pa_xnew(pa_subscription_event, 1);
     e->core = c;
     e->type = t;
     e->index = idx;
+    e->object = object;
+    e->object_prev = latest;
+    e->delayed = not_before > 0;
+    e->not_before = not_before;
+
+    if (latest)
+        pa_hashmap_remove(c->subscription_events_by_object, &object);
+    pa_assert_se(pa_hashmap_put(c->subscription_events_by_object, &e->object, e) == 0);
+
+    if (++c->subscription_stats.n_queued > c->subscription_stats.max_queued)
+        c->subscription_stats.max_queued = c->subscription_stats.n_queued;
+
+    if (e->delayed) {
+        c->subscription_stats.n_delayed++;
+
+        /* Keep them in order, events that are due at the same time
+         * are dispatched in the order they were posted */
+        PA_LLIST_INSERT_AFTER(pa_subscription_event, c->subscription_delayed_queue, c->subscription_delayed_last, e);
+        c->subscription_delayed_last = e;
+        sched_delayed(c, not_before);
+        return;
+    }
 
     PA_LLIST_INSERT_AFTER(pa_subscription_event, c->subscription_event_queue, c->subscription_event_last, e);
     c->subscription_event_last = e;
@@ -261,3 +526,9 @@ void pa_subscription_post(pa_core *c, pa_subscription_event_type_t t, uint32_t i
 
     sched_event(c);
 }
+
+void pa_subscription_set_change_interval(pa_core *c, pa_usec_t interval) {
+    pa_assert(c);
+
+    c->subscription_change_interval = interval;
+}
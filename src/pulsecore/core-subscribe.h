@@ -22,18 +22,46 @@
   USA.
 ***/
 
+#include <inttypes.h>
+
 typedef struct pa_subscription pa_subscription;
 typedef struct pa_subscription_event pa_subscription_event;
 
+/* Event queue accounting, maintained by pa_subscription_post() and the
+ * dispatcher */
+typedef struct pa_subscription_stats {
+    /* Events currently queued, and the most ever queued at once */
+    unsigned n_queued, max_queued;
+    /* Events dispatched to the subscribers */
+    uint64_t n_dispatched;
+    /* Change events merged into an event already queued for the object */
+    uint64_t n_merged;
+    /* Queued events dropped because the object was removed */
+    uint64_t n_dropped;
+    /* Change events held back by the change interval */
+    uint64_t n_delayed;
+} pa_subscription_stats;
+
 #include <pulsecore/core.h>
 #include <pulsecore/native-common.h>
+#include <pulsecore/packet.h>
 
 typedef void (*pa_subscription_cb_t)(pa_core *c, pa_subscription_event_type_t t, uint32_t idx, void *userdata);
 
+/* The packet is a serialized PA_COMMAND_SUBSCRIBE_EVENT for the native
+ * protocol. It is built once per event and shared by all subscribers,
+ * take a reference to keep it. */
+typedef void (*pa_subscription_packet_cb_t)(pa_core *c, pa_subscription_event_type_t t, uint32_t idx, pa_packet *packet, void *userdata);
+
 pa_subscription* pa_subscription_new(pa_core *c, pa_subscription_mask_t m,  pa_subscription_cb_t cb, void *userdata);
+pa_subscription* pa_subscription_new_packet(pa_core *c, pa_subscription_mask_t m, pa_subscription_packet_cb_t cb, void *userdata);
 void pa_subscription_free(pa_subscription*s);
 void pa_subscription_free_all(pa_core *c);
 
 void pa_subscription_post(pa_core *c, pa_subscription_event_type_t t, uint32_t idx);
 
+/* Change events for the same object are dispatched at most once per
+ * interval, 0 disables this */
+void pa_subscription_set_change_interval(pa_core *c, pa_usec_t interval);
+
 #endif
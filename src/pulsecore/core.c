@@ -123,6 +123,13 @@ pa_core* pa_core_new(pa_mainloop_api *m, bool shared, size_t shm_size) {
     PA_LLIST_HEAD_INIT(pa_subscription, c->subscriptions);
     PA_LLIST_HEAD_INIT(pa_subscription_event, c->subscription_event_queue);
     c->subscription_event_last = NULL;
+    PA_LLIST_HEAD_INIT(pa_subscription_event, c->subscription_delayed_queue);
+    c->subscription_delayed_last = NULL;
+    c->subscription_time_event = NULL;
+    c->subscription_events_by_object = NULL;
+    c->subscription_change_times = NULL;
+    c->subscription_change_interval = 0;
+    pa_zero(c->subscription_stats);
 
     c->mempool = pool;
     pa_silence_cache_init(&c->silence_cache);
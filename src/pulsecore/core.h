@@ -161,6 +161,16 @@ struct pa_core {
     PA_LLIST_HEAD(pa_subscription, subscriptions);
     PA_LLIST_HEAD(pa_subscription_event, subscription_event_queue);
     pa_subscription_event *subscription_event_last;
+    /* Change events waiting for the change interval to pass */
+    PA_LLIST_HEAD(pa_subscription_event, subscription_delayed_queue);
+    pa_subscription_event *subscription_delayed_last;
+    pa_time_event *subscription_time_event;
+    /* The latest queued event of every object */
+    pa_hashmap *subscription_events_by_object;
+    /* When the last change event of every object was dispatched */
+    pa_hashmap *subscription_change_times;
+    pa_usec_t subscription_change_interval;
+    pa_subscription_stats subscription_stats;
 
     pa_mempool *mempool;
     pa_silence_cache silence_cache;
@@ -39,9 +39,23 @@ static void get_cpuid(uint32_t op, uint32_t *a, uint32_t *b, uint32_t *c, uint32
         "  pop %%"PA_REG_b"    \n\t"
 
         : "=a" (*a), "=S" (*b), "=c" (*c), "=d" (*d)
-        : "0" (op)
+        : "0" (op), "2" (0)
     );
 }
+
+/* Returns the state components the OS saves on context switches */
+static uint32_t get_xcr0(void) {
+    uint32_t eax, edx;
+
+    __asm__ __volatile__ (
+        "  .byte 0x0f, 0x01, 0xd0  \n\t" /* xgetbv, for older assemblers */
+
+        : "=a" (eax), "=d" (edx)
+        : "c" (0)
+    );
+
+    return eax;
+}
 #endif
 
 void pa_cpu_get_x86_flags(pa_cpu_x86_flag_t *flags) {
@@ -79,6 +93,18 @@ void pa_cpu_get_x86_flags(pa_cpu_x86_flag_t *flags) {
 
         if (ecx & (1<<20))
           *flags |= PA_CPU_X86_SSE4_2;
+
+        /* AVX is only usable if the OS saves the YMM registers, too */
+        if ((ecx & (1<<28)) && (ecx & (1<<27)) && (get_xcr0() & 0x6) == 0x6)
+          *flags |= PA_CPU_X86_AVX;
+    }
+
+    /* get structured extended features, subleaf 0 */
+    if (level >= 7 && (*flags & PA_CPU_X86_AVX)) {
+        get_cpuid(0x00000007, &eax, &ebx, &ecx, &edx);
+
+        if (ebx & (1<<5))
+          *flags |= PA_CPU_X86_AVX2;
     }
 
     /* get extended level */
@@ -99,7 +125,7 @@ void pa_cpu_get_x86_flags(pa_cpu_x86_flag_t *flags) {
           *flags |= PA_CPU_X86_3DNOW;
     }
 
-    pa_log_info("CPU flags: %s%s%s%s%s%s%s%s%s%s%s",
+    pa_log_info("CPU flags: %s%s%s%s%s%s%s%s%s%s%s%s%s",
     (*flags & PA_CPU_X86_CMOV) ? "CMOV " : "",
     (*flags & PA_CPU_X86_MMX) ? "MMX " : "",
     (*flags & PA_CPU_X86_SSE) ? "SSE " : "",
@@ -108,6 +134,8 @@ void pa_cpu_get_x86_flags(pa_cpu_x86_flag_t *flags) {
     (*flags & PA_CPU_X86_SSSE3) ? "SSSE3 " : "",
     (*flags & PA_CPU_X86_SSE4_1) ? "SSE4_1 " : "",
     (*flags & PA_CPU_X86_SSE4_2) ? "SSE4_2 " : "",
+    (*flags & PA_CPU_X86_AVX) ? "AVX " : "",
+    (*flags & PA_CPU_X86_AVX2) ? "AVX2 " : "",
     (*flags & PA_CPU_X86_MMXEXT) ? "MMXEXT " : "",
     (*flags & PA_CPU_X86_3DNOW) ? "3DNOW " : "",
     (*flags & PA_CPU_X86_3DNOWEXT) ? "3DNOWEXT " : "");
@@ -128,7 +156,20 @@ bool pa_cpu_init_x86(pa_cpu_x86_flag_t *flags) {
         pa_volume_func_init_sse(*flags);
         pa_remap_func_init_sse(*flags);
         pa_convert_func_init_sse(*flags);
+        pa_sinc_func_init_sse(*flags);
+    }
+
+#ifdef HAVE_AVX
+    if (*flags & PA_CPU_X86_AVX)
+        pa_sinc_func_init_avx(*flags);
+#endif
+
+#ifdef HAVE_AVX2
+    if (*flags & PA_CPU_X86_AVX2) {
+        pa_volume_func_init_avx2(*flags);
+        pa_convert_func_init_avx2(*flags);
     }
+#endif
 
     return true;
 #else /* defined (__i386__) || defined (__amd64__) */
@@ -70,6 +70,9 @@ struct AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter
 int av_resample(struct AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx);
 void av_resample_compensate(struct AVResampleContext *c, int sample_delta, int compensation_distance);
 void av_resample_close(struct AVResampleContext *c);
+int av_resample_state_size(void);
+void av_resample_save_state(struct AVResampleContext *c, void *state);
+void av_resample_restore_state(struct AVResampleContext *c, const void *state);
 void av_build_filter(int16_t *filter, double factor, int tap_count, int phase_count, int scale, int type);
 
 /*
@@ -202,6 +202,24 @@ void av_resample_close(AVResampleContext *c){
     av_freep(&c);
 }
 
+/* PulseAudio addition: the context holds the complete stream state
+ * except for the filter bank, which is immutable after init. Hence
+ * the state can be checkpointed by copying the context. */
+int av_resample_state_size(void){
+    return sizeof(AVResampleContext);
+}
+
+void av_resample_save_state(AVResampleContext *c, void *state){
+    memcpy(state, c, sizeof(AVResampleContext));
+}
+
+void av_resample_restore_state(AVResampleContext *c, const void *state){
+    FELEM *filter_bank= c->filter_bank;
+
+    memcpy(c, state, sizeof(AVResampleContext));
+    c->filter_bank= filter_bank;
+}
+
 void av_resample_compensate(AVResampleContext *c, int sample_delta, int compensation_distance){
 //    sample_delta += (c->ideal_dst_incr - c->dst_incr)*(int64_t)c->compensation_distance / c->ideal_dst_incr;
     c->compensation_distance= compensation_distance;
@@ -72,6 +72,7 @@ struct pa_memblock {
 
     bool read_only:1;
     bool is_silence:1;
+    bool is_planar:1;
 
     pa_atomic_ptr_t data;
     size_t length;
@@ -235,7 +236,7 @@ static pa_memblock *memblock_new_appended(pa_mempool *p, size_t length) {
     PA_REFCNT_INIT(b);
     b->pool = p;
     b->type = PA_MEMBLOCK_APPENDED;
-    b->read_only = b->is_silence = false;
+    b->read_only = b->is_silence = b->is_planar = false;
     pa_atomic_ptr_store(&b->data, (uint8_t*) b + PA_ALIGN(sizeof(pa_memblock)));
     b->length = length;
     pa_atomic_store(&b->n_acquired, 0);
@@ -351,7 +352,7 @@ pa_memblock *pa_memblock_new_pool(pa_mempool *p, size_t length) {
 
     PA_REFCNT_INIT(b);
     b->pool = p;
-    b->read_only = b->is_silence = false;
+    b->read_only = b->is_silence = b->is_planar = false;
     b->length = length;
     pa_atomic_store(&b->n_acquired, 0);
     pa_atomic_store(&b->please_signal, 0);
@@ -376,7 +377,7 @@ pa_memblock *pa_memblock_new_fixed(pa_mempool *p, void *d, size_t length, bool r
     b->pool = p;
     b->type = PA_MEMBLOCK_FIXED;
     b->read_only = read_only;
-    b->is_silence = false;
+    b->is_silence = b->is_planar = false;
     pa_atomic_ptr_store(&b->data, d);
     b->length = length;
     pa_atomic_store(&b->n_acquired, 0);
@@ -403,7 +404,7 @@ pa_memblock *pa_memblock_new_user(pa_mempool *p, void *d, size_t length, pa_free
     b->pool = p;
     b->type = PA_MEMBLOCK_USER;
     b->read_only = read_only;
-    b->is_silence = false;
+    b->is_silence = b->is_planar = false;
     pa_atomic_ptr_store(&b->data, d);
     b->length = length;
     pa_atomic_store(&b->n_acquired, 0);
@@ -439,6 +440,22 @@ void pa_memblock_set_is_silence(pa_memblock *b, bool v) {
     b->is_silence = v;
 }
 
+/* No lock necessary */
+bool pa_memblock_is_planar(pa_memblock *b) {
+    pa_assert(b);
+    pa_assert(PA_REFCNT_VALUE(b) > 0);
+
+    return b->is_planar;
+}
+
+/* No lock necessary */
+void pa_memblock_set_is_planar(pa_memblock *b, bool v) {
+    pa_assert(b);
+    pa_assert(PA_REFCNT_VALUE(b) > 0);
+
+    b->is_planar = v;
+}
+
 /* No lock necessary */
 bool pa_memblock_ref_is_one(pa_memblock *b) {
     int r;
@@ -1003,7 +1020,7 @@ pa_memblock* pa_memimport_get(pa_memimport *i, uint32_t block_id, uint32_t shm_i
     b->pool = i->pool;
     b->type = PA_MEMBLOCK_IMPORTED;
     b->read_only = true;
-    b->is_silence = false;
+    b->is_silence = b->is_planar = false;
     pa_atomic_ptr_store(&b->data, (uint8_t*) seg->memory.ptr + offset);
     b->length = size;
     pa_atomic_store(&b->n_acquired, 0);
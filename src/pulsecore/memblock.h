@@ -109,6 +109,15 @@ bool pa_memblock_is_silence(pa_memblock *b);
 bool pa_memblock_ref_is_one(pa_memblock *b);
 void pa_memblock_set_is_silence(pa_memblock *b, bool v);
 
+/* Planar blocks contain PA_SAMPLE_FLOAT32NE data with one plane per
+ * channel instead of interleaved frames. Each plane is
+ * pa_memblock_get_length(b) / channels bytes long. Memchunk indexes
+ * and lengths on planar blocks are still counted in interleaved bytes,
+ * so frame aligned slices stay valid, but the bytes of a slice are not
+ * contiguous. See pa_planar_channel() in sample-util.h. */
+bool pa_memblock_is_planar(pa_memblock *b);
+void pa_memblock_set_is_planar(pa_memblock *b, bool v);
+
 void* pa_memblock_acquire(pa_memblock *b);
 void *pa_memblock_acquire_chunk(const pa_memchunk *c);
 void pa_memblock_release(pa_memblock *b);
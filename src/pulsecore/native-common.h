@@ -176,6 +176,9 @@ enum {
     /* Supported since protocol v27 (3.0) */
     PA_COMMAND_SET_PORT_LATENCY_OFFSET,
 
+    /* Supported since protocol v29 (5.0) */
+    PA_COMMAND_GET_FILTERED_INFO_LIST,
+
     PA_COMMAND_MAX
 };
 
@@ -33,6 +33,8 @@
 #include <pulse/timeval.h>
 
 #include <pulsecore/core-util.h>
+#include <pulsecore/hashmap.h>
+#include <pulsecore/refcnt.h>
 #include <pulsecore/ioline.h>
 #include <pulsecore/thread-mq.h>
 #include <pulsecore/macro.h>
@@ -46,13 +48,18 @@
 #include "protocol-http.h"
 
 /* Don't allow more than this many concurrent connections */
-#define MAX_CONNECTIONS 10
+#define MAX_CONNECTIONS 256
+
+/* Every listener that is not a broadcast listener has a source output
+ * and buffer of its own, so there are fewer of those */
+#define MAX_PRIVATE_LISTENERS 10
 
 #define URL_ROOT "/"
 #define URL_CSS "/style"
 #define URL_STATUS "/status"
 #define URL_LISTEN "/listen"
 #define URL_LISTEN_SOURCE "/listen/source/"
+#define URL_BROADCAST_SOURCE "/broadcast/source/"
 
 #define MIME_HTML "text/html; charset=utf-8"
 #define MIME_TEXT "text/plain; charset=utf-8"
@@ -75,6 +82,10 @@
 #define RECORD_BUFFER_SECONDS (5)
 #define DEFAULT_SOURCE_LATENCY (300*PA_USEC_PER_MSEC)
 
+/* Maximum number of chunks the ring of a broadcast keeps around, in
+ * addition to the limit of RECORD_BUFFER_SECONDS */
+#define BROADCAST_RING_SLOTS 256
+
 enum state {
     STATE_REQUEST_LINE,
     STATE_MIME_HEADER,
@@ -86,6 +97,8 @@ enum method {
     METHOD_HEAD
 };
 
+struct broadcast;
+
 struct connection {
     pa_http_protocol *protocol;
     pa_iochannel *io;
@@ -97,6 +110,35 @@ struct connection {
     char *url;
     enum method method;
     pa_module *module;
+
+    /* Set for listeners of a broadcast instead of output_memblockq and
+     * source_output. seq is the ring position of the next chunk to
+     * send, current the chunk being sent right now. */
+    struct broadcast *broadcast;
+    uint64_t seq;
+    pa_memchunk current;
+};
+
+/* One source output per source, shared by all of its broadcast
+ * listeners. The recorded chunks are kept in a ring and written to the
+ * sockets of the listeners from there, so every listener costs a
+ * reference to a memory block, not a copy of the data. Listeners that
+ * can't keep up miss the chunks that dropped out of the ring. */
+struct broadcast {
+    PA_REFCNT_DECLARE;
+
+    pa_http_protocol *protocol;
+    uint32_t source_index;
+    pa_source_output *source_output;
+    pa_sample_spec sample_spec;
+    pa_channel_map channel_map;
+
+    pa_idxset *listeners;
+
+    /* Chunks tail..head-1 are valid, chunk n is in slot n % BROADCAST_RING_SLOTS */
+    pa_memchunk ring[BROADCAST_RING_SLOTS];
+    uint64_t head, tail;
+    size_t ring_length, max_ring_length;
 };
 
 struct pa_http_protocol {
@@ -105,6 +147,9 @@ struct pa_http_protocol {
     pa_core *core;
     pa_idxset *connections;
 
+    /* struct broadcast by source index */
+    pa_hashmap *broadcasts;
+
     pa_strlist *servers;
 };
 
@@ -112,10 +157,21 @@ enum {
     SOURCE_OUTPUT_MESSAGE_POST_DATA = PA_SOURCE_OUTPUT_MESSAGE_MAX
 };
 
+static void broadcast_unref(struct broadcast *b);
+
 /* Called from main context */
 static void connection_unlink(struct connection *c) {
     pa_assert(c);
 
+    if (c->broadcast) {
+        pa_assert_se(pa_idxset_remove_by_data(c->broadcast->listeners, c, NULL) == c);
+
+        if (c->current.memblock)
+            pa_memblock_unref(c->current.memblock);
+
+        broadcast_unref(c->broadcast);
+    }
+
     if (c->source_output) {
         pa_source_output_unlink(c->source_output);
         c->source_output->userdata = NULL;
@@ -171,6 +227,50 @@ static int do_write(struct connection *c) {
     return 1;
 }
 
+/* Called from main context */
+static int broadcast_do_write(struct connection *c) {
+    struct broadcast *b = c->broadcast;
+    ssize_t r;
+    void *p;
+
+    pa_assert(c);
+    pa_assert(b);
+
+    if (!c->current.memblock) {
+
+        if (c->seq < b->tail) {
+            pa_log_debug("Broadcast listener too slow, skipping %llu chunks.", (unsigned long long) (b->tail - c->seq));
+            c->seq = b->tail;
+        }
+
+        if (c->seq >= b->head)
+            return 0;
+
+        c->current = b->ring[c->seq % BROADCAST_RING_SLOTS];
+        pa_memblock_ref(c->current.memblock);
+        c->seq++;
+    }
+
+    p = pa_memblock_acquire(c->current.memblock);
+    r = pa_iochannel_write(c->io, (uint8_t*) p+c->current.index, c->current.length);
+    pa_memblock_release(c->current.memblock);
+
+    if (r < 0) {
+        pa_log("write(): %s", pa_cstrerror(errno));
+        return -1;
+    }
+
+    c->current.index += (size_t) r;
+    c->current.length -= (size_t) r;
+
+    if (c->current.length <= 0) {
+        pa_memblock_unref(c->current.memblock);
+        pa_memchunk_reset(&c->current);
+    }
+
+    return 1;
+}
+
 /* Called from main context */
 static void do_work(struct connection *c) {
     pa_assert(c);
@@ -179,7 +279,7 @@ static void do_work(struct connection *c) {
         goto fail;
 
     while (pa_iochannel_is_writable(c->io)) {
-        int r = do_write(c);
+        int r = c->broadcast ? broadcast_do_write(c) : do_write(c);
         if (r < 0)
             goto fail;
         if (r == 0)
@@ -249,6 +349,172 @@ static pa_usec_t source_output_get_latency_cb(pa_source_output *o) {
     return pa_bytes_to_usec(pa_memblockq_get_length(c->output_memblockq), &c->source_output->sample_spec);
 }
 
+/* Called from main context */
+static void broadcast_push(struct broadcast *b, const pa_memchunk *chunk) {
+    struct connection *c;
+    uint32_t idx;
+
+    pa_assert(b);
+    pa_assert(chunk);
+
+    /* Make room, listeners that still need the oldest chunks will skip
+     * them */
+    while (b->tail < b->head &&
+           (b->head - b->tail >= BROADCAST_RING_SLOTS || b->ring_length + chunk->length > b->max_ring_length)) {
+        pa_memchunk *old = &b->ring[b->tail % BROADCAST_RING_SLOTS];
+
+        b->ring_length -= old->length;
+        pa_memblock_unref(old->memblock);
+        pa_memchunk_reset(old);
+        b->tail++;
+    }
+
+    b->ring[b->head % BROADCAST_RING_SLOTS] = *chunk;
+    pa_memblock_ref(chunk->memblock);
+    b->ring_length += chunk->length;
+    b->head++;
+
+    /* The listeners that are waiting for data won't get an I/O event,
+     * so write to them now. The others continue when their socket
+     * becomes writable again. */
+    PA_IDXSET_FOREACH(c, b->listeners, idx)
+        if (c->io)
+            do_work(c);
+}
+
+/* Called from thread context, except when it is not */
+static int broadcast_source_output_process_msg(pa_msgobject *m, int code, void *userdata, int64_t offset, pa_memchunk *chunk) {
+    pa_source_output *o = PA_SOURCE_OUTPUT(m);
+    struct broadcast *b;
+
+    pa_source_output_assert_ref(o);
+
+    if (!(b = o->userdata))
+        return -1;
+
+    switch (code) {
+
+        case SOURCE_OUTPUT_MESSAGE_POST_DATA:
+            /* Not called from IO thread context either, see above */
+            PA_REFCNT_INC(b);
+            broadcast_push(b, chunk);
+            broadcast_unref(b);
+            break;
+
+        default:
+            return pa_source_output_process_msg(m, code, userdata, offset, chunk);
+    }
+
+    return 0;
+}
+
+/* Called from thread context */
+static void broadcast_source_output_push_cb(pa_source_output *o, const pa_memchunk *chunk) {
+    pa_source_output_assert_ref(o);
+    pa_assert(o->userdata);
+    pa_assert(chunk);
+
+    pa_asyncmsgq_post(pa_thread_mq_get()->outq, PA_MSGOBJECT(o), SOURCE_OUTPUT_MESSAGE_POST_DATA, NULL, 0, chunk, NULL);
+}
+
+/* Called from main context */
+static void broadcast_source_output_kill_cb(pa_source_output *o) {
+    struct broadcast *b;
+    struct connection *c;
+
+    pa_source_output_assert_ref(o);
+    pa_assert_se(b = o->userdata);
+
+    PA_REFCNT_INC(b);
+
+    while ((c = pa_idxset_first(b->listeners, NULL)))
+        connection_unlink(c);
+
+    broadcast_unref(b);
+}
+
+/* Called from main context */
+static pa_usec_t broadcast_source_output_get_latency_cb(pa_source_output *o) {
+    struct broadcast *b;
+
+    pa_source_output_assert_ref(o);
+    pa_assert_se(b = o->userdata);
+
+    return pa_bytes_to_usec(b->ring_length, &b->sample_spec);
+}
+
+static struct broadcast *broadcast_new(pa_http_protocol *p, pa_source *source, const pa_sample_spec *ss, const pa_channel_map *cm) {
+    struct broadcast *b;
+    pa_source_output_new_data data;
+
+    pa_source_output_new_data_init(&data);
+    data.driver = __FILE__;
+    pa_source_output_new_data_set_source(&data, source, false);
+    pa_proplist_sets(data.proplist, PA_PROP_MEDIA_NAME, "HTTP Broadcast");
+    pa_proplist_sets(data.proplist, PA_PROP_APPLICATION_NAME, "HTTP Broadcast");
+    pa_source_output_new_data_set_sample_spec(&data, ss);
+    pa_source_output_new_data_set_channel_map(&data, cm);
+
+    /* Broadcasts are looked up by the index of their source, so the
+     * stream must stay where it is */
+    data.flags |= PA_SOURCE_OUTPUT_DONT_MOVE;
+
+    b = pa_xnew0(struct broadcast, 1);
+    PA_REFCNT_INIT(b);
+    b->protocol = p;
+    b->source_index = source->index;
+    b->sample_spec = *ss;
+    b->channel_map = *cm;
+    b->listeners = pa_idxset_new(NULL, NULL);
+    b->max_ring_length = pa_bytes_per_second(ss) * RECORD_BUFFER_SECONDS;
+
+    pa_source_output_new(&b->source_output, p->core, &data);
+    pa_source_output_new_data_done(&data);
+
+    if (!b->source_output) {
+        pa_idxset_free(b->listeners, NULL);
+        pa_xfree(b);
+        return NULL;
+    }
+
+    b->source_output->parent.process_msg = broadcast_source_output_process_msg;
+    b->source_output->push = broadcast_source_output_push_cb;
+    b->source_output->kill = broadcast_source_output_kill_cb;
+    b->source_output->get_latency = broadcast_source_output_get_latency_cb;
+    b->source_output->userdata = b;
+
+    pa_source_output_set_requested_latency(b->source_output, DEFAULT_SOURCE_LATENCY);
+
+    pa_assert_se(pa_hashmap_put(p->broadcasts, PA_UINT32_TO_PTR(b->source_index), b) >= 0);
+
+    pa_source_output_put(b->source_output);
+
+    return b;
+}
+
+/* Called from main context */
+static void broadcast_unref(struct broadcast *b) {
+    pa_assert(b);
+    pa_assert(PA_REFCNT_VALUE(b) >= 1);
+
+    if (PA_REFCNT_DEC(b) > 0)
+        return;
+
+    pa_assert(pa_idxset_isempty(b->listeners));
+
+    pa_assert_se(pa_hashmap_remove(b->protocol->broadcasts, PA_UINT32_TO_PTR(b->source_index)) == b);
+
+    pa_source_output_unlink(b->source_output);
+    b->source_output->userdata = NULL;
+    pa_source_output_unref(b->source_output);
+
+    for (; b->tail < b->head; b->tail++)
+        pa_memblock_unref(b->ring[b->tail % BROADCAST_RING_SLOTS].memblock);
+
+    pa_idxset_free(b->listeners, NULL);
+    pa_xfree(b);
+}
+
 /*** client callbacks ***/
 static void client_kill_cb(pa_client *client) {
     struct connection*c;
@@ -479,8 +745,9 @@ static void handle_listen(struct connection *c) {
         m = pa_sample_spec_to_mime_type_mimefy(&sink->sample_spec, &sink->channel_map);
 
         pa_ioline_printf(c->line,
-                         "<a href=\"" URL_LISTEN_SOURCE "%s\" title=\"%s\">%s</a><br/>\n",
-                         sink->monitor_source->name, m, t);
+                         "<a href=\"" URL_LISTEN_SOURCE "%s\" title=\"%s\">%s</a> "
+                         "(<a href=\"" URL_BROADCAST_SOURCE "%s\" title=\"%s\">shared</a>)<br/>\n",
+                         sink->monitor_source->name, m, t, sink->monitor_source->name, m);
 
         pa_xfree(t);
         pa_xfree(m);
@@ -501,8 +768,9 @@ static void handle_listen(struct connection *c) {
         m = pa_sample_spec_to_mime_type_mimefy(&source->sample_spec, &source->channel_map);
 
         pa_ioline_printf(c->line,
-                         "<a href=\"" URL_LISTEN_SOURCE "%s\" title=\"%s\">%s</a><br/>\n",
-                         source->name, m, t);
+                         "<a href=\"" URL_LISTEN_SOURCE "%s\" title=\"%s\">%s</a> "
+                         "(<a href=\"" URL_BROADCAST_SOURCE "%s\" title=\"%s\">shared</a>)<br/>\n",
+                         source->name, m, t, source->name, m);
 
         pa_xfree(m);
         pa_xfree(t);
@@ -527,7 +795,12 @@ static void line_drain_callback(pa_ioline *l, void *userdata) {
     pa_assert_se(c->io = pa_ioline_detach_iochannel(c->line));
     pa_iochannel_set_callback(c->io, io_callback, c);
 
-    pa_iochannel_socket_set_sndbuf(c->io, pa_memblockq_get_length(c->output_memblockq));
+    /* Broadcast listeners start with the next chunk recorded, the ring
+     * does the buffering for them */
+    if (c->broadcast)
+        c->seq = c->broadcast->head;
+    else
+        pa_iochannel_socket_set_sndbuf(c->io, pa_memblockq_get_length(c->output_memblockq));
 
     pa_ioline_unref(c->line);
     c->line = NULL;
@@ -538,6 +811,9 @@ static void handle_listen_prefix(struct connection *c, const char *source_name)
     pa_source_output_new_data data;
     pa_sample_spec ss;
     pa_channel_map cm;
+    struct connection *other;
+    uint32_t idx;
+    unsigned n = 0;
     char *t;
     size_t l;
 
@@ -552,6 +828,15 @@ static void handle_listen_prefix(struct connection *c, const char *source_name)
         return;
     }
 
+    PA_IDXSET_FOREACH(other, c->protocol->connections, idx)
+        if (other->source_output)
+            n++;
+
+    if (n >= MAX_PRIVATE_LISTENERS) {
+        html_response(c, 503, "Too many listeners", NULL);
+        return;
+    }
+
     ss = source->sample_spec;
     cm = source->channel_map;
 
@@ -612,6 +897,60 @@ static void handle_listen_prefix(struct connection *c, const char *source_name)
         pa_ioline_set_drain_callback(c->line, line_drain_callback, c);
 }
 
+static void handle_broadcast_prefix(struct connection *c, const char *source_name) {
+    pa_source *source;
+    struct broadcast *b;
+    pa_sample_spec ss;
+    pa_channel_map cm;
+    char *t;
+
+    pa_assert(c);
+    pa_assert(source_name);
+
+    pa_assert(c->line);
+    pa_assert(!c->io);
+
+    if (!(source = pa_namereg_get(c->protocol->core, source_name, PA_NAMEREG_SOURCE))) {
+        html_response(c, 404, "Source not found", NULL);
+        return;
+    }
+
+    ss = source->sample_spec;
+    cm = source->channel_map;
+
+    pa_sample_spec_mimefy(&ss, &cm);
+
+    t = pa_sample_spec_to_mime_type(&ss, &cm);
+
+    if (c->method == METHOD_HEAD) {
+        http_response(c, 200, "OK", t);
+        pa_xfree(t);
+        pa_ioline_defer_close(c->line);
+        return;
+    }
+
+    if ((b = pa_hashmap_get(c->protocol->broadcasts, PA_UINT32_TO_PTR(source->index))))
+        PA_REFCNT_INC(b);
+    else if (!(b = broadcast_new(c->protocol, source, &ss, &cm))) {
+        pa_xfree(t);
+        html_response(c, 403, "Cannot create source output", NULL);
+        return;
+    }
+
+    c->broadcast = b;
+    pa_idxset_put(b->listeners, c, NULL);
+
+    http_response(c, 200, "OK", t);
+    pa_xfree(t);
+
+    pa_ioline_set_callback(c->line, NULL, NULL);
+
+    if (pa_ioline_is_drained(c->line))
+        line_drain_callback(c->line, c);
+    else
+        pa_ioline_set_drain_callback(c->line, line_drain_callback, c);
+}
+
 static void handle_url(struct connection *c) {
     pa_assert(c);
 
@@ -627,6 +966,8 @@ static void handle_url(struct connection *c) {
         handle_listen(c);
     else if (pa_startswith(c->url, URL_LISTEN_SOURCE))
         handle_listen_prefix(c, c->url + sizeof(URL_LISTEN_SOURCE)-1);
+    else if (pa_startswith(c->url, URL_BROADCAST_SOURCE))
+        handle_broadcast_prefix(c, c->url + sizeof(URL_BROADCAST_SOURCE)-1);
     else
         html_response(c, 404, "Not Found", NULL);
 }
@@ -750,6 +1091,7 @@ static pa_http_protocol* http_protocol_new(pa_core *c) {
     PA_REFCNT_INIT(p);
     p->core = c;
     p->connections = pa_idxset_new(NULL, NULL);
+    p->broadcasts = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
 
     pa_assert_se(pa_shared_set(c, "http-protocol", p) >= 0);
 
@@ -788,6 +1130,10 @@ void pa_http_protocol_unref(pa_http_protocol *p) {
 
     pa_idxset_free(p->connections, NULL);
 
+    /* Each broadcast goes away with its last listener */
+    pa_assert(pa_hashmap_isempty(p->broadcasts));
+    pa_hashmap_free(p->broadcasts, NULL);
+
     pa_strlist_free(p->servers);
 
     pa_assert_se(pa_shared_remove(p->core, "http-protocol") >= 0);
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <pulse/introspect.h>
 #include <pulse/rtclock.h>
 #include <pulse/timeval.h>
 #include <pulse/version.h>
@@ -36,6 +37,7 @@
 #include <pulse/util.h>
 #include <pulse/xmalloc.h>
 #include <pulse/internal.h>
+#include <pulse/thread-mainloop.h>
 
 #include <pulsecore/native-common.h>
 #include <pulsecore/packet.h>
@@ -57,6 +59,7 @@
 #include <pulsecore/core-util.h>
 #include <pulsecore/ipacl.h>
 #include <pulsecore/thread-mq.h>
+#include <pulsecore/timing-page.h>
 
 #include "protocol-native.h"
 
@@ -68,11 +71,17 @@
 /* Don't accept more connection than this */
 #define MAX_CONNECTIONS 64
 
+/* Don't start more socket I/O threads than this */
+#define MAX_IO_THREADS 16U
+
 #define MAX_MEMBLOCKQ_LENGTH (4*1024*1024) /* 4MB */
 #define DEFAULT_TLENGTH_MSEC 2000 /* 2s */
 #define DEFAULT_PROCESS_MSEC 20   /* 20ms */
 #define DEFAULT_FRAGSIZE_MSEC DEFAULT_TLENGTH_MSEC
 
+/* Don't query the sink latency for the timing page more often than this */
+#define TIMING_PAGE_INTERVAL_USEC (10*PA_USEC_PER_MSEC)
+
 struct pa_native_protocol;
 
 typedef struct record_stream {
@@ -145,6 +154,10 @@ typedef struct playback_stream {
     size_t render_memblockq_length;
     pa_usec_t current_sink_latency;
     uint64_t playing_for, underrun_for;
+
+    /* Our slot in the timing page of the connection */
+    uint32_t timing_slot;
+    pa_usec_t timing_page_updated;
 } playback_stream;
 
 #define PLAYBACK_STREAM(o) (playback_stream_cast(o))
@@ -173,6 +186,7 @@ struct pa_native_connection {
     pa_native_options *options;
     bool authorized:1;
     bool is_local:1;
+    bool subscribe_with_info:1;
     uint32_t version;
     pa_client *client;
     pa_pstream *pstream;
@@ -181,6 +195,11 @@ struct pa_native_connection {
     uint32_t rrobin_index;
     pa_subscription *subscription;
     pa_time_event *auth_timeout_event;
+    pa_timing_page *timing_page;
+
+    /* The thread doing the socket I/O of the pstream, NULL if that's
+     * the main loop */
+    pa_threaded_mainloop *io_thread;
 };
 
 #define PA_NATIVE_CONNECTION(o) (pa_native_connection_cast(o))
@@ -196,6 +215,21 @@ struct pa_native_protocol {
     pa_hook hooks[PA_NATIVE_HOOK_MAX];
 
     pa_hashmap *extensions;
+
+    /* Subscription events with the info record attached, built once
+     * per protocol version for the event packet event_info_for */
+    pa_packet *event_info_for;
+    pa_hashmap *event_info_packets;
+
+    /* Sent in place of property lists that were not asked for */
+    pa_proplist *empty_proplist;
+
+    /* Started on demand for modules with io-threads= set, shared by
+     * all of them. They only do the socket I/O and the framing of the
+     * connections' pstreams. Parsing and handling of the commands,
+     * including introspection, stays in the main loop. */
+    pa_threaded_mainloop *io_threads[MAX_IO_THREADS];
+    unsigned n_io_threads, next_io_thread;
 };
 
 enum {
@@ -271,6 +305,7 @@ static void command_play_sample(pa_pdispatch *pd, uint32_t command, uint32_t tag
 static void command_remove_sample(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_get_info(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_get_info_list(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
+static void command_get_filtered_info_list(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_get_server_info(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_subscribe(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_set_volume(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
@@ -334,6 +369,7 @@ static const pa_pdispatch_cb_t command_table[PA_COMMAND_MAX] = {
     [PA_COMMAND_GET_SINK_INPUT_INFO_LIST] = command_get_info_list,
     [PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST] = command_get_info_list,
     [PA_COMMAND_GET_SAMPLE_INFO_LIST] = command_get_info_list,
+    [PA_COMMAND_GET_FILTERED_INFO_LIST] = command_get_filtered_info_list,
     [PA_COMMAND_GET_SERVER_INFO] = command_get_server_info,
     [PA_COMMAND_SUBSCRIBE] = command_subscribe,
 
@@ -770,6 +806,11 @@ static void playback_stream_unlink(playback_stream *s) {
         s->sink_input = NULL;
     }
 
+    if (s->timing_slot != PA_INVALID_INDEX) {
+        pa_timing_page_free_slot(s->connection->timing_page, s->timing_slot);
+        s->timing_slot = PA_INVALID_INDEX;
+    }
+
     if (s->drain_request)
         pa_pstream_send_error(s->connection->pstream, s->drain_tag, PA_ERR_NOENTITY);
 
@@ -1177,6 +1218,7 @@ static playback_stream* playback_stream_new(
     s->early_requests = early_requests;
     pa_atomic_store(&s->seek_or_post_in_queue, 0);
     s->seek_windex = -1;
+    s->timing_slot = PA_INVALID_INDEX;
 
     s->sink_input->parent.process_msg = sink_input_process_msg;
     s->sink_input->pop = sink_input_pop_cb;
@@ -1222,6 +1264,16 @@ static playback_stream* playback_stream_new(
 
     pa_idxset_put(c->output_streams, s, &s->index);
 
+    /* Publish the timing data in shared memory, if the client can map
+     * it. Must happen before the IO thread knows about the stream */
+    if (c->version >= 29 && pa_pstream_get_shm(c->pstream)) {
+        if (!c->timing_page)
+            c->timing_page = pa_timing_page_new();
+
+        if (c->timing_page)
+            s->timing_slot = pa_timing_page_alloc_slot(c->timing_page, s->index);
+    }
+
     pa_log_info("Final latency %0.2f ms = %0.2f ms + 2*%0.2f ms + %0.2f ms",
                 ((double) pa_bytes_to_usec(s->buffer_attr.tlength, &sink_input->sample_spec) + (double) s->configured_sink_latency) / PA_USEC_PER_MSEC,
                 (double) pa_bytes_to_usec(s->buffer_attr.tlength-s->buffer_attr.minreq*2, &sink_input->sample_spec) / PA_USEC_PER_MSEC,
@@ -1329,9 +1381,16 @@ static void native_connection_unlink(pa_native_connection *c) {
     if (c->subscription)
         pa_subscription_free(c->subscription);
 
-    if (c->pstream)
+    if (c->pstream) {
+        if (c->io_thread)
+            pa_threaded_mainloop_lock(c->io_thread);
+
         pa_pstream_unlink(c->pstream);
 
+        if (c->io_thread)
+            pa_threaded_mainloop_unlock(c->io_thread);
+    }
+
     if (c->auth_timeout_event) {
         c->protocol->core->mainloop->time_free(c->auth_timeout_event);
         c->auth_timeout_event = NULL;
@@ -1357,6 +1416,9 @@ static void native_connection_free(pa_object *o) {
     pa_pstream_unref(c->pstream);
     pa_client_free(c->client);
 
+    if (c->timing_page)
+        pa_timing_page_free(c->timing_page);
+
     pa_xfree(c);
 }
 
@@ -1395,6 +1457,42 @@ static void native_connection_send_memblock(pa_native_connection *c) {
 
 /*** sink input callbacks ***/
 
+/* Called from thread context. pending is the length of the chunk pop()
+ * is returning, which is not part of the sink input's state yet. */
+static void update_timing_page(playback_stream *s, bool force, size_t pending) {
+    pa_timing_snapshot snapshot;
+    pa_usec_t now;
+
+    playback_stream_assert_ref(s);
+
+    if (s->timing_slot == PA_INVALID_INDEX)
+        return;
+
+    now = pa_rtclock_now();
+
+    if (!force && now < s->timing_page_updated + TIMING_PAGE_INTERVAL_USEC)
+        return;
+
+    snapshot.stream_index = s->index;
+    snapshot.read_index = pa_memblockq_get_read_index(s->memblockq);
+    snapshot.write_index = pa_memblockq_get_write_index(s->memblockq);
+    snapshot.sink_usec =
+        pa_sink_get_latency_within_thread(s->sink_input->sink) +
+        pa_bytes_to_usec(pa_memblockq_get_length(s->sink_input->thread_info.render_memblockq), &s->sink_input->sink->sample_spec);
+    snapshot.underrun_for = s->sink_input->thread_info.underrun_for;
+    snapshot.playing_for = s->sink_input->thread_info.playing_for;
+    snapshot.playing =
+        snapshot.playing_for > 0 &&
+        s->sink_input->sink->thread_info.state == PA_SINK_RUNNING &&
+        s->sink_input->thread_info.state == PA_SINK_INPUT_RUNNING;
+    snapshot.timestamp = now;
+
+    pa_timing_snapshot_add_pending(&snapshot, pending, pa_bytes_to_usec(pending, &s->sink_input->sample_spec));
+
+    pa_timing_page_write(s->connection->timing_page, s->timing_slot, &snapshot);
+    s->timing_page_updated = now;
+}
+
 /* Called from thread context */
 static void handle_seek(playback_stream *s, int64_t indexw) {
     playback_stream_assert_ref(s);
@@ -1548,6 +1646,7 @@ static int sink_input_process_msg(pa_msgobject *o, int code, void *userdata, int
             s->underrun_for = s->sink_input->thread_info.underrun_for;
             s->playing_for = s->sink_input->thread_info.playing_for;
 
+            update_timing_page(s, true, 0);
             return 0;
 
         case PA_SINK_INPUT_MESSAGE_SET_STATE: {
@@ -1653,6 +1752,9 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     pa_memblockq_drop(s->memblockq, chunk->length);
     playback_stream_request_bytes(s);
 
+    /* Publish the start of playback right away */
+    update_timing_page(s, i->thread_info.underrun_for > 0, chunk->length);
+
     return 0;
 }
 
@@ -1669,6 +1771,8 @@ static void sink_input_process_rewind_cb(pa_sink_input *i, size_t nbytes) {
         return;
 
     pa_memblockq_rewind(s->memblockq, nbytes);
+
+    update_timing_page(s, true, 0);
 }
 
 /* Called from thread context */
@@ -2224,6 +2328,17 @@ static void command_create_playback_stream(pa_pdispatch *pd, uint32_t command, u
         }
     }
 
+    if (c->version >= 29) {
+        /* Where the client can read our timing data without asking */
+        if (s->timing_slot != PA_INVALID_INDEX) {
+            pa_tagstruct_putu32(reply, pa_timing_page_get_id(c->timing_page));
+            pa_tagstruct_putu32(reply, s->timing_slot);
+        } else {
+            pa_tagstruct_putu32(reply, PA_INVALID_INDEX);
+            pa_tagstruct_putu32(reply, PA_INVALID_INDEX);
+        }
+    }
+
     pa_pstream_send_tagstruct(c->pstream, reply);
 
 finish:
@@ -3113,7 +3228,7 @@ static void fixup_sample_spec(pa_native_connection *c, pa_sample_spec *fixed, co
     }
 }
 
-static void sink_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sink *sink) {
+static void sink_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sink *sink, pa_info_field_mask_t fields) {
     pa_sample_spec fixed_ss;
 
     pa_assert(t);
@@ -3133,14 +3248,14 @@ static void sink_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sin
         PA_TAG_BOOLEAN, pa_sink_get_mute(sink, false),
         PA_TAG_U32, sink->monitor_source ? sink->monitor_source->index : PA_INVALID_INDEX,
         PA_TAG_STRING, sink->monitor_source ? sink->monitor_source->name : NULL,
-        PA_TAG_USEC, pa_sink_get_latency(sink),
+        PA_TAG_USEC, (fields & PA_INFO_FIELD_LATENCY) ? pa_sink_get_latency(sink) : 0,
         PA_TAG_STRING, sink->driver,
         PA_TAG_U32, sink->flags & PA_SINK_CLIENT_FLAGS_MASK,
         PA_TAG_INVALID);
 
     if (c->version >= 13) {
-        pa_tagstruct_put_proplist(t, sink->proplist);
-        pa_tagstruct_put_usec(t, pa_sink_get_requested_latency(sink));
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? sink->proplist : c->protocol->empty_proplist);
+        pa_tagstruct_put_usec(t, (fields & PA_INFO_FIELD_LATENCY) ? pa_sink_get_requested_latency(sink) : 0);
     }
 
     if (c->version >= 15) {
@@ -3152,7 +3267,10 @@ static void sink_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sin
         pa_tagstruct_putu32(t, sink->card ? sink->card->index : PA_INVALID_INDEX);
     }
 
-    if (c->version >= 16) {
+    if (c->version >= 16 && !(fields & PA_INFO_FIELD_PORTS)) {
+        pa_tagstruct_putu32(t, 0);
+        pa_tagstruct_puts(t, NULL);
+    } else if (c->version >= 16) {
         void *state;
         pa_device_port *p;
 
@@ -3183,7 +3301,7 @@ static void sink_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sin
     }
 }
 
-static void source_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_source *source) {
+static void source_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_source *source, pa_info_field_mask_t fields) {
     pa_sample_spec fixed_ss;
 
     pa_assert(t);
@@ -3203,14 +3321,14 @@ static void source_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_s
         PA_TAG_BOOLEAN, pa_source_get_mute(source, false),
         PA_TAG_U32, source->monitor_of ? source->monitor_of->index : PA_INVALID_INDEX,
         PA_TAG_STRING, source->monitor_of ? source->monitor_of->name : NULL,
-        PA_TAG_USEC, pa_source_get_latency(source),
+        PA_TAG_USEC, (fields & PA_INFO_FIELD_LATENCY) ? pa_source_get_latency(source) : 0,
         PA_TAG_STRING, source->driver,
         PA_TAG_U32, source->flags & PA_SOURCE_CLIENT_FLAGS_MASK,
         PA_TAG_INVALID);
 
     if (c->version >= 13) {
-        pa_tagstruct_put_proplist(t, source->proplist);
-        pa_tagstruct_put_usec(t, pa_source_get_requested_latency(source));
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? source->proplist : c->protocol->empty_proplist);
+        pa_tagstruct_put_usec(t, (fields & PA_INFO_FIELD_LATENCY) ? pa_source_get_requested_latency(source) : 0);
     }
 
     if (c->version >= 15) {
@@ -3222,7 +3340,10 @@ static void source_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_s
         pa_tagstruct_putu32(t, source->card ? source->card->index : PA_INVALID_INDEX);
     }
 
-    if (c->version >= 16) {
+    if (c->version >= 16 && !(fields & PA_INFO_FIELD_PORTS)) {
+        pa_tagstruct_putu32(t, 0);
+        pa_tagstruct_puts(t, NULL);
+    } else if (c->version >= 16) {
         void *state;
         pa_device_port *p;
 
@@ -3253,7 +3374,7 @@ static void source_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_s
     }
 }
 
-static void client_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_client *client) {
+static void client_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_client *client, pa_info_field_mask_t fields) {
     pa_assert(t);
     pa_assert(client);
 
@@ -3263,10 +3384,10 @@ static void client_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_c
     pa_tagstruct_puts(t, client->driver);
 
     if (c->version >= 13)
-        pa_tagstruct_put_proplist(t, client->proplist);
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? client->proplist : c->protocol->empty_proplist);
 }
 
-static void card_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_card *card) {
+static void card_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_card *card, pa_info_field_mask_t fields) {
     void *state = NULL;
     pa_card_profile *p;
     pa_device_port *port;
@@ -3290,11 +3411,16 @@ static void card_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_car
     }
 
     pa_tagstruct_puts(t, card->active_profile->name);
-    pa_tagstruct_put_proplist(t, card->proplist);
+    pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? card->proplist : c->protocol->empty_proplist);
 
     if (c->version < 26)
         return;
 
+    if (!(fields & PA_INFO_FIELD_PORTS)) {
+        pa_tagstruct_putu32(t, 0);
+        return;
+    }
+
     pa_tagstruct_putu32(t, pa_hashmap_size(card->ports));
 
     PA_HASHMAP_FOREACH(port, card->ports, state) {
@@ -3305,7 +3431,7 @@ static void card_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_car
         pa_tagstruct_putu32(t, port->priority);
         pa_tagstruct_putu32(t, port->available);
         pa_tagstruct_putu8(t, port->direction);
-        pa_tagstruct_put_proplist(t, port->proplist);
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? port->proplist : c->protocol->empty_proplist);
 
         pa_tagstruct_putu32(t, pa_hashmap_size(port->profiles));
 
@@ -3333,9 +3459,9 @@ static void module_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_m
         pa_tagstruct_put_proplist(t, module->proplist);
 }
 
-static void sink_input_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sink_input *s) {
+static void sink_input_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_sink_input *s, pa_info_field_mask_t fields) {
     pa_sample_spec fixed_ss;
-    pa_usec_t sink_latency;
+    pa_usec_t latency = 0, sink_latency = 0;
     pa_cvolume v;
     bool has_volume = false;
 
@@ -3350,6 +3476,10 @@ static void sink_input_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t,
     else
         pa_cvolume_reset(&v, fixed_ss.channels);
 
+    /* Asks the IO thread */
+    if (fields & PA_INFO_FIELD_LATENCY)
+        latency = pa_sink_input_get_latency(s, &sink_latency);
+
     pa_tagstruct_putu32(t, s->index);
     pa_tagstruct_puts(t, pa_strnull(pa_proplist_gets(s->proplist, PA_PROP_MEDIA_NAME)));
     pa_tagstruct_putu32(t, s->module ? s->module->index : PA_INVALID_INDEX);
@@ -3358,14 +3488,14 @@ static void sink_input_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t,
     pa_tagstruct_put_sample_spec(t, &fixed_ss);
     pa_tagstruct_put_channel_map(t, &s->channel_map);
     pa_tagstruct_put_cvolume(t, &v);
-    pa_tagstruct_put_usec(t, pa_sink_input_get_latency(s, &sink_latency));
+    pa_tagstruct_put_usec(t, latency);
     pa_tagstruct_put_usec(t, sink_latency);
     pa_tagstruct_puts(t, pa_resample_method_to_string(pa_sink_input_get_resample_method(s)));
     pa_tagstruct_puts(t, s->driver);
     if (c->version >= 11)
         pa_tagstruct_put_boolean(t, pa_sink_input_get_mute(s));
     if (c->version >= 13)
-        pa_tagstruct_put_proplist(t, s->proplist);
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? s->proplist : c->protocol->empty_proplist);
     if (c->version >= 19)
         pa_tagstruct_put_boolean(t, (pa_sink_input_get_state(s) == PA_SINK_INPUT_CORKED));
     if (c->version >= 20) {
@@ -3376,9 +3506,9 @@ static void sink_input_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t,
         pa_tagstruct_put_format_info(t, s->format);
 }
 
-static void source_output_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_source_output *s) {
+static void source_output_fill_tagstruct(pa_native_connection *c, pa_tagstruct *t, pa_source_output *s, pa_info_field_mask_t fields) {
     pa_sample_spec fixed_ss;
-    pa_usec_t source_latency;
+    pa_usec_t latency = 0, source_latency = 0;
     pa_cvolume v;
     bool has_volume = false;
 
@@ -3393,6 +3523,10 @@ static void source_output_fill_tagstruct(pa_native_connection *c, pa_tagstruct *
     else
         pa_cvolume_reset(&v, fixed_ss.channels);
 
+    /* Asks the IO thread */
+    if (fields & PA_INFO_FIELD_LATENCY)
+        latency = pa_source_output_get_latency(s, &source_latency);
+
     pa_tagstruct_putu32(t, s->index);
     pa_tagstruct_puts(t, pa_strnull(pa_proplist_gets(s->proplist, PA_PROP_MEDIA_NAME)));
     pa_tagstruct_putu32(t, s->module ? s->module->index : PA_INVALID_INDEX);
@@ -3400,12 +3534,12 @@ static void source_output_fill_tagstruct(pa_native_connection *c, pa_tagstruct *
     pa_tagstruct_putu32(t, s->source->index);
     pa_tagstruct_put_sample_spec(t, &fixed_ss);
     pa_tagstruct_put_channel_map(t, &s->channel_map);
-    pa_tagstruct_put_usec(t, pa_source_output_get_latency(s, &source_latency));
+    pa_tagstruct_put_usec(t, latency);
     pa_tagstruct_put_usec(t, source_latency);
     pa_tagstruct_puts(t, pa_resample_method_to_string(pa_source_output_get_resample_method(s)));
     pa_tagstruct_puts(t, s->driver);
     if (c->version >= 13)
-        pa_tagstruct_put_proplist(t, s->proplist);
+        pa_tagstruct_put_proplist(t, (fields & PA_INFO_FIELD_PROPLIST) ? s->proplist : c->protocol->empty_proplist);
     if (c->version >= 19)
         pa_tagstruct_put_boolean(t, (pa_source_output_get_state(s) == PA_SOURCE_OUTPUT_CORKED));
     if (c->version >= 22) {
@@ -3528,42 +3662,118 @@ static void command_get_info(pa_pdispatch *pd, uint32_t command, uint32_t tag, p
 
     reply = reply_new(tag);
     if (sink)
-        sink_fill_tagstruct(c, reply, sink);
+        sink_fill_tagstruct(c, reply, sink, PA_INFO_FIELD_ALL);
     else if (source)
-        source_fill_tagstruct(c, reply, source);
+        source_fill_tagstruct(c, reply, source, PA_INFO_FIELD_ALL);
     else if (client)
-        client_fill_tagstruct(c, reply, client);
+        client_fill_tagstruct(c, reply, client, PA_INFO_FIELD_ALL);
     else if (card)
-        card_fill_tagstruct(c, reply, card);
+        card_fill_tagstruct(c, reply, card, PA_INFO_FIELD_ALL);
     else if (module)
         module_fill_tagstruct(c, reply, module);
     else if (si)
-        sink_input_fill_tagstruct(c, reply, si);
+        sink_input_fill_tagstruct(c, reply, si, PA_INFO_FIELD_ALL);
     else if (so)
-        source_output_fill_tagstruct(c, reply, so);
+        source_output_fill_tagstruct(c, reply, so, PA_INFO_FIELD_ALL);
     else
         scache_fill_tagstruct(c, reply, sce);
     pa_pstream_send_tagstruct(c->pstream, reply);
 }
 
-static void command_get_info_list(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
-    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
-    pa_idxset *i;
-    uint32_t idx;
-    void *p;
-    pa_tagstruct *reply;
+static bool info_filter_match(const pa_info_filter *f, uint32_t command, void *object) {
+    pa_module *module = NULL;
+    pa_client *client = NULL;
+    uint32_t device = PA_INVALID_INDEX;
+    pa_proplist *proplist;
 
-    pa_native_connection_assert_ref(c);
-    pa_assert(t);
+    switch (command) {
+        case PA_COMMAND_GET_SINK_INFO_LIST: {
+            pa_sink *sink = object;
 
-    if (!pa_tagstruct_eof(t)) {
-        protocol_error(c);
-        return;
+            module = sink->module;
+            device = sink->card ? sink->card->index : PA_INVALID_INDEX;
+            proplist = sink->proplist;
+            break;
+        }
+
+        case PA_COMMAND_GET_SOURCE_INFO_LIST: {
+            pa_source *source = object;
+
+            module = source->module;
+            device = source->card ? source->card->index : PA_INVALID_INDEX;
+            proplist = source->proplist;
+            break;
+        }
+
+        case PA_COMMAND_GET_CLIENT_INFO_LIST: {
+            pa_client *cl = object;
+
+            module = cl->module;
+            proplist = cl->proplist;
+            break;
+        }
+
+        case PA_COMMAND_GET_CARD_INFO_LIST: {
+            pa_card *card = object;
+
+            module = card->module;
+            proplist = card->proplist;
+            break;
+        }
+
+        case PA_COMMAND_GET_SINK_INPUT_INFO_LIST: {
+            pa_sink_input *si = object;
+
+            module = si->module;
+            client = si->client;
+            device = si->sink->index;
+            proplist = si->proplist;
+            break;
+        }
+
+        case PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST: {
+            pa_source_output *so = object;
+
+            module = so->module;
+            client = so->client;
+            device = so->source->index;
+            proplist = so->proplist;
+            break;
+        }
+
+        default:
+            pa_assert_not_reached();
     }
 
-    CHECK_VALIDITY(c->pstream, c->authorized, tag, PA_ERR_ACCESS);
+    if (f->owner_module != PA_INVALID_INDEX && (!module || module->index != f->owner_module))
+        return false;
 
-    reply = reply_new(tag);
+    if (f->client != PA_INVALID_INDEX && (!client || client->index != f->client))
+        return false;
+
+    if (f->device != PA_INVALID_INDEX && device != f->device)
+        return false;
+
+    if (f->property) {
+        const char *v;
+
+        if (!f->value)
+            return pa_proplist_contains(proplist, f->property) > 0;
+
+        if (!(v = pa_proplist_gets(proplist, f->property)) || !pa_streq(v, f->value))
+            return false;
+    }
+
+    return true;
+}
+
+/* Appends the records of the objects of the list command that match
+ * f, or of all of them if f is NULL */
+static void fill_info_list(pa_native_connection *c, pa_tagstruct *reply, uint32_t command, const pa_info_filter *f) {
+    pa_info_field_mask_t fields = f ? f->fields : PA_INFO_FIELD_ALL;
+    pa_idxset *i;
+    uint32_t idx;
+    void *p;
 
     if (command == PA_COMMAND_GET_SINK_INFO_LIST)
         i = c->protocol->core->sinks;
@@ -3584,29 +3794,92 @@ static void command_get_info_list(pa_pdispatch *pd, uint32_t command, uint32_t t
         i = c->protocol->core->scache;
     }
 
-    if (i) {
-        PA_IDXSET_FOREACH(p, i, idx) {
-            if (command == PA_COMMAND_GET_SINK_INFO_LIST)
-                sink_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_SOURCE_INFO_LIST)
-                source_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_CLIENT_INFO_LIST)
-                client_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_CARD_INFO_LIST)
-                card_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_MODULE_INFO_LIST)
-                module_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_SINK_INPUT_INFO_LIST)
-                sink_input_fill_tagstruct(c, reply, p);
-            else if (command == PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST)
-                source_output_fill_tagstruct(c, reply, p);
-            else {
-                pa_assert(command == PA_COMMAND_GET_SAMPLE_INFO_LIST);
-                scache_fill_tagstruct(c, reply, p);
-            }
+    if (!i)
+        return;
+
+    PA_IDXSET_FOREACH(p, i, idx) {
+        if (f && !info_filter_match(f, command, p))
+            continue;
+
+        if (command == PA_COMMAND_GET_SINK_INFO_LIST)
+            sink_fill_tagstruct(c, reply, p, fields);
+        else if (command == PA_COMMAND_GET_SOURCE_INFO_LIST)
+            source_fill_tagstruct(c, reply, p, fields);
+        else if (command == PA_COMMAND_GET_CLIENT_INFO_LIST)
+            client_fill_tagstruct(c, reply, p, fields);
+        else if (command == PA_COMMAND_GET_CARD_INFO_LIST)
+            card_fill_tagstruct(c, reply, p, fields);
+        else if (command == PA_COMMAND_GET_MODULE_INFO_LIST)
+            module_fill_tagstruct(c, reply, p);
+        else if (command == PA_COMMAND_GET_SINK_INPUT_INFO_LIST)
+            sink_input_fill_tagstruct(c, reply, p, fields);
+        else if (command == PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST)
+            source_output_fill_tagstruct(c, reply, p, fields);
+        else {
+            pa_assert(command == PA_COMMAND_GET_SAMPLE_INFO_LIST);
+            scache_fill_tagstruct(c, reply, p);
         }
     }
+}
+
+static void command_get_info_list(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
+    pa_tagstruct *reply;
+
+    pa_native_connection_assert_ref(c);
+    pa_assert(t);
+
+    if (!pa_tagstruct_eof(t)) {
+        protocol_error(c);
+        return;
+    }
+
+    CHECK_VALIDITY(c->pstream, c->authorized, tag, PA_ERR_ACCESS);
+
+    reply = reply_new(tag);
+    fill_info_list(c, reply, command, NULL);
+    pa_pstream_send_tagstruct(c->pstream, reply);
+}
+
+static void command_get_filtered_info_list(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
+    uint32_t list_command, fields;
+    pa_info_filter f;
+    pa_tagstruct *reply;
+    bool streams, devices;
+
+    pa_native_connection_assert_ref(c);
+    pa_assert(t);
+
+    if (pa_tagstruct_getu32(t, &list_command) < 0 ||
+        pa_tagstruct_getu32(t, &fields) < 0 ||
+        pa_tagstruct_getu32(t, &f.owner_module) < 0 ||
+        pa_tagstruct_getu32(t, &f.client) < 0 ||
+        pa_tagstruct_getu32(t, &f.device) < 0 ||
+        pa_tagstruct_gets(t, &f.property) < 0 ||
+        pa_tagstruct_gets(t, &f.value) < 0 ||
+        !pa_tagstruct_eof(t)) {
+        protocol_error(c);
+        return;
+    }
+
+    f.fields = (pa_info_field_mask_t) fields;
+
+    streams = list_command == PA_COMMAND_GET_SINK_INPUT_INFO_LIST || list_command == PA_COMMAND_GET_SOURCE_OUTPUT_INFO_LIST;
+    devices = list_command == PA_COMMAND_GET_SINK_INFO_LIST || list_command == PA_COMMAND_GET_SOURCE_INFO_LIST;
 
+    CHECK_VALIDITY(c->pstream, c->authorized, tag, PA_ERR_ACCESS);
+    CHECK_VALIDITY(c->pstream, streams || devices ||
+                   list_command == PA_COMMAND_GET_CLIENT_INFO_LIST ||
+                   list_command == PA_COMMAND_GET_CARD_INFO_LIST, tag, PA_ERR_NOTSUPPORTED);
+    CHECK_VALIDITY(c->pstream, (fields & ~PA_INFO_FIELD_ALL) == 0, tag, PA_ERR_INVALID);
+    CHECK_VALIDITY(c->pstream, f.client == PA_INVALID_INDEX || streams, tag, PA_ERR_INVALID);
+    CHECK_VALIDITY(c->pstream, f.device == PA_INVALID_INDEX || streams || devices, tag, PA_ERR_INVALID);
+    CHECK_VALIDITY(c->pstream, !f.property || pa_proplist_key_valid(f.property), tag, PA_ERR_INVALID);
+    CHECK_VALIDITY(c->pstream, !f.value || f.property, tag, PA_ERR_INVALID);
+
+    reply = reply_new(tag);
+    fill_info_list(c, reply, list_command, &f);
     pa_pstream_send_tagstruct(c->pstream, reply);
 }
 
@@ -3656,28 +3929,123 @@ static void command_get_server_info(pa_pdispatch *pd, uint32_t command, uint32_t
     pa_pstream_send_tagstruct(c->pstream, reply);
 }
 
-static void subscription_cb(pa_core *core, pa_subscription_event_type_t e, uint32_t idx, void *userdata) {
+/* Builds the event packet with the record GET_*_INFO would send for the
+ * object, or returns NULL if there is none to attach */
+static pa_packet *event_info_packet_new(pa_native_connection *c, pa_subscription_event_type_t e, uint32_t idx) {
+    pa_core *core = c->protocol->core;
     pa_tagstruct *t;
-    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
+    void *object = NULL;
+    uint8_t *data;
+    size_t length;
 
-    pa_native_connection_assert_ref(c);
+    switch (e & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            object = pa_idxset_get_by_index(core->sinks, idx);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            object = pa_idxset_get_by_index(core->sources, idx);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+            object = pa_idxset_get_by_index(core->sink_inputs, idx);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+            object = pa_idxset_get_by_index(core->source_outputs, idx);
+            break;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+            object = pa_idxset_get_by_index(core->clients, idx);
+            break;
+        default:
+            break;
+    }
+
+    /* The object might be gone already if the event was delayed */
+    if (!object)
+        return NULL;
 
     t = pa_tagstruct_new(NULL, 0);
     pa_tagstruct_putu32(t, PA_COMMAND_SUBSCRIBE_EVENT);
     pa_tagstruct_putu32(t, (uint32_t) -1);
     pa_tagstruct_putu32(t, e);
     pa_tagstruct_putu32(t, idx);
-    pa_pstream_send_tagstruct(c->pstream, t);
+
+    switch (e & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            sink_fill_tagstruct(c, t, object, PA_INFO_FIELD_ALL);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            source_fill_tagstruct(c, t, object, PA_INFO_FIELD_ALL);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+            sink_input_fill_tagstruct(c, t, object, PA_INFO_FIELD_ALL);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+            source_output_fill_tagstruct(c, t, object, PA_INFO_FIELD_ALL);
+            break;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+            client_fill_tagstruct(c, t, object, PA_INFO_FIELD_ALL);
+            break;
+        default:
+            pa_assert_not_reached();
+    }
+
+    pa_assert_se(data = pa_tagstruct_free_data(t, &length));
+    return pa_packet_new_dynamic(data, length);
+}
+
+static pa_packet *event_info_packet(pa_native_connection *c, pa_subscription_event_type_t e, uint32_t idx, pa_packet *packet) {
+    pa_native_protocol *p = c->protocol;
+    pa_packet *info;
+
+    if ((e & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+        return NULL;
+
+    /* The records only depend on the protocol version of the
+     * connection, so all connections with the same version get the
+     * same packet. We keep a reference to the plain event packet so
+     * that the next event cannot be mistaken for this one. */
+    if (p->event_info_for != packet) {
+        pa_hashmap_remove_all(p->event_info_packets, (pa_free_cb_t) pa_packet_unref);
+
+        if (p->event_info_for)
+            pa_packet_unref(p->event_info_for);
+        p->event_info_for = pa_packet_ref(packet);
+    }
+
+    if (!(info = pa_hashmap_get(p->event_info_packets, PA_UINT32_TO_PTR(c->version)))) {
+        if (!(info = event_info_packet_new(c, e, idx)))
+            return NULL;
+
+        pa_assert_se(pa_hashmap_put(p->event_info_packets, PA_UINT32_TO_PTR(c->version), info) == 0);
+    }
+
+    return info;
+}
+
+static void subscription_cb(pa_core *core, pa_subscription_event_type_t e, uint32_t idx, pa_packet *packet, void *userdata) {
+    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
+    pa_packet *info;
+
+    pa_native_connection_assert_ref(c);
+
+    if (c->subscribe_with_info && (info = event_info_packet(c, e, idx, packet))) {
+        pa_pstream_send_packet(c->pstream, info, NULL);
+        return;
+    }
+
+    /* The packet is shared by all connections subscribed to the event */
+    pa_pstream_send_packet(c->pstream, packet, NULL);
 }
 
 static void command_subscribe(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
     pa_subscription_mask_t m;
+    bool with_info = false;
 
     pa_native_connection_assert_ref(c);
     pa_assert(t);
 
     if (pa_tagstruct_getu32(t, &m) < 0 ||
+        (c->version >= 29 && pa_tagstruct_get_boolean(t, &with_info) < 0) ||
         !pa_tagstruct_eof(t)) {
         protocol_error(c);
         return;
@@ -3690,11 +4058,13 @@ static void command_subscribe(pa_pdispatch *pd, uint32_t command, uint32_t tag,
         pa_subscription_free(c->subscription);
 
     if (m != 0) {
-        c->subscription = pa_subscription_new(c->protocol->core, m, subscription_cb, c);
+        c->subscription = pa_subscription_new_packet(c->protocol->core, m, subscription_cb, c);
         pa_assert(c->subscription);
     } else
         c->subscription = NULL;
 
+    c->subscribe_with_info = with_info;
+
     pa_pstream_send_simple_ack(c->pstream, tag);
 }
 
@@ -4961,6 +5331,16 @@ static void client_send_event_cb(pa_client *client, const char*event, pa_proplis
     pa_pstream_send_tagstruct(c->pstream, t);
 }
 
+static bool client_owns_event_cb(pa_client *client, void *event_userdata) {
+    pa_native_connection *c;
+
+    pa_assert(client);
+    c = PA_NATIVE_CONNECTION(client->userdata);
+    pa_native_connection_assert_ref(c);
+
+    return event_userdata == c || (c->pstream && pa_pstream_owns_event(c->pstream, event_userdata));
+}
+
 /*** module entry points ***/
 
 static void auth_timeout(pa_mainloop_api*m, pa_time_event *e, const struct timeval *t, void *userdata) {
@@ -4976,6 +5356,74 @@ static void auth_timeout(pa_mainloop_api*m, pa_time_event *e, const struct timev
     }
 }
 
+/* Returns the next I/O thread to hand a connection to, round robin
+ * over the first n of them */
+static pa_threaded_mainloop *get_io_thread(pa_native_protocol *p, uint32_t n) {
+    unsigned idx;
+
+    n = PA_MIN(n, MAX_IO_THREADS);
+    idx = p->next_io_thread++ % n;
+
+    while (p->n_io_threads <= idx) {
+        pa_threaded_mainloop *m;
+        char name[16];
+
+        m = pa_threaded_mainloop_new();
+        pa_snprintf(name, sizeof(name), "native-io-%u", p->n_io_threads);
+        pa_threaded_mainloop_set_name(m, name);
+
+        if (pa_threaded_mainloop_start(m) < 0) {
+            pa_log("Failed to start I/O thread.");
+            pa_threaded_mainloop_free(m);
+            return NULL;
+        }
+
+        p->io_threads[p->n_io_threads++] = m;
+    }
+
+    return p->io_threads[idx];
+}
+
+/* Moves the socket I/O of the connection to one of the I/O threads.
+ * Packets are still dispatched from the main loop. Returns NULL if that
+ * didn't work out, the connection stays with io then. On success io is
+ * freed. */
+static pa_pstream *pstream_new_threaded(pa_native_protocol *p, pa_native_connection *c, pa_iochannel *io) {
+    pa_threaded_mainloop *m;
+    pa_iochannel *thread_io;
+    pa_pstream *pstream;
+
+    if (!(m = get_io_thread(p, c->options->io_threads)))
+        return NULL;
+
+    pa_threaded_mainloop_lock(m);
+
+    /* I/O channels are bound to their main loop, so make a new one for
+     * the same socket */
+    thread_io = pa_iochannel_new(pa_threaded_mainloop_get_api(m), pa_iochannel_get_recv_fd(io), pa_iochannel_get_send_fd(io));
+
+#ifdef HAVE_CREDS
+    if (pa_iochannel_creds_supported(thread_io))
+        pa_iochannel_creds_enable(thread_io);
+#endif
+
+    if (!(pstream = pa_pstream_new_threaded(p->core->mainloop, pa_threaded_mainloop_get_api(m), thread_io, p->core->mempool))) {
+        pa_threaded_mainloop_unlock(m);
+
+        pa_iochannel_set_noclose(thread_io, true);
+        pa_iochannel_free(thread_io);
+        return NULL;
+    }
+
+    pa_threaded_mainloop_unlock(m);
+
+    pa_iochannel_set_noclose(io, true);
+    pa_iochannel_free(io);
+
+    c->io_thread = m;
+    return pstream;
+}
+
 void pa_native_protocol_connect(pa_native_protocol *p, pa_iochannel *io, pa_native_options *o) {
     pa_native_connection *c;
     char pname[128];
@@ -5030,14 +5478,30 @@ void pa_native_protocol_connect(pa_native_protocol *p, pa_iochannel *io, pa_nati
         c->auth_timeout_event = NULL;
 
     c->is_local = pa_iochannel_socket_is_local(io);
+    c->subscribe_with_info = false;
     c->version = 8;
 
     c->client = client;
     c->client->kill = client_kill_cb;
     c->client->send_event = client_send_event_cb;
+    c->client->owns_event = client_owns_event_cb;
     c->client->userdata = c;
 
-    c->pstream = pa_pstream_new(p->core->mainloop, io, p->core->mempool);
+    c->io_thread = NULL;
+    c->pstream = NULL;
+
+    if (o->io_threads > 0)
+        c->pstream = pstream_new_threaded(p, c, io);
+
+    if (!c->pstream) {
+        c->pstream = pa_pstream_new(p->core->mainloop, io, p->core->mempool);
+
+#ifdef HAVE_CREDS
+        if (pa_iochannel_creds_supported(io))
+            pa_iochannel_creds_enable(io);
+#endif
+    }
+
     pa_pstream_set_receive_packet_callback(c->pstream, pstream_packet_callback, c);
     pa_pstream_set_receive_memblock_callback(c->pstream, pstream_memblock_callback, c);
     pa_pstream_set_die_callback(c->pstream, pstream_die_callback, c);
@@ -5055,11 +5519,6 @@ void pa_native_protocol_connect(pa_native_protocol *p, pa_iochannel *io, pa_nati
 
     pa_idxset_put(p->connections, c, NULL);
 
-#ifdef HAVE_CREDS
-    if (pa_iochannel_creds_supported(io))
-        pa_iochannel_creds_enable(io);
-#endif
-
     pa_hook_fire(&p->hooks[PA_NATIVE_HOOK_CONNECTION_PUT], c);
 }
 
@@ -5090,6 +5549,13 @@ static pa_native_protocol* native_protocol_new(pa_core *c) {
 
     p->extensions = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
 
+    p->event_info_for = NULL;
+    p->event_info_packets = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+
+    p->empty_proplist = pa_proplist_new();
+
+    p->n_io_threads = p->next_io_thread = 0;
+
     for (h = 0; h < PA_NATIVE_HOOK_MAX; h++)
         pa_hook_init(&p->hooks[h], p);
 
@@ -5119,6 +5585,7 @@ pa_native_protocol* pa_native_protocol_ref(pa_native_protocol *p) {
 void pa_native_protocol_unref(pa_native_protocol *p) {
     pa_native_connection *c;
     pa_native_hook_t h;
+    unsigned i;
 
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) >= 1);
@@ -5138,6 +5605,17 @@ void pa_native_protocol_unref(pa_native_protocol *p) {
 
     pa_hashmap_free(p->extensions, NULL);
 
+    pa_hashmap_free(p->event_info_packets, (pa_free_cb_t) pa_packet_unref);
+    if (p->event_info_for)
+        pa_packet_unref(p->event_info_for);
+
+    pa_proplist_free(p->empty_proplist);
+
+    for (i = 0; i < p->n_io_threads; i++) {
+        pa_threaded_mainloop_stop(p->io_threads[i]);
+        pa_threaded_mainloop_free(p->io_threads[i]);
+    }
+
     pa_assert_se(pa_shared_remove(p->core, "native-protocol") >= 0);
 
     pa_xfree(p);
@@ -5245,6 +5723,11 @@ int pa_native_options_parse(pa_native_options *o, pa_core *c, pa_modargs *ma) {
         return -1;
     }
 
+    if (pa_modargs_get_value_u32(ma, "io-threads", &o->io_threads) < 0 || o->io_threads > MAX_IO_THREADS) {
+        pa_log("io-threads= expects a number between 0 and %u.", MAX_IO_THREADS);
+        return -1;
+    }
+
     enabled = true;
     if (pa_modargs_get_value_boolean(ma, "auth-group-enable", &enabled) < 0) {
         pa_log("auth-group-enable= expects a boolean argument.");
@@ -47,6 +47,10 @@ typedef struct pa_native_options {
     char *auth_group;
     pa_ip_acl *auth_ip_acl;
     pa_auth_cookie *auth_cookie;
+
+    /* If non-zero, the socket I/O of the connections is done by up to
+     * this many worker threads instead of the main loop */
+    uint32_t io_threads;
 } pa_native_options;
 
 typedef enum pa_native_hook {
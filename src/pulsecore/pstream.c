@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
 
 #ifdef HAVE_NETINET_IN_H
 #include <netinet/in.h>
@@ -34,6 +35,7 @@
 
 #include <pulse/xmalloc.h>
 
+#include <pulsecore/core-error.h>
 #include <pulsecore/socket.h>
 #include <pulsecore/queue.h>
 #include <pulsecore/log.h>
@@ -41,6 +43,8 @@
 #include <pulsecore/refcnt.h>
 #include <pulsecore/flist.h>
 #include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+#include <pulsecore/core-util.h>
 
 #include "pstream.h"
 
@@ -81,6 +85,12 @@ typedef uint32_t pa_pstream_descriptor[PA_PSTREAM_DESCRIPTOR_MAX];
  */
 #define FRAME_SIZE_MAX_ALLOW (1024*1024*16)
 
+/* For threaded pstreams: how many received frames may be waiting for
+ * the owner before we stop reading from the socket, and how many of
+ * them the owner handles before giving other event sources a turn */
+#define MAX_OWNER_BACKLOG 64
+#define OWNER_BATCH 16
+
 PA_STATIC_FLIST_DECLARE(items, 0, pa_xfree);
 
 struct item_info {
@@ -88,7 +98,13 @@ struct item_info {
         PA_PSTREAM_ITEM_PACKET,
         PA_PSTREAM_ITEM_MEMBLOCK,
         PA_PSTREAM_ITEM_SHMRELEASE,
-        PA_PSTREAM_ITEM_SHMREVOKE
+        PA_PSTREAM_ITEM_SHMREVOKE,
+
+        /* What the I/O thread of a threaded pstream hands to the owner */
+        PA_PSTREAM_EVENT_PACKET,
+        PA_PSTREAM_EVENT_MEMBLOCK,
+        PA_PSTREAM_EVENT_DRAIN,
+        PA_PSTREAM_EVENT_DIE
     } type;
 
     /* packet info */
@@ -108,6 +124,14 @@ struct item_info {
     uint32_t block_id;
 };
 
+/* A pipe to wake up another thread's main loop */
+struct wakeup {
+    int fds[2];
+    int write_type;
+    bool signalled;
+    pa_io_event *event;
+};
+
 struct pa_pstream {
     PA_REFCNT_DECLARE;
 
@@ -117,6 +141,10 @@ struct pa_pstream {
 
     pa_queue *send_queue;
 
+    /* Items pushed to the send queue that are not completely written
+     * yet */
+    unsigned n_queued;
+
     bool dead;
 
     struct {
@@ -168,26 +196,158 @@ struct pa_pstream {
     pa_creds read_creds, write_creds;
     bool read_creds_valid, send_creds_now;
 #endif
+
+    /* Only set for pstreams whose I/O is done by another thread, see
+     * pa_pstream_new_threaded(). Protects the send queue, the SHM
+     * state and everything in 'thread'. */
+    pa_mutex *mutex;
+
+    struct {
+        /* The main loop of the thread owning the pstream. p->mainloop
+         * is the one of the I/O thread. */
+        pa_mainloop_api *mainloop;
+
+        struct wakeup io_wakeup, owner_wakeup;
+
+        /* Received data, waiting for the owner */
+        pa_queue *events;
+        unsigned n_events;
+        bool throttled;
+        bool drain_posted;
+    } thread;
 };
 
 static int do_write(pa_pstream *p);
 static int do_read(pa_pstream *p);
 
+static void pstream_lock(pa_pstream *p) {
+    if (p->mutex)
+        pa_mutex_lock(p->mutex);
+}
+
+static void pstream_unlock(pa_pstream *p) {
+    if (p->mutex)
+        pa_mutex_unlock(p->mutex);
+}
+
+static int wakeup_init(struct wakeup *w, pa_mainloop_api *m, pa_io_event_cb_t cb, void *userdata) {
+    if (pa_pipe_cloexec(w->fds) < 0) {
+        pa_log("pipe() failed: %s", pa_cstrerror(errno));
+        w->fds[0] = w->fds[1] = -1;
+        return -1;
+    }
+
+    pa_make_fd_nonblock(w->fds[0]);
+    pa_make_fd_nonblock(w->fds[1]);
+
+    w->write_type = 0;
+    w->signalled = false;
+    w->event = m->io_new(m, w->fds[0], PA_IO_EVENT_INPUT, cb, userdata);
+
+    return 0;
+}
+
+static void wakeup_done(struct wakeup *w) {
+    pa_assert(!w->event);
+
+    if (w->fds[0] >= 0)
+        pa_close_pipe(w->fds);
+}
+
+/* Called with the mutex held */
+static void wakeup_signal(struct wakeup *w) {
+    const uint8_t x = 'x';
+
+    if (w->signalled || w->fds[1] < 0)
+        return;
+
+    if (pa_write(w->fds[1], &x, 1, &w->write_type) == 1)
+        w->signalled = true;
+}
+
+/* Called with the mutex held */
+static void wakeup_clear(struct wakeup *w) {
+    uint8_t x[16];
+
+    while (pa_read(w->fds[0], x, sizeof(x), NULL) > 0)
+        ;
+
+    w->signalled = false;
+}
+
+/* Called from the I/O thread, hands an item to the owner */
+static void post_event(pa_pstream *p, struct item_info *i) {
+    pa_assert(p->mutex);
+
+    pa_mutex_lock(p->mutex);
+    pa_queue_push(p->thread.events, i);
+    p->thread.n_events++;
+    wakeup_signal(&p->thread.owner_wakeup);
+    pa_mutex_unlock(p->mutex);
+}
+
+static struct item_info *event_new(int type) {
+    struct item_info *i;
+
+    if (!(i = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
+        i = pa_xnew(struct item_info, 1);
+
+    i->type = type;
+    i->packet = NULL;
+    pa_memchunk_reset(&i->chunk);
+#ifdef HAVE_CREDS
+    i->with_creds = false;
+#endif
+
+    return i;
+}
+
+/* Called from the I/O thread. Returns true if the owner has so much
+ * received data to chew on that we should stop reading for now. */
+static bool owner_backlog_full(pa_pstream *p) {
+    bool full;
+
+    if (!p->mutex)
+        return false;
+
+    pa_mutex_lock(p->mutex);
+    full = p->thread.n_events >= MAX_OWNER_BACKLOG;
+    if (full)
+        p->thread.throttled = true;
+    pa_mutex_unlock(p->mutex);
+
+    return full;
+}
+
+/* Called from the I/O thread, on errors */
+static void io_teardown(pa_pstream *p) {
+    if (p->io) {
+        pa_iochannel_free(p->io);
+        p->io = NULL;
+    }
+
+    if (p->thread.io_wakeup.event) {
+        p->mainloop->io_free(p->thread.io_wakeup.event);
+        p->thread.io_wakeup.event = NULL;
+    }
+}
+
 static void do_pstream_read_write(pa_pstream *p) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
     pa_pstream_ref(p);
 
-    p->mainloop->defer_enable(p->defer_event, 0);
+    if (p->defer_event)
+        p->mainloop->defer_enable(p->defer_event, 0);
 
-    if (!p->dead && pa_iochannel_is_readable(p->io)) {
+    if (p->io && pa_iochannel_is_readable(p->io) && !owner_backlog_full(p)) {
         if (do_read(p) < 0)
             goto fail;
-    } else if (!p->dead && pa_iochannel_is_hungup(p->io))
+    } else if (p->io && pa_iochannel_is_hungup(p->io))
         goto fail;
 
-    while (!p->dead && pa_iochannel_is_writable(p->io)) {
+    while (p->io && pa_iochannel_is_writable(p->io)) {
         int r = do_write(p);
         if (r < 0)
             goto fail;
@@ -200,6 +360,14 @@ static void do_pstream_read_write(pa_pstream *p) {
 
 fail:
 
+    if (p->mutex) {
+        /* The owner unlinks us when it gets to this */
+        io_teardown(p);
+        post_event(p, event_new(PA_PSTREAM_EVENT_DIE));
+        pa_pstream_unref(p);
+        return;
+    }
+
     if (p->die_callback)
         p->die_callback(p, p->die_callback_userdata);
 
@@ -228,26 +396,92 @@ static void defer_callback(pa_mainloop_api *m, pa_defer_event *e, void*userdata)
     do_pstream_read_write(p);
 }
 
+static void io_wakeup_callback(pa_mainloop_api *m, pa_io_event *e, int fd, pa_io_event_flags_t f, void *userdata) {
+    pa_pstream *p = userdata;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(p->thread.io_wakeup.event == e);
+
+    pa_mutex_lock(p->mutex);
+    wakeup_clear(&p->thread.io_wakeup);
+    pa_mutex_unlock(p->mutex);
+
+    do_pstream_read_write(p);
+}
+
+static void item_free(void *item);
+static void dispatch_event(pa_pstream *p, struct item_info *i);
+
+static void owner_wakeup_callback(pa_mainloop_api *m, pa_io_event *e, int fd, pa_io_event_flags_t f, void *userdata) {
+    pa_pstream *p = userdata;
+    unsigned n;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(p->thread.owner_wakeup.event == e);
+
+    pa_pstream_ref(p);
+
+    pa_mutex_lock(p->mutex);
+    wakeup_clear(&p->thread.owner_wakeup);
+    pa_mutex_unlock(p->mutex);
+
+    for (n = 0; n < OWNER_BATCH && !p->dead; n++) {
+        struct item_info *i;
+
+        pa_mutex_lock(p->mutex);
+
+        if ((i = pa_queue_pop(p->thread.events))) {
+            p->thread.n_events--;
+
+            /* Let the I/O thread continue reading */
+            if (p->thread.throttled && p->thread.n_events < MAX_OWNER_BACKLOG / 2) {
+                p->thread.throttled = false;
+                wakeup_signal(&p->thread.io_wakeup);
+            }
+        }
+
+        pa_mutex_unlock(p->mutex);
+
+        if (!i)
+            break;
+
+        dispatch_event(p, i);
+        item_free(i);
+    }
+
+    /* If there is more, come back after the other event sources of
+     * the main loop had their turn */
+    if (!p->dead) {
+        pa_mutex_lock(p->mutex);
+        if (p->thread.n_events > 0)
+            wakeup_signal(&p->thread.owner_wakeup);
+        pa_mutex_unlock(p->mutex);
+    }
+
+    pa_pstream_unref(p);
+}
+
 static void memimport_release_cb(pa_memimport *i, uint32_t block_id, void *userdata);
 
-pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *pool) {
+static pa_pstream *pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *pool) {
     pa_pstream *p;
 
     pa_assert(m);
     pa_assert(io);
     pa_assert(pool);
 
-    p = pa_xnew(pa_pstream, 1);
+    p = pa_xnew0(pa_pstream, 1);
     PA_REFCNT_INIT(p);
     p->io = io;
     pa_iochannel_set_callback(io, io_callback, p);
     p->dead = false;
 
     p->mainloop = m;
-    p->defer_event = m->defer_new(m, defer_callback, p);
-    m->defer_enable(p->defer_event, 0);
 
     p->send_queue = pa_queue_new();
+    p->n_queued = 0;
 
     p->write.current = NULL;
     p->write.index = 0;
@@ -284,6 +518,56 @@ pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *poo
     p->send_creds_now = false;
     p->read_creds_valid = false;
 #endif
+
+    p->mutex = NULL;
+
+    return p;
+}
+
+pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *pool) {
+    pa_pstream *p;
+
+    p = pstream_new(m, io, pool);
+
+    p->defer_event = m->defer_new(m, defer_callback, p);
+    m->defer_enable(p->defer_event, 0);
+
+    return p;
+}
+
+pa_pstream *pa_pstream_new_threaded(pa_mainloop_api *m, pa_mainloop_api *io_mainloop, pa_iochannel *io, pa_mempool *pool) {
+    pa_pstream *p;
+
+    pa_assert(m);
+    pa_assert(io_mainloop);
+    pa_assert(pa_iochannel_get_mainloop_api(io) == io_mainloop);
+
+    p = pstream_new(io_mainloop, io, pool);
+
+    p->defer_event = NULL;
+    /* Recursive, since unreferencing imported memory blocks might
+     * send release frames */
+    p->mutex = pa_mutex_new(true, false);
+    p->thread.mainloop = m;
+    p->thread.events = pa_queue_new();
+    p->thread.n_events = 0;
+    p->thread.throttled = false;
+    p->thread.drain_posted = false;
+    p->thread.io_wakeup.fds[0] = p->thread.io_wakeup.fds[1] = -1;
+    p->thread.owner_wakeup.fds[0] = p->thread.owner_wakeup.fds[1] = -1;
+
+    if (wakeup_init(&p->thread.io_wakeup, io_mainloop, io_wakeup_callback, p) < 0 ||
+        wakeup_init(&p->thread.owner_wakeup, m, owner_wakeup_callback, p) < 0) {
+
+        /* Leave the I/O channel to the caller */
+        pa_iochannel_set_callback(io, NULL, NULL);
+        p->io = NULL;
+
+        pa_pstream_unlink(p);
+        pa_pstream_unref(p);
+        return NULL;
+    }
+
     return p;
 }
 
@@ -294,9 +578,13 @@ static void item_free(void *item) {
     if (i->type == PA_PSTREAM_ITEM_MEMBLOCK) {
         pa_assert(i->chunk.memblock);
         pa_memblock_unref(i->chunk.memblock);
-    } else if (i->type == PA_PSTREAM_ITEM_PACKET) {
+    } else if (i->type == PA_PSTREAM_ITEM_PACKET || i->type == PA_PSTREAM_EVENT_PACKET) {
         pa_assert(i->packet);
         pa_packet_unref(i->packet);
+    } else if (i->type == PA_PSTREAM_EVENT_MEMBLOCK) {
+        /* NULL if an SHM block could not be imported */
+        if (i->chunk.memblock)
+            pa_memblock_unref(i->chunk.memblock);
     }
 
     if (pa_flist_push(PA_STATIC_FLIST_GET(items), i) < 0)
@@ -322,9 +610,24 @@ static void pstream_free(pa_pstream *p) {
     if (p->read.packet)
         pa_packet_unref(p->read.packet);
 
+    if (p->mutex) {
+        pa_queue_free(p->thread.events, item_free);
+        wakeup_done(&p->thread.io_wakeup);
+        wakeup_done(&p->thread.owner_wakeup);
+        pa_mutex_free(p->mutex);
+    }
+
     pa_xfree(p);
 }
 
+/* Called with the mutex held */
+static void schedule_write(pa_pstream *p) {
+    if (p->mutex)
+        wakeup_signal(&p->thread.io_wakeup);
+    else
+        p->mainloop->defer_enable(p->defer_event, 1);
+}
+
 void pa_pstream_send_packet(pa_pstream*p, pa_packet *packet, const pa_creds *creds) {
     struct item_info *i;
 
@@ -332,8 +635,12 @@ void pa_pstream_send_packet(pa_pstream*p, pa_packet *packet, const pa_creds *cre
     pa_assert(PA_REFCNT_VALUE(p) > 0);
     pa_assert(packet);
 
-    if (p->dead)
+    pstream_lock(p);
+
+    if (p->dead) {
+        pstream_unlock(p);
         return;
+    }
 
     if (!(i = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
         i = pa_xnew(struct item_info, 1);
@@ -347,8 +654,10 @@ void pa_pstream_send_packet(pa_pstream*p, pa_packet *packet, const pa_creds *cre
 #endif
 
     pa_queue_push(p->send_queue, i);
+    p->n_queued++;
 
-    p->mainloop->defer_enable(p->defer_event, 1);
+    schedule_write(p);
+    pstream_unlock(p);
 }
 
 void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa_seek_mode_t seek_mode, const pa_memchunk *chunk) {
@@ -360,8 +669,12 @@ void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa
     pa_assert(channel != (uint32_t) -1);
     pa_assert(chunk);
 
-    if (p->dead)
+    pstream_lock(p);
+
+    if (p->dead) {
+        pstream_unlock(p);
         return;
+    }
 
     idx = 0;
     length = chunk->length;
@@ -389,12 +702,14 @@ void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa
 #endif
 
         pa_queue_push(p->send_queue, i);
+        p->n_queued++;
 
         idx += n;
         length -= n;
     }
 
-    p->mainloop->defer_enable(p->defer_event, 1);
+    schedule_write(p);
+    pstream_unlock(p);
 }
 
 void pa_pstream_send_release(pa_pstream *p, uint32_t block_id) {
@@ -402,8 +717,12 @@ void pa_pstream_send_release(pa_pstream *p, uint32_t block_id) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
-    if (p->dead)
+    pstream_lock(p);
+
+    if (p->dead) {
+        pstream_unlock(p);
         return;
+    }
 
 /*     pa_log("Releasing block %u", block_id); */
 
@@ -416,7 +735,10 @@ void pa_pstream_send_release(pa_pstream *p, uint32_t block_id) {
 #endif
 
     pa_queue_push(p->send_queue, item);
-    p->mainloop->defer_enable(p->defer_event, 1);
+    p->n_queued++;
+
+    schedule_write(p);
+    pstream_unlock(p);
 }
 
 /* might be called from thread context */
@@ -440,8 +762,13 @@ void pa_pstream_send_revoke(pa_pstream *p, uint32_t block_id) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
-    if (p->dead)
+    pstream_lock(p);
+
+    if (p->dead) {
+        pstream_unlock(p);
         return;
+    }
+
 /*     pa_log("Revoking block %u", block_id); */
 
     if (!(item = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
@@ -453,7 +780,10 @@ void pa_pstream_send_revoke(pa_pstream *p, uint32_t block_id) {
 #endif
 
     pa_queue_push(p->send_queue, item);
-    p->mainloop->defer_enable(p->defer_event, 1);
+    p->n_queued++;
+
+    schedule_write(p);
+    pstream_unlock(p);
 }
 
 /* might be called from thread context */
@@ -469,6 +799,7 @@ static void memexport_revoke_cb(pa_memexport *e, uint32_t block_id, void *userda
         pa_pstream_send_revoke(p, block_id);
 }
 
+/* Called with the mutex held */
 static void prepare_next_write_item(pa_pstream *p) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
@@ -577,8 +908,11 @@ static int do_write(pa_pstream *p) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
-    if (!p->write.current)
+    if (!p->write.current) {
+        pstream_lock(p);
         prepare_next_write_item(p);
+        pstream_unlock(p);
+    }
 
     if (!p->write.current)
         return 0;
@@ -624,6 +958,8 @@ static int do_write(pa_pstream *p) {
     p->write.index += (size_t) r;
 
     if (p->write.index >= PA_PSTREAM_DESCRIPTOR_SIZE + ntohl(p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH])) {
+        bool drained;
+
         pa_assert(p->write.current);
         item_free(p->write.current);
         p->write.current = NULL;
@@ -633,7 +969,21 @@ static int do_write(pa_pstream *p) {
 
         pa_memchunk_reset(&p->write.memchunk);
 
-        if (p->drain_callback && !pa_pstream_is_pending(p))
+        pstream_lock(p);
+        pa_assert(p->n_queued > 0);
+        drained = --p->n_queued == 0;
+
+        if (p->mutex && drained && !p->thread.drain_posted) {
+            /* The owner checks again when it gets to this */
+            p->thread.drain_posted = true;
+            pa_queue_push(p->thread.events, event_new(PA_PSTREAM_EVENT_DRAIN));
+            p->thread.n_events++;
+            wakeup_signal(&p->thread.owner_wakeup);
+        }
+
+        pstream_unlock(p);
+
+        if (!p->mutex && drained && p->drain_callback)
             p->drain_callback(p, p->drain_callback_userdata);
     }
 
@@ -647,6 +997,101 @@ fail:
     return -1;
 }
 
+static void deliver_packet(pa_pstream *p) {
+    struct item_info *i;
+
+    if (!p->mutex) {
+        if (p->receive_packet_callback)
+#ifdef HAVE_CREDS
+            p->receive_packet_callback(p, p->read.packet, p->read_creds_valid ? &p->read_creds : NULL, p->receive_packet_callback_userdata);
+#else
+            p->receive_packet_callback(p, p->read.packet, NULL, p->receive_packet_callback_userdata);
+#endif
+        return;
+    }
+
+    i = event_new(PA_PSTREAM_EVENT_PACKET);
+    i->packet = pa_packet_ref(p->read.packet);
+#ifdef HAVE_CREDS
+    if ((i->with_creds = p->read_creds_valid))
+        i->creds = p->read_creds;
+#endif
+
+    post_event(p, i);
+}
+
+static void deliver_memblock(pa_pstream *p, const pa_memchunk *chunk) {
+    struct item_info *i;
+    uint32_t channel;
+    int64_t offset;
+    pa_seek_mode_t seek_mode;
+
+    channel = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL]);
+    offset = (int64_t) (
+            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI])) << 32) |
+            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO]))));
+    seek_mode = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS]) & PA_FLAG_SEEKMASK;
+
+    if (!p->mutex) {
+        if (p->receive_memblock_callback)
+            p->receive_memblock_callback(p, channel, offset, seek_mode, chunk, p->receive_memblock_callback_userdata);
+        return;
+    }
+
+    i = event_new(PA_PSTREAM_EVENT_MEMBLOCK);
+    i->chunk = *chunk;
+    if (i->chunk.memblock)
+        pa_memblock_ref(i->chunk.memblock);
+    i->channel = channel;
+    i->offset = offset;
+    i->seek_mode = seek_mode;
+
+    post_event(p, i);
+}
+
+/* Called from the owner of a threaded pstream */
+static void dispatch_event(pa_pstream *p, struct item_info *i) {
+    bool drained;
+
+    switch (i->type) {
+
+        case PA_PSTREAM_EVENT_PACKET:
+            if (p->receive_packet_callback)
+#ifdef HAVE_CREDS
+                p->receive_packet_callback(p, i->packet, i->with_creds ? &i->creds : NULL, p->receive_packet_callback_userdata);
+#else
+                p->receive_packet_callback(p, i->packet, NULL, p->receive_packet_callback_userdata);
+#endif
+            break;
+
+        case PA_PSTREAM_EVENT_MEMBLOCK:
+            if (p->receive_memblock_callback)
+                p->receive_memblock_callback(p, i->channel, i->offset, i->seek_mode, &i->chunk, p->receive_memblock_callback_userdata);
+            break;
+
+        case PA_PSTREAM_EVENT_DRAIN:
+            /* Something might have been queued since */
+            pa_mutex_lock(p->mutex);
+            p->thread.drain_posted = false;
+            drained = p->n_queued == 0;
+            pa_mutex_unlock(p->mutex);
+
+            if (drained && p->drain_callback)
+                p->drain_callback(p, p->drain_callback_userdata);
+            break;
+
+        case PA_PSTREAM_EVENT_DIE:
+            if (p->die_callback)
+                p->die_callback(p, p->die_callback_userdata);
+
+            pa_pstream_unlink(p);
+            break;
+
+        default:
+            pa_assert_not_reached();
+    }
+}
+
 static int do_read(pa_pstream *p) {
     void *d;
     size_t l;
@@ -708,8 +1153,10 @@ static int do_read(pa_pstream *p) {
 
 /*             pa_log("Got release frame for %u", ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI])); */
 
+            pstream_lock(p);
             pa_assert(p->export);
             pa_memexport_process_release(p->export, ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI]));
+            pstream_unlock(p);
 
             goto frame_done;
 
@@ -780,7 +1227,7 @@ static int do_read(pa_pstream *p) {
     } else if (p->read.index > PA_PSTREAM_DESCRIPTOR_SIZE) {
         /* Frame payload available */
 
-        if (p->read.memblock && p->receive_memblock_callback) {
+        if (p->read.memblock) {
 
             /* Is this memblock data? Than pass it to the user */
             l = (p->read.index - (size_t) r) < PA_PSTREAM_DESCRIPTOR_SIZE ? (size_t) (p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE) : (size_t) r;
@@ -792,21 +1239,7 @@ static int do_read(pa_pstream *p) {
                 chunk.index = p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE - l;
                 chunk.length = l;
 
-                if (p->receive_memblock_callback) {
-                    int64_t offset;
-
-                    offset = (int64_t) (
-                            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI])) << 32) |
-                            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO]))));
-
-                    p->receive_memblock_callback(
-                        p,
-                        ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL]),
-                        offset,
-                        ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS]) & PA_FLAG_SEEKMASK,
-                        &chunk,
-                        p->receive_memblock_callback_userdata);
-                }
+                deliver_memblock(p, &chunk);
 
                 /* Drop seek info for following callbacks */
                 p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] =
@@ -825,13 +1258,7 @@ static int do_read(pa_pstream *p) {
 
             } else if (p->read.packet) {
 
-                if (p->receive_packet_callback)
-#ifdef HAVE_CREDS
-                    p->receive_packet_callback(p, p->read.packet, p->read_creds_valid ? &p->read_creds : NULL, p->receive_packet_callback_userdata);
-#else
-                    p->receive_packet_callback(p, p->read.packet, NULL, p->receive_packet_callback_userdata);
-#endif
-
+                deliver_packet(p);
                 pa_packet_unref(p->read.packet);
             } else {
                 pa_memblock *b;
@@ -850,25 +1277,14 @@ static int do_read(pa_pstream *p) {
                         pa_log_debug("Failed to import memory block.");
                 }
 
-                if (p->receive_memblock_callback) {
-                    int64_t offset;
+                {
                     pa_memchunk chunk;
 
                     chunk.memblock = b;
                     chunk.index = 0;
                     chunk.length = b ? pa_memblock_get_length(b) : ntohl(p->read.shm_info[PA_PSTREAM_SHM_LENGTH]);
 
-                    offset = (int64_t) (
-                            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI])) << 32) |
-                            (((uint64_t) ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO]))));
-
-                    p->receive_memblock_callback(
-                            p,
-                            ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL]),
-                            offset,
-                            ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS]) & PA_FLAG_SEEKMASK,
-                            &chunk,
-                            p->receive_memblock_callback_userdata);
+                    deliver_memblock(p, &chunk);
                 }
 
                 if (b)
@@ -954,10 +1370,14 @@ bool pa_pstream_is_pending(pa_pstream *p) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
+    pstream_lock(p);
+
     if (p->dead)
         b = false;
     else
-        b = p->write.current || !pa_queue_isempty(p->send_queue);
+        b = p->n_queued > 0;
+
+    pstream_unlock(p);
 
     return b;
 }
@@ -979,13 +1399,29 @@ pa_pstream* pa_pstream_ref(pa_pstream*p) {
 }
 
 void pa_pstream_unlink(pa_pstream *p) {
+    pa_queue *events = NULL;
+
     pa_assert(p);
 
     if (p->dead)
         return;
 
+    pstream_lock(p);
     p->dead = true;
 
+    if (p->mutex) {
+        /* Freed outside of the lock, the memory blocks in there might
+         * want to send release frames */
+        events = p->thread.events;
+        p->thread.events = pa_queue_new();
+        p->thread.n_events = 0;
+    }
+
+    pstream_unlock(p);
+
+    if (events)
+        pa_queue_free(events, item_free);
+
     if (p->import) {
         pa_memimport_free(p->import);
         p->import = NULL;
@@ -1006,6 +1442,16 @@ void pa_pstream_unlink(pa_pstream *p) {
         p->defer_event = NULL;
     }
 
+    if (p->thread.io_wakeup.event) {
+        p->mainloop->io_free(p->thread.io_wakeup.event);
+        p->thread.io_wakeup.event = NULL;
+    }
+
+    if (p->thread.owner_wakeup.event) {
+        p->thread.mainloop->io_free(p->thread.owner_wakeup.event);
+        p->thread.owner_wakeup.event = NULL;
+    }
+
     p->die_callback = NULL;
     p->drain_callback = NULL;
     p->receive_packet_callback = NULL;
@@ -1016,6 +1462,8 @@ void pa_pstream_enable_shm(pa_pstream *p, bool enable) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
+    pstream_lock(p);
+
     p->use_shm = enable;
 
     if (enable) {
@@ -1030,6 +1478,8 @@ void pa_pstream_enable_shm(pa_pstream *p, bool enable) {
             p->export = NULL;
         }
     }
+
+    pstream_unlock(p);
 }
 
 bool pa_pstream_get_shm(pa_pstream *p) {
@@ -1038,3 +1488,19 @@ bool pa_pstream_get_shm(pa_pstream *p) {
 
     return p->use_shm;
 }
+
+bool pa_pstream_owns_event(pa_pstream *p, void *event_userdata) {
+    bool b;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+
+    if (event_userdata == p)
+        return true;
+
+    pstream_lock(p);
+    b = p->io && event_userdata == p->io;
+    pstream_unlock(p);
+
+    return b;
+}
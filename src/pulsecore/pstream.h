@@ -44,6 +44,18 @@ typedef void (*pa_pstream_block_id_cb_t)(pa_pstream *p, uint32_t block_id, void
 
 pa_pstream* pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *p);
 
+/* Creates a pstream whose socket I/O, framing and SHM handling is done
+ * by the thread running io_mainloop, which is also the main loop of
+ * the I/O channel. Received packets and memory blocks as well as the
+ * drain and die notifications are handed over to, and all callbacks
+ * are called from, the thread running m. The send functions may be
+ * called from any thread. Has to be called with io_mainloop locked
+ * (i.e. under pa_threaded_mainloop_lock()), just like
+ * pa_pstream_unlink() unless the pstream died already. Returns NULL
+ * if the wakeup pipes could not be set up, the I/O channel is left to
+ * the caller then. */
+pa_pstream* pa_pstream_new_threaded(pa_mainloop_api *m, pa_mainloop_api *io_mainloop, pa_iochannel *io, pa_mempool *p);
+
 pa_pstream* pa_pstream_ref(pa_pstream*p);
 void pa_pstream_unref(pa_pstream*p);
 
@@ -66,4 +78,8 @@ bool pa_pstream_is_pending(pa_pstream *p);
 void pa_pstream_enable_shm(pa_pstream *p, bool enable);
 bool pa_pstream_get_shm(pa_pstream *p);
 
+/* Returns true if a main loop event with this userdata was created by
+ * the pstream or its iochannel */
+bool pa_pstream_owns_event(pa_pstream *p, void *event_userdata);
+
 #endif
@@ -40,6 +40,7 @@
 #include <pulsecore/strbuf.h>
 #include <pulsecore/remap.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/sinc.h>
 #include "ffmpeg/avcodec.h"
 
 #include "resampler.h"
@@ -47,6 +48,41 @@
 /* Number of samples of extra space we allow the resamplers to return */
 #define EXTRA_FRAMES 128
 
+/* Maximum number of blocks we keep checkpoints for */
+#define CHECKPOINTS_MAX 64
+
+/* A snapshot of the resampler state taken before each block that is
+ * passed to pa_resampler_run(), together with a reference to the input
+ * of that block. Restoring a checkpoint and replaying part of its
+ * input brings the resampler into the exact state it had at any
+ * position inside the block. */
+typedef struct pa_resampler_checkpoint {
+    uint64_t position; /* in input frames */
+    pa_memchunk input;
+    void *state;
+    void *leftover;
+    size_t leftover_length, leftover_size;
+} pa_resampler_checkpoint;
+
+/* Maximum number of 2x or 3x stages of the integer ratio resampler */
+#define HALFBAND_STAGES_MAX 2
+#define HALFBAND_FACTOR_MAX 3
+
+/* One stage of the integer ratio resampler. When upsampling, buf holds
+ * the input history of every channel. When downsampling, it holds one
+ * history per channel and input phase, i.e. every factor-th frame. */
+typedef struct pa_halfband_stage {
+    pa_sinc_table *table;
+    unsigned factor;
+    bool up;
+
+    float *buf;
+    unsigned buf_frames, n_frames;
+
+    /* Input frames already stored of the next group, when downsampling */
+    unsigned fill;
+} pa_halfband_stage;
+
 struct pa_resampler {
     pa_resample_method_t method;
     pa_resample_flags_t flags;
@@ -78,6 +114,16 @@ struct pa_resampler {
     void (*impl_update_rates)(pa_resampler *r);
     void (*impl_resample)(pa_resampler *r, const pa_memchunk *in, unsigned in_samples, pa_memchunk *out, unsigned *out_samples);
     void (*impl_reset)(pa_resampler *r);
+    void (*impl_save)(pa_resampler *r, void *state);
+    void (*impl_restore)(pa_resampler *r, const void *state);
+    size_t impl_state_size;
+
+    struct { /* checkpoints for restoring the state on rewinds */
+        uint64_t position;
+        size_t max_frames;
+        pa_resampler_checkpoint *checkpoints;
+        unsigned idx, n;
+    } history;
 
     struct { /* data specific to the trivial resampler */
         unsigned o_counter;
@@ -102,6 +148,12 @@ struct pa_resampler {
 #ifdef HAVE_SPEEX
     struct { /* data specific to speex */
         SpeexResamplerState* state;
+
+        /* Frames passed in since the last reset, and the tail of
+         * them that is needed to re-prime the filter on rewinds */
+        uint64_t n_frames;
+        uint8_t *prime;
+        unsigned prime_frames, filt_frames, period;
     } speex;
 #endif
 
@@ -109,6 +161,34 @@ struct pa_resampler {
         struct AVResampleContext *state;
         pa_memchunk buf[PA_CHANNELS_MAX];
     } ffmpeg;
+
+    struct { /* data specific to the native sinc resampler */
+        pa_sinc_table *table;
+        pa_sinc_dot_func_t dot;
+        pa_sinc_dot_interp_func_t dot_interp;
+
+        /* Deinterleaved input history, buf_frames per channel */
+        float *buf;
+        unsigned buf_frames, n_frames;
+
+        /* Input frames to drop before the next filter window starts */
+        unsigned skip;
+
+        /* Position of the next output frame between two input frames
+         * is frac/den, each output frame advances it by in/out */
+        uint32_t frac, den;
+        uint32_t int_adv, frac_adv;
+    } sinc;
+
+    struct { /* data specific to the integer ratio resampler */
+        pa_halfband_stage stages[HALFBAND_STAGES_MAX];
+        unsigned n_stages;
+        pa_sinc_dot_func_t dot;
+
+        /* Deinterleaved data passed between the stages */
+        float *planar;
+        unsigned planar_frames;
+    } halfband;
 };
 
 static int copy_init(pa_resampler *r);
@@ -117,12 +197,17 @@ static int trivial_init(pa_resampler*r);
 static int speex_init(pa_resampler*r);
 #endif
 static int ffmpeg_init(pa_resampler*r);
+static int sinc_init(pa_resampler*r);
+static int halfband_init(pa_resampler*r);
+static unsigned halfband_factor(uint32_t a, uint32_t b);
 static int peaks_init(pa_resampler*r);
 #ifdef HAVE_LIBSAMPLERATE
 static int libsamplerate_init(pa_resampler*r);
 #endif
 
 static void calc_map_table(pa_resampler *r);
+static void history_clear(pa_resampler *r);
+static void history_push(pa_resampler *r, const pa_memchunk *in);
 
 static int (* const init_table[])(pa_resampler*r) = {
 #ifdef HAVE_LIBSAMPLERATE
@@ -187,6 +272,14 @@ static int (* const init_table[])(pa_resampler*r) = {
     [PA_RESAMPLER_SPEEX_FIXED_BASE+10]     = NULL,
 #endif
     [PA_RESAMPLER_FFMPEG]                  = ffmpeg_init,
+    [PA_RESAMPLER_SINC_BASE+0]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+1]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+2]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+3]             = sinc_init,
+    [PA_RESAMPLER_HALFBAND_BASE+0]         = halfband_init,
+    [PA_RESAMPLER_HALFBAND_BASE+1]         = halfband_init,
+    [PA_RESAMPLER_HALFBAND_BASE+2]         = halfband_init,
+    [PA_RESAMPLER_HALFBAND_BASE+3]         = halfband_init,
     [PA_RESAMPLER_AUTO]                    = NULL,
     [PA_RESAMPLER_COPY]                    = copy_init,
     [PA_RESAMPLER_PEAKS]                   = peaks_init,
@@ -233,14 +326,21 @@ pa_resampler* pa_resampler_new(
         method = PA_RESAMPLER_AUTO;
     }
 
+    if (method >= PA_RESAMPLER_HALFBAND_BASE && method <= PA_RESAMPLER_HALFBAND_MAX &&
+        ((flags & PA_RESAMPLER_VARIABLE_RATE) || !halfband_factor(a->rate, b->rate))) {
+        pa_log_info("Resampler '%s' can only do fixed 2x, 3x and 4x conversions, reverting to resampler 'auto'.", pa_resample_method_to_string(method));
+        method = PA_RESAMPLER_AUTO;
+    }
+
+    /* Integer ratios are cheaper to do with dedicated filters */
+    if (method == PA_RESAMPLER_AUTO && !(flags & PA_RESAMPLER_VARIABLE_RATE) && halfband_factor(a->rate, b->rate))
+        method = PA_RESAMPLER_HALFBAND_BASE + 1;
+
     if (method == PA_RESAMPLER_AUTO) {
 #ifdef HAVE_SPEEX
         method = PA_RESAMPLER_SPEEX_FLOAT_BASE + 1;
 #else
-        if (flags & PA_RESAMPLER_VARIABLE_RATE)
-            method = PA_RESAMPLER_TRIVIAL;
-        else
-            method = PA_RESAMPLER_FFMPEG;
+        method = PA_RESAMPLER_SINC_BASE + 1;
 #endif
     }
 
@@ -343,6 +443,8 @@ fail:
 void pa_resampler_free(pa_resampler *r) {
     pa_assert(r);
 
+    pa_resampler_set_max_rewind(r, 0);
+
     if (r->impl_free)
         r->impl_free(r);
 
@@ -367,6 +469,7 @@ void pa_resampler_set_input_rate(pa_resampler *r, uint32_t rate) {
 
     r->i_ss.rate = rate;
 
+    history_clear(r);
     r->impl_update_rates(r);
 }
 
@@ -379,6 +482,7 @@ void pa_resampler_set_output_rate(pa_resampler *r, uint32_t rate) {
 
     r->o_ss.rate = rate;
 
+    history_clear(r);
     r->impl_update_rates(r);
 }
 
@@ -449,6 +553,8 @@ void pa_resampler_reset(pa_resampler *r) {
         r->impl_reset(r);
 
     r->remap_buf_contains_leftover_data = false;
+
+    history_clear(r);
 }
 
 pa_resample_method_t pa_resampler_get_method(pa_resampler *r) {
@@ -511,6 +617,14 @@ static const char * const resample_methods[] = {
     "speex-fixed-9",
     "speex-fixed-10",
     "ffmpeg",
+    "sinc-0",
+    "sinc-1",
+    "sinc-2",
+    "sinc-3",
+    "halfband-0",
+    "halfband-1",
+    "halfband-2",
+    "halfband-3",
     "auto",
     "copy",
     "peaks"
@@ -559,6 +673,12 @@ pa_resample_method_t pa_parse_resample_method(const char *string) {
     if (pa_streq(string, "speex-float"))
         return PA_RESAMPLER_SPEEX_FLOAT_BASE + 1;
 
+    if (pa_streq(string, "sinc"))
+        return PA_RESAMPLER_SINC_BASE + 1;
+
+    if (pa_streq(string, "halfband"))
+        return PA_RESAMPLER_HALFBAND_BASE + 1;
+
     return PA_RESAMPLER_INVALID;
 }
 
@@ -1208,6 +1328,11 @@ void pa_resampler_run(pa_resampler *r, const pa_memchunk *in, pa_memchunk *out)
     pa_assert(in->memblock);
     pa_assert(in->length % r->i_fz == 0);
 
+    if (r->history.max_frames > 0)
+        history_push(r, in);
+
+    r->history.position += in->length / r->i_fz;
+
     buf = (pa_memchunk*) in;
     buf = convert_to_work_format(r, buf);
     buf = remap_channels(r, buf);
@@ -1251,6 +1376,186 @@ static void save_leftover(pa_resampler *r, void *buf, size_t len) {
     r->remap_buf_contains_leftover_data = true;
 }
 
+/*** Rewind history ***/
+
+static pa_resampler_checkpoint *history_get(pa_resampler *r, unsigned i) {
+    pa_assert(i < r->history.n);
+
+    return r->history.checkpoints + ((r->history.idx + i) % CHECKPOINTS_MAX);
+}
+
+static void checkpoint_drop(pa_resampler_checkpoint *c) {
+    if (c->input.memblock)
+        pa_memblock_unref(c->input.memblock);
+
+    pa_memchunk_reset(&c->input);
+}
+
+static void history_clear(pa_resampler *r) {
+    while (r->history.n > 0) {
+        checkpoint_drop(history_get(r, 0));
+        r->history.idx = (r->history.idx + 1) % CHECKPOINTS_MAX;
+        r->history.n--;
+    }
+}
+
+/* Drop checkpoints that are no longer needed to rewind by max_frames
+ * from the specified position */
+static void history_trim(pa_resampler *r, uint64_t position) {
+    while (r->history.n > 1 &&
+           history_get(r, 1)->position + r->history.max_frames <= position) {
+        checkpoint_drop(history_get(r, 0));
+        r->history.idx = (r->history.idx + 1) % CHECKPOINTS_MAX;
+        r->history.n--;
+    }
+}
+
+static void history_push(pa_resampler *r, const pa_memchunk *in) {
+    pa_resampler_checkpoint *c;
+
+    if (!r->impl_save)
+        return;
+
+    if (r->history.n >= CHECKPOINTS_MAX) {
+        checkpoint_drop(history_get(r, 0));
+        r->history.idx = (r->history.idx + 1) % CHECKPOINTS_MAX;
+        r->history.n--;
+    }
+
+    r->history.n++;
+    c = history_get(r, r->history.n - 1);
+
+    c->position = r->history.position;
+    c->input = *in;
+    pa_memblock_ref(c->input.memblock);
+
+    if (!c->state)
+        c->state = pa_xmalloc(r->impl_state_size);
+
+    r->impl_save(r, c->state);
+
+    c->leftover_length = 0;
+
+    if (r->remap_buf_contains_leftover_data) {
+        void *src;
+
+        c->leftover_length = r->remap_buf.length;
+
+        if (c->leftover_size < c->leftover_length) {
+            pa_xfree(c->leftover);
+            c->leftover_size = c->leftover_length;
+            c->leftover = pa_xmalloc(c->leftover_size);
+        }
+
+        src = pa_memblock_acquire(r->remap_buf.memblock);
+        memcpy(c->leftover, src, c->leftover_length);
+        pa_memblock_release(r->remap_buf.memblock);
+    }
+
+    /* We just need to cover max_frames before the end of this block */
+    history_trim(r, r->history.position + in->length / r->i_fz);
+}
+
+void pa_resampler_set_max_rewind(pa_resampler *r, size_t in_bytes) {
+    unsigned i;
+
+    pa_assert(r);
+
+    r->history.max_frames = in_bytes / r->i_fz;
+
+    if (r->history.max_frames > 0) {
+        if (!r->history.checkpoints)
+            r->history.checkpoints = pa_xnew0(pa_resampler_checkpoint, CHECKPOINTS_MAX);
+
+        history_trim(r, r->history.position);
+        return;
+    }
+
+    if (!r->history.checkpoints)
+        return;
+
+    history_clear(r);
+
+    for (i = 0; i < CHECKPOINTS_MAX; i++) {
+        pa_xfree(r->history.checkpoints[i].state);
+        pa_xfree(r->history.checkpoints[i].leftover);
+    }
+
+    pa_xfree(r->history.checkpoints);
+    r->history.checkpoints = NULL;
+}
+
+bool pa_resampler_rewind(pa_resampler *r, size_t in_bytes) {
+    pa_resampler_checkpoint *c = NULL;
+    uint64_t target, frames;
+    pa_memchunk replay;
+
+    pa_assert(r);
+
+    frames = in_bytes / r->i_fz;
+
+    if (frames <= 0)
+        return true;
+
+    if (frames > r->history.position)
+        goto fail;
+
+    target = r->history.position - frames;
+
+    /* Find the last checkpoint at or before the rewind target */
+    while (r->history.n > 0) {
+        c = history_get(r, r->history.n - 1);
+
+        if (c->position <= target)
+            break;
+
+        checkpoint_drop(c);
+        r->history.n--;
+        c = NULL;
+    }
+
+    if (!c)
+        goto fail;
+
+    pa_assert(target < c->position + c->input.length / r->i_fz);
+
+    r->impl_restore(r, c->state);
+
+    r->remap_buf_contains_leftover_data = false;
+    if (c->leftover_length > 0)
+        save_leftover(r, c->leftover, c->leftover_length);
+
+    /* Now feed the part of the block up to the rewind target, and
+     * throw away the output, which has already been played. */
+    replay = c->input;
+    replay.length = (size_t) (target - c->position) * r->i_fz;
+
+    if (replay.length > 0) {
+        pa_memchunk *buf;
+
+        buf = convert_to_work_format(r, &replay);
+        buf = remap_channels(r, buf);
+        resample(r, buf);
+
+        /* Whatever follows the target is going to be rendered anew */
+        c->input.length = replay.length;
+    } else {
+        checkpoint_drop(c);
+        r->history.n--;
+    }
+
+    r->history.position = target;
+
+    return true;
+
+fail:
+    pa_log_debug("Cannot restore resampler state, resetting.");
+    pa_resampler_reset(r);
+    r->history.position = 0;
+
+    return false;
+}
+
 /*** libsamplerate based implementation ***/
 
 #ifdef HAVE_LIBSAMPLERATE
@@ -1327,6 +1632,37 @@ static int libsamplerate_init(pa_resampler *r) {
 #ifdef HAVE_SPEEX
 /*** speex based implementation ***/
 
+/* Upper bound of the input tail we keep per checkpoint */
+#define SPEEX_PRIME_FRAMES_MAX 4096
+
+/* The speex state is opaque, so we cannot snapshot it. However, after
+ * a reset it only depends on the last filter length worth of input and
+ * on the filter phase, which repeats every 'period' input frames. So we
+ * keep enough of the input tail to reset and replay into the same
+ * state. */
+typedef struct speex_state {
+    uint64_t n_frames;
+} speex_state;
+
+static void speex_keep_input(pa_resampler *r, const void *src, unsigned n_frames) {
+    size_t fz = r->w_sz * r->o_ss.channels;
+    unsigned keep;
+
+    r->speex.n_frames += n_frames;
+
+    if (!r->impl_save)
+        return;
+
+    if (n_frames >= r->speex.prime_frames) {
+        memcpy(r->speex.prime, (const uint8_t*) src + (n_frames - r->speex.prime_frames) * fz, r->speex.prime_frames * fz);
+        return;
+    }
+
+    keep = r->speex.prime_frames - n_frames;
+    memmove(r->speex.prime, r->speex.prime + n_frames * fz, keep * fz);
+    memcpy(r->speex.prime + keep * fz, src, n_frames * fz);
+}
+
 static void speex_resample_float(pa_resampler *r, const pa_memchunk *input, unsigned in_n_frames, pa_memchunk *output, unsigned *out_n_frames) {
     float *in, *out;
     uint32_t inf = in_n_frames, outf = *out_n_frames;
@@ -1340,6 +1676,7 @@ static void speex_resample_float(pa_resampler *r, const pa_memchunk *input, unsi
     out = pa_memblock_acquire_chunk(output);
 
     pa_assert_se(speex_resampler_process_interleaved_float(r->speex.state, in, &inf, out, &outf) == 0);
+    speex_keep_input(r, in, in_n_frames);
 
     pa_memblock_release(input->memblock);
     pa_memblock_release(output->memblock);
@@ -1361,6 +1698,7 @@ static void speex_resample_int(pa_resampler *r, const pa_memchunk *input, unsign
     out = pa_memblock_acquire_chunk(output);
 
     pa_assert_se(speex_resampler_process_interleaved_int(r->speex.state, in, &inf, out, &outf) == 0);
+    speex_keep_input(r, in, in_n_frames);
 
     pa_memblock_release(input->memblock);
     pa_memblock_release(output->memblock);
@@ -1373,12 +1711,65 @@ static void speex_update_rates(pa_resampler *r) {
     pa_assert(r);
 
     pa_assert_se(speex_resampler_set_rate(r->speex.state, r->i_ss.rate, r->o_ss.rate) == 0);
+
+    /* speex rescales the phase and may change the filter length, the
+     * state can no longer be derived from the input alone */
+    r->impl_save = NULL;
 }
 
 static void speex_reset(pa_resampler *r) {
     pa_assert(r);
 
     pa_assert_se(speex_resampler_reset_mem(r->speex.state) == 0);
+    r->speex.n_frames = 0;
+}
+
+static void speex_save(pa_resampler *r, void *state) {
+    speex_state *s = state;
+
+    pa_assert(r);
+
+    s->n_frames = r->speex.n_frames;
+    memcpy((uint8_t*) state + PA_ALIGN(sizeof(speex_state)), r->speex.prime, r->speex.prime_frames * r->w_sz * r->o_ss.channels);
+}
+
+static void speex_restore(pa_resampler *r, const void *state) {
+    const speex_state *s = state;
+    const uint8_t *prime = (const uint8_t*) state + PA_ALIGN(sizeof(speex_state));
+    size_t fz = r->w_sz * r->o_ss.channels;
+    uint32_t inf, outf;
+    void *out;
+
+    pa_assert(r);
+
+    pa_assert_se(speex_resampler_reset_mem(r->speex.state) == 0);
+
+    /* Replay at least a filter length, ending in the same phase */
+    if (s->n_frames <= r->speex.prime_frames)
+        inf = (uint32_t) s->n_frames;
+    else
+        inf = r->speex.filt_frames + (uint32_t) ((s->n_frames - r->speex.filt_frames) % r->speex.period);
+
+    pa_assert(inf <= r->speex.prime_frames);
+
+    if (inf > 0) {
+        const uint8_t *in = prime + (r->speex.prime_frames - inf) * fz;
+        uint32_t n = inf;
+
+        outf = (uint32_t) (((uint64_t) inf * r->o_ss.rate + r->i_ss.rate - 1) / r->i_ss.rate) + 1;
+        out = pa_xmalloc(outf * fz);
+
+        if (r->work_format == PA_SAMPLE_S16NE)
+            pa_assert_se(speex_resampler_process_interleaved_int(r->speex.state, (const spx_int16_t*) in, &n, out, &outf) == 0);
+        else
+            pa_assert_se(speex_resampler_process_interleaved_float(r->speex.state, (const float*) in, &n, out, &outf) == 0);
+
+        pa_assert(n == inf);
+        pa_xfree(out);
+    }
+
+    r->speex.n_frames = s->n_frames;
+    memcpy(r->speex.prime, prime, r->speex.prime_frames * fz);
 }
 
 static void speex_free(pa_resampler *r) {
@@ -1388,6 +1779,7 @@ static void speex_free(pa_resampler *r) {
         return;
 
     speex_resampler_destroy(r->speex.state);
+    pa_xfree(r->speex.prime);
 }
 
 static int speex_init(pa_resampler *r) {
@@ -1416,6 +1808,19 @@ static int speex_init(pa_resampler *r) {
     if (!(r->speex.state = speex_resampler_init(r->o_ss.channels, r->i_ss.rate, r->o_ss.rate, q, &err)))
         return -1;
 
+    r->speex.filt_frames = 2 * (unsigned) speex_resampler_get_input_latency(r->speex.state) + 1;
+    r->speex.period = r->i_ss.rate / pa_gcd(r->i_ss.rate, r->o_ss.rate);
+    r->speex.prime_frames = r->speex.filt_frames + r->speex.period;
+
+    if (r->speex.prime_frames <= SPEEX_PRIME_FRAMES_MAX) {
+        r->speex.prime = pa_xmalloc0(r->speex.prime_frames * r->w_sz * r->o_ss.channels);
+
+        r->impl_save = speex_save;
+        r->impl_restore = speex_restore;
+        r->impl_state_size = PA_ALIGN(sizeof(speex_state)) + r->speex.prime_frames * r->w_sz * r->o_ss.channels;
+    } else
+        pa_log_debug("Speex filter too long to be restored on rewinds.");
+
     return 0;
 }
 #endif
@@ -1472,6 +1877,18 @@ static void trivial_update_rates_or_reset(pa_resampler *r) {
     r->trivial.o_counter = 0;
 }
 
+static void trivial_save(pa_resampler *r, void *state) {
+    pa_assert(r);
+
+    memcpy(state, &r->trivial, sizeof(r->trivial));
+}
+
+static void trivial_restore(pa_resampler *r, const void *state) {
+    pa_assert(r);
+
+    memcpy(&r->trivial, state, sizeof(r->trivial));
+}
+
 static int trivial_init(pa_resampler*r) {
     pa_assert(r);
 
@@ -1480,6 +1897,9 @@ static int trivial_init(pa_resampler*r) {
     r->impl_resample = trivial_resample;
     r->impl_update_rates = trivial_update_rates_or_reset;
     r->impl_reset = trivial_update_rates_or_reset;
+    r->impl_save = trivial_save;
+    r->impl_restore = trivial_restore;
+    r->impl_state_size = sizeof(r->trivial);
 
     return 0;
 }
@@ -1589,6 +2009,18 @@ static void peaks_update_rates_or_reset(pa_resampler *r) {
     r->peaks.o_counter = 0;
 }
 
+static void peaks_save(pa_resampler *r, void *state) {
+    pa_assert(r);
+
+    memcpy(state, &r->peaks, sizeof(r->peaks));
+}
+
+static void peaks_restore(pa_resampler *r, const void *state) {
+    pa_assert(r);
+
+    memcpy(&r->peaks, state, sizeof(r->peaks));
+}
+
 static int peaks_init(pa_resampler*r) {
     pa_assert(r);
     pa_assert(r->i_ss.rate >= r->o_ss.rate);
@@ -1601,6 +2033,9 @@ static int peaks_init(pa_resampler*r) {
     r->impl_resample = peaks_resample;
     r->impl_update_rates = peaks_update_rates_or_reset;
     r->impl_reset = peaks_update_rates_or_reset;
+    r->impl_save = peaks_save;
+    r->impl_restore = peaks_restore;
+    r->impl_state_size = sizeof(r->peaks);
 
     return 0;
 }
@@ -1690,6 +2125,18 @@ static void ffmpeg_free(pa_resampler *r) {
             pa_memblock_unref(r->ffmpeg.buf[c].memblock);
 }
 
+static void ffmpeg_save(pa_resampler *r, void *state) {
+    pa_assert(r);
+
+    av_resample_save_state(r->ffmpeg.state, state);
+}
+
+static void ffmpeg_restore(pa_resampler *r, const void *state) {
+    pa_assert(r);
+
+    av_resample_restore_state(r->ffmpeg.state, state);
+}
+
 static int ffmpeg_init(pa_resampler *r) {
     unsigned c;
 
@@ -1705,6 +2152,9 @@ static int ffmpeg_init(pa_resampler *r) {
 
     r->impl_free = ffmpeg_free;
     r->impl_resample = ffmpeg_resample;
+    r->impl_save = ffmpeg_save;
+    r->impl_restore = ffmpeg_restore;
+    r->impl_state_size = (size_t) av_resample_state_size();
 
     for (c = 0; c < PA_ELEMENTSOF(r->ffmpeg.buf); c++)
         pa_memchunk_reset(&r->ffmpeg.buf[c]);
@@ -1712,6 +2162,544 @@ static int ffmpeg_init(pa_resampler *r) {
     return 0;
 }
 
+/*** native polyphase sinc implementation ***/
+
+typedef struct sinc_state {
+    uint32_t frac;
+    unsigned n_frames, skip;
+} sinc_state;
+
+static void sinc_resample(pa_resampler *r, const pa_memchunk *input, unsigned in_n_frames, pa_memchunk *output, unsigned *out_n_frames) {
+    const pa_sinc_table *t;
+    unsigned c, channels, n_taps, idx, o_index;
+    float *src, *dst;
+
+    pa_assert(r);
+    pa_assert(input);
+    pa_assert(output);
+    pa_assert(out_n_frames);
+
+    t = r->sinc.table;
+    n_taps = t->n_taps;
+    channels = r->o_ss.channels;
+
+    src = pa_memblock_acquire_chunk(input);
+    dst = pa_memblock_acquire_chunk(output);
+
+    /* When downsampling the window may have moved past the input we
+     * got so far */
+    if (r->sinc.skip > 0) {
+        unsigned n = PA_MIN(r->sinc.skip, in_n_frames);
+
+        src += n * channels;
+        in_n_frames -= n;
+        r->sinc.skip -= n;
+    }
+
+    if (r->sinc.n_frames + in_n_frames > r->sinc.buf_frames) {
+        float *buf;
+
+        buf = pa_xnew(float, (r->sinc.n_frames + in_n_frames) * channels);
+
+        for (c = 0; c < channels; c++)
+            memcpy(buf + c * (r->sinc.n_frames + in_n_frames), r->sinc.buf + c * r->sinc.buf_frames, r->sinc.n_frames * sizeof(float));
+
+        pa_xfree(r->sinc.buf);
+        r->sinc.buf = buf;
+        r->sinc.buf_frames = r->sinc.n_frames + in_n_frames;
+    }
+
+    for (c = 0; c < channels; c++) {
+        float *d = r->sinc.buf + c * r->sinc.buf_frames + r->sinc.n_frames;
+        const float *s = src + c;
+        unsigned i;
+
+        for (i = 0; i < in_n_frames; i++, s += channels)
+            d[i] = *s;
+    }
+
+    r->sinc.n_frames += in_n_frames;
+
+    for (idx = 0, o_index = 0; idx + n_taps <= r->sinc.n_frames; o_index++) {
+        const float *x = r->sinc.buf + idx;
+
+        pa_assert_fp((o_index + 1) * channels * sizeof(float) <= output->length);
+
+        if (t->n_phases % r->sinc.den == 0) {
+            const float *h = pa_sinc_table_phase(t, r->sinc.frac * (t->n_phases / r->sinc.den));
+
+            for (c = 0; c < channels; c++, x += r->sinc.buf_frames)
+                *(dst++) = r->sinc.dot(x, h, n_taps);
+
+        } else {
+            /* The rate was changed since the table was built, we
+             * need to interpolate between neighbouring phases */
+            uint64_t pos = (uint64_t) r->sinc.frac * t->n_phases;
+            unsigned phase = (unsigned) (pos / r->sinc.den);
+            float w = (float) (pos % r->sinc.den) / (float) r->sinc.den;
+            const float *h0 = pa_sinc_table_phase(t, phase), *h1 = pa_sinc_table_phase(t, phase + 1);
+
+            for (c = 0; c < channels; c++, x += r->sinc.buf_frames)
+                *(dst++) = r->sinc.dot_interp(x, h0, h1, w, n_taps);
+        }
+
+        idx += r->sinc.int_adv;
+        r->sinc.frac += r->sinc.frac_adv;
+
+        if (r->sinc.frac >= r->sinc.den) {
+            r->sinc.frac -= r->sinc.den;
+            idx++;
+        }
+    }
+
+    pa_memblock_release(input->memblock);
+    pa_memblock_release(output->memblock);
+
+    *out_n_frames = o_index;
+
+    /* Keep what the next filter window still needs */
+    if (idx >= r->sinc.n_frames) {
+        r->sinc.skip += idx - r->sinc.n_frames;
+        r->sinc.n_frames = 0;
+    } else if (idx > 0) {
+        r->sinc.n_frames -= idx;
+
+        for (c = 0; c < channels; c++)
+            memmove(r->sinc.buf + c * r->sinc.buf_frames, r->sinc.buf + c * r->sinc.buf_frames + idx, r->sinc.n_frames * sizeof(float));
+    }
+}
+
+static void sinc_update_rates(pa_resampler *r) {
+    uint32_t g, den;
+
+    pa_assert(r);
+
+    /* The table is kept, only the step through it changes. Phases
+     * that don't hit the table exactly anymore are interpolated. */
+    g = pa_gcd(r->i_ss.rate, r->o_ss.rate);
+    den = r->o_ss.rate / g;
+
+    r->sinc.frac = (uint32_t) (((uint64_t) r->sinc.frac * den) / r->sinc.den);
+    r->sinc.den = den;
+    r->sinc.int_adv = (r->i_ss.rate / g) / den;
+    r->sinc.frac_adv = (r->i_ss.rate / g) % den;
+}
+
+static void sinc_reset(pa_resampler *r) {
+    pa_assert(r);
+
+    /* Center the first filter window on the first input frame */
+    r->sinc.n_frames = r->sinc.table->n_taps / 2 - 1;
+    memset(r->sinc.buf, 0, r->sinc.buf_frames * r->o_ss.channels * sizeof(float));
+
+    r->sinc.skip = 0;
+    r->sinc.frac = 0;
+}
+
+static void sinc_save(pa_resampler *r, void *state) {
+    sinc_state *s = state;
+    float *d = (float*) ((uint8_t*) state + PA_ALIGN(sizeof(sinc_state)));
+    unsigned c;
+
+    pa_assert(r);
+    pa_assert(r->sinc.n_frames < r->sinc.table->n_taps);
+
+    s->frac = r->sinc.frac;
+    s->n_frames = r->sinc.n_frames;
+    s->skip = r->sinc.skip;
+
+    for (c = 0; c < r->o_ss.channels; c++)
+        memcpy(d + c * r->sinc.table->n_taps, r->sinc.buf + c * r->sinc.buf_frames, r->sinc.n_frames * sizeof(float));
+}
+
+static void sinc_restore(pa_resampler *r, const void *state) {
+    const sinc_state *s = state;
+    const float *d = (const float*) ((const uint8_t*) state + PA_ALIGN(sizeof(sinc_state)));
+    unsigned c;
+
+    pa_assert(r);
+
+    r->sinc.frac = s->frac;
+    r->sinc.n_frames = s->n_frames;
+    r->sinc.skip = s->skip;
+
+    for (c = 0; c < r->o_ss.channels; c++)
+        memcpy(r->sinc.buf + c * r->sinc.buf_frames, d + c * r->sinc.table->n_taps, r->sinc.n_frames * sizeof(float));
+}
+
+static void sinc_free(pa_resampler *r) {
+    pa_assert(r);
+
+    if (r->sinc.table)
+        pa_sinc_table_unref(r->sinc.table);
+
+    pa_xfree(r->sinc.buf);
+}
+
+static int sinc_init(pa_resampler *r) {
+    unsigned q;
+
+    pa_assert(r);
+    pa_assert(r->method >= PA_RESAMPLER_SINC_BASE && r->method <= PA_RESAMPLER_SINC_MAX);
+
+    q = r->method - PA_RESAMPLER_SINC_BASE;
+
+    pa_log_info("Choosing sinc quality setting %u.", q);
+
+    r->sinc.table = pa_sinc_table_get(r->i_ss.rate, r->o_ss.rate, q);
+    r->sinc.dot = pa_get_sinc_dot_func();
+    r->sinc.dot_interp = pa_get_sinc_dot_interp_func();
+
+    r->sinc.buf_frames = r->sinc.table->n_taps;
+    r->sinc.buf = pa_xnew(float, r->sinc.buf_frames * r->o_ss.channels);
+
+    r->sinc.den = 1;
+    sinc_update_rates(r);
+    sinc_reset(r);
+
+    r->impl_free = sinc_free;
+    r->impl_resample = sinc_resample;
+    r->impl_update_rates = sinc_update_rates;
+    r->impl_reset = sinc_reset;
+    r->impl_save = sinc_save;
+    r->impl_restore = sinc_restore;
+    r->impl_state_size = PA_ALIGN(sizeof(sinc_state)) + r->sinc.table->n_taps * r->o_ss.channels * sizeof(float);
+
+    return 0;
+}
+
+/*** integer ratio implementation ***/
+
+typedef struct halfband_state {
+    unsigned n_frames, fill;
+} halfband_state;
+
+/* Returns the factor between the two rates if the integer ratio
+ * resampler can handle it, 0 otherwise */
+static unsigned halfband_factor(uint32_t a, uint32_t b) {
+    uint32_t lo = PA_MIN(a, b), hi = PA_MAX(a, b);
+
+    if (hi % lo != 0)
+        return 0;
+
+    if (hi / lo < 2 || hi / lo > 4)
+        return 0;
+
+    return hi / lo;
+}
+
+static unsigned halfband_streams(pa_resampler *r, pa_halfband_stage *s) {
+    return r->o_ss.channels * (s->up ? 1 : s->factor);
+}
+
+static float *halfband_stream(pa_halfband_stage *s, unsigned c, unsigned q) {
+    return s->buf + (c * (s->up ? 1 : s->factor) + q) * s->buf_frames;
+}
+
+static void halfband_stage_reserve(pa_resampler *r, pa_halfband_stage *s, unsigned frames) {
+    unsigned i, n;
+    float *buf;
+
+    if (frames <= s->buf_frames)
+        return;
+
+    n = halfband_streams(r, s);
+    buf = pa_xnew(float, n * frames);
+
+    /* When downsampling, the slot after the last complete group may
+     * hold the beginning of the next one */
+    for (i = 0; i < n; i++)
+        memcpy(buf + i * frames, s->buf + i * s->buf_frames, PA_MIN(s->n_frames + 1, s->buf_frames) * sizeof(float));
+
+    pa_xfree(s->buf);
+    s->buf = buf;
+    s->buf_frames = frames;
+}
+
+/* Runs one stage on n_in frames. Sample k of channel c is read from
+ * in[c * in_cs + k * in_fs] and written to out[c * out_cs + k * out_fs],
+ * so that the first and last stage can work on the interleaved data
+ * directly. */
+static unsigned halfband_stage_run(pa_resampler *r, pa_halfband_stage *s,
+                                   const float *in, unsigned in_cs, unsigned in_fs, unsigned n_in,
+                                   float *out, unsigned out_cs, unsigned out_fs) {
+    unsigned c, q, i = 0, k, n_taps, n_frames, fill;
+    const float *h[HALFBAND_FACTOR_MAX];
+
+    n_taps = s->table->n_taps;
+
+    for (q = 1; q < s->factor; q++)
+        h[q] = pa_sinc_table_phase(s->table, q);
+
+    if (s->up) {
+        halfband_stage_reserve(r, s, s->n_frames + n_in);
+
+        for (c = 0; c < r->o_ss.channels; c++) {
+            const float *src = in + c * in_cs;
+            float *x = halfband_stream(s, c, 0);
+            float *d = out + c * out_cs;
+
+            for (k = 0; k < n_in; k++)
+                x[s->n_frames + k] = src[k * in_fs];
+
+            for (i = 0; i + n_taps <= s->n_frames + n_in; i++, x++) {
+                /* Phase 0 of a Nyquist filter is a pure delay */
+                *d = x[n_taps / 2 - 1];
+                d += out_fs;
+
+                for (q = 1; q < s->factor; q++) {
+                    *d = r->halfband.dot(x, h[q], n_taps);
+                    d += out_fs;
+                }
+            }
+        }
+
+        s->n_frames += n_in;
+
+    } else {
+        float center;
+
+        halfband_stage_reserve(r, s, s->n_frames + n_in / s->factor + 2);
+
+        n_frames = s->n_frames;
+        fill = s->fill;
+
+        for (c = 0; c < r->o_ss.channels; c++) {
+            const float *src = in + c * in_cs;
+            float *x[HALFBAND_FACTOR_MAX];
+
+            for (q = 0; q < s->factor; q++)
+                x[q] = halfband_stream(s, c, q);
+
+            n_frames = s->n_frames;
+            fill = s->fill;
+            k = 0;
+
+            /* Complete the group started in the last run first */
+            for (; fill > 0 && k < n_in; k++, src += in_fs)
+                if (++fill >= s->factor) {
+                    x[fill - 1][n_frames++] = *src;
+                    fill = 0;
+                } else
+                    x[fill - 1][n_frames] = *src;
+
+            for (; k + s->factor <= n_in; k += s->factor, n_frames++)
+                for (q = 0; q < s->factor; q++, src += in_fs)
+                    x[q][n_frames] = *src;
+
+            for (; k < n_in; k++, src += in_fs)
+                x[fill++][n_frames] = *src;
+        }
+
+        s->n_frames = n_frames;
+        s->fill = fill;
+
+        center = pa_sinc_table_phase(s->table, 0)[n_taps / 2];
+
+        for (c = 0; c < r->o_ss.channels; c++) {
+            const float *x[HALFBAND_FACTOR_MAX];
+            float *d = out + c * out_cs;
+
+            for (q = 0; q < s->factor; q++)
+                x[q] = halfband_stream(s, c, q);
+
+            for (i = 0; i + n_taps <= s->n_frames; i++, d += out_fs) {
+                float y = center * x[0][i + n_taps / 2];
+
+                for (q = 1; q < s->factor; q++)
+                    y += r->halfband.dot(x[q] + i, h[q], n_taps);
+
+                *d = y;
+            }
+        }
+    }
+
+    /* Drop the history the next filter window doesn't need anymore */
+    if (i > 0) {
+        unsigned n = halfband_streams(r, s);
+
+        s->n_frames -= i;
+
+        for (k = 0; k < n; k++) {
+            float *x = s->buf + k * s->buf_frames;
+
+            memmove(x, x + i, (s->up ? s->n_frames : s->n_frames + 1) * sizeof(float));
+        }
+    }
+
+    return s->up ? i * s->factor : i;
+}
+
+static void halfband_resample(pa_resampler *r, const pa_memchunk *input, unsigned in_n_frames, pa_memchunk *output, unsigned *out_n_frames) {
+    pa_halfband_stage *s;
+    unsigned channels, n;
+    float *src, *dst;
+
+    pa_assert(r);
+    pa_assert(input);
+    pa_assert(output);
+    pa_assert(out_n_frames);
+
+    channels = r->o_ss.channels;
+    s = &r->halfband.stages[0];
+
+    src = pa_memblock_acquire_chunk(input);
+    dst = pa_memblock_acquire_chunk(output);
+
+    if (r->halfband.n_stages == 1)
+        n = halfband_stage_run(r, s, src, 1, channels, in_n_frames, dst, 1, channels);
+    else {
+        unsigned need;
+
+        /* The intermediate result needs to take what the first stage
+         * had buffered from earlier runs, too */
+        if (s->up)
+            need = (in_n_frames + s->table->n_taps) * s->factor;
+        else
+            need = in_n_frames / s->factor + 1;
+
+        if (need > r->halfband.planar_frames) {
+            pa_xfree(r->halfband.planar);
+            r->halfband.planar = pa_xnew(float, need * channels);
+            r->halfband.planar_frames = need;
+        }
+
+        n = halfband_stage_run(r, s, src, 1, channels, in_n_frames, r->halfband.planar, r->halfband.planar_frames, 1);
+        n = halfband_stage_run(r, s + 1, r->halfband.planar, r->halfband.planar_frames, 1, n, dst, 1, channels);
+    }
+
+    pa_memblock_release(input->memblock);
+    pa_memblock_release(output->memblock);
+
+    pa_assert(n <= *out_n_frames);
+    *out_n_frames = n;
+}
+
+static void halfband_reset(pa_resampler *r) {
+    unsigned i;
+
+    pa_assert(r);
+
+    /* Center the first filter window on the first input frame */
+    for (i = 0; i < r->halfband.n_stages; i++) {
+        pa_halfband_stage *s = &r->halfband.stages[i];
+
+        memset(s->buf, 0, halfband_streams(r, s) * s->buf_frames * sizeof(float));
+
+        s->n_frames = s->up ? s->table->n_taps / 2 - 1 : s->table->n_taps / 2;
+        s->fill = 0;
+    }
+}
+
+static size_t halfband_stage_state_size(pa_resampler *r, pa_halfband_stage *s) {
+    return PA_ALIGN(sizeof(halfband_state)) + halfband_streams(r, s) * (s->table->n_taps + 1) * sizeof(float);
+}
+
+static void halfband_save(pa_resampler *r, void *state) {
+    uint8_t *p = state;
+    unsigned i, k;
+
+    pa_assert(r);
+
+    for (i = 0; i < r->halfband.n_stages; i++) {
+        pa_halfband_stage *s = &r->halfband.stages[i];
+        halfband_state *h = (halfband_state*) p;
+        float *d = (float*) (p + PA_ALIGN(sizeof(halfband_state)));
+
+        pa_assert(s->n_frames < s->table->n_taps);
+
+        h->n_frames = s->n_frames;
+        h->fill = s->fill;
+
+        for (k = 0; k < halfband_streams(r, s); k++)
+            memcpy(d + k * (s->table->n_taps + 1), s->buf + k * s->buf_frames, (s->n_frames + 1) * sizeof(float));
+
+        p += halfband_stage_state_size(r, s);
+    }
+}
+
+static void halfband_restore(pa_resampler *r, const void *state) {
+    const uint8_t *p = state;
+    unsigned i, k;
+
+    pa_assert(r);
+
+    for (i = 0; i < r->halfband.n_stages; i++) {
+        pa_halfband_stage *s = &r->halfband.stages[i];
+        const halfband_state *h = (const halfband_state*) p;
+        const float *d = (const float*) (p + PA_ALIGN(sizeof(halfband_state)));
+
+        s->n_frames = h->n_frames;
+        s->fill = h->fill;
+
+        for (k = 0; k < halfband_streams(r, s); k++)
+            memcpy(s->buf + k * s->buf_frames, d + k * (s->table->n_taps + 1), (s->n_frames + 1) * sizeof(float));
+
+        p += halfband_stage_state_size(r, s);
+    }
+}
+
+static void halfband_free(pa_resampler *r) {
+    unsigned i;
+
+    pa_assert(r);
+
+    for (i = 0; i < r->halfband.n_stages; i++) {
+        if (r->halfband.stages[i].table)
+            pa_sinc_table_unref(r->halfband.stages[i].table);
+
+        pa_xfree(r->halfband.stages[i].buf);
+    }
+
+    pa_xfree(r->halfband.planar);
+}
+
+static int halfband_init(pa_resampler *r) {
+    unsigned q, i, factor;
+    bool up;
+
+    pa_assert(r);
+    pa_assert(r->method >= PA_RESAMPLER_HALFBAND_BASE && r->method <= PA_RESAMPLER_HALFBAND_MAX);
+    pa_assert_se(factor = halfband_factor(r->i_ss.rate, r->o_ss.rate));
+
+    q = r->method - PA_RESAMPLER_HALFBAND_BASE;
+    up = r->o_ss.rate > r->i_ss.rate;
+
+    pa_log_info("Choosing integer ratio quality setting %u.", q);
+
+    /* 4x is done as two half-band stages */
+    if (factor == 4) {
+        r->halfband.stages[0].factor = r->halfband.stages[1].factor = 2;
+        r->halfband.n_stages = 2;
+    } else {
+        r->halfband.stages[0].factor = factor;
+        r->halfband.n_stages = 1;
+    }
+
+    r->impl_free = halfband_free;
+    r->impl_resample = halfband_resample;
+    r->impl_reset = halfband_reset;
+    r->impl_save = halfband_save;
+    r->impl_restore = halfband_restore;
+
+    for (i = 0; i < r->halfband.n_stages; i++) {
+        pa_halfband_stage *s = &r->halfband.stages[i];
+
+        s->up = up;
+        s->table = up ? pa_sinc_table_get_nyquist(1, s->factor, q) : pa_sinc_table_get_nyquist(s->factor, 1, q);
+        s->buf_frames = s->table->n_taps + 1;
+        s->buf = pa_xnew(float, halfband_streams(r, s) * s->buf_frames);
+
+        r->impl_state_size += halfband_stage_state_size(r, s);
+    }
+
+    r->halfband.dot = pa_get_sinc_dot_func();
+
+    halfband_reset(r);
+
+    return 0;
+}
+
 /*** copy (noop) implementation ***/
 
 static int copy_init(pa_resampler *r) {
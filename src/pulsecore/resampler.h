@@ -42,6 +42,10 @@ typedef enum pa_resample_method {
     PA_RESAMPLER_SPEEX_FIXED_BASE,
     PA_RESAMPLER_SPEEX_FIXED_MAX = PA_RESAMPLER_SPEEX_FIXED_BASE + 10,
     PA_RESAMPLER_FFMPEG,
+    PA_RESAMPLER_SINC_BASE,
+    PA_RESAMPLER_SINC_MAX = PA_RESAMPLER_SINC_BASE + 3,
+    PA_RESAMPLER_HALFBAND_BASE,
+    PA_RESAMPLER_HALFBAND_MAX = PA_RESAMPLER_HALFBAND_BASE + 3,
     PA_RESAMPLER_AUTO, /* automatic select based on sample format */
     PA_RESAMPLER_COPY,
     PA_RESAMPLER_PEAKS,
@@ -87,6 +91,16 @@ void pa_resampler_set_output_rate(pa_resampler *r, uint32_t rate);
 /* Reinitialize state of the resampler, possibly due to seeking or other discontinuities */
 void pa_resampler_reset(pa_resampler *r);
 
+/* Keep enough history to restore the exact state of the resampler
+ * after rewinding by up to the specified amount of input data. Pass
+ * 0 to disable the history. */
+void pa_resampler_set_max_rewind(pa_resampler *r, size_t in_bytes);
+
+/* Rewind the resampler by the specified amount of input data. If the
+ * state at that point can be restored exactly true is returned,
+ * otherwise the resampler is reset and false is returned. */
+bool pa_resampler_rewind(pa_resampler *r, size_t in_bytes);
+
 /* Return the resampling method of the resampler object */
 pa_resample_method_t pa_resampler_get_method(pa_resampler *r);
 
@@ -549,10 +549,11 @@ static int asyncmsgq_read_work(pa_rtpoll_item *i) {
     void *data;
     pa_memchunk chunk;
     int64_t offset;
+    bool worked = false;
 
     pa_assert(i);
 
-    if (pa_asyncmsgq_get(i->userdata, &object, &code, &data, &offset, &chunk, 0) == 0) {
+    while (pa_asyncmsgq_get(i->userdata, &object, &code, &data, &offset, &chunk, 0) == 0) {
         int ret;
 
         if (!object && code == PA_MESSAGE_SHUTDOWN) {
@@ -563,10 +564,16 @@ static int asyncmsgq_read_work(pa_rtpoll_item *i) {
 
         ret = pa_asyncmsgq_dispatch(object, code, data, offset, &chunk);
         pa_asyncmsgq_done(i->userdata, ret);
-        return 1;
+        worked = true;
+
+        /* For batching queues we go on until the queue is empty,
+         * unless the message handler removed this item or asked us
+         * to quit */
+        if (i->dead || i->rtpoll->quit || !pa_asyncmsgq_get_batch(i->userdata))
+            break;
     }
 
-    return 0;
+    return worked;
 }
 
 pa_rtpoll_item *pa_rtpoll_item_new_asyncmsgq_read(pa_rtpoll *p, pa_rtpoll_priority_t prio, pa_asyncmsgq *q) {
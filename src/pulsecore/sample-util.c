@@ -151,6 +151,63 @@ void pa_interleave(const void *src[], unsigned channels, void *dst, size_t ss, u
     }
 }
 
+pa_memblock *pa_planar_memblock_new(pa_mempool *pool, size_t length, const pa_sample_spec *ss) {
+    pa_memblock *b;
+
+    pa_assert(pool);
+    pa_assert(ss);
+    pa_assert(ss->format == PA_SAMPLE_FLOAT32NE);
+    pa_assert(length > 0);
+    pa_assert(pa_frame_aligned(length, ss));
+
+    b = pa_memblock_new(pool, length);
+    pa_memblock_set_is_planar(b, true);
+
+    return b;
+}
+
+void pa_memchunk_interleave(pa_memchunk *c, const pa_sample_spec *ss, pa_mempool *pool) {
+    pa_memblock *b;
+    unsigned ch, n;
+    float *d;
+    void *p;
+
+    pa_assert(c);
+    pa_assert(c->memblock);
+    pa_assert(ss);
+    pa_assert(pool);
+
+    if (!pa_memblock_is_planar(c->memblock))
+        return;
+
+    pa_assert(ss->format == PA_SAMPLE_FLOAT32NE);
+    pa_assert(c->length > 0);
+    pa_assert(pa_frame_aligned(c->index, ss));
+    pa_assert(pa_frame_aligned(c->length, ss));
+
+    n = (unsigned) (c->length / pa_frame_size(ss));
+    b = pa_memblock_new(pool, c->length);
+
+    p = pa_memblock_acquire(c->memblock);
+    d = pa_memblock_acquire(b);
+
+    for (ch = 0; ch < ss->channels; ch++) {
+        const float *s = pa_planar_channel(p, c, ss, ch);
+        float *t = d + ch;
+        unsigned j;
+
+        for (j = 0; j < n; j++, t += ss->channels)
+            *t = s[j];
+    }
+
+    pa_memblock_release(b);
+    pa_memblock_release(c->memblock);
+
+    pa_memblock_unref(c->memblock);
+    c->memblock = b;
+    c->index = 0;
+}
+
 void pa_deinterleave(const void *src, void *dst[], unsigned channels, size_t ss, unsigned n) {
     size_t fs;
     unsigned c;
@@ -54,6 +54,20 @@ bool pa_frame_aligned(size_t l, const pa_sample_spec *ss) PA_GCC_PURE;
 void pa_interleave(const void *src[], unsigned channels, void *dst, size_t ss, unsigned n);
 void pa_deinterleave(const void *src, void *dst[], unsigned channels, size_t ss, unsigned n);
 
+/* Returns the samples of one channel of a chunk of a planar block,
+ * p is the acquired data of c->memblock. */
+static inline float *pa_planar_channel(void *p, const pa_memchunk *c, const pa_sample_spec *ss, unsigned channel) {
+    size_t plane = pa_memblock_get_length(c->memblock) / ss->channels;
+
+    return (float*) ((uint8_t*) p + channel * plane + c->index / ss->channels);
+}
+
+pa_memblock *pa_planar_memblock_new(pa_mempool *pool, size_t length, const pa_sample_spec *ss);
+
+/* Replaces a chunk of a planar block with an interleaved copy, does
+ * nothing for interleaved chunks */
+void pa_memchunk_interleave(pa_memchunk *c, const pa_sample_spec *ss, pa_mempool *pool);
+
 void pa_sample_clamp(pa_sample_format_t format, void *dst, size_t dstr, const void *src, size_t sstr, unsigned n);
 
 static inline int32_t pa_mult_s16_volume(int16_t v, int32_t cv) {
@@ -0,0 +1,219 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include <pulsecore/macro.h>
+#include <pulsecore/log.h>
+#include <pulsecore/endianmacros.h>
+
+#include <pulsecore/sconv-s16le.h>
+#include <pulsecore/sconv-s16be.h>
+
+#include "cpu-x86.h"
+#include "sconv.h"
+
+/* This file is built with AVX2_CFLAGS, the functions in here must only
+ * be called after the CPU and OS support for AVX2 has been verified. */
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__)
+
+#include <immintrin.h>
+
+/* Only the conversions between float and the 16 and 32 bit formats are
+ * done here, the others gain little from the wider registers over the
+ * SSE2 versions. The same rules apply: 16 samples per iteration, the
+ * rest is handed to the C versions, and the results are bit exact with
+ * those. */
+
+static inline __m256i bswap16(__m256i v) {
+    const __m256i mask = _mm256_setr_epi8(
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+    return _mm256_shuffle_epi8(v, mask);
+}
+
+static inline __m256i bswap32(__m256i v) {
+    const __m256i mask = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    return _mm256_shuffle_epi8(v, mask);
+}
+
+static inline __m256i load_s16(const uint8_t *p, bool swap) {
+    const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+
+    if (swap)
+        v = _mm_shuffle_epi8(v, mask);
+
+    return _mm256_cvtepi16_epi32(v);
+}
+
+static inline __m256i load_s32(const uint8_t *p, bool swap) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+
+    return swap ? bswap32(v) : v;
+}
+
+static inline void store_s32(uint8_t *p, __m256i v, bool swap) {
+    _mm256_storeu_si256((__m256i *) p, swap ? bswap32(v) : v);
+}
+
+static inline __m256 s32_to_float(__m256i v) {
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(1.0f / (1U << 31)));
+}
+
+static inline __m256i float_to_s32(__m256 v) {
+    const __m256 scale = _mm256_set1_ps((float) (1U << 31));
+    __m256i over;
+
+    v = _mm256_mul_ps(v, scale);
+
+    /* Saturate positive overflows, cvtps2dq returns 0x80000000 for them */
+    over = _mm256_castps_si256(_mm256_cmp_ps(v, scale, _CMP_GE_OQ));
+
+    return _mm256_xor_si256(_mm256_cvtps_epi32(v), over);
+}
+
+static inline __m256i float_to_s16(__m256 v) {
+    v = _mm256_max_ps(_mm256_mul_ps(v, _mm256_set1_ps((float) (1 << 15))), _mm256_set1_ps(-0x8000));
+    v = _mm256_min_ps(v, _mm256_set1_ps(0x7fff));
+
+    return _mm256_cvtps_epi32(v);
+}
+
+/* Packs two vectors of 32 bit samples to 16 samples of 16 bit */
+static inline __m256i pack_s16(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+}
+
+static inline __m256 load_float(const uint8_t *p, bool swap) {
+    return swap ? _mm256_castsi256_ps(load_s32(p, true)) : _mm256_loadu_ps((const float *) p);
+}
+
+static inline void store_float(uint8_t *p, __m256 v, bool swap) {
+    if (swap)
+        store_s32(p, _mm256_castps_si256(v), true);
+    else
+        _mm256_storeu_ps((float *) p, v);
+}
+
+static void float32re_to_float32ne_c(unsigned n, const float *a, float *b) {
+    for (; n > 0; n--, a++, b++)
+        *((uint32_t *) b) = PA_UINT32_SWAP(*((uint32_t *) a));
+}
+
+#define SCONV_AVX2(name, in_size, out_size, expr, tail)                \
+    static void name(unsigned n, const void *a, void *b) {             \
+        const uint8_t *src = a;                                         \
+        uint8_t *dst = b;                                               \
+                                                                        \
+        pa_assert(a);                                                   \
+        pa_assert(b);                                                   \
+                                                                        \
+        for (; n >= 16; n -= 16) {                                      \
+            expr;                                                       \
+            src += 16 * (in_size);                                      \
+            dst += 16 * (out_size);                                     \
+        }                                                               \
+                                                                        \
+        tail(n, (const void *) src, (void *) dst);                      \
+    }
+
+/* s16 <-> float */
+#define S16_TO_FLOAT(swap_in, swap_out)                                 \
+    store_float(dst, s32_to_float(_mm256_slli_epi32(load_s16(src, swap_in), 16)), swap_out); \
+    store_float(dst + 32, s32_to_float(_mm256_slli_epi32(load_s16(src + 16, swap_in), 16)), swap_out)
+
+#define FLOAT_TO_S16(swap_in, swap_out)                                 \
+    __m256i v = pack_s16(float_to_s16(load_float(src, swap_in)), float_to_s16(load_float(src + 32, swap_in))); \
+    _mm256_storeu_si256((__m256i *) dst, swap_out ? bswap16(v) : v)
+
+SCONV_AVX2(s16le_to_float32ne_avx2, 2, 4, S16_TO_FLOAT(false, false), pa_sconv_s16le_to_float32ne)
+SCONV_AVX2(s16be_to_float32ne_avx2, 2, 4, S16_TO_FLOAT(true, false), pa_sconv_s16be_to_float32ne)
+SCONV_AVX2(float32be_from_s16ne_avx2, 2, 4, S16_TO_FLOAT(false, true), pa_sconv_float32be_from_s16ne)
+
+SCONV_AVX2(s16le_from_float32ne_avx2, 4, 2, FLOAT_TO_S16(false, false), pa_sconv_s16le_from_float32ne)
+SCONV_AVX2(s16be_from_float32ne_avx2, 4, 2, FLOAT_TO_S16(false, true), pa_sconv_s16be_from_float32ne)
+SCONV_AVX2(float32be_to_s16ne_avx2, 4, 2, FLOAT_TO_S16(true, false), pa_sconv_float32be_to_s16ne)
+
+/* s32 and s24_32 <-> float */
+#define S32_TO_FLOAT(swap, shift)                                       \
+    store_float(dst, s32_to_float(_mm256_slli_epi32(load_s32(src, swap), shift)), false); \
+    store_float(dst + 32, s32_to_float(_mm256_slli_epi32(load_s32(src + 32, swap), shift)), false)
+
+#define FLOAT_TO_S32(swap, shift)                                       \
+    store_s32(dst, _mm256_srli_epi32(float_to_s32(load_float(src, false)), shift), swap); \
+    store_s32(dst + 32, _mm256_srli_epi32(float_to_s32(load_float(src + 32, false)), shift), swap)
+
+SCONV_AVX2(s32le_to_float32ne_avx2, 4, 4, S32_TO_FLOAT(false, 0), pa_sconv_s32le_to_float32ne)
+SCONV_AVX2(s32be_to_float32ne_avx2, 4, 4, S32_TO_FLOAT(true, 0), pa_sconv_s32be_to_float32ne)
+SCONV_AVX2(s24_32le_to_float32ne_avx2, 4, 4, S32_TO_FLOAT(false, 8), pa_sconv_s24_32le_to_float32ne)
+SCONV_AVX2(s24_32be_to_float32ne_avx2, 4, 4, S32_TO_FLOAT(true, 8), pa_sconv_s24_32be_to_float32ne)
+
+SCONV_AVX2(s32le_from_float32ne_avx2, 4, 4, FLOAT_TO_S32(false, 0), pa_sconv_s32le_from_float32ne)
+SCONV_AVX2(s32be_from_float32ne_avx2, 4, 4, FLOAT_TO_S32(true, 0), pa_sconv_s32be_from_float32ne)
+SCONV_AVX2(s24_32le_from_float32ne_avx2, 4, 4, FLOAT_TO_S32(false, 8), pa_sconv_s24_32le_from_float32ne)
+SCONV_AVX2(s24_32be_from_float32ne_avx2, 4, 4, FLOAT_TO_S32(true, 8), pa_sconv_s24_32be_from_float32ne)
+
+/* float32re <-> float32ne */
+SCONV_AVX2(float32re_to_float32ne_avx2, 4, 4,
+           store_s32(dst, load_s32(src, true), false); store_s32(dst + 32, load_s32(src + 32, true), false),
+           float32re_to_float32ne_c)
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__) */
+
+void pa_convert_func_init_avx2(pa_cpu_x86_flag_t flags) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__)
+
+    if (flags & PA_CPU_X86_AVX2) {
+        pa_log_info("Initialising AVX2 optimized conversions.");
+
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S16LE, s16le_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S16BE, s16be_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S32LE, s32le_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S32BE, s32be_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24_32LE, s24_32le_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24_32BE, s24_32be_to_float32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_FLOAT32RE, float32re_to_float32ne_avx2);
+
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, s16le_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S16BE, s16be_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S32LE, s32le_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S32BE, s32be_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24_32LE, s24_32le_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24_32BE, s24_32be_from_float32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_FLOAT32RE, float32re_to_float32ne_avx2);
+
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_FLOAT32LE, s16le_from_float32ne_avx2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_FLOAT32BE, float32be_to_s16ne_avx2);
+
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_FLOAT32LE, s16le_to_float32ne_avx2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_FLOAT32BE, float32be_from_s16ne_avx2);
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__) */
+}
@@ -26,10 +26,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include <pulsecore/macro.h>
 #include <pulsecore/endianmacros.h>
 
+#include <pulsecore/sconv-s16le.h>
+#include <pulsecore/sconv-s16be.h>
+
 #include "cpu-x86.h"
 #include "sconv.h"
 
@@ -102,6 +106,9 @@ static void pa_sconv_s16le_from_f32ne_sse(unsigned n, const float *a, int16_t *b
     );
 }
 
+#ifndef __SSE2__
+/* Without -msse2 the intrinsics below are not available, so keep this
+ * one for CPUs that have SSE2 at run time */
 static void pa_sconv_s16le_from_f32ne_sse2(unsigned n, const float *a, int16_t *b) {
     pa_reg_x86 temp, i;
 
@@ -159,17 +166,483 @@ static void pa_sconv_s16le_from_f32ne_sse2(unsigned n, const float *a, int16_t *
         : "cc", "memory"
     );
 }
+#endif /* __SSE2__ */
 
 #endif /* defined (__i386__) || defined (__amd64__) */
 
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__)
+
+#include <emmintrin.h>
+
+/* The SSE2 conversions below work on 8 samples at a time. Integer
+ * samples are widened to a common 32 bit representation with the sample
+ * in the most significant bits on the way through, which is what the C
+ * versions in sconv-s16le.c do implicitly, too. The last few samples are
+ * handed to the C versions, and the results are bit exact with them for
+ * all integer input and all float input with a magnitude below 2^32
+ * (beyond that llrintf() overflows and the C versions wrap around,
+ * while we saturate). */
+
+typedef struct { __m128i lo, hi; } ipair;
+typedef struct { __m128 lo, hi; } fpair;
+
+static inline __m128i bswap16(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i bswap32(__m128i v) {
+    return bswap16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1));
+}
+
+/* Gathers the four 3 byte samples at p into the low bytes of each
+ * lane. Reads 16 bytes. */
+static inline __m128i s24_unpack(const uint8_t *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+
+    return _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3)),
+            _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9)));
+}
+
+/* The inverse of s24_unpack(), the top byte of each lane needs to be
+ * zero. Writes 16 bytes, the last 4 of which are zero. */
+static inline void s24_pack(uint8_t *p, __m128i v) {
+    const __m128i low = _mm_set_epi32(0, 0, -1, -1);
+    const __m128i low32 = _mm_set_epi32(0, -1, 0, -1);
+
+    /* Six bytes in each 64 bit half... */
+    v = _mm_or_si128(_mm_and_si128(v, low32), _mm_srli_epi64(_mm_andnot_si128(low32, v), 8));
+    /* ...and twelve in the whole register */
+    v = _mm_or_si128(_mm_and_si128(v, low), _mm_srli_si128(_mm_andnot_si128(low, v), 2));
+
+    _mm_storeu_si128((__m128i *) p, v);
+}
+
+static inline ipair load_s16ne(const uint8_t *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    ipair r = { _mm_unpacklo_epi16(_mm_setzero_si128(), v), _mm_unpackhi_epi16(_mm_setzero_si128(), v) };
+    return r;
+}
+
+static inline ipair load_s16re(const uint8_t *p) {
+    __m128i v = bswap16(_mm_loadu_si128((const __m128i *) p));
+    ipair r = { _mm_unpacklo_epi16(_mm_setzero_si128(), v), _mm_unpackhi_epi16(_mm_setzero_si128(), v) };
+    return r;
+}
+
+static inline ipair load_s32ne(const uint8_t *p) {
+    ipair r = { _mm_loadu_si128((const __m128i *) p), _mm_loadu_si128((const __m128i *) (p + 16)) };
+    return r;
+}
+
+static inline ipair load_s32re(const uint8_t *p) {
+    ipair r = { bswap32(_mm_loadu_si128((const __m128i *) p)), bswap32(_mm_loadu_si128((const __m128i *) (p + 16))) };
+    return r;
+}
+
+static inline ipair load_s24_32ne(const uint8_t *p) {
+    ipair r = load_s32ne(p);
+    r.lo = _mm_slli_epi32(r.lo, 8);
+    r.hi = _mm_slli_epi32(r.hi, 8);
+    return r;
+}
+
+static inline ipair load_s24_32re(const uint8_t *p) {
+    ipair r = load_s32re(p);
+    r.lo = _mm_slli_epi32(r.lo, 8);
+    r.hi = _mm_slli_epi32(r.hi, 8);
+    return r;
+}
+
+static inline ipair load_s24ne(const uint8_t *p) {
+    ipair r = { _mm_slli_epi32(s24_unpack(p), 8), _mm_slli_epi32(s24_unpack(p + 12), 8) };
+    return r;
+}
+
+static inline ipair load_s24re(const uint8_t *p) {
+    const __m128i mask = _mm_set1_epi32((int) 0xffffff00);
+    ipair r = { _mm_and_si128(bswap32(s24_unpack(p)), mask), _mm_and_si128(bswap32(s24_unpack(p + 12)), mask) };
+    return r;
+}
+
+static inline void store_s16ne(uint8_t *p, ipair v) {
+    _mm_storeu_si128((__m128i *) p, _mm_packs_epi32(_mm_srai_epi32(v.lo, 16), _mm_srai_epi32(v.hi, 16)));
+}
+
+static inline void store_s32ne(uint8_t *p, ipair v) {
+    _mm_storeu_si128((__m128i *) p, v.lo);
+    _mm_storeu_si128((__m128i *) (p + 16), v.hi);
+}
+
+static inline void store_s32re(uint8_t *p, ipair v) {
+    _mm_storeu_si128((__m128i *) p, bswap32(v.lo));
+    _mm_storeu_si128((__m128i *) (p + 16), bswap32(v.hi));
+}
+
+static inline void store_s24_32ne(uint8_t *p, ipair v) {
+    _mm_storeu_si128((__m128i *) p, _mm_srli_epi32(v.lo, 8));
+    _mm_storeu_si128((__m128i *) (p + 16), _mm_srli_epi32(v.hi, 8));
+}
+
+static inline void store_s24_32re(uint8_t *p, ipair v) {
+    _mm_storeu_si128((__m128i *) p, bswap32(_mm_srli_epi32(v.lo, 8)));
+    _mm_storeu_si128((__m128i *) (p + 16), bswap32(_mm_srli_epi32(v.hi, 8)));
+}
+
+static inline void store_s24ne(uint8_t *p, ipair v) {
+    s24_pack(p, _mm_srli_epi32(v.lo, 8));
+    s24_pack(p + 12, _mm_srli_epi32(v.hi, 8));
+}
+
+static inline void store_s24re(uint8_t *p, ipair v) {
+    const __m128i mask = _mm_set1_epi32((int) 0xffffff00);
+
+    s24_pack(p, bswap32(_mm_and_si128(v.lo, mask)));
+    s24_pack(p + 12, bswap32(_mm_and_si128(v.hi, mask)));
+}
+
+static inline fpair load_float32ne(const uint8_t *p) {
+    fpair r = { _mm_loadu_ps((const float *) p), _mm_loadu_ps((const float *) (p + 16)) };
+    return r;
+}
+
+static inline fpair load_float32re(const uint8_t *p) {
+    ipair v = load_s32re(p);
+    fpair r = { _mm_castsi128_ps(v.lo), _mm_castsi128_ps(v.hi) };
+    return r;
+}
+
+static inline void store_float32ne(uint8_t *p, fpair v) {
+    _mm_storeu_ps((float *) p, v.lo);
+    _mm_storeu_ps((float *) (p + 16), v.hi);
+}
+
+static inline void store_float32re(uint8_t *p, fpair v) {
+    ipair r = { _mm_castps_si128(v.lo), _mm_castps_si128(v.hi) };
+    store_s32re(p, r);
+}
+
+static inline fpair s32_to_float(ipair v) {
+    const __m128 factor = _mm_set1_ps(1.0f / (1U << 31));
+    fpair r = { _mm_mul_ps(_mm_cvtepi32_ps(v.lo), factor), _mm_mul_ps(_mm_cvtepi32_ps(v.hi), factor) };
+    return r;
+}
+
+static inline __m128i float_to_s32_one(__m128 v) {
+    const __m128 factor = _mm_set1_ps((float) (1U << 31));
+    __m128i over;
+
+    v = _mm_mul_ps(v, factor);
+
+    /* cvtps2dq returns 0x80000000 for anything out of range, turn that
+     * into 0x7fffffff where the sample was positive */
+    over = _mm_castps_si128(_mm_cmpge_ps(v, factor));
+
+    return _mm_xor_si128(_mm_cvtps_epi32(v), over);
+}
+
+static inline ipair float_to_s32(fpair v) {
+    ipair r = { float_to_s32_one(v.lo), float_to_s32_one(v.hi) };
+    return r;
+}
+
+static inline __m128i float_to_s16_one(__m128 v) {
+    /* Clamping before the conversion also maps NaN to -0x8000, like
+     * lrintf() followed by the clamp does */
+    v = _mm_max_ps(_mm_mul_ps(v, _mm_set1_ps((float) (1 << 15))), _mm_set1_ps(-0x8000));
+    v = _mm_min_ps(v, _mm_set1_ps(0x7fff));
+
+    return _mm_cvtps_epi32(v);
+}
+
+static inline __m128i float_to_s16(fpair v) {
+    return _mm_packs_epi32(float_to_s16_one(v.lo), float_to_s16_one(v.hi));
+}
+
+/* The C versions of these live in sconv.c and are static */
+static void u8_to_float32ne_c(unsigned n, const uint8_t *a, float *b) {
+    for (; n > 0; n--, a++, b++)
+        *b = (*a * 1.0/128.0) - 1.0;
+}
+
+static void u8_from_float32ne_c(unsigned n, const float *a, uint8_t *b) {
+    for (; n > 0; n--, a++, b++) {
+        float v;
+        v = (*a * 127.0) + 128.0;
+        v = PA_CLAMP_UNLIKELY (v, 0.0, 255.0);
+        *b = rint (v);
+    }
+}
+
+static void u8_to_s16ne_c(unsigned n, const uint8_t *a, int16_t *b) {
+    for (; n > 0; n--, a++, b++)
+        *b = (((int16_t)*a) - 128) << 8;
+}
+
+static void u8_from_s16ne_c(unsigned n, const int16_t *a, uint8_t *b) {
+    for (; n > 0; n--, a++, b++)
+        *b = (uint8_t) ((uint16_t) *a >> 8) + (uint8_t) 0x80U;
+}
+
+static void float32re_to_float32ne_c(unsigned n, const float *a, float *b) {
+    for (; n > 0; n--, a++, b++)
+        *((uint32_t *) b) = PA_UINT32_SWAP(*((uint32_t *) a));
+}
+
+static void s16re_to_s16ne_c(unsigned n, const int16_t *a, int16_t *b) {
+    for (; n > 0; n--, a++, b++)
+        *b = PA_INT16_SWAP(*a);
+}
+
+/* Defines a conversion of 8 samples per iteration. The packed 24 bit
+ * formats read or write 16 bytes for every 12, slack makes sure that
+ * stays within the buffers. */
+#define SCONV_SSE2(name, in_size, out_size, slack, expr, tail)         \
+    static void name(unsigned n, const void *a, void *b) {             \
+        const uint8_t *src = a;                                         \
+        uint8_t *dst = b;                                               \
+                                                                        \
+        pa_assert(a);                                                   \
+        pa_assert(b);                                                   \
+                                                                        \
+        for (; n >= 8 + (slack); n -= 8) {                              \
+            expr;                                                       \
+            src += 8 * (in_size);                                       \
+            dst += 8 * (out_size);                                      \
+        }                                                               \
+                                                                        \
+        tail(n, (const void *) src, (void *) dst);                      \
+    }
+
+/* to float32ne */
+SCONV_SSE2(s16le_to_float32ne_sse2, 2, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s16ne(src))), pa_sconv_s16le_to_float32ne)
+SCONV_SSE2(s16be_to_float32ne_sse2, 2, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s16re(src))), pa_sconv_s16be_to_float32ne)
+SCONV_SSE2(s32le_to_float32ne_sse2, 4, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s32ne(src))), pa_sconv_s32le_to_float32ne)
+SCONV_SSE2(s32be_to_float32ne_sse2, 4, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s32re(src))), pa_sconv_s32be_to_float32ne)
+SCONV_SSE2(s24le_to_float32ne_sse2, 3, 4, 2,
+           store_float32ne(dst, s32_to_float(load_s24ne(src))), pa_sconv_s24le_to_float32ne)
+SCONV_SSE2(s24be_to_float32ne_sse2, 3, 4, 2,
+           store_float32ne(dst, s32_to_float(load_s24re(src))), pa_sconv_s24be_to_float32ne)
+SCONV_SSE2(s24_32le_to_float32ne_sse2, 4, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s24_32ne(src))), pa_sconv_s24_32le_to_float32ne)
+SCONV_SSE2(s24_32be_to_float32ne_sse2, 4, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s24_32re(src))), pa_sconv_s24_32be_to_float32ne)
+SCONV_SSE2(float32re_to_float32ne_sse2, 4, 4, 0,
+           store_float32ne(dst, load_float32re(src)), float32re_to_float32ne_c)
+
+/* from float32ne */
+SCONV_SSE2(s16le_from_float32ne_sse2, 4, 2, 0,
+           _mm_storeu_si128((__m128i *) dst, float_to_s16(load_float32ne(src))), pa_sconv_s16le_from_float32ne)
+SCONV_SSE2(s16be_from_float32ne_sse2, 4, 2, 0,
+           _mm_storeu_si128((__m128i *) dst, bswap16(float_to_s16(load_float32ne(src)))), pa_sconv_s16be_from_float32ne)
+SCONV_SSE2(s32le_from_float32ne_sse2, 4, 4, 0,
+           store_s32ne(dst, float_to_s32(load_float32ne(src))), pa_sconv_s32le_from_float32ne)
+SCONV_SSE2(s32be_from_float32ne_sse2, 4, 4, 0,
+           store_s32re(dst, float_to_s32(load_float32ne(src))), pa_sconv_s32be_from_float32ne)
+SCONV_SSE2(s24le_from_float32ne_sse2, 4, 3, 2,
+           store_s24ne(dst, float_to_s32(load_float32ne(src))), pa_sconv_s24le_from_float32ne)
+SCONV_SSE2(s24be_from_float32ne_sse2, 4, 3, 2,
+           store_s24re(dst, float_to_s32(load_float32ne(src))), pa_sconv_s24be_from_float32ne)
+SCONV_SSE2(s24_32le_from_float32ne_sse2, 4, 4, 0,
+           store_s24_32ne(dst, float_to_s32(load_float32ne(src))), pa_sconv_s24_32le_from_float32ne)
+SCONV_SSE2(s24_32be_from_float32ne_sse2, 4, 4, 0,
+           store_s24_32re(dst, float_to_s32(load_float32ne(src))), pa_sconv_s24_32be_from_float32ne)
+
+/* to s16ne */
+SCONV_SSE2(s16re_to_s16ne_sse2, 2, 2, 0,
+           _mm_storeu_si128((__m128i *) dst, bswap16(_mm_loadu_si128((const __m128i *) src))), s16re_to_s16ne_c)
+SCONV_SSE2(float32le_to_s16ne_sse2, 4, 2, 0,
+           _mm_storeu_si128((__m128i *) dst, float_to_s16(load_float32ne(src))), pa_sconv_float32le_to_s16ne)
+SCONV_SSE2(float32be_to_s16ne_sse2, 4, 2, 0,
+           _mm_storeu_si128((__m128i *) dst, float_to_s16(load_float32re(src))), pa_sconv_float32be_to_s16ne)
+SCONV_SSE2(s32le_to_s16ne_sse2, 4, 2, 0,
+           store_s16ne(dst, load_s32ne(src)), pa_sconv_s32le_to_s16ne)
+SCONV_SSE2(s32be_to_s16ne_sse2, 4, 2, 0,
+           store_s16ne(dst, load_s32re(src)), pa_sconv_s32be_to_s16ne)
+SCONV_SSE2(s24le_to_s16ne_sse2, 3, 2, 2,
+           store_s16ne(dst, load_s24ne(src)), pa_sconv_s24le_to_s16ne)
+SCONV_SSE2(s24be_to_s16ne_sse2, 3, 2, 2,
+           store_s16ne(dst, load_s24re(src)), pa_sconv_s24be_to_s16ne)
+SCONV_SSE2(s24_32le_to_s16ne_sse2, 4, 2, 0,
+           store_s16ne(dst, load_s24_32ne(src)), pa_sconv_s24_32le_to_s16ne)
+SCONV_SSE2(s24_32be_to_s16ne_sse2, 4, 2, 0,
+           store_s16ne(dst, load_s24_32re(src)), pa_sconv_s24_32be_to_s16ne)
+
+/* from s16ne */
+SCONV_SSE2(float32le_from_s16ne_sse2, 2, 4, 0,
+           store_float32ne(dst, s32_to_float(load_s16ne(src))), pa_sconv_float32le_from_s16ne)
+SCONV_SSE2(float32be_from_s16ne_sse2, 2, 4, 0,
+           store_float32re(dst, s32_to_float(load_s16ne(src))), pa_sconv_float32be_from_s16ne)
+SCONV_SSE2(s32le_from_s16ne_sse2, 2, 4, 0,
+           store_s32ne(dst, load_s16ne(src)), pa_sconv_s32le_from_s16ne)
+SCONV_SSE2(s32be_from_s16ne_sse2, 2, 4, 0,
+           store_s32re(dst, load_s16ne(src)), pa_sconv_s32be_from_s16ne)
+SCONV_SSE2(s24le_from_s16ne_sse2, 2, 3, 2,
+           store_s24ne(dst, load_s16ne(src)), pa_sconv_s24le_from_s16ne)
+SCONV_SSE2(s24be_from_s16ne_sse2, 2, 3, 2,
+           store_s24re(dst, load_s16ne(src)), pa_sconv_s24be_from_s16ne)
+SCONV_SSE2(s24_32le_from_s16ne_sse2, 2, 4, 0,
+           store_s24_32ne(dst, load_s16ne(src)), pa_sconv_s24_32le_from_s16ne)
+SCONV_SSE2(s24_32be_from_s16ne_sse2, 2, 4, 0,
+           store_s24_32re(dst, load_s16ne(src)), pa_sconv_s24_32be_from_s16ne)
+
+/* u8, 16 samples at a time */
+static void u8_to_float32ne_sse2(unsigned n, const uint8_t *a, float *b) {
+    const __m128 factor = _mm_set1_ps(1.0f / 128);
+    const __m128i offset = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+
+    pa_assert(a);
+    pa_assert(b);
+
+    for (; n >= 16; n -= 16, a += 16, b += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) a);
+        __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+
+        /* (x - 128) / 128 is exact in single precision, too */
+        _mm_storeu_ps(b, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(lo, zero), offset)), factor));
+        _mm_storeu_ps(b + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(lo, zero), offset)), factor));
+        _mm_storeu_ps(b + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(hi, zero), offset)), factor));
+        _mm_storeu_ps(b + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(hi, zero), offset)), factor));
+    }
+
+    u8_to_float32ne_c(n, a, b);
+}
+
+static inline __m128i u8_from_float_one(__m128 v) {
+    const __m128d factor = _mm_set1_pd(127.0), offset = _mm_set1_pd(128.0);
+    __m128d lo, hi;
+
+    /* The C version scales in double precision before rounding to
+     * float, do the same to get the same results */
+    lo = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(v), factor), offset);
+    hi = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), factor), offset);
+    v = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+
+    return _mm_cvtps_epi32(v);
+}
+
+static void u8_from_float32ne_sse2(unsigned n, const float *a, uint8_t *b) {
+    pa_assert(a);
+    pa_assert(b);
+
+    for (; n >= 16; n -= 16, a += 16, b += 16) {
+        __m128i lo, hi;
+
+        lo = _mm_packs_epi32(u8_from_float_one(_mm_loadu_ps(a)), u8_from_float_one(_mm_loadu_ps(a + 4)));
+        hi = _mm_packs_epi32(u8_from_float_one(_mm_loadu_ps(a + 8)), u8_from_float_one(_mm_loadu_ps(a + 12)));
+        _mm_storeu_si128((__m128i *) b, _mm_packus_epi16(lo, hi));
+    }
+
+    u8_from_float32ne_c(n, a, b);
+}
+
+static void u8_to_s16ne_sse2(unsigned n, const uint8_t *a, int16_t *b) {
+    const __m128i sign = _mm_set1_epi16((int16_t) 0x8000);
+
+    pa_assert(a);
+    pa_assert(b);
+
+    for (; n >= 16; n -= 16, a += 16, b += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) a);
+
+        _mm_storeu_si128((__m128i *) b, _mm_xor_si128(_mm_unpacklo_epi8(_mm_setzero_si128(), v), sign));
+        _mm_storeu_si128((__m128i *) (b + 8), _mm_xor_si128(_mm_unpackhi_epi8(_mm_setzero_si128(), v), sign));
+    }
+
+    u8_to_s16ne_c(n, a, b);
+}
+
+static void u8_from_s16ne_sse2(unsigned n, const int16_t *a, uint8_t *b) {
+    const __m128i sign = _mm_set1_epi16(0x80);
+
+    pa_assert(a);
+    pa_assert(b);
+
+    for (; n >= 16; n -= 16, a += 16, b += 16) {
+        __m128i lo = _mm_xor_si128(_mm_srli_epi16(_mm_loadu_si128((const __m128i *) a), 8), sign);
+        __m128i hi = _mm_xor_si128(_mm_srli_epi16(_mm_loadu_si128((const __m128i *) (a + 8)), 8), sign);
+
+        _mm_storeu_si128((__m128i *) b, _mm_packus_epi16(lo, hi));
+    }
+
+    u8_from_s16ne_c(n, a, b);
+}
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__) */
+
 void pa_convert_func_init_sse(pa_cpu_x86_flag_t flags) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__)
+
+    if (flags & PA_CPU_X86_SSE2) {
+        pa_log_info("Initialising SSE2 optimized conversions.");
+
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_U8, (pa_convert_func_t) u8_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S16LE, s16le_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S16BE, s16be_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S32LE, s32le_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S32BE, s32be_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24LE, s24le_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24BE, s24be_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24_32LE, s24_32le_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24_32BE, s24_32be_to_float32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_FLOAT32RE, float32re_to_float32ne_sse2);
+
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_U8, (pa_convert_func_t) u8_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, s16le_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S16BE, s16be_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S32LE, s32le_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S32BE, s32be_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24LE, s24le_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24BE, s24be_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24_32LE, s24_32le_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24_32BE, s24_32be_from_float32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_FLOAT32RE, float32re_to_float32ne_sse2);
+
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_U8, (pa_convert_func_t) u8_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S16RE, s16re_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_FLOAT32LE, float32le_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_FLOAT32BE, float32be_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S32LE, s32le_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S32BE, s32be_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24LE, s24le_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24BE, s24be_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24_32LE, s24_32le_to_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24_32BE, s24_32be_to_s16ne_sse2);
+
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_U8, (pa_convert_func_t) u8_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S16RE, s16re_to_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_FLOAT32LE, float32le_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_FLOAT32BE, float32be_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S32LE, s32le_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S32BE, s32be_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24LE, s24le_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24BE, s24be_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24_32LE, s24_32le_from_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24_32BE, s24_32be_from_s16ne_sse2);
+
+        return;
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__) */
+
 #if !defined(__APPLE__) && defined (__i386__) || defined (__amd64__)
 
+#ifndef __SSE2__
     if (flags & PA_CPU_X86_SSE2) {
         pa_log_info("Initialising SSE2 optimized conversions.");
         pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, (pa_convert_func_t) pa_sconv_s16le_from_f32ne_sse2);
+        return;
+    }
+#endif
 
-    } else if (flags & PA_CPU_X86_SSE) {
+    if (flags & PA_CPU_X86_SSE) {
         pa_log_info("Initialising SSE optimized conversions.");
         pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, (pa_convert_func_t) pa_sconv_s16le_from_f32ne_sse);
     }
@@ -0,0 +1,85 @@
+#ifndef foopulseseqlockhfoo
+#define foopulseseqlockhfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <pulsecore/atomic.h>
+#include <pulsecore/macro.h>
+
+/*
+ * A sequence counter that lets a single writer publish a small data
+ * structure to any number of readers without ever waiting for them.
+ * The writer makes the counter odd while it modifies the data. Readers
+ * copy the data out and retry if the counter was odd or changed in
+ * the meantime:
+ *
+ *     do {
+ *         seq = pa_seqlock_read_begin(&lock);
+ *         copy = data;
+ *     } while (pa_seqlock_read_retry(&lock, seq));
+ *
+ * Unlike pa_aupdate the writer side is wait-free, which makes it
+ * suitable for publishing from an IO thread. Only use it for plain
+ * data: readers may see (and have to discard) half updated copies.
+ *
+ * The counter is a plain pa_atomic_t, so a seqlock may live in shared
+ * memory and be read from a read-only mapping.
+ */
+
+typedef struct pa_seqlock {
+    pa_atomic_t seq;
+} pa_seqlock;
+
+#define PA_SEQLOCK_INIT { PA_ATOMIC_INIT(0) }
+
+static inline void pa_seqlock_init(pa_seqlock *l) {
+    pa_atomic_store(&l->seq, 0);
+}
+
+/* Both increments are full memory barriers */
+static inline void pa_seqlock_write_begin(pa_seqlock *l) {
+    pa_atomic_inc(&l->seq);
+}
+
+static inline void pa_seqlock_write_end(pa_seqlock *l) {
+    pa_atomic_inc(&l->seq);
+}
+
+static inline int pa_seqlock_read_begin(const pa_seqlock *l) {
+    int seq;
+
+    seq = pa_atomic_load(&l->seq);
+
+    /* The second load is only there for its barrier, which keeps the
+     * reads of the data from being done before the first one. If the
+     * counter moved on already, make the caller retry. */
+    if (pa_atomic_load(&l->seq) != seq)
+        seq |= 1;
+
+    return seq;
+}
+
+/* Returns true if the data read since pa_seqlock_read_begin() needs
+ * to be thrown away */
+static inline bool pa_seqlock_read_retry(const pa_seqlock *l, int seq) {
+    return (seq & 1) || pa_atomic_load(&l->seq) != seq;
+}
+
+#endif
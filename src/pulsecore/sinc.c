@@ -0,0 +1,347 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+
+#include "sinc.h"
+
+/* Tables with more phases than this are not built for exact rational
+ * stepping, we interpolate between the phases of a smaller one
+ * instead. */
+#define EXACT_PHASES_MAX 1024
+
+#define TAPS_MAX 1024U
+
+static const struct {
+    unsigned n_taps;
+    double beta;
+    double cutoff;
+    unsigned n_phases;
+} quality_table[PA_SINC_QUALITY_MAX + 1] = {
+    {  16,  5.0, 0.80,  64 },
+    {  32,  6.5, 0.88, 128 },
+    {  64,  8.5, 0.92, 256 },
+    { 128, 10.5, 0.95, 512 }
+};
+
+static pa_static_mutex mutex = PA_STATIC_MUTEX_INIT;
+static PA_LLIST_HEAD(pa_sinc_table, tables) = NULL;
+
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0, y = x * x / 4.0;
+    unsigned k;
+
+    for (k = 1; k < 100 && term > sum * 1e-12; k++) {
+        term *= y / ((double) k * k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+static double sinc(double x) {
+    if (fabs(x) < 1e-9)
+        return 1.0;
+
+    return sin(M_PI * x) / (M_PI * x);
+}
+
+static double window(double u, double half, double beta, double i0_beta) {
+    double x = u / half;
+
+    if (x <= -1.0 || x >= 1.0)
+        return 0;
+
+    return bessel_i0(beta * sqrt(1.0 - x * x)) / i0_beta;
+}
+
+static pa_sinc_table *table_new(pa_sinc_table_type_t type, unsigned in_rate, unsigned out_rate, unsigned quality) {
+    pa_sinc_table *t;
+
+    t = pa_xnew0(pa_sinc_table, 1);
+    t->ref = 1;
+    t->type = type;
+    t->in_rate = in_rate;
+    t->out_rate = out_rate;
+    t->quality = quality;
+
+    return t;
+}
+
+static void table_alloc(pa_sinc_table *t) {
+    t->data = pa_xmalloc((t->n_phases + 1) * t->n_taps * sizeof(float) + 31);
+    t->coeffs = (float*) (((uintptr_t) t->data + 31) & ~(uintptr_t) 31);
+}
+
+static void build_polyphase(pa_sinc_table *t) {
+    double cutoff, beta, i0_beta;
+    unsigned p, k, half;
+
+    cutoff = quality_table[t->quality].cutoff;
+    t->n_taps = quality_table[t->quality].n_taps;
+
+    /* When downsampling the pass band shrinks, so the filter needs to
+     * get longer to keep the same transition band relative to it. */
+    if (t->out_rate < t->in_rate) {
+        cutoff = cutoff * t->out_rate / t->in_rate;
+        t->n_taps = (unsigned) (((uint64_t) t->n_taps * t->in_rate + t->out_rate - 1) / t->out_rate);
+    }
+
+    t->n_taps = PA_MIN(((t->n_taps + 7) / 8) * 8, TAPS_MAX);
+
+    /* Use as many phases as needed to hit every output position
+     * exactly, as long as that is affordable. */
+    if (t->out_rate <= EXACT_PHASES_MAX)
+        t->n_phases = ((quality_table[t->quality].n_phases + t->out_rate - 1) / t->out_rate) * t->out_rate;
+    else
+        t->n_phases = quality_table[t->quality].n_phases;
+
+    table_alloc(t);
+
+    half = t->n_taps / 2;
+    beta = quality_table[t->quality].beta;
+    i0_beta = bessel_i0(beta);
+
+    for (p = 0; p <= t->n_phases; p++) {
+        float *row = t->coeffs + p * t->n_taps;
+        double sum = 0;
+
+        for (k = 0; k < t->n_taps; k++) {
+            double u, v;
+
+            /* Distance between the output position and the input
+             * sample multiplied with tap k, in input samples */
+            u = (double) p / t->n_phases + half - 1 - k;
+            v = cutoff * sinc(cutoff * u) * window(u, half, beta, i0_beta);
+
+            row[k] = (float) v;
+            sum += v;
+        }
+
+        /* Normalize every phase to unity gain at DC */
+        for (k = 0; k < t->n_taps; k++)
+            row[k] = (float) (row[k] / sum);
+    }
+}
+
+static void build_nyquist(pa_sinc_table *t) {
+    double beta, i0_beta, sum = 0;
+    unsigned p, k, half, factor;
+    bool up;
+
+    up = t->in_rate == 1;
+    factor = up ? t->out_rate : t->in_rate;
+
+    /* Taps per phase, counted at the lower of the two rates */
+    t->n_taps = quality_table[t->quality].n_taps;
+    t->n_phases = factor;
+
+    table_alloc(t);
+
+    half = t->n_taps / 2;
+    beta = quality_table[t->quality].beta;
+    i0_beta = bessel_i0(beta);
+
+    for (p = 0; p <= t->n_phases; p++) {
+        float *row = t->coeffs + p * t->n_taps;
+        double row_sum = 0;
+
+        for (k = 0; k < t->n_taps; k++) {
+            double u, v;
+
+            /* Distance between output and input sample, in samples
+             * at the lower rate. The cutoff is at the lower rate's
+             * Nyquist frequency, so the integer distances are the
+             * zeros of the filter. */
+            if (up)
+                u = (double) p / factor + half - 1 - k;
+            else
+                u = half - (double) k - (double) p / factor;
+
+            if (p == 0)
+                v = (up ? k + 1 == half : k == half) ? 1.0 : 0.0;
+            else
+                v = sinc(u) * window(u, half, beta, i0_beta);
+
+            row[k] = (float) v;
+            row_sum += v;
+        }
+
+        if (up) {
+            for (k = 0; k < t->n_taps; k++)
+                row[k] = (float) (row[k] / row_sum);
+        } else if (p < factor)
+            sum += row_sum;
+    }
+
+    /* When downsampling all phases together make up one output
+     * frame, normalize them together */
+    if (!up)
+        for (k = 0; k < factor * t->n_taps; k++)
+            t->coeffs[k] = (float) (t->coeffs[k] / sum);
+}
+
+static pa_sinc_table *table_get(pa_sinc_table_type_t type, unsigned in_rate, unsigned out_rate, unsigned quality) {
+    pa_sinc_table *t;
+    pa_mutex *m;
+
+    m = pa_static_mutex_get(&mutex, false, false);
+    pa_mutex_lock(m);
+
+    for (t = tables; t; t = t->next)
+        if (t->type == type && t->in_rate == in_rate && t->out_rate == out_rate && t->quality == quality)
+            break;
+
+    if (t)
+        t->ref++;
+    else {
+        t = table_new(type, in_rate, out_rate, quality);
+
+        if (type == PA_SINC_TABLE_NYQUIST)
+            build_nyquist(t);
+        else
+            build_polyphase(t);
+
+        pa_log_debug("Built %s sinc table for %u:%u at quality %u: %u taps, %u phases.",
+                     type == PA_SINC_TABLE_NYQUIST ? "Nyquist" : "polyphase",
+                     in_rate, out_rate, quality, t->n_taps, t->n_phases);
+
+        PA_LLIST_PREPEND(pa_sinc_table, tables, t);
+    }
+
+    pa_mutex_unlock(m);
+
+    return t;
+}
+
+double pa_sinc_quality_attenuation(unsigned quality) {
+    double beta;
+
+    pa_assert(quality <= PA_SINC_QUALITY_MAX);
+
+    /* Kaiser's empirical formula, valid for attenuations above 50 dB */
+    beta = quality_table[quality].beta;
+    pa_assert(beta > 4.5509);
+
+    return beta / 0.1102 + 8.7;
+}
+
+pa_sinc_table *pa_sinc_table_get(unsigned in_rate, unsigned out_rate, unsigned quality) {
+    unsigned g;
+
+    pa_assert(in_rate > 0);
+    pa_assert(out_rate > 0);
+    pa_assert(quality <= PA_SINC_QUALITY_MAX);
+
+    g = pa_gcd(in_rate, out_rate);
+
+    return table_get(PA_SINC_TABLE_POLYPHASE, in_rate / g, out_rate / g, quality);
+}
+
+pa_sinc_table *pa_sinc_table_get_nyquist(unsigned in_rate, unsigned out_rate, unsigned quality) {
+    pa_assert(in_rate == 1 || out_rate == 1);
+    pa_assert(in_rate > 1 || out_rate > 1);
+    pa_assert(quality <= PA_SINC_QUALITY_MAX);
+
+    return table_get(PA_SINC_TABLE_NYQUIST, in_rate, out_rate, quality);
+}
+
+void pa_sinc_table_unref(pa_sinc_table *t) {
+    pa_mutex *m;
+
+    pa_assert(t);
+
+    m = pa_static_mutex_get(&mutex, false, false);
+    pa_mutex_lock(m);
+
+    pa_assert(t->ref >= 1);
+
+    if (--t->ref > 0)
+        t = NULL;
+    else
+        PA_LLIST_REMOVE(pa_sinc_table, tables, t);
+
+    pa_mutex_unlock(m);
+
+    if (t) {
+        pa_xfree(t->data);
+        pa_xfree(t);
+    }
+}
+
+static float sinc_dot_c(const float *x, const float *h, unsigned n) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    unsigned i;
+
+    for (i = 0; i < n; i += 4) {
+        s0 += x[i] * h[i];
+        s1 += x[i+1] * h[i+1];
+        s2 += x[i+2] * h[i+2];
+        s3 += x[i+3] * h[i+3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+static float sinc_dot_interp_c(const float *x, const float *h0, const float *h1, float frac, unsigned n) {
+    float s0 = 0, s1 = 0, t0 = 0, t1 = 0;
+    unsigned i;
+
+    for (i = 0; i < n; i += 2) {
+        s0 += x[i] * h0[i];
+        s1 += x[i+1] * h0[i+1];
+        t0 += x[i] * h1[i];
+        t1 += x[i+1] * h1[i+1];
+    }
+
+    s0 += s1;
+    t0 += t1;
+
+    return s0 + frac * (t0 - s0);
+}
+
+static pa_sinc_dot_func_t dot_func = sinc_dot_c;
+static pa_sinc_dot_interp_func_t dot_interp_func = sinc_dot_interp_c;
+
+pa_sinc_dot_func_t pa_get_sinc_dot_func(void) {
+    return dot_func;
+}
+
+pa_sinc_dot_interp_func_t pa_get_sinc_dot_interp_func(void) {
+    return dot_interp_func;
+}
+
+void pa_set_sinc_funcs(pa_sinc_dot_func_t dot, pa_sinc_dot_interp_func_t dot_interp) {
+    pa_assert(dot);
+    pa_assert(dot_interp);
+
+    dot_func = dot;
+    dot_interp_func = dot_interp;
+}
@@ -0,0 +1,96 @@
+#ifndef foosinchfoo
+#define foosinchfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <pulsecore/llist.h>
+
+#define PA_SINC_QUALITY_MAX 3
+
+/* A polyphase windowed-sinc filter bank. Tables are immutable once
+ * built and shared between all resamplers that convert between the
+ * same pair of (reduced) rates at the same quality level. */
+typedef struct pa_sinc_table pa_sinc_table;
+
+typedef enum pa_sinc_table_type {
+    /* Phases of a filter for arbitrary rate ratios */
+    PA_SINC_TABLE_POLYPHASE,
+
+    /* Nyquist (half-band, third-band, ...) filter for a single integer
+     * up- or downsampling stage. Every factor-th tap of it is zero,
+     * which leaves one trivial phase:
+     *
+     * When upsampling, row p computes output p of the factor outputs
+     * following an input frame. Row 0 is a pure delay.
+     *
+     * When downsampling, row q is applied to the input frames with
+     * index q modulo factor. Row 0 only has the center tap set. */
+    PA_SINC_TABLE_NYQUIST
+} pa_sinc_table_type_t;
+
+struct pa_sinc_table {
+    unsigned ref;
+
+    pa_sinc_table_type_t type;
+    unsigned in_rate, out_rate, quality;
+
+    /* Number of taps per phase, always a multiple of 8 */
+    unsigned n_taps;
+
+    /* Number of phases the interval between two input samples is
+     * split into. There are n_phases + 1 rows in coeffs, so that the
+     * last phase can be interpolated towards the next input sample. */
+    unsigned n_phases;
+
+    /* Row-major, 32 byte aligned */
+    float *coeffs;
+    void *data;
+
+    PA_LLIST_FIELDS(pa_sinc_table);
+};
+
+/* Returns a reference to the table for the specified conversion,
+ * building it if no other resampler uses it yet. */
+pa_sinc_table *pa_sinc_table_get(unsigned in_rate, unsigned out_rate, unsigned quality);
+
+/* Returns a reference to the Nyquist filter for one stage of integer
+ * resampling, either in_rate or out_rate needs to be 1. */
+pa_sinc_table *pa_sinc_table_get_nyquist(unsigned in_rate, unsigned out_rate, unsigned quality);
+void pa_sinc_table_unref(pa_sinc_table *t);
+
+/* Stop-band attenuation in dB of the Kaiser window used at the
+ * specified quality, i.e. the rejection the filters are designed for */
+double pa_sinc_quality_attenuation(unsigned quality);
+
+static inline const float *pa_sinc_table_phase(const pa_sinc_table *t, unsigned phase) {
+    return t->coeffs + phase * t->n_taps;
+}
+
+/* Inner loops of the filter: x may be unaligned, the coefficients are
+ * 32 byte aligned and n is a multiple of 8. The interpolating variant
+ * returns (1 - frac) * <x, h0> + frac * <x, h1>. */
+typedef float (*pa_sinc_dot_func_t) (const float *x, const float *h, unsigned n);
+typedef float (*pa_sinc_dot_interp_func_t) (const float *x, const float *h0, const float *h1, float frac, unsigned n);
+
+pa_sinc_dot_func_t pa_get_sinc_dot_func(void);
+pa_sinc_dot_interp_func_t pa_get_sinc_dot_interp_func(void);
+void pa_set_sinc_funcs(pa_sinc_dot_func_t dot, pa_sinc_dot_interp_func_t dot_interp);
+
+#endif
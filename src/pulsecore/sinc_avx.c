@@ -0,0 +1,90 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulsecore/macro.h>
+#include <pulsecore/log.h>
+
+#include "cpu-x86.h"
+#include "sinc.h"
+
+/* This file is built with AVX_CFLAGS, the functions in here must only
+ * be called after the CPU and OS support for AVX has been verified. */
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX__)
+
+#include <immintrin.h>
+
+static inline float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+
+    return _mm_cvtss_f32(s);
+}
+
+static float sinc_dot_avx(const float *x, const float *h, unsigned n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    unsigned i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_load_ps(h + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_load_ps(h + i + 8)));
+    }
+
+    if (i < n)
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_load_ps(h + i)));
+
+    return hsum(_mm256_add_ps(s0, s1));
+}
+
+static float sinc_dot_interp_avx(const float *x, const float *h0, const float *h1, float frac, unsigned n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    unsigned i;
+    float a, b;
+
+    for (i = 0; i < n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(v, _mm256_load_ps(h0 + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(v, _mm256_load_ps(h1 + i)));
+    }
+
+    a = hsum(s0);
+    b = hsum(s1);
+
+    return a + frac * (b - a);
+}
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX__) */
+
+void pa_sinc_func_init_avx(pa_cpu_x86_flag_t flags) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX__)
+
+    if (flags & PA_CPU_X86_AVX) {
+        pa_log_info("Initialising AVX optimized sinc filter.");
+        pa_set_sinc_funcs(sinc_dot_avx, sinc_dot_interp_avx);
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX__) */
+}
@@ -0,0 +1,82 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulsecore/macro.h>
+#include <pulsecore/log.h>
+
+#include "cpu-x86.h"
+#include "sinc.h"
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE__)
+
+#include <xmmintrin.h>
+
+static inline float hsum(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+
+    return _mm_cvtss_f32(v);
+}
+
+static float sinc_dot_sse(const float *x, const float *h, unsigned n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    unsigned i;
+
+    for (i = 0; i < n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_load_ps(h + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_load_ps(h + i + 4)));
+    }
+
+    return hsum(_mm_add_ps(s0, s1));
+}
+
+static float sinc_dot_interp_sse(const float *x, const float *h0, const float *h1, float frac, unsigned n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    unsigned i;
+    float a, b;
+
+    for (i = 0; i < n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+
+        s0 = _mm_add_ps(s0, _mm_mul_ps(v, _mm_load_ps(h0 + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(v, _mm_load_ps(h1 + i)));
+    }
+
+    a = hsum(s0);
+    b = hsum(s1);
+
+    return a + frac * (b - a);
+}
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE__) */
+
+void pa_sinc_func_init_sse(pa_cpu_x86_flag_t flags) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE__)
+
+    if (flags & PA_CPU_X86_SSE) {
+        pa_log_info("Initialising SSE optimized sinc filter.");
+        pa_set_sinc_funcs(sinc_dot_sse, sinc_dot_interp_sse);
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE__) */
+}
@@ -908,6 +908,7 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink bytes */, pa
 
     while (!pa_memblockq_is_readable(i->thread_info.render_memblockq)) {
         pa_memchunk tchunk;
+        bool planar_ok;
 
         /* There's nothing in our render queue. We need to fill it up
          * with data from the implementor. */
@@ -933,6 +934,15 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink bytes */, pa
         pa_assert(tchunk.length > 0);
         pa_assert(tchunk.memblock);
 
+        /* Planar data may only pass through us untouched */
+        planar_ok = i->sink->thread_info.accept_planar &&
+            !i->thread_info.resampler &&
+            !need_volume_factor_sink &&
+            !(do_volume_adj_here && !volume_is_norm);
+
+        if (!planar_ok)
+            pa_memchunk_interleave(&tchunk, &i->thread_info.sample_spec, i->core->mempool);
+
         i->thread_info.underrun_for = 0;
         i->thread_info.underrun_for_sink = 0;
         i->thread_info.playing_for += tchunk.length;
@@ -1011,6 +1021,11 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink bytes */, pa
     pa_assert(chunk->length > 0);
     pa_assert(chunk->memblock);
 
+    /* We might have been moved to a sink that doesn't take planar
+     * data with some still queued up */
+    if (!i->sink->thread_info.accept_planar)
+        pa_memchunk_interleave(chunk, &i->sink->sample_spec, i->core->mempool);
+
 #ifdef SINK_INPUT_DEBUG
     pa_log_debug("peeking %lu", (unsigned long) chunk->length);
 #endif
@@ -1031,6 +1046,22 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink bytes */, pa
         *volume = i->thread_info.soft_volume;
 }
 
+/* Called from thread context. Tells a filter whether it may return
+ * planar blocks from pop(), which is the case if our sink can process
+ * them and they would reach it without any conversion. */
+bool pa_sink_input_pop_planar(pa_sink_input *i) {
+    pa_sink_input_assert_ref(i);
+    pa_sink_input_assert_io_context(i);
+
+    return i->sink->thread_info.accept_planar &&
+        i->thread_info.sample_spec.format == PA_SAMPLE_FLOAT32NE &&
+        !i->thread_info.resampler &&
+        pa_channel_map_equal(&i->channel_map, &i->sink->channel_map) &&
+        pa_cvolume_is_norm(&i->thread_info.soft_volume) &&
+        !i->thread_info.muted &&
+        pa_cvolume_is_norm(&i->volume_factor_sink);
+}
+
 /* Called from thread context */
 void pa_sink_input_drop(pa_sink_input *i, size_t nbytes /* in sink sample spec */) {
 
@@ -1105,6 +1136,8 @@ void pa_sink_input_process_rewind(pa_sink_input *i, size_t nbytes /* in sink sam
         amount = PA_MIN(i->thread_info.rewrite_nbytes, max_rewrite);
 
         if (amount > 0) {
+            size_t sink_amount = amount;
+
             pa_log_debug("Have to rewind %lu bytes on implementor.", (unsigned long) amount);
 
             /* Tell the implementor */
@@ -1114,18 +1147,19 @@ void pa_sink_input_process_rewind(pa_sink_input *i, size_t nbytes /* in sink sam
 
             /* Convert back to to sink domain */
             if (i->thread_info.resampler)
-                amount = pa_resampler_result(i->thread_info.resampler, amount);
+                sink_amount = pa_resampler_result(i->thread_info.resampler, amount);
 
-            if (amount > 0)
+            if (sink_amount > 0)
                 /* Ok, now update the write pointer */
-                pa_memblockq_seek(i->thread_info.render_memblockq, - ((int64_t) amount), PA_SEEK_RELATIVE, true);
+                pa_memblockq_seek(i->thread_info.render_memblockq, - ((int64_t) sink_amount), PA_SEEK_RELATIVE, true);
 
             if (i->thread_info.rewrite_flush)
                 pa_memblockq_silence(i->thread_info.render_memblockq);
 
-            /* And reset the resampler */
+            /* And bring the resampler back to the state it had at the
+             * rewind point, or reset it if that's not possible */
             if (i->thread_info.resampler)
-                pa_resampler_reset(i->thread_info.resampler);
+                pa_resampler_rewind(i->thread_info.resampler, amount);
         }
     }
 
@@ -1166,6 +1200,9 @@ void pa_sink_input_update_max_rewind(pa_sink_input *i, size_t nbytes  /* in the
 
     pa_memblockq_set_maxrewind(i->thread_info.render_memblockq, nbytes);
 
+    if (i->thread_info.resampler)
+        pa_resampler_set_max_rewind(i->thread_info.resampler, pa_resampler_request(i->thread_info.resampler, nbytes));
+
     if (i->update_max_rewind)
         i->update_max_rewind(i, i->thread_info.resampler ? pa_resampler_request(i->thread_info.resampler, nbytes) : nbytes);
 }
@@ -132,7 +132,8 @@ struct pa_sink_input {
      * specified length request_nbytes. This is an optimization
      * only. If less data is available, it's fine to return a smaller
      * block. If more data is already ready, it is better to return
-     * the full block. */
+     * the full block. Filters may return a planar block if
+     * pa_sink_input_pop_planar() says so. */
     int (*pop) (pa_sink_input *i, size_t request_nbytes, pa_memchunk *chunk); /* may NOT be NULL */
 
     /* This is called when the playback buffer has actually played back
@@ -402,6 +403,7 @@ pa_usec_t pa_sink_input_get_requested_latency(pa_sink_input *i);
 
 void pa_sink_input_peek(pa_sink_input *i, size_t length, pa_memchunk *chunk, pa_cvolume *volume);
 void pa_sink_input_drop(pa_sink_input *i, size_t length);
+bool pa_sink_input_pop_planar(pa_sink_input *i);
 void pa_sink_input_process_rewind(pa_sink_input *i, size_t nbytes /* in the sink's sample spec */);
 void pa_sink_input_update_max_rewind(pa_sink_input *i, size_t nbytes  /* in the sink's sample spec */);
 void pa_sink_input_update_max_request(pa_sink_input *i, size_t nbytes  /* in the sink's sample spec */);
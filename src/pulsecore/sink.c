@@ -328,13 +328,16 @@ pa_sink* pa_sink_new(
     s->thread_info.inputs = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
     s->thread_info.soft_volume =  s->soft_volume;
     s->thread_info.soft_muted = s->muted;
+    s->thread_info.accept_planar = false;
     s->thread_info.state = s->state;
     s->thread_info.rewind_nbytes = 0;
     s->thread_info.rewind_requested = false;
+    pa_zero(s->thread_info.rewind_stats);
     s->thread_info.max_rewind = 0;
     s->thread_info.max_request = 0;
     s->thread_info.requested_latency_valid = false;
     s->thread_info.requested_latency = 0;
+    s->thread_info.render_depth = 0;
     s->thread_info.min_latency = ABSOLUTE_MIN_LATENCY;
     s->thread_info.max_latency = ABSOLUTE_MAX_LATENCY;
     s->thread_info.fixed_latency = flags & PA_SINK_DYNAMIC_LATENCY ? 0 : DEFAULT_FIXED_LATENCY;
@@ -346,6 +349,12 @@ pa_sink* pa_sink_new(
     s->thread_info.volume_change_extra_delay = core->deferred_volume_extra_delay_usec;
     s->thread_info.latency_offset = s->latency_offset;
 
+    pa_seqlock_init(&s->published.lock);
+    s->published.latency_valid = false;
+    s->published.requested_latency_valid = false;
+    s->published.max_rewind = 0;
+    s->published.max_request = 0;
+
     /* FIXME: This should probably be moved to pa_sink_put() */
     pa_assert_se(pa_idxset_put(core->sinks, s, &s->index) >= 0);
 
@@ -585,6 +594,14 @@ void pa_sink_put(pa_sink* s) {
     pa_assert(s->asyncmsgq);
     pa_assert(s->thread_info.min_latency <= s->thread_info.max_latency);
 
+    /* Implementors may have set thread_info.max_rewind or max_request
+     * directly, the main thread only sees the published values once we
+     * are linked */
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.max_rewind = s->thread_info.max_rewind;
+    s->published.max_request = s->thread_info.max_request;
+    pa_seqlock_write_end(&s->published.lock);
+
     /* Generally, flags should be initialized via pa_sink_new(). As a
      * special exception we allow some volume related flags to be set
      * between _new() and _put() by the callback setter functions above.
@@ -754,6 +771,12 @@ void pa_sink_set_asyncmsgq(pa_sink *s, pa_asyncmsgq *q) {
 
     s->asyncmsgq = q;
 
+    /* Posted messages that request rewinds (seeks, new data) often
+     * arrive in bursts. Handling them in one go lets the requests
+     * collapse into a single rewind before the next render. */
+    if (q)
+        pa_asyncmsgq_set_batch(q, true);
+
     if (s->monitor_source)
         pa_source_set_asyncmsgq(s->monitor_source, q);
 }
@@ -960,6 +983,65 @@ size_t pa_sink_process_input_underruns(pa_sink *s, size_t left_to_play) {
     return left_to_play - result;
 }
 
+/* Called from IO thread context, with length being what was just
+ * rendered but not handed to the device yet */
+static void publish_latency(pa_sink *s, size_t length) {
+    pa_usec_t usec = 0;
+    pa_msgobject *o;
+    bool valid;
+
+    if (!(s->flags & PA_SINK_LATENCY))
+        return;
+
+    o = PA_MSGOBJECT(s);
+    valid = o->process_msg(o, PA_SINK_MESSAGE_GET_LATENCY, &usec, 0, NULL) >= 0;
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.latency_valid = valid;
+    s->published.latency = usec + pa_bytes_to_usec(length, &s->sample_spec);
+    s->published.latency_at = pa_rtclock_now();
+    pa_seqlock_write_end(&s->published.lock);
+}
+
+/* Called from IO thread context */
+static void invalidate_published_latency(pa_sink *s) {
+    if (!s->published.latency_valid)
+        return;
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.latency_valid = false;
+    pa_seqlock_write_end(&s->published.lock);
+}
+
+/* Called from IO thread context */
+static pa_usec_t publish_requested_latency(pa_sink *s) {
+    pa_usec_t usec;
+
+    usec = pa_sink_get_requested_latency_within_thread(s);
+
+    /* Yes, that's right, the IO thread will see -1 when no
+     * explicit requested latency is configured, the main
+     * thread will see max_latency */
+    if (usec == (pa_usec_t) -1)
+        usec = s->thread_info.max_latency;
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.requested_latency_valid = true;
+    s->published.requested_latency = usec;
+    pa_seqlock_write_end(&s->published.lock);
+
+    return usec;
+}
+
+/* Called from IO thread context */
+static void render_done(pa_sink *s, size_t length) {
+    pa_assert(s->thread_info.render_depth > 0);
+
+    /* Only the outermost call knows how much is left for the device */
+    if (--s->thread_info.render_depth == 0)
+        publish_latency(s, length);
+}
+
 /* Called from IO thread context */
 void pa_sink_process_rewind(pa_sink *s, size_t nbytes) {
     pa_sink_input *i;
@@ -981,8 +1063,15 @@ void pa_sink_process_rewind(pa_sink *s, size_t nbytes) {
 
     if (nbytes > 0) {
         pa_log_debug("Processing rewind...");
+
+        s->thread_info.rewind_stats.n_rewinds++;
+        s->thread_info.rewind_stats.rewound_bytes += nbytes;
+
         if (s->flags & PA_SINK_DEFERRED_VOLUME)
             pa_sink_volume_change_rewind(s, nbytes);
+
+        /* Until the next render the main thread has to ask */
+        invalidate_published_latency(s);
     }
 
     PA_HASHMAP_FOREACH(i, s->thread_info.inputs, state) {
@@ -1036,6 +1125,15 @@ static unsigned fill_mix_info(pa_sink *s, size_t *length, pa_mix_info *info, uns
     return n;
 }
 
+/* Called from IO thread context */
+static void mix_info_interleave(pa_sink *s, pa_mix_info *info, unsigned n) {
+
+    /* pa_mix() and everything that copies bytes around needs
+     * interleaved data */
+    for (; n > 0; info++, n--)
+        pa_memchunk_interleave(&info->chunk, &s->sample_spec, s->core->mempool);
+}
+
 /* Called from IO thread context */
 static void inputs_drop(pa_sink *s, pa_mix_info *info, unsigned n, pa_memchunk *result) {
     pa_sink_input *i;
@@ -1086,6 +1184,7 @@ static void inputs_drop(pa_sink *s, pa_mix_info *info, unsigned n, pa_memchunk *
                     pa_assert(result->length <= c.length);
                     c.length = result->length;
 
+                    pa_memchunk_interleave(&c, &s->sample_spec, s->core->mempool);
                     pa_memchunk_make_writable(&c, 0);
                     pa_volume_memchunk(&c, &s->sample_spec, &m->volume);
                 } else {
@@ -1129,8 +1228,19 @@ static void inputs_drop(pa_sink *s, pa_mix_info *info, unsigned n, pa_memchunk *
         }
     }
 
-    if (s->monitor_source && PA_SOURCE_IS_LINKED(s->monitor_source->thread_info.state))
-        pa_source_post(s->monitor_source, result);
+    if (s->monitor_source && PA_SOURCE_IS_LINKED(s->monitor_source->thread_info.state)) {
+
+        if (pa_memblock_is_planar(result->memblock) &&
+            PA_SOURCE_IS_OPENED(s->monitor_source->thread_info.state)) {
+            pa_memchunk c = *result;
+
+            pa_memblock_ref(c.memblock);
+            pa_memchunk_interleave(&c, &s->sample_spec, s->core->mempool);
+            pa_source_post(s->monitor_source, &c);
+            pa_memblock_unref(c.memblock);
+        } else
+            pa_source_post(s->monitor_source, result);
+    }
 }
 
 /* Called from IO thread context */
@@ -1156,6 +1266,7 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
     }
 
     pa_sink_ref(s);
+    s->thread_info.render_depth++;
 
     if (length <= 0)
         length = pa_frame_align(MIX_BUFFER_LENGTH, &s->sample_spec);
@@ -1195,11 +1306,14 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
                                     &s->sample_spec,
                                     result->length);
         } else if (!pa_cvolume_is_norm(&volume)) {
+            pa_memchunk_interleave(result, &s->sample_spec, s->core->mempool);
             pa_memchunk_make_writable(result, 0);
             pa_volume_memchunk(result, &s->sample_spec, &volume);
         }
     } else {
         void *ptr;
+
+        mix_info_interleave(s, info, n);
         result->memblock = pa_memblock_new(s->core->mempool, length);
 
         ptr = pa_memblock_acquire(result->memblock);
@@ -1215,6 +1329,7 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
 
     inputs_drop(s, info, n, result);
 
+    render_done(s, result->length);
     pa_sink_unref(s);
 }
 
@@ -1241,6 +1356,7 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
     }
 
     pa_sink_ref(s);
+    s->thread_info.render_depth++;
 
     length = target->length;
     block_size_max = pa_mempool_block_size_max(s->core->mempool);
@@ -1250,6 +1366,7 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
     pa_assert(length > 0);
 
     n = fill_mix_info(s, &length, info, MAX_MIX_CHANNELS);
+    mix_info_interleave(s, info, n);
 
     if (n == 0) {
         if (target->length > length)
@@ -1300,6 +1417,7 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
 
     inputs_drop(s, info, n, target);
 
+    render_done(s, target->length);
     pa_sink_unref(s);
 }
 
@@ -1325,6 +1443,7 @@ void pa_sink_render_into_full(pa_sink *s, pa_memchunk *target) {
     }
 
     pa_sink_ref(s);
+    s->thread_info.render_depth++;
 
     l = target->length;
     d = 0;
@@ -1339,6 +1458,7 @@ void pa_sink_render_into_full(pa_sink *s, pa_memchunk *target) {
         l -= chunk.length;
     }
 
+    render_done(s, target->length);
     pa_sink_unref(s);
 }
 
@@ -1355,12 +1475,14 @@ void pa_sink_render_full(pa_sink *s, size_t length, pa_memchunk *result) {
     pa_assert(s->thread_info.rewind_nbytes == 0);
 
     pa_sink_ref(s);
+    s->thread_info.render_depth++;
 
     pa_sink_render(s, length, result);
 
     if (result->length < length) {
         pa_memchunk chunk;
 
+        pa_memchunk_interleave(result, &s->sample_spec, s->core->mempool);
         pa_memchunk_make_writable(result, length);
 
         chunk.memblock = result->memblock;
@@ -1372,6 +1494,7 @@ void pa_sink_render_full(pa_sink *s, size_t length, pa_memchunk *result) {
         result->length = length;
     }
 
+    render_done(s, result->length);
     pa_sink_unref(s);
 }
 
@@ -1460,6 +1583,31 @@ bool pa_sink_update_rate(pa_sink *s, uint32_t rate, bool passthrough) {
     return ret ;
 }
 
+/* Called from main thread */
+static int get_published_latency(pa_sink *s, pa_usec_t *usec) {
+    pa_usec_t latency, latency_at, now;
+    bool valid;
+    int seq;
+
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        valid = s->published.latency_valid;
+        latency = s->published.latency;
+        latency_at = s->published.latency_at;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
+
+    if (!valid)
+        return -1;
+
+    /* The device kept on playing since the last render */
+    now = pa_rtclock_now();
+    if (now > latency_at)
+        latency = latency > now - latency_at ? latency - (now - latency_at) : 0;
+
+    *usec = latency;
+    return 0;
+}
+
 /* Called from main thread */
 pa_usec_t pa_sink_get_latency(pa_sink *s) {
     pa_usec_t usec = 0;
@@ -1476,7 +1624,8 @@ pa_usec_t pa_sink_get_latency(pa_sink *s) {
     if (!(s->flags & PA_SINK_LATENCY))
         return 0;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_LATENCY, &usec, 0, NULL) == 0);
+    if (get_published_latency(s, &usec) < 0)
+        pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_LATENCY, &usec, 0, NULL) == 0);
 
     /* usec is unsigned, so check that the offset can be added to usec without
      * underflowing. */
@@ -2774,6 +2923,7 @@ int pa_sink_process_msg(pa_msgobject *o, int code, void *userdata, int64_t offse
                 (PA_SINK_IS_OPENED(s->thread_info.state) && PA_PTR_TO_UINT(userdata) == PA_SINK_SUSPENDED);
 
             s->thread_info.state = PA_PTR_TO_UINT(userdata);
+            invalidate_published_latency(s);
 
             if (s->thread_info.state == PA_SINK_SUSPENDED) {
                 s->thread_info.rewind_nbytes = 0;
@@ -2807,13 +2957,7 @@ int pa_sink_process_msg(pa_msgobject *o, int code, void *userdata, int64_t offse
         case PA_SINK_MESSAGE_GET_REQUESTED_LATENCY: {
 
             pa_usec_t *usec = userdata;
-            *usec = pa_sink_get_requested_latency_within_thread(s);
-
-            /* Yes, that's right, the IO thread will see -1 when no
-             * explicit requested latency is configured, the main
-             * thread will see max_latency */
-            if (*usec == (pa_usec_t) -1)
-                *usec = s->thread_info.max_latency;
+            *usec = publish_requested_latency(s);
 
             return 0;
         }
@@ -2855,6 +2999,11 @@ int pa_sink_process_msg(pa_msgobject *o, int code, void *userdata, int64_t offse
             *((size_t*) userdata) = s->thread_info.max_request;
             return 0;
 
+        case PA_SINK_MESSAGE_GET_REWIND_STATS:
+
+            *((pa_sink_rewind_stats*) userdata) = s->thread_info.rewind_stats;
+            return 0;
+
         case PA_SINK_MESSAGE_SET_MAX_REWIND:
 
             pa_sink_set_max_rewind_within_thread(s, (size_t) offset);
@@ -2981,9 +3130,14 @@ void pa_sink_request_rewind(pa_sink*s, size_t nbytes) {
 
     nbytes = PA_MIN(nbytes, s->thread_info.max_rewind);
 
-    if (s->thread_info.rewind_requested &&
-        nbytes <= s->thread_info.rewind_nbytes)
+    s->thread_info.rewind_stats.n_requests++;
+
+    /* If a rewind is already pending it will be processed once for
+     * the largest of all requested sizes in this cycle */
+    if (s->thread_info.rewind_requested && nbytes <= s->thread_info.rewind_nbytes) {
+        s->thread_info.rewind_stats.n_coalesced++;
         return;
+    }
 
     s->thread_info.rewind_nbytes = nbytes;
     s->thread_info.rewind_requested = true;
@@ -3034,6 +3188,8 @@ pa_usec_t pa_sink_get_requested_latency_within_thread(pa_sink *s) {
 /* Called from main thread */
 pa_usec_t pa_sink_get_requested_latency(pa_sink *s) {
     pa_usec_t usec = 0;
+    bool valid;
+    int seq;
 
     pa_sink_assert_ref(s);
     pa_assert_ctl_context();
@@ -3042,7 +3198,14 @@ pa_usec_t pa_sink_get_requested_latency(pa_sink *s) {
     if (s->state == PA_SINK_SUSPENDED)
         return 0;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_REQUESTED_LATENCY, &usec, 0, NULL) == 0);
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        valid = s->published.requested_latency_valid;
+        usec = s->published.requested_latency;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
+
+    if (!valid)
+        pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_REQUESTED_LATENCY, &usec, 0, NULL) == 0);
 
     return usec;
 }
@@ -3060,6 +3223,10 @@ void pa_sink_set_max_rewind_within_thread(pa_sink *s, size_t max_rewind) {
 
     s->thread_info.max_rewind = max_rewind;
 
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.max_rewind = max_rewind;
+    pa_seqlock_write_end(&s->published.lock);
+
     if (PA_SINK_IS_LINKED(s->thread_info.state))
         PA_HASHMAP_FOREACH(i, s->thread_info.inputs, state)
             pa_sink_input_update_max_rewind(i, s->thread_info.max_rewind);
@@ -3091,6 +3258,10 @@ void pa_sink_set_max_request_within_thread(pa_sink *s, size_t max_request) {
 
     s->thread_info.max_request = max_request;
 
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.max_request = max_request;
+    pa_seqlock_write_end(&s->published.lock);
+
     if (PA_SINK_IS_LINKED(s->thread_info.state)) {
         pa_sink_input *i;
 
@@ -3131,6 +3302,8 @@ void pa_sink_invalidate_requested_latency(pa_sink *s, bool dynamic) {
         PA_HASHMAP_FOREACH(i, s->thread_info.inputs, state)
             if (i->update_sink_requested_latency)
                 i->update_sink_requested_latency(i);
+
+        publish_requested_latency(s);
     }
 }
 
@@ -3248,6 +3421,16 @@ void pa_sink_set_fixed_latency(pa_sink *s, pa_usec_t latency) {
     pa_source_set_fixed_latency(s->monitor_source, latency);
 }
 
+/* Called from main thread, before pa_sink_put() */
+void pa_sink_set_accept_planar(pa_sink *s, bool accept) {
+    pa_sink_assert_ref(s);
+    pa_assert_ctl_context();
+    pa_assert(s->state == PA_SINK_INIT);
+    pa_assert(!accept || s->sample_spec.format == PA_SAMPLE_FLOAT32NE);
+
+    s->thread_info.accept_planar = accept;
+}
+
 /* Called from main thread */
 pa_usec_t pa_sink_get_fixed_latency(pa_sink *s) {
     pa_usec_t latency;
@@ -3318,13 +3501,17 @@ void pa_sink_set_latency_offset(pa_sink *s, int64_t offset) {
 /* Called from main context */
 size_t pa_sink_get_max_rewind(pa_sink *s) {
     size_t r;
+    int seq;
     pa_assert_ctl_context();
     pa_sink_assert_ref(s);
 
     if (!PA_SINK_IS_LINKED(s->state))
         return s->thread_info.max_rewind;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_MAX_REWIND, &r, 0, NULL) == 0);
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        r = s->published.max_rewind;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
 
     return r;
 }
@@ -3332,17 +3519,35 @@ size_t pa_sink_get_max_rewind(pa_sink *s) {
 /* Called from main context */
 size_t pa_sink_get_max_request(pa_sink *s) {
     size_t r;
+    int seq;
     pa_sink_assert_ref(s);
     pa_assert_ctl_context();
 
     if (!PA_SINK_IS_LINKED(s->state))
         return s->thread_info.max_request;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_MAX_REQUEST, &r, 0, NULL) == 0);
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        r = s->published.max_request;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
 
     return r;
 }
 
+/* Called from main context */
+void pa_sink_get_rewind_stats(pa_sink *s, pa_sink_rewind_stats *stats) {
+    pa_sink_assert_ref(s);
+    pa_assert_ctl_context();
+    pa_assert(stats);
+
+    if (!PA_SINK_IS_LINKED(s->state)) {
+        *stats = s->thread_info.rewind_stats;
+        return;
+    }
+
+    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SINK_MESSAGE_GET_REWIND_STATS, stats, 0, NULL) == 0);
+}
+
 /* Called from main context */
 int pa_sink_set_port(pa_sink *s, const char *name, bool save) {
     pa_device_port *port;
@@ -45,6 +45,7 @@ typedef struct pa_sink_volume_change pa_sink_volume_change;
 #include <pulsecore/device-port.h>
 #include <pulsecore/card.h>
 #include <pulsecore/queue.h>
+#include <pulsecore/seqlock.h>
 #include <pulsecore/thread-mq.h>
 #include <pulsecore/sink-input.h>
 
@@ -58,6 +59,18 @@ static inline bool PA_SINK_IS_LINKED(pa_sink_state_t x) {
 /* A generic definition for void callback functions */
 typedef void(*pa_sink_cb_t)(pa_sink *s);
 
+/* Rewind accounting, maintained by the IO thread */
+typedef struct pa_sink_rewind_stats {
+    /* Number of calls to pa_sink_request_rewind() */
+    uint64_t n_requests;
+    /* Requests that were covered by an already pending rewind */
+    uint64_t n_coalesced;
+    /* Rewinds that were actually processed */
+    uint64_t n_rewinds;
+    /* Bytes that had to be rendered a second time due to rewinds */
+    uint64_t rewound_bytes;
+} pa_sink_rewind_stats;
+
 struct pa_sink {
     pa_msgobject parent;
 
@@ -243,6 +256,12 @@ struct pa_sink {
         pa_cvolume soft_volume;
         bool soft_muted:1;
 
+        /* If set, filter inputs may hand out planar float blocks (see
+         * pa_memblock_is_planar()) and the implementor of this sink
+         * has to be able to process what pa_sink_render() returns in
+         * that layout. */
+        bool accept_planar:1;
+
         /* The requested latency is used for dynamic latency
          * sinks. For fixed latency sinks it is always identical to
          * the fixed_latency. See below. */
@@ -257,10 +276,15 @@ struct pa_sink {
          * every DMA write request */
         size_t max_request;
 
+        /* How deep pa_sink_render() and friends are nested right now */
+        unsigned render_depth;
+
         /* Maximum of what clients requested to rewind in this cycle */
         size_t rewind_nbytes;
         bool rewind_requested;
 
+        pa_sink_rewind_stats rewind_stats;
+
         /* Both dynamic and fixed latencies will be clamped to this
          * range. */
         pa_usec_t min_latency; /* we won't go below this latency */
@@ -290,6 +314,25 @@ struct pa_sink {
         int32_t volume_change_extra_delay;
     } thread_info;
 
+    /* Copies of some of the thread_info fields that the IO thread keeps
+     * up to date, so that the main thread can read them without a round
+     * trip through the asyncmsgq. Written by the IO thread only. */
+    struct {
+        pa_seqlock lock;
+
+        /* The latency (without latency_offset) right after the last
+         * render, and when that was */
+        bool latency_valid;
+        pa_usec_t latency;
+        pa_usec_t latency_at;
+
+        bool requested_latency_valid;
+        pa_usec_t requested_latency;
+
+        size_t max_rewind;
+        size_t max_request;
+    } published;
+
     void *userdata;
 };
 
@@ -324,6 +367,7 @@ typedef enum pa_sink_message {
     PA_SINK_MESSAGE_SET_PORT,
     PA_SINK_MESSAGE_UPDATE_VOLUME_AND_MUTE,
     PA_SINK_MESSAGE_SET_LATENCY_OFFSET,
+    PA_SINK_MESSAGE_GET_REWIND_STATS,
     PA_SINK_MESSAGE_MAX
 } pa_sink_message_t;
 
@@ -394,6 +438,7 @@ void pa_sink_set_max_rewind(pa_sink *s, size_t max_rewind);
 void pa_sink_set_max_request(pa_sink *s, size_t max_request);
 void pa_sink_set_latency_range(pa_sink *s, pa_usec_t min_latency, pa_usec_t max_latency);
 void pa_sink_set_fixed_latency(pa_sink *s, pa_usec_t latency);
+void pa_sink_set_accept_planar(pa_sink *s, bool accept);
 
 void pa_sink_detach(pa_sink *s);
 void pa_sink_attach(pa_sink *s);
@@ -422,6 +467,7 @@ pa_usec_t pa_sink_get_fixed_latency(pa_sink *s);
 
 size_t pa_sink_get_max_rewind(pa_sink *s);
 size_t pa_sink_get_max_request(pa_sink *s);
+void pa_sink_get_rewind_stats(pa_sink *s, pa_sink_rewind_stats *stats);
 
 int pa_sink_update_status(pa_sink*s);
 int pa_sink_suspend(pa_sink *s, bool suspend, pa_suspend_cause_t cause);
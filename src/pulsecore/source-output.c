@@ -843,6 +843,8 @@ void pa_source_output_process_rewind(pa_source_output *o, size_t nbytes /* in so
         return;
 
     if (o->process_rewind) {
+        size_t source_nbytes = nbytes;
+
         pa_assert(pa_memblockq_get_length(o->thread_info.delay_memblockq) == 0);
 
         if (o->thread_info.resampler)
@@ -854,7 +856,7 @@ void pa_source_output_process_rewind(pa_source_output *o, size_t nbytes /* in so
             o->process_rewind(o, nbytes);
 
         if (o->thread_info.resampler)
-            pa_resampler_reset(o->thread_info.resampler);
+            pa_resampler_rewind(o->thread_info.resampler, source_nbytes);
 
     } else
         pa_memblockq_rewind(o->thread_info.delay_memblockq, nbytes);
@@ -875,6 +877,9 @@ void pa_source_output_update_max_rewind(pa_source_output *o, size_t nbytes  /* i
     pa_assert(PA_SOURCE_OUTPUT_IS_LINKED(o->thread_info.state));
     pa_assert(pa_frame_aligned(nbytes, &o->source->sample_spec));
 
+    if (o->thread_info.resampler && o->process_rewind)
+        pa_resampler_set_max_rewind(o->thread_info.resampler, nbytes);
+
     if (o->update_max_rewind)
         o->update_max_rewind(o, o->thread_info.resampler ? pa_resampler_result(o->thread_info.resampler, nbytes) : nbytes);
 }
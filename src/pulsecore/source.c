@@ -331,6 +331,11 @@ pa_source* pa_source_new(
     s->thread_info.volume_change_extra_delay = core->deferred_volume_extra_delay_usec;
     s->thread_info.latency_offset = s->latency_offset;
 
+    pa_seqlock_init(&s->published.lock);
+    s->published.latency_valid = false;
+    s->published.requested_latency_valid = false;
+    s->published.max_rewind = 0;
+
     /* FIXME: This should probably be moved to pa_source_put() */
     pa_assert_se(pa_idxset_put(core->sources, s, &s->index) >= 0);
 
@@ -536,6 +541,12 @@ void pa_source_put(pa_source *s) {
     pa_assert(s->asyncmsgq);
     pa_assert(s->thread_info.min_latency <= s->thread_info.max_latency);
 
+    /* Implementors may have set thread_info.max_rewind directly, the
+     * main thread only sees the published value once we are linked */
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.max_rewind = s->thread_info.max_rewind;
+    pa_seqlock_write_end(&s->published.lock);
+
     /* Generally, flags should be initialized via pa_source_new(). As a
      * special exception we allow some volume related flags to be set
      * between _new() and _put() by the callback setter functions above.
@@ -893,6 +904,58 @@ void pa_source_process_rewind(pa_source *s, size_t nbytes) {
     }
 }
 
+/* Called from IO thread context, with length being what was just
+ * posted. The drivers count it as read only once pa_source_post()
+ * returned, so their latency still includes it. */
+static void publish_latency(pa_source *s, size_t length) {
+    pa_usec_t usec = 0, posted;
+    pa_msgobject *o;
+    bool valid;
+
+    if (!(s->flags & PA_SOURCE_LATENCY))
+        return;
+
+    o = PA_MSGOBJECT(s);
+    valid = o->process_msg(o, PA_SOURCE_MESSAGE_GET_LATENCY, &usec, 0, NULL) >= 0;
+    posted = pa_bytes_to_usec(length, &s->sample_spec);
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.latency_valid = valid;
+    s->published.latency = usec > posted ? usec - posted : 0;
+    s->published.latency_at = pa_rtclock_now();
+    pa_seqlock_write_end(&s->published.lock);
+}
+
+/* Called from IO thread context */
+static void invalidate_published_latency(pa_source *s) {
+    if (!s->published.latency_valid)
+        return;
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.latency_valid = false;
+    pa_seqlock_write_end(&s->published.lock);
+}
+
+/* Called from IO thread context */
+static pa_usec_t publish_requested_latency(pa_source *s) {
+    pa_usec_t usec;
+
+    usec = pa_source_get_requested_latency_within_thread(s);
+
+    /* Yes, that's right, the IO thread will see -1 when no
+     * explicit requested latency is configured, the main
+     * thread will see max_latency */
+    if (usec == (pa_usec_t) -1)
+        usec = s->thread_info.max_latency;
+
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.requested_latency_valid = true;
+    s->published.requested_latency = usec;
+    pa_seqlock_write_end(&s->published.lock);
+
+    return usec;
+}
+
 /* Called from IO thread context */
 void pa_source_post(pa_source*s, const pa_memchunk *chunk) {
     pa_source_output *o;
@@ -934,6 +997,8 @@ void pa_source_post(pa_source*s, const pa_memchunk *chunk) {
                 pa_source_output_push(o, chunk);
         }
     }
+
+    publish_latency(s, chunk->length);
 }
 
 /* Called from IO thread context */
@@ -1040,6 +1105,32 @@ bool pa_source_update_rate(pa_source *s, uint32_t rate, bool passthrough) {
     return ret;
 }
 
+/* Called from main thread */
+static int get_published_latency(pa_source *s, pa_usec_t *usec) {
+    pa_usec_t latency, latency_at, now;
+    bool valid;
+    int seq;
+
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        valid = s->published.latency_valid;
+        latency = s->published.latency;
+        latency_at = s->published.latency_at;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
+
+    if (!valid)
+        return -1;
+
+    /* The device kept on recording since the last post. Monitor
+     * sources are fed directly by the rendering and have none. */
+    now = pa_rtclock_now();
+    if (!s->monitor_of && now > latency_at)
+        latency += now - latency_at;
+
+    *usec = latency;
+    return 0;
+}
+
 /* Called from main thread */
 pa_usec_t pa_source_get_latency(pa_source *s) {
     pa_usec_t usec;
@@ -1054,7 +1145,8 @@ pa_usec_t pa_source_get_latency(pa_source *s) {
     if (!(s->flags & PA_SOURCE_LATENCY))
         return 0;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SOURCE_MESSAGE_GET_LATENCY, &usec, 0, NULL) == 0);
+    if (get_published_latency(s, &usec) < 0)
+        pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SOURCE_MESSAGE_GET_LATENCY, &usec, 0, NULL) == 0);
 
     /* usec is unsigned, so check that the offset can be added to usec without
      * underflowing. */
@@ -2107,6 +2199,7 @@ int pa_source_process_msg(pa_msgobject *object, int code, void *userdata, int64_
                 (PA_SOURCE_IS_OPENED(s->thread_info.state) && PA_PTR_TO_UINT(userdata) == PA_SOURCE_SUSPENDED);
 
             s->thread_info.state = PA_PTR_TO_UINT(userdata);
+            invalidate_published_latency(s);
 
             if (suspend_change) {
                 pa_source_output *o;
@@ -2135,13 +2228,7 @@ int pa_source_process_msg(pa_msgobject *object, int code, void *userdata, int64_
         case PA_SOURCE_MESSAGE_GET_REQUESTED_LATENCY: {
 
             pa_usec_t *usec = userdata;
-            *usec = pa_source_get_requested_latency_within_thread(s);
-
-            /* Yes, that's right, the IO thread will see -1 when no
-             * explicit requested latency is configured, the main
-             * thread will see max_latency */
-            if (*usec == (pa_usec_t) -1)
-                *usec = s->thread_info.max_latency;
+            *usec = publish_requested_latency(s);
 
             return 0;
         }
@@ -2329,6 +2416,8 @@ pa_usec_t pa_source_get_requested_latency_within_thread(pa_source *s) {
 /* Called from main thread */
 pa_usec_t pa_source_get_requested_latency(pa_source *s) {
     pa_usec_t usec = 0;
+    bool valid;
+    int seq;
 
     pa_source_assert_ref(s);
     pa_assert_ctl_context();
@@ -2337,7 +2426,14 @@ pa_usec_t pa_source_get_requested_latency(pa_source *s) {
     if (s->state == PA_SOURCE_SUSPENDED)
         return 0;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SOURCE_MESSAGE_GET_REQUESTED_LATENCY, &usec, 0, NULL) == 0);
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        valid = s->published.requested_latency_valid;
+        usec = s->published.requested_latency;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
+
+    if (!valid)
+        pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SOURCE_MESSAGE_GET_REQUESTED_LATENCY, &usec, 0, NULL) == 0);
 
     return usec;
 }
@@ -2355,6 +2451,10 @@ void pa_source_set_max_rewind_within_thread(pa_source *s, size_t max_rewind) {
 
     s->thread_info.max_rewind = max_rewind;
 
+    pa_seqlock_write_begin(&s->published.lock);
+    s->published.max_rewind = max_rewind;
+    pa_seqlock_write_end(&s->published.lock);
+
     if (PA_SOURCE_IS_LINKED(s->thread_info.state))
         PA_HASHMAP_FOREACH(o, s->thread_info.outputs, state)
             pa_source_output_update_max_rewind(o, s->thread_info.max_rewind);
@@ -2392,6 +2492,8 @@ void pa_source_invalidate_requested_latency(pa_source *s, bool dynamic) {
         while ((o = pa_hashmap_iterate(s->thread_info.outputs, &state, NULL)))
             if (o->update_source_requested_latency)
                 o->update_source_requested_latency(o);
+
+        publish_requested_latency(s);
     }
 
     if (s->monitor_of)
@@ -2574,13 +2676,17 @@ void pa_source_set_latency_offset(pa_source *s, int64_t offset) {
 /* Called from main thread */
 size_t pa_source_get_max_rewind(pa_source *s) {
     size_t r;
+    int seq;
     pa_assert_ctl_context();
     pa_source_assert_ref(s);
 
     if (!PA_SOURCE_IS_LINKED(s->state))
         return s->thread_info.max_rewind;
 
-    pa_assert_se(pa_asyncmsgq_send(s->asyncmsgq, PA_MSGOBJECT(s), PA_SOURCE_MESSAGE_GET_MAX_REWIND, &r, 0, NULL) == 0);
+    do {
+        seq = pa_seqlock_read_begin(&s->published.lock);
+        r = s->published.max_rewind;
+    } while (pa_seqlock_read_retry(&s->published.lock, seq));
 
     return r;
 }
@@ -45,6 +45,7 @@ typedef struct pa_source_volume_change pa_source_volume_change;
 #include <pulsecore/card.h>
 #include <pulsecore/device-port.h>
 #include <pulsecore/queue.h>
+#include <pulsecore/seqlock.h>
 #include <pulsecore/thread-mq.h>
 #include <pulsecore/source-output.h>
 
@@ -231,6 +232,24 @@ struct pa_source {
         int32_t volume_change_extra_delay;
     } thread_info;
 
+    /* Copies of some of the thread_info fields that the IO thread keeps
+     * up to date, so that the main thread can read them without a round
+     * trip through the asyncmsgq. Written by the IO thread only. */
+    struct {
+        pa_seqlock lock;
+
+        /* The latency (without latency_offset) right after the last
+         * post, and when that was */
+        bool latency_valid;
+        pa_usec_t latency;
+        pa_usec_t latency_at;
+
+        bool requested_latency_valid;
+        pa_usec_t requested_latency;
+
+        size_t max_rewind;
+    } published;
+
     void *userdata;
 };
 
@@ -0,0 +1,167 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulsecore/macro.h>
+#include <pulsecore/log.h>
+#include <pulsecore/endianmacros.h>
+
+#include "cpu-x86.h"
+#include "sample-util.h"
+
+/* This file is built with AVX2_CFLAGS, the functions in here must only
+ * be called after the CPU and OS support for AVX2 has been verified. */
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__)
+
+#include <immintrin.h>
+
+/* 16 samples per iteration. We read up to 16 volumes past the current
+ * channel, so channels must be at least 16 and a multiple of the
+ * original number. The volume array has enough padding for that. */
+static const unsigned channel_overread_table[16] = {
+    16, 16, 16, 18, 16, 20, 18, 21, 16, 18, 20, 22, 24, 26, 28, 30
+};
+
+#define MOD_INC(channel, n, channels)                                   \
+    do {                                                                \
+        channel += n;                                                   \
+        if (channel >= channels)                                        \
+            channel -= channels;                                        \
+    } while (0)
+
+static inline __m256i bswap32(__m256i v) {
+    const __m256i mask = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    return _mm256_shuffle_epi8(v, mask);
+}
+
+/* floor(s * v / 0x10000) clamped to 32 bit, exact in double precision
+ * whenever the result is in range, see svolume_sse.c */
+static inline __m128i volume_s32_4(__m128i s, __m128i v) {
+    __m256d t;
+
+    t = _mm256_mul_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(s), _mm256_cvtepi32_pd(v)), _mm256_set1_pd(1.0 / 0x10000));
+    t = _mm256_min_pd(_mm256_max_pd(t, _mm256_set1_pd(-2147483648.0)), _mm256_set1_pd(2147483647.0));
+
+    return _mm256_cvtpd_epi32(_mm256_floor_pd(t));
+}
+
+static inline __m256i volume_s32_8(__m256i s, const int32_t *volumes) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) volumes);
+    __m128i lo, hi;
+
+    lo = volume_s32_4(_mm256_castsi256_si128(s), _mm256_castsi256_si128(v));
+    hi = volume_s32_4(_mm256_extracti128_si256(s, 1), _mm256_extracti128_si256(v, 1));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+static inline int32_t volume_s32_1(int32_t s, int32_t v) {
+    int64_t t;
+
+    t = ((int64_t) s * v) >> 16;
+    t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+
+    return (int32_t) t;
+}
+
+static inline __m256i load(const void *p, bool swap) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+
+    return swap ? bswap32(v) : v;
+}
+
+static inline void store(void *p, __m256i v, bool swap) {
+    _mm256_storeu_si256((__m256i *) p, swap ? bswap32(v) : v);
+}
+
+/* The volume functions only differ in the sample access: expr handles
+ * 8 samples at p, tail a single one at samples. */
+#define VOLUME_AVX2(name, type, vtype, swap, expr, tail)               \
+    static void name(type *samples, const vtype *volumes, unsigned channels, unsigned length) { \
+        unsigned channel = 0, orig_channels = channels;                 \
+                                                                        \
+        if (channels < 16)                                              \
+            channels = channel_overread_table[channels];                \
+                                                                        \
+        for (length /= sizeof(type); length >= 16; length -= 16, samples += 16) { \
+            expr(samples, swap);                                        \
+            expr(samples + 8, swap);                                    \
+            MOD_INC(channel, 16, channels);                             \
+        }                                                               \
+                                                                        \
+        for (channel %= orig_channels; length; length--, samples++) {   \
+            tail;                                                       \
+            MOD_INC(channel, 1, orig_channels);                         \
+        }                                                               \
+    }
+
+#define FLOAT_EXPR(p, swap)                                             \
+    store(p, _mm256_castps_si256(_mm256_mul_ps(_mm256_castsi256_ps(load(p, swap)), \
+                                               _mm256_loadu_ps(volumes + channel + ((p) - samples)))), swap)
+
+#define S32_EXPR(p, swap)                                               \
+    store(p, volume_s32_8(load(p, swap), volumes + channel + ((p) - samples)), swap)
+
+#define S24_32_EXPR(p, swap)                                            \
+    store(p, _mm256_srli_epi32(volume_s32_8(_mm256_slli_epi32(load(p, swap), 8), volumes + channel + ((p) - samples)), 8), swap)
+
+VOLUME_AVX2(pa_volume_float32ne_avx2, float, float, false, FLOAT_EXPR,
+            *samples *= volumes[channel])
+
+VOLUME_AVX2(pa_volume_float32re_avx2, float, float, true, FLOAT_EXPR,
+            float t = PA_FLOAT32_SWAP(*samples); t *= volumes[channel]; *samples = PA_FLOAT32_SWAP(t))
+
+VOLUME_AVX2(pa_volume_s32ne_avx2, int32_t, int32_t, false, S32_EXPR,
+            *samples = volume_s32_1(*samples, volumes[channel]))
+
+VOLUME_AVX2(pa_volume_s32re_avx2, int32_t, int32_t, true, S32_EXPR,
+            *samples = PA_INT32_SWAP(volume_s32_1(PA_INT32_SWAP(*samples), volumes[channel])))
+
+VOLUME_AVX2(pa_volume_s24_32ne_avx2, uint32_t, int32_t, false, S24_32_EXPR,
+            *samples = ((uint32_t) volume_s32_1((int32_t) (*samples << 8), volumes[channel])) >> 8)
+
+VOLUME_AVX2(pa_volume_s24_32re_avx2, uint32_t, int32_t, true, S24_32_EXPR,
+            uint32_t t = ((uint32_t) volume_s32_1((int32_t) (PA_UINT32_SWAP(*samples) << 8), volumes[channel])) >> 8;
+            *samples = PA_UINT32_SWAP(t))
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__) */
+
+void pa_volume_func_init_avx2(pa_cpu_x86_flag_t flags) {
+#if (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__)
+
+    if (flags & PA_CPU_X86_AVX2) {
+        pa_log_info("Initialising AVX2 optimized volume functions.");
+
+        pa_set_volume_func(PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_avx2);
+        pa_set_volume_func(PA_SAMPLE_FLOAT32RE, (pa_do_volume_func_t) pa_volume_float32re_avx2);
+        pa_set_volume_func(PA_SAMPLE_S32NE, (pa_do_volume_func_t) pa_volume_s32ne_avx2);
+        pa_set_volume_func(PA_SAMPLE_S32RE, (pa_do_volume_func_t) pa_volume_s32re_avx2);
+        pa_set_volume_func(PA_SAMPLE_S24_32NE, (pa_do_volume_func_t) pa_volume_s24_32ne_avx2);
+        pa_set_volume_func(PA_SAMPLE_S24_32RE, (pa_do_volume_func_t) pa_volume_s24_32re_avx2);
+    }
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__AVX2__) */
+}
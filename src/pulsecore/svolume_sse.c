@@ -253,6 +253,241 @@ static void pa_volume_s16re_sse2(int16_t *samples, const int32_t *volumes, unsig
 
 #endif /* defined (__i386__) || defined (__amd64__) */
 
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__)
+
+#include <emmintrin.h>
+
+/* The kernels below handle 8 samples at a time, with the same trick for
+ * the channel position as the s16 ones above. */
+
+static inline __m128i bswap32(__m128i v) {
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+/* floor(s * v / 0x10000) clamped to 32 bit, for two samples. The product
+ * is exact in double precision whenever the result is in range, so this
+ * matches the 64 bit integer arithmetic of the C versions. */
+static inline __m128i volume_s32_2(__m128i s, __m128i v) {
+    __m128d t, back;
+    __m128i i;
+
+    t = _mm_mul_pd(_mm_mul_pd(_mm_cvtepi32_pd(s), _mm_cvtepi32_pd(v)), _mm_set1_pd(1.0 / 0x10000));
+    t = _mm_min_pd(_mm_max_pd(t, _mm_set1_pd(-2147483648.0)), _mm_set1_pd(2147483647.0));
+
+    /* No floor before SSE4.1, truncate and correct the negative ones */
+    i = _mm_cvttpd_epi32(t);
+    back = _mm_cvtepi32_pd(i);
+
+    return _mm_add_epi32(i, _mm_shuffle_epi32(_mm_castpd_si128(_mm_cmplt_pd(t, back)), 0x08));
+}
+
+static inline __m128i volume_s32_4(__m128i s, const int32_t *volumes) {
+    __m128i v = _mm_loadu_si128((const __m128i *) volumes);
+
+    return _mm_unpacklo_epi64(volume_s32_2(s, v), volume_s32_2(_mm_srli_si128(s, 8), _mm_srli_si128(v, 8)));
+}
+
+/* Gathers the four packed 24 bit samples at p into the top three bytes
+ * of each lane. Reads 16 bytes. */
+static inline __m128i s24ne_load_4(const uint8_t *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+
+    v = _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3)),
+            _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9)));
+
+    return _mm_slli_epi32(v, 8);
+}
+
+/* The inverse of s24ne_load_4(). Writes exactly 12 bytes, the samples
+ * that follow are not processed yet. */
+static inline void s24ne_store_4(uint8_t *p, __m128i v) {
+    const __m128i low = _mm_set_epi32(0, 0, -1, -1);
+    const __m128i low32 = _mm_set_epi32(0, -1, 0, -1);
+
+    v = _mm_srli_epi32(v, 8);
+    v = _mm_or_si128(_mm_and_si128(v, low32), _mm_srli_epi64(_mm_andnot_si128(low32, v), 8));
+    v = _mm_or_si128(_mm_and_si128(v, low), _mm_srli_si128(_mm_andnot_si128(low, v), 2));
+
+    _mm_storel_epi64((__m128i *) p, v);
+    *(uint32_t *) (p + 8) = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+static inline int32_t volume_s32_1(int32_t s, int32_t v) {
+    int64_t t;
+
+    t = ((int64_t) s * v) >> 16;
+    t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+
+    return (int32_t) t;
+}
+
+#define MOD_INC(channel, n, channels)                                   \
+    do {                                                                \
+        channel += n;                                                   \
+        if (channel >= channels)                                        \
+            channel -= channels;                                        \
+    } while (0)
+
+static void pa_volume_float32ne_sse2(float *samples, const float *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(float); length >= 8; length -= 8, samples += 8) {
+        _mm_storeu_ps(samples, _mm_mul_ps(_mm_loadu_ps(samples), _mm_loadu_ps(volumes + channel)));
+        _mm_storeu_ps(samples + 4, _mm_mul_ps(_mm_loadu_ps(samples + 4), _mm_loadu_ps(volumes + channel + 4)));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        *samples++ *= volumes[channel];
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_float32re_sse2(float *samples, const float *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(float); length >= 8; length -= 8, samples += 8) {
+        __m128 s0 = _mm_castsi128_ps(bswap32(_mm_loadu_si128((const __m128i *) samples)));
+        __m128 s1 = _mm_castsi128_ps(bswap32(_mm_loadu_si128((const __m128i *) (samples + 4))));
+
+        s0 = _mm_mul_ps(s0, _mm_loadu_ps(volumes + channel));
+        s1 = _mm_mul_ps(s1, _mm_loadu_ps(volumes + channel + 4));
+        _mm_storeu_si128((__m128i *) samples, bswap32(_mm_castps_si128(s0)));
+        _mm_storeu_si128((__m128i *) (samples + 4), bswap32(_mm_castps_si128(s1)));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        float t = PA_FLOAT32_SWAP(*samples);
+        t *= volumes[channel];
+        *samples++ = PA_FLOAT32_SWAP(t);
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_s32ne_sse2(int32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(int32_t); length >= 8; length -= 8, samples += 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *) samples);
+        __m128i s1 = _mm_loadu_si128((const __m128i *) (samples + 4));
+
+        _mm_storeu_si128((__m128i *) samples, volume_s32_4(s0, volumes + channel));
+        _mm_storeu_si128((__m128i *) (samples + 4), volume_s32_4(s1, volumes + channel + 4));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        *samples = volume_s32_1(*samples, volumes[channel]);
+        samples++;
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_s32re_sse2(int32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(int32_t); length >= 8; length -= 8, samples += 8) {
+        __m128i s0 = bswap32(_mm_loadu_si128((const __m128i *) samples));
+        __m128i s1 = bswap32(_mm_loadu_si128((const __m128i *) (samples + 4)));
+
+        _mm_storeu_si128((__m128i *) samples, bswap32(volume_s32_4(s0, volumes + channel)));
+        _mm_storeu_si128((__m128i *) (samples + 4), bswap32(volume_s32_4(s1, volumes + channel + 4)));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        *samples = PA_INT32_SWAP(volume_s32_1(PA_INT32_SWAP(*samples), volumes[channel]));
+        samples++;
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_s24_32ne_sse2(uint32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(uint32_t); length >= 8; length -= 8, samples += 8) {
+        __m128i s0 = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) samples), 8);
+        __m128i s1 = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) (samples + 4)), 8);
+
+        _mm_storeu_si128((__m128i *) samples, _mm_srli_epi32(volume_s32_4(s0, volumes + channel), 8));
+        _mm_storeu_si128((__m128i *) (samples + 4), _mm_srli_epi32(volume_s32_4(s1, volumes + channel + 4), 8));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        *samples = ((uint32_t) volume_s32_1((int32_t) (*samples << 8), volumes[channel])) >> 8;
+        samples++;
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_s24_32re_sse2(uint32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    for (length /= sizeof(uint32_t); length >= 8; length -= 8, samples += 8) {
+        __m128i s0 = _mm_slli_epi32(bswap32(_mm_loadu_si128((const __m128i *) samples)), 8);
+        __m128i s1 = _mm_slli_epi32(bswap32(_mm_loadu_si128((const __m128i *) (samples + 4))), 8);
+
+        _mm_storeu_si128((__m128i *) samples, bswap32(_mm_srli_epi32(volume_s32_4(s0, volumes + channel), 8)));
+        _mm_storeu_si128((__m128i *) (samples + 4), bswap32(_mm_srli_epi32(volume_s32_4(s1, volumes + channel + 4), 8)));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--) {
+        uint32_t t = ((uint32_t) volume_s32_1((int32_t) (PA_UINT32_SWAP(*samples) << 8), volumes[channel])) >> 8;
+        *samples++ = PA_UINT32_SWAP(t);
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+static void pa_volume_s24ne_sse2(uint8_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    unsigned channel = 0, orig_channels = channels;
+
+    if (channels < 8)
+        channels = channel_overread_table[channels];
+
+    length /= 3;
+
+    /* The 16 byte accesses go 4 bytes past the 8 samples */
+    for (; length >= 10; length -= 8, samples += 24) {
+        __m128i s0 = s24ne_load_4(samples);
+        __m128i s1 = s24ne_load_4(samples + 12);
+
+        s24ne_store_4(samples, volume_s32_4(s0, volumes + channel));
+        s24ne_store_4(samples + 12, volume_s32_4(s1, volumes + channel + 4));
+        MOD_INC(channel, 8, channels);
+    }
+
+    for (channel %= orig_channels; length; length--, samples += 3) {
+        int32_t t = volume_s32_1((int32_t) (PA_READ24NE(samples) << 8), volumes[channel]);
+        PA_WRITE24NE(samples, ((uint32_t) t) >> 8);
+        MOD_INC(channel, 1, orig_channels);
+    }
+}
+
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__) */
+
 void pa_volume_func_init_sse(pa_cpu_x86_flag_t flags) {
 #if defined (__i386__) || defined (__amd64__)
     if (flags & PA_CPU_X86_SSE2) {
@@ -262,4 +497,16 @@ void pa_volume_func_init_sse(pa_cpu_x86_flag_t flags) {
         pa_set_volume_func(PA_SAMPLE_S16RE, (pa_do_volume_func_t) pa_volume_s16re_sse2);
     }
 #endif /* defined (__i386__) || defined (__amd64__) */
+
+#if (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__)
+    if (flags & PA_CPU_X86_SSE2) {
+        pa_set_volume_func(PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_sse2);
+        pa_set_volume_func(PA_SAMPLE_FLOAT32RE, (pa_do_volume_func_t) pa_volume_float32re_sse2);
+        pa_set_volume_func(PA_SAMPLE_S32NE, (pa_do_volume_func_t) pa_volume_s32ne_sse2);
+        pa_set_volume_func(PA_SAMPLE_S32RE, (pa_do_volume_func_t) pa_volume_s32re_sse2);
+        pa_set_volume_func(PA_SAMPLE_S24NE, (pa_do_volume_func_t) pa_volume_s24ne_sse2);
+        pa_set_volume_func(PA_SAMPLE_S24_32NE, (pa_do_volume_func_t) pa_volume_s24_32ne_sse2);
+        pa_set_volume_func(PA_SAMPLE_S24_32RE, (pa_do_volume_func_t) pa_volume_s24_32re_sse2);
+    }
+#endif /* (defined (__i386__) || defined (__amd64__)) && defined (__SSE2__) */
 }
@@ -429,6 +429,14 @@ const uint8_t* pa_tagstruct_data(pa_tagstruct*t, size_t *l) {
     return t->data;
 }
 
+const uint8_t* pa_tagstruct_unread_data(pa_tagstruct*t, size_t *l) {
+    pa_assert(t);
+    pa_assert(l);
+
+    *l = t->length - t->rindex;
+    return t->data + t->rindex;
+}
+
 int pa_tagstruct_get_boolean(pa_tagstruct*t, bool *b) {
     pa_assert(t);
     pa_assert(b);
@@ -69,6 +69,9 @@ uint8_t* pa_tagstruct_free_data(pa_tagstruct*t, size_t *l);
 int pa_tagstruct_eof(pa_tagstruct*t);
 const uint8_t* pa_tagstruct_data(pa_tagstruct*t, size_t *l);
 
+/* Returns what is left to read, without consuming it */
+const uint8_t* pa_tagstruct_unread_data(pa_tagstruct*t, size_t *l);
+
 void pa_tagstruct_put(pa_tagstruct *t, ...);
 
 void pa_tagstruct_puts(pa_tagstruct*t, const char *s);
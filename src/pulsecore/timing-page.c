@@ -0,0 +1,226 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/log.h>
+#include <pulsecore/seqlock.h>
+#include <pulsecore/shm.h>
+
+#include "timing-page.h"
+
+#define N_SLOTS 64
+
+/* How often a reader tries to get a consistent copy before giving up */
+#define MAX_READ_TRIES 100
+
+#define SLOT_VALID 0x1U
+#define SLOT_PLAYING 0x2U
+
+/* This is shared between processes that might have different word
+ * widths, hence only fixed size fields, all naturally aligned */
+struct slot {
+    pa_seqlock lock;
+    uint32_t stream_index;
+    uint32_t flags;
+    uint32_t _reserved;
+    uint64_t read_index;
+    uint64_t write_index;
+    uint64_t sink_usec;
+    uint64_t timestamp;
+    uint64_t underrun_for;
+    uint64_t playing_for;
+};
+
+struct pa_timing_page {
+    pa_shm memory;
+    bool writable;
+    bool used[N_SLOTS];
+};
+
+static struct slot *get_slot(pa_timing_page *p, uint32_t slot) {
+    return (struct slot*) p->memory.ptr + slot;
+}
+
+pa_timing_page* pa_timing_page_new(void) {
+    pa_timing_page *p;
+
+    p = pa_xnew0(pa_timing_page, 1);
+
+    if (pa_shm_create_rw(&p->memory, N_SLOTS * sizeof(struct slot), true, 0700) < 0) {
+        pa_xfree(p);
+        return NULL;
+    }
+
+    p->writable = true;
+
+    return p;
+}
+
+pa_timing_page* pa_timing_page_attach(uint32_t id) {
+    pa_timing_page *p;
+
+    p = pa_xnew0(pa_timing_page, 1);
+
+    if (pa_shm_attach_ro(&p->memory, id) < 0) {
+        pa_xfree(p);
+        return NULL;
+    }
+
+    if (p->memory.size < N_SLOTS * sizeof(struct slot)) {
+        pa_log_warn("Timing page too small.");
+        pa_timing_page_free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+void pa_timing_page_free(pa_timing_page *p) {
+    pa_assert(p);
+
+    pa_shm_free(&p->memory);
+    pa_xfree(p);
+}
+
+uint32_t pa_timing_page_get_id(pa_timing_page *p) {
+    pa_assert(p);
+
+    return p->memory.id;
+}
+
+/* Marks the slot as not holding any data for the stream yet */
+static void reset_slot(pa_timing_page *p, uint32_t slot, uint32_t stream_index) {
+    struct slot *s = get_slot(p, slot);
+
+    pa_seqlock_write_begin(&s->lock);
+    s->stream_index = stream_index;
+    s->flags = 0;
+    pa_seqlock_write_end(&s->lock);
+}
+
+uint32_t pa_timing_page_alloc_slot(pa_timing_page *p, uint32_t stream_index) {
+    uint32_t slot;
+
+    pa_assert(p);
+    pa_assert(p->writable);
+
+    for (slot = 0; slot < N_SLOTS; slot++)
+        if (!p->used[slot])
+            break;
+
+    if (slot >= N_SLOTS)
+        return PA_INVALID_INDEX;
+
+    p->used[slot] = true;
+    reset_slot(p, slot, stream_index);
+
+    return slot;
+}
+
+void pa_timing_page_free_slot(pa_timing_page *p, uint32_t slot) {
+    pa_assert(p);
+    pa_assert(p->writable);
+    pa_assert(slot < N_SLOTS);
+    pa_assert(p->used[slot]);
+
+    reset_slot(p, slot, PA_INVALID_INDEX);
+    p->used[slot] = false;
+}
+
+void pa_timing_page_write(pa_timing_page *p, uint32_t slot, const pa_timing_snapshot *snapshot) {
+    struct slot *s;
+
+    pa_assert(p);
+    pa_assert(p->writable);
+    pa_assert(slot < N_SLOTS);
+    pa_assert(snapshot);
+
+    s = get_slot(p, slot);
+
+    pa_seqlock_write_begin(&s->lock);
+
+    s->stream_index = snapshot->stream_index;
+    s->flags = SLOT_VALID | (snapshot->playing ? SLOT_PLAYING : 0);
+    s->read_index = (uint64_t) snapshot->read_index;
+    s->write_index = (uint64_t) snapshot->write_index;
+    s->sink_usec = snapshot->sink_usec;
+    s->timestamp = snapshot->timestamp;
+    s->underrun_for = snapshot->underrun_for;
+    s->playing_for = snapshot->playing_for;
+
+    pa_seqlock_write_end(&s->lock);
+}
+
+void pa_timing_snapshot_add_pending(pa_timing_snapshot *s, size_t length, pa_usec_t usec) {
+    pa_assert(s);
+
+    if (length == 0)
+        return;
+
+    s->sink_usec += usec;
+    s->underrun_for = 0;
+    s->playing_for += length;
+    s->playing = true;
+}
+
+int pa_timing_page_read(pa_timing_page *p, uint32_t slot, uint32_t stream_index, pa_timing_snapshot *snapshot) {
+    volatile struct slot *s;
+    unsigned tries;
+
+    pa_assert(p);
+    pa_assert(snapshot);
+
+    if (slot >= N_SLOTS)
+        return -1;
+
+    s = get_slot(p, slot);
+
+    for (tries = 0; tries < MAX_READ_TRIES; tries++) {
+        uint32_t flags;
+        int seq;
+
+        seq = pa_seqlock_read_begin((pa_seqlock*) &s->lock);
+
+        snapshot->stream_index = s->stream_index;
+        flags = s->flags;
+        snapshot->playing = !!(flags & SLOT_PLAYING);
+        snapshot->read_index = (int64_t) s->read_index;
+        snapshot->write_index = (int64_t) s->write_index;
+        snapshot->sink_usec = s->sink_usec;
+        snapshot->timestamp = s->timestamp;
+        snapshot->underrun_for = s->underrun_for;
+        snapshot->playing_for = s->playing_for;
+
+        if (pa_seqlock_read_retry((pa_seqlock*) &s->lock, seq))
+            continue;
+
+        /* The slot might have been handed to another stream already */
+        if (!(flags & SLOT_VALID) || snapshot->stream_index != stream_index)
+            return -1;
+
+        return 0;
+    }
+
+    return -1;
+}
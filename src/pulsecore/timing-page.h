@@ -0,0 +1,71 @@
+#ifndef foopulsetimingpagehfoo
+#define foopulsetimingpagehfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <inttypes.h>
+
+#include <pulse/def.h>
+#include <pulse/sample.h>
+
+#include <pulsecore/macro.h>
+
+/* A page of shared memory the server publishes the timing data of the
+ * playback streams of one connection in, one slot per stream. The
+ * client maps it read-only and can answer latency queries without a
+ * round trip. Every slot is protected by a sequence counter: the
+ * single writer makes it odd while updating, readers retry when they
+ * saw an odd counter or when it changed during the copy. */
+
+typedef struct pa_timing_page pa_timing_page;
+
+typedef struct pa_timing_snapshot {
+    uint32_t stream_index;
+    bool playing;
+    int64_t read_index, write_index;
+    /* Latency of the sink, including the data already rendered but not
+     * yet passed on to it */
+    pa_usec_t sink_usec;
+    /* When this was taken, pa_rtclock_now() of the writer */
+    pa_usec_t timestamp;
+    uint64_t underrun_for, playing_for;
+} pa_timing_snapshot;
+
+/* Called by the server, from the main thread */
+pa_timing_page* pa_timing_page_new(void);
+uint32_t pa_timing_page_alloc_slot(pa_timing_page *p, uint32_t stream_index);
+void pa_timing_page_free_slot(pa_timing_page *p, uint32_t slot);
+
+/* Called by the server, from the thread owning the stream of the slot */
+void pa_timing_page_write(pa_timing_page *p, uint32_t slot, const pa_timing_snapshot *s);
+
+/* Accounts for a chunk of length bytes, usec long, that the stream is
+ * handing out right now, but which the sink input has not queued or
+ * counted as played yet */
+void pa_timing_snapshot_add_pending(pa_timing_snapshot *s, size_t length, pa_usec_t usec);
+
+/* Called by the client */
+pa_timing_page* pa_timing_page_attach(uint32_t id);
+int pa_timing_page_read(pa_timing_page *p, uint32_t slot, uint32_t stream_index, pa_timing_snapshot *s);
+
+uint32_t pa_timing_page_get_id(pa_timing_page *p);
+void pa_timing_page_free(pa_timing_page *p);
+
+#endif
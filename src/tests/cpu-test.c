@@ -28,6 +28,7 @@
 #include <pulse/rtclock.h>
 #include <pulsecore/cpu-x86.h>
 #include <pulsecore/cpu-orc.h>
+#include <pulsecore/core-util.h>
 #include <pulsecore/random.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/endianmacros.h>
@@ -250,6 +251,169 @@ START_TEST (svolume_orc_test) {
 }
 END_TEST
 
+#if defined (__i386__) || defined (__amd64__)
+/* The float and 32 bit volume functions may read up to 16 volumes past
+ * the current channel, like mix.c we pad with 32 */
+#define VOLUME_PADDING 32
+
+static const pa_sample_format_t volume_formats[] = {
+    PA_SAMPLE_FLOAT32NE, PA_SAMPLE_FLOAT32RE,
+    PA_SAMPLE_S32NE, PA_SAMPLE_S32RE,
+    PA_SAMPLE_S24NE, PA_SAMPLE_S24RE,
+    PA_SAMPLE_S24_32NE, PA_SAMPLE_S24_32RE
+};
+
+static void run_volume_test_exact(
+        pa_do_volume_func_t func,
+        pa_do_volume_func_t orig_func,
+        pa_sample_format_t format,
+        int align,
+        int channels,
+        bool perf) {
+
+    PA_DECLARE_ALIGNED(8, uint8_t, s[SAMPLES * 4]) = { 0 };
+    PA_DECLARE_ALIGNED(8, uint8_t, s_ref[SAMPLES * 4]) = { 0 };
+    PA_DECLARE_ALIGNED(8, uint8_t, s_orig[SAMPLES * 4]) = { 0 };
+    union {
+        int32_t i[PA_CHANNELS_MAX + VOLUME_PADDING];
+        float f[PA_CHANNELS_MAX + VOLUME_PADDING];
+    } volumes;
+    uint8_t *samples, *samples_ref, *samples_orig;
+    size_t ss;
+    int i, nsamples, size;
+    bool is_float;
+
+    ss = pa_sample_size_of_format(format);
+    is_float = format == PA_SAMPLE_FLOAT32NE || format == PA_SAMPLE_FLOAT32RE;
+
+    /* Force sample alignment as requested */
+    samples = s + align * ss;
+    samples_ref = s_ref + align * ss;
+    samples_orig = s_orig + align * ss;
+    nsamples = SAMPLES - align;
+    nsamples -= nsamples % channels;
+    size = nsamples * ss;
+
+    if (is_float) {
+        float *f = (float *) samples_orig;
+
+        for (i = 0; i < nsamples; i++) {
+            f[i] = 2.0f * (rand()/(float) RAND_MAX - 0.5f);
+            if (format == PA_SAMPLE_FLOAT32RE)
+                f[i] = PA_FLOAT32_SWAP(f[i]);
+        }
+    } else
+        pa_random(samples_orig, size);
+
+    memcpy(samples, samples_orig, size);
+    memcpy(samples_ref, samples_orig, size);
+
+    /* Up to 4x gain, to get some clipping, too */
+    for (i = 0; i < channels; i++) {
+        if (is_float)
+            volumes.f[i] = 4.0f * rand()/(float) RAND_MAX;
+        else
+            volumes.i[i] = rand() >> 13;
+    }
+    for (; i < channels + VOLUME_PADDING; i++)
+        volumes.i[i] = volumes.i[i - channels];
+
+    orig_func(samples_ref, &volumes, channels, size);
+    func(samples, &volumes, channels, size);
+
+    for (i = 0; i < nsamples; i++) {
+        if (memcmp(samples + i * ss, samples_ref + i * ss, ss)) {
+            pa_log_debug("Correctness test failed: %s, align=%d, channels=%d",
+                         pa_sample_format_to_string(format), align, channels);
+            fail();
+        }
+    }
+
+    if (perf) {
+        pa_log_debug("Testing svolume %s %dch performance with %d sample alignment",
+                     pa_sample_format_to_string(format), channels, align);
+
+        PA_CPU_TEST_RUN_START("func", TIMES, TIMES2) {
+            memcpy(samples, samples_orig, size);
+            func(samples, &volumes, channels, size);
+        } PA_CPU_TEST_RUN_STOP
+
+        PA_CPU_TEST_RUN_START("orig", TIMES, TIMES2) {
+            memcpy(samples_ref, samples_orig, size);
+            orig_func(samples_ref, &volumes, channels, size);
+        } PA_CPU_TEST_RUN_STOP
+
+        fail_unless(memcmp(samples_ref, samples, size) == 0);
+    }
+}
+
+/* Checks every volume function that got replaced since orig was taken */
+static void run_volume_tests_exact(const pa_do_volume_func_t orig[PA_SAMPLE_MAX], const char *label) {
+    unsigned k;
+    int i, j;
+
+    for (k = 0; k < PA_ELEMENTSOF(volume_formats); k++) {
+        pa_sample_format_t f = volume_formats[k];
+        pa_do_volume_func_t func = pa_get_volume_func(f);
+
+        if (func == orig[f])
+            continue;
+
+        pa_log_debug("Checking %s svolume (%s)", label, pa_sample_format_to_string(f));
+        for (i = 1; i <= 18; i++) {
+            for (j = 0; j < 7; j++)
+                run_volume_test_exact(func, orig[f], f, j, i, false);
+        }
+        run_volume_test_exact(func, orig[f], f, 7, 2, true);
+    }
+}
+
+static void get_volume_funcs(pa_do_volume_func_t funcs[PA_SAMPLE_MAX]) {
+    int f;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++)
+        funcs[f] = pa_get_volume_func(f);
+}
+
+START_TEST (svolume_sse2_exact_test) {
+    pa_do_volume_func_t orig[PA_SAMPLE_MAX];
+    pa_cpu_x86_flag_t flags = 0;
+
+    pa_cpu_get_x86_flags(&flags);
+
+    if (!(flags & PA_CPU_X86_SSE2)) {
+        pa_log_info("SSE2 not supported. Skipping");
+        return;
+    }
+
+    get_volume_funcs(orig);
+    pa_volume_func_init_sse(flags);
+    run_volume_tests_exact(orig, "SSE2");
+}
+END_TEST
+
+#ifdef HAVE_AVX2
+START_TEST (svolume_avx2_test) {
+    pa_do_volume_func_t orig[PA_SAMPLE_MAX];
+    pa_cpu_x86_flag_t flags = 0;
+
+    pa_cpu_get_x86_flags(&flags);
+
+    if (!(flags & PA_CPU_X86_AVX2)) {
+        pa_log_info("AVX2 not supported. Skipping");
+        return;
+    }
+
+    get_volume_funcs(orig);
+    pa_volume_func_init_avx2(flags);
+    run_volume_tests_exact(orig, "AVX2");
+}
+END_TEST
+#endif /* HAVE_AVX2 */
+
+#undef VOLUME_PADDING
+#endif /* defined (__i386__) || defined (__amd64__) */
+
 #undef SAMPLES
 #undef TIMES
 #undef TIMES2
@@ -464,6 +628,170 @@ END_TEST
 #endif /* HAVE_NEON */
 #endif /* defined (__arm__) && defined (__linux__) */
 
+#if defined (__i386__) || defined (__amd64__)
+typedef struct {
+    pa_convert_func_t to_float32ne, from_float32ne, to_s16ne, from_s16ne;
+} conv_funcs;
+
+static void get_conv_funcs(conv_funcs funcs[PA_SAMPLE_MAX]) {
+    int f;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        funcs[f].to_float32ne = pa_get_convert_to_float32ne_function(f);
+        funcs[f].from_float32ne = pa_get_convert_from_float32ne_function(f);
+        funcs[f].to_s16ne = pa_get_convert_to_s16ne_function(f);
+        funcs[f].from_s16ne = pa_get_convert_from_s16ne_function(f);
+    }
+}
+
+/* Rounding and clipping corner cases, the optimized conversions need to
+ * match the C versions for all of them */
+static const float conv_special[] = {
+    0.0f, -0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 0.99999994f, -0.99999994f,
+    0.5f / 0x8000, 1.5f / 0x8000, -2.5f / 0x8000, 32767.5f / 0x8000, -32768.5f / 0x8000,
+    0.5f / 127, -1.5f / 127, 127.5f / 127, -128.5f / 127,
+    1e-40f, -1e-30f, 65536.0f, -65536.0f, 3e9f, -3e9f
+};
+
+static void run_conv_test_exact(
+        pa_convert_func_t func,
+        pa_convert_func_t orig_func,
+        pa_sample_format_t in_format,
+        pa_sample_format_t out_format,
+        int align,
+        bool perf) {
+
+    PA_DECLARE_ALIGNED(8, uint8_t, in[SAMPLES * 4]) = { 0 };
+    PA_DECLARE_ALIGNED(8, uint8_t, out[SAMPLES * 4]) = { 0 };
+    PA_DECLARE_ALIGNED(8, uint8_t, out_ref[SAMPLES * 4]) = { 0 };
+    size_t in_size, out_size;
+    uint8_t *src, *dst, *dst_ref;
+    char h1[16], h2[16], h3[16];
+    int i, nsamples;
+
+    in_size = pa_sample_size_of_format(in_format);
+    out_size = pa_sample_size_of_format(out_format);
+
+    /* Force sample alignment as requested */
+    src = in + align * in_size;
+    dst = out + align * out_size;
+    dst_ref = out_ref + align * out_size;
+    nsamples = SAMPLES - align;
+
+    if (in_format == PA_SAMPLE_FLOAT32LE || in_format == PA_SAMPLE_FLOAT32BE) {
+        float *floats = (float *) src;
+
+        for (i = 0; i < nsamples; i++) {
+            if (i % 4 == 0)
+                floats[i] = conv_special[(i / 4) % PA_ELEMENTSOF(conv_special)];
+            else
+                floats[i] = 2.2f * (rand()/(float) RAND_MAX - 0.5f);
+
+            if (in_format != PA_SAMPLE_FLOAT32NE)
+                floats[i] = PA_FLOAT32_SWAP(floats[i]);
+        }
+    } else
+        pa_random(src, nsamples * in_size);
+
+    orig_func(nsamples, src, dst_ref);
+    func(nsamples, src, dst);
+
+    for (i = 0; i < nsamples; i++) {
+        if (memcmp(dst + i * out_size, dst_ref + i * out_size, out_size)) {
+            pa_log_debug("Correctness test failed: %s -> %s, align=%d",
+                         pa_sample_format_to_string(in_format), pa_sample_format_to_string(out_format), align);
+            pa_log_debug("%d: %s != %s (%s)\n", i,
+                         pa_hexstr(dst + i * out_size, out_size, h1, sizeof(h1)),
+                         pa_hexstr(dst_ref + i * out_size, out_size, h2, sizeof(h2)),
+                         pa_hexstr(src + i * in_size, in_size, h3, sizeof(h3)));
+            fail();
+        }
+    }
+
+    if (perf) {
+        pa_log_debug("Testing sconv performance with %d sample alignment", align);
+
+        PA_CPU_TEST_RUN_START("func", TIMES, TIMES2) {
+            func(nsamples, src, dst);
+        } PA_CPU_TEST_RUN_STOP
+
+        PA_CPU_TEST_RUN_START("orig", TIMES, TIMES2) {
+            orig_func(nsamples, src, dst_ref);
+        } PA_CPU_TEST_RUN_STOP
+    }
+}
+
+static void run_conv_tests_exact(
+        pa_convert_func_t func,
+        pa_convert_func_t orig_func,
+        pa_sample_format_t in_format,
+        pa_sample_format_t out_format,
+        const char *label) {
+
+    int align;
+
+    if (func == orig_func)
+        return;
+
+    pa_log_debug("Checking %s sconv (%s -> %s)", label,
+                 pa_sample_format_to_string(in_format), pa_sample_format_to_string(out_format));
+
+    for (align = 0; align < 8; align++)
+        run_conv_test_exact(func, orig_func, in_format, out_format, align, align == 7);
+}
+
+/* Compares every conversion that got replaced since orig was taken */
+static void run_conv_tests_exact_all(const conv_funcs orig[PA_SAMPLE_MAX], const char *label) {
+    conv_funcs funcs[PA_SAMPLE_MAX];
+    int f;
+
+    get_conv_funcs(funcs);
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        run_conv_tests_exact(funcs[f].to_float32ne, orig[f].to_float32ne, f, PA_SAMPLE_FLOAT32NE, label);
+        run_conv_tests_exact(funcs[f].from_float32ne, orig[f].from_float32ne, PA_SAMPLE_FLOAT32NE, f, label);
+        run_conv_tests_exact(funcs[f].to_s16ne, orig[f].to_s16ne, f, PA_SAMPLE_S16NE, label);
+        run_conv_tests_exact(funcs[f].from_s16ne, orig[f].from_s16ne, PA_SAMPLE_S16NE, f, label);
+    }
+}
+
+START_TEST (sconv_sse2_exact_test) {
+    pa_cpu_x86_flag_t flags = 0;
+    conv_funcs orig[PA_SAMPLE_MAX];
+
+    pa_cpu_get_x86_flags(&flags);
+
+    if (!(flags & PA_CPU_X86_SSE2)) {
+        pa_log_info("SSE2 not supported. Skipping");
+        return;
+    }
+
+    get_conv_funcs(orig);
+    pa_convert_func_init_sse(PA_CPU_X86_SSE2);
+    run_conv_tests_exact_all(orig, "SSE2");
+}
+END_TEST
+
+#ifdef HAVE_AVX2
+START_TEST (sconv_avx2_test) {
+    pa_cpu_x86_flag_t flags = 0;
+    conv_funcs orig[PA_SAMPLE_MAX];
+
+    pa_cpu_get_x86_flags(&flags);
+
+    if (!(flags & PA_CPU_X86_AVX2)) {
+        pa_log_info("AVX2 not supported. Skipping");
+        return;
+    }
+
+    get_conv_funcs(orig);
+    pa_convert_func_init_avx2(PA_CPU_X86_AVX2);
+    run_conv_tests_exact_all(orig, "AVX2");
+}
+END_TEST
+#endif /* HAVE_AVX2 */
+#endif /* defined (__i386__) || defined (__amd64__) */
+
 #undef SAMPLES
 #undef TIMES
 /* End conversion tests */
@@ -865,6 +1193,10 @@ int main(int argc, char *argv[]) {
 #if defined (__i386__) || defined (__amd64__)
     tcase_add_test(tc, svolume_mmx_test);
     tcase_add_test(tc, svolume_sse_test);
+    tcase_add_test(tc, svolume_sse2_exact_test);
+#ifdef HAVE_AVX2
+    tcase_add_test(tc, svolume_avx2_test);
+#endif
 #endif
 #if defined (__arm__) && defined (__linux__)
     tcase_add_test(tc, svolume_arm_test);
@@ -878,6 +1210,10 @@ int main(int argc, char *argv[]) {
 #if defined (__i386__) || defined (__amd64__)
     tcase_add_test(tc, sconv_sse2_test);
     tcase_add_test(tc, sconv_sse_test);
+    tcase_add_test(tc, sconv_sse2_exact_test);
+#ifdef HAVE_AVX2
+    tcase_add_test(tc, sconv_avx2_test);
+#endif
 #endif
 #if defined (__arm__) && defined (__linux__)
 #if HAVE_NEON
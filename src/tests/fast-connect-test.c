@@ -0,0 +1,172 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pulse/pulseaudio.h>
+#include <pulse/mainloop.h>
+
+#include <pulsecore/macro.h>
+
+/* Number of connections timed in every mode */
+#define N_RUNS 50
+
+static const pa_sample_spec sample_spec = {
+    .format = PA_SAMPLE_S16LE,
+    .rate = 44100,
+    .channels = 2
+};
+
+/* One short-lived client, like an event sound player */
+struct run {
+    pa_mainloop *mainloop;
+    pa_context *context;
+    pa_stream *stream;
+    pa_usec_t start, started;
+    bool fast, written;
+};
+
+static void stream_write_cb(pa_stream *s, size_t nbytes, void *userdata) {
+    struct run *r = userdata;
+    void *data;
+
+    if (r->written)
+        return;
+
+    /* Enough to get past prebuf */
+    fail_unless(pa_stream_begin_write(s, &data, &nbytes) == 0);
+    memset(data, 0, nbytes);
+    fail_unless(pa_stream_write(s, data, nbytes, NULL, 0, PA_SEEK_RELATIVE) == 0);
+
+    r->written = true;
+}
+
+static void stream_started_cb(pa_stream *s, void *userdata) {
+    struct run *r = userdata;
+
+    r->started = pa_rtclock_now();
+}
+
+static void stream_state_cb(pa_stream *s, void *userdata) {
+    fail_unless(PA_STREAM_IS_GOOD(pa_stream_get_state(s)));
+}
+
+static void connect_stream(struct run *r) {
+    fail_unless((r->stream = pa_stream_new(r->context, "fast-connect-test", &sample_spec, NULL)) != NULL);
+
+    pa_stream_set_state_callback(r->stream, stream_state_cb, r);
+    pa_stream_set_write_callback(r->stream, stream_write_cb, r);
+    pa_stream_set_started_callback(r->stream, stream_started_cb, r);
+
+    fail_unless(pa_stream_connect_playback(r->stream, NULL, NULL, 0, NULL, NULL) == 0);
+}
+
+static void context_state_cb(pa_context *c, void *userdata) {
+    struct run *r = userdata;
+
+    switch (pa_context_get_state(c)) {
+        case PA_CONTEXT_AUTHORIZING:
+            /* With fast connect the stream goes out together with the
+             * authentication */
+            if (r->fast)
+                connect_stream(r);
+            break;
+
+        case PA_CONTEXT_READY:
+            if (!r->stream)
+                connect_stream(r);
+            break;
+
+        case PA_CONTEXT_FAILED:
+            fail();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Returns the time from pa_context_connect() until the server started
+ * playing the first samples */
+static pa_usec_t run_once(pa_context_flags_t flags) {
+    struct run r;
+
+    pa_zero(r);
+    r.fast = !!(flags & PA_CONTEXT_FAST_CONNECT);
+
+    fail_unless((r.mainloop = pa_mainloop_new()) != NULL);
+    fail_unless((r.context = pa_context_new(pa_mainloop_get_api(r.mainloop), "fast-connect-test")) != NULL);
+    pa_context_set_state_callback(r.context, context_state_cb, &r);
+
+    r.start = pa_rtclock_now();
+    fail_unless(pa_context_connect(r.context, NULL, flags, NULL) >= 0);
+
+    while (!r.started)
+        fail_unless(pa_mainloop_iterate(r.mainloop, 1, NULL) >= 0);
+
+    pa_stream_disconnect(r.stream);
+    pa_stream_unref(r.stream);
+    pa_context_disconnect(r.context);
+    pa_context_unref(r.context);
+    pa_mainloop_free(r.mainloop);
+
+    return r.started - r.start;
+}
+
+START_TEST (fast_connect_test) {
+    pa_usec_t t_normal = 0, t_fast = 0;
+    unsigned i;
+
+    for (i = 0; i < N_RUNS; i++) {
+        t_normal += run_once(PA_CONTEXT_NOAUTOSPAWN);
+        t_fast += run_once(PA_CONTEXT_NOAUTOSPAWN|PA_CONTEXT_FAST_CONNECT);
+    }
+
+    fprintf(stderr, "Time to first sample: %0.2f ms with the usual setup, %0.2f ms with fast connect.\n",
+            (double) t_normal / N_RUNS / PA_USEC_PER_MSEC,
+            (double) t_fast / N_RUNS / PA_USEC_PER_MSEC);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    s = suite_create("Fast Connect");
+    tc = tcase_create("fast-connect");
+    tcase_add_test(tc, fast_connect_test);
+    tcase_set_timeout(tc, 120);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
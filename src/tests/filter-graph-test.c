@@ -0,0 +1,159 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include <modules/filter-chain/filter-graph.h>
+
+#define CHANNELS 2
+#define FRAMES 64
+
+/* Node that computes out = in * gain + offset and counts resets */
+struct test_node {
+    pa_filter_node node;
+    float gain, offset;
+    unsigned n_resets;
+};
+
+static void test_process(pa_filter_node *n, float * const in[], float * const out[], unsigned n_frames) {
+    struct test_node *t = n->userdata;
+    unsigned c, i;
+
+    for (c = 0; c < CHANNELS; c++) {
+        fail_unless(in[c] != out[c]);
+
+        for (i = 0; i < n_frames; i++)
+            out[c][i] = in[c][i] * t->gain + t->offset;
+    }
+}
+
+static void test_reset(pa_filter_node *n) {
+    struct test_node *t = n->userdata;
+
+    t->n_resets++;
+}
+
+static void test_free(pa_filter_node *n) {
+    pa_xfree(n->userdata);
+}
+
+static struct test_node *test_node_new(float gain, float offset) {
+    struct test_node *t = pa_xnew0(struct test_node, 1);
+
+    t->node.process = test_process;
+    t->node.reset = test_reset;
+    t->node.free = test_free;
+    t->node.userdata = t;
+    t->gain = gain;
+    t->offset = offset;
+
+    return t;
+}
+
+START_TEST (filter_graph_test) {
+    pa_sample_spec ss = { PA_SAMPLE_FLOAT32NE, 48000, CHANNELS };
+    float in_data[CHANNELS][FRAMES], out_data[CHANNELS][FRAMES];
+    float *in[CHANNELS], *out[CHANNELS];
+    struct test_node *nodes[3];
+    pa_filter_graph *g;
+    unsigned c, i;
+
+    for (c = 0; c < CHANNELS; c++) {
+        in[c] = in_data[c];
+        out[c] = out_data[c];
+
+        for (i = 0; i < FRAMES; i++)
+            in_data[c][i] = (float) (c * FRAMES + i);
+    }
+
+    g = pa_filter_graph_new(&ss, FRAMES);
+
+    /* An empty graph copies */
+    pa_filter_graph_process(g, in, out, FRAMES);
+    for (c = 0; c < CHANNELS; c++)
+        for (i = 0; i < FRAMES; i++)
+            fail_unless(fabsf(out_data[c][i] - in_data[c][i]) <= 1e-6f);
+
+    /* ((x * 2 + 1) * 3 - 2) * 0.5 */
+    nodes[0] = test_node_new(2, 1);
+    nodes[1] = test_node_new(3, -2);
+    nodes[2] = test_node_new(0.5, 0);
+
+    for (i = 0; i < 3; i++)
+        pa_filter_graph_append(g, &nodes[i]->node);
+
+    fail_unless(pa_filter_graph_get_n_nodes(g) == 3);
+    fail_unless(pa_filter_graph_get_node(g, 1) == &nodes[1]->node);
+
+    pa_filter_graph_process(g, in, out, FRAMES - 3);
+    for (c = 0; c < CHANNELS; c++)
+        for (i = 0; i < FRAMES - 3; i++)
+            fail_unless(fabsf(out_data[c][i] - ((in_data[c][i] * 2 + 1) * 3 - 2) * 0.5f) <= 1e-6f);
+
+    pa_filter_graph_reset(g);
+    for (i = 0; i < 3; i++)
+        fail_unless(nodes[i]->n_resets == 1);
+
+    pa_filter_graph_free(g);
+}
+END_TEST
+
+START_TEST (filter_graph_parse_test) {
+    pa_sample_spec ss = { PA_SAMPLE_FLOAT32NE, 48000, CHANNELS };
+
+    fail_unless(pa_filter_graph_new_from_string("", &ss, FRAMES) == NULL);
+    fail_unless(pa_filter_graph_new_from_string("type=foo", &ss, FRAMES) == NULL);
+    fail_unless(pa_filter_graph_new_from_string("plugin=x", &ss, FRAMES) == NULL);
+    fail_unless(pa_filter_graph_new_from_string("plugin=x label=y bogus=1", &ss, FRAMES) == NULL);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    s = suite_create("Filter Graph");
+    tc = tcase_create("filter-graph");
+    tcase_add_test(tc, filter_graph_test);
+    tcase_add_test(tc, filter_graph_parse_test);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
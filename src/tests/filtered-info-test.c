@@ -0,0 +1,157 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pulse/pulseaudio.h>
+#include <pulse/mainloop.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/macro.h>
+
+#define TEST_SINK_NAME "filtered-info-test"
+#define TEST_PROPERTY "filtered-info-test.tag"
+
+static pa_mainloop *mainloop = NULL;
+static pa_context *context = NULL;
+
+static uint32_t module_index;
+static unsigned n_sinks;
+static bool have_proplist;
+
+static void wait_for(pa_operation *o) {
+    fail_unless(o != NULL);
+
+    while (pa_operation_get_state(o) == PA_OPERATION_RUNNING)
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+
+    fail_unless(pa_operation_get_state(o) == PA_OPERATION_DONE);
+    pa_operation_unref(o);
+}
+
+static void success_cb(pa_context *c, int success, void *userdata) {
+    fail_unless(success);
+}
+
+static void index_cb(pa_context *c, uint32_t idx, void *userdata) {
+    fail_unless(idx != PA_INVALID_INDEX);
+    module_index = idx;
+}
+
+static void sink_cb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    if (eol) {
+        fail_unless(eol > 0);
+        return;
+    }
+
+    fail_unless(pa_streq(i->name, TEST_SINK_NAME));
+    fail_unless(i->owner_module == module_index);
+
+    n_sinks++;
+    have_proplist = pa_proplist_contains(i->proplist, TEST_PROPERTY) > 0;
+}
+
+static void count_cb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    if (!eol)
+        n_sinks++;
+}
+
+START_TEST (filtered_info_test) {
+    pa_info_filter f;
+
+    fail_unless((mainloop = pa_mainloop_new()) != NULL);
+    fail_unless((context = pa_context_new(pa_mainloop_get_api(mainloop), "filtered-info-test")) != NULL);
+    fail_unless(pa_context_connect(context, NULL, 0, NULL) >= 0);
+
+    while (pa_context_get_state(context) != PA_CONTEXT_READY) {
+        fail_unless(PA_CONTEXT_IS_GOOD(pa_context_get_state(context)));
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+    }
+
+    wait_for(pa_context_load_module(context, "module-null-sink",
+                                    "sink_name=" TEST_SINK_NAME " sink_properties=" TEST_PROPERTY "=yes",
+                                    index_cb, NULL));
+
+    /* By owner module, with everything */
+    pa_info_filter_init(&f);
+    f.owner_module = module_index;
+
+    n_sinks = 0;
+    wait_for(pa_context_get_sink_info_list_filtered(context, &f, sink_cb, NULL));
+    fail_unless(n_sinks == 1);
+    fail_unless(have_proplist);
+
+    /* By property, without the property list */
+    pa_info_filter_init(&f);
+    f.fields = 0;
+    f.property = TEST_PROPERTY;
+    f.value = "yes";
+
+    n_sinks = 0;
+    wait_for(pa_context_get_sink_info_list_filtered(context, &f, sink_cb, NULL));
+    fail_unless(n_sinks == 1);
+    fail_unless(!have_proplist);
+
+    f.value = "no";
+
+    n_sinks = 0;
+    wait_for(pa_context_get_sink_info_list_filtered(context, &f, count_cb, NULL));
+    fail_unless(n_sinks == 0);
+
+    /* Filters that make no sense for sinks are refused */
+    pa_info_filter_init(&f);
+    f.client = 0;
+
+    n_sinks = 0;
+    wait_for(pa_context_get_sink_info_list_filtered(context, &f, count_cb, NULL));
+    fail_unless(n_sinks == 0);
+    fail_unless(pa_context_errno(context) == PA_ERR_INVALID);
+
+    wait_for(pa_context_unload_module(context, module_index, success_cb, NULL));
+
+    pa_context_disconnect(context);
+    pa_context_unref(context);
+    pa_mainloop_free(mainloop);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    s = suite_create("Filtered Info");
+    tc = tcase_create("filtered-info");
+    tcase_add_test(tc, filtered_info_test);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
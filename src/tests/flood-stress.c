@@ -0,0 +1,307 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pulse/pulseaudio.h>
+
+#include <pulsecore/macro.h>
+
+/* Clients flooding the server, each with a playback stream and this
+ * many requests in flight */
+#define N_FLOODERS 8
+#define FLOOD_DEPTH 32
+
+/* Number of round trips timed in every mode */
+#define N_PROBES 1000
+
+#define SAMPLE_HZ 44100
+
+static const pa_sample_spec sample_spec = {
+    .format = PA_SAMPLE_FLOAT32,
+    .rate = SAMPLE_HZ,
+    .channels = 1
+};
+
+struct flooder {
+    pa_context *context;
+    pa_stream *stream;
+};
+
+static pa_threaded_mainloop *flood_mainloop, *probe_mainloop;
+static struct flooder flooders[N_FLOODERS];
+static bool flooding;
+static unsigned n_flood_replies;
+
+static void context_state_cb(pa_context *c, void *userdata) {
+    pa_threaded_mainloop *m = userdata;
+
+    fail_unless(PA_CONTEXT_IS_GOOD(pa_context_get_state(c)));
+    pa_threaded_mainloop_signal(m, 0);
+}
+
+/* Called with m locked */
+static pa_context *connect_context(pa_threaded_mainloop *m, const char *server) {
+    pa_context *c;
+
+    fail_unless((c = pa_context_new(pa_threaded_mainloop_get_api(m), "flood-stress")) != NULL);
+    pa_context_set_state_callback(c, context_state_cb, m);
+    fail_unless(pa_context_connect(c, server, PA_CONTEXT_NOAUTOSPAWN, NULL) >= 0);
+
+    while (pa_context_get_state(c) != PA_CONTEXT_READY)
+        pa_threaded_mainloop_wait(m);
+
+    return c;
+}
+
+/* Called with the main loop of c locked */
+static void disconnect_context(pa_context *c) {
+    pa_context_set_state_callback(c, NULL, NULL);
+    pa_context_disconnect(c);
+    pa_context_unref(c);
+}
+
+static void index_cb(pa_context *c, uint32_t idx, void *userdata) {
+    uint32_t *module_idx = userdata;
+
+    *module_idx = idx;
+    pa_threaded_mainloop_signal(probe_mainloop, 0);
+}
+
+static void success_cb(pa_context *c, int success, void *userdata) {
+    bool *done = userdata;
+
+    *done = true;
+    pa_threaded_mainloop_signal(probe_mainloop, 0);
+}
+
+static void flood_info_cb(pa_context *c, const pa_server_info *i, void *userdata) {
+    pa_operation *o;
+
+    if (!flooding)
+        return;
+
+    /* Not for the requests start_flooding() fires off */
+    if (i)
+        n_flood_replies++;
+
+    fail_unless((o = pa_context_get_server_info(c, flood_info_cb, NULL)) != NULL);
+    pa_operation_unref(o);
+}
+
+static void stream_write_cb(pa_stream *s, size_t nbytes, void *userdata) {
+    void *data;
+
+    while (nbytes > 0) {
+        size_t n = nbytes;
+
+        fail_unless(pa_stream_begin_write(s, &data, &n) == 0);
+        memset(data, 0, n);
+        fail_unless(pa_stream_write(s, data, n, NULL, 0, PA_SEEK_RELATIVE) == 0);
+
+        nbytes -= PA_MIN(n, nbytes);
+    }
+}
+
+static void stream_state_cb(pa_stream *s, void *userdata) {
+    fail_unless(PA_STREAM_IS_GOOD(pa_stream_get_state(s)));
+}
+
+static void start_flooding(const char *server) {
+    unsigned i, j;
+
+    pa_threaded_mainloop_lock(flood_mainloop);
+
+    flooding = true;
+
+    for (i = 0; i < N_FLOODERS; i++) {
+        struct flooder *f = &flooders[i];
+
+        f->context = connect_context(flood_mainloop, server);
+
+        fail_unless((f->stream = pa_stream_new(f->context, "flood-stress", &sample_spec, NULL)) != NULL);
+        pa_stream_set_state_callback(f->stream, stream_state_cb, NULL);
+        pa_stream_set_write_callback(f->stream, stream_write_cb, NULL);
+        fail_unless(pa_stream_connect_playback(f->stream, NULL, NULL, 0, NULL, NULL) == 0);
+
+        for (j = 0; j < FLOOD_DEPTH; j++)
+            flood_info_cb(f->context, NULL, NULL);
+    }
+
+    pa_threaded_mainloop_unlock(flood_mainloop);
+}
+
+static void stop_flooding(void) {
+    unsigned i;
+
+    pa_threaded_mainloop_lock(flood_mainloop);
+
+    flooding = false;
+
+    for (i = 0; i < N_FLOODERS; i++) {
+        pa_stream_set_state_callback(flooders[i].stream, NULL, NULL);
+        pa_stream_disconnect(flooders[i].stream);
+        pa_stream_unref(flooders[i].stream);
+        disconnect_context(flooders[i].context);
+    }
+
+    pa_threaded_mainloop_unlock(flood_mainloop);
+}
+
+static void probe_info_cb(pa_context *c, const pa_server_info *i, void *userdata) {
+    bool *done = userdata;
+
+    fail_unless(i != NULL);
+
+    *done = true;
+    pa_threaded_mainloop_signal(probe_mainloop, 0);
+}
+
+/* Times request round trips of an idle client while the others flood
+ * a native protocol module with the given number of I/O threads */
+static void run_mode(pa_context *admin, uint32_t io_threads, pa_usec_t *avg, pa_usec_t *max, unsigned *n_flooded) {
+    char path[64], args[128], server[80];
+    uint32_t module_idx = PA_INVALID_INDEX;
+    pa_context *probe;
+    pa_usec_t sum = 0;
+    bool done = false;
+    unsigned i;
+
+    snprintf(path, sizeof(path), "/tmp/flood-stress-%lu-%u", (unsigned long) getpid(), io_threads);
+    snprintf(args, sizeof(args), "socket=%s auth-anonymous=1 io-threads=%u", path, io_threads);
+    snprintf(server, sizeof(server), "unix:%s", path);
+
+    pa_threaded_mainloop_lock(probe_mainloop);
+
+    pa_operation_unref(pa_context_load_module(admin, "module-native-protocol-unix", args, index_cb, &module_idx));
+    while (module_idx == PA_INVALID_INDEX)
+        pa_threaded_mainloop_wait(probe_mainloop);
+
+    pa_threaded_mainloop_unlock(probe_mainloop);
+
+    start_flooding(server);
+
+    pa_threaded_mainloop_lock(probe_mainloop);
+
+    probe = connect_context(probe_mainloop, server);
+    *max = 0;
+
+    for (i = 0; i < N_PROBES; i++) {
+        pa_usec_t start, t;
+
+        done = false;
+        start = pa_rtclock_now();
+
+        pa_operation_unref(pa_context_get_server_info(probe, probe_info_cb, &done));
+        while (!done)
+            pa_threaded_mainloop_wait(probe_mainloop);
+
+        t = pa_rtclock_now() - start;
+        sum += t;
+        *max = PA_MAX(*max, t);
+    }
+
+    disconnect_context(probe);
+
+    pa_threaded_mainloop_unlock(probe_mainloop);
+
+    stop_flooding();
+
+    pa_threaded_mainloop_lock(flood_mainloop);
+    *n_flooded = n_flood_replies;
+    n_flood_replies = 0;
+    pa_threaded_mainloop_unlock(flood_mainloop);
+
+    pa_threaded_mainloop_lock(probe_mainloop);
+
+    done = false;
+    pa_operation_unref(pa_context_unload_module(admin, module_idx, success_cb, &done));
+    while (!done)
+        pa_threaded_mainloop_wait(probe_mainloop);
+
+    pa_threaded_mainloop_unlock(probe_mainloop);
+
+    *avg = sum / N_PROBES;
+}
+
+START_TEST (flood_stress_test) {
+    pa_usec_t avg_main, max_main, avg_threads, max_threads;
+    unsigned n_main, n_threads;
+    pa_context *admin;
+
+    fail_unless((flood_mainloop = pa_threaded_mainloop_new()) != NULL);
+    fail_unless((probe_mainloop = pa_threaded_mainloop_new()) != NULL);
+    fail_unless(pa_threaded_mainloop_start(flood_mainloop) == 0);
+    fail_unless(pa_threaded_mainloop_start(probe_mainloop) == 0);
+
+    pa_threaded_mainloop_lock(probe_mainloop);
+    admin = connect_context(probe_mainloop, NULL);
+    pa_threaded_mainloop_unlock(probe_mainloop);
+
+    run_mode(admin, 0, &avg_main, &max_main, &n_main);
+    run_mode(admin, 4, &avg_threads, &max_threads, &n_threads);
+
+    fprintf(stderr, "Round trip under load: %0.3f ms avg, %0.3f ms max with the main loop doing the I/O, "
+            "%0.3f ms avg, %0.3f ms max with 4 I/O threads.\n",
+            (double) avg_main / PA_USEC_PER_MSEC, (double) max_main / PA_USEC_PER_MSEC,
+            (double) avg_threads / PA_USEC_PER_MSEC, (double) max_threads / PA_USEC_PER_MSEC);
+
+    /* The timings depend too much on the machine to check them, but
+     * in both modes the flooders must have been answered, too */
+    fail_unless(n_main > 0);
+    fail_unless(n_threads > 0);
+
+    pa_threaded_mainloop_lock(probe_mainloop);
+    disconnect_context(admin);
+    pa_threaded_mainloop_unlock(probe_mainloop);
+
+    pa_threaded_mainloop_stop(flood_mainloop);
+    pa_threaded_mainloop_stop(probe_mainloop);
+    pa_threaded_mainloop_free(flood_mainloop);
+    pa_threaded_mainloop_free(probe_mainloop);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    s = suite_create("Flood Stress");
+    tc = tcase_create("flood-stress");
+    tcase_add_test(tc, flood_stress_test);
+    tcase_set_timeout(tc, 120);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
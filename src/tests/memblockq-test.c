@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <signal.h>
+#include <math.h>
 
 #include <check.h>
 
@@ -32,6 +33,7 @@
 #include <pulsecore/macro.h>
 #include <pulsecore/strbuf.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/sample-util.h>
 
 #include <pulse/xmalloc.h>
 
@@ -214,6 +216,66 @@ START_TEST (memblockq_test) {
 }
 END_TEST
 
+START_TEST (planar_test) {
+    pa_mempool *p;
+    pa_memblockq *bq;
+    pa_memchunk chunk;
+    float *d;
+    unsigned c, f;
+    pa_sample_spec ss = {
+        .format = PA_SAMPLE_FLOAT32NE,
+        .rate = 48000,
+        .channels = 3
+    };
+
+    p = pa_mempool_new(false, 0);
+
+    /* 8 frames, sample f of channel c is c * 100 + f */
+    chunk.memblock = pa_planar_memblock_new(p, 8 * pa_frame_size(&ss), &ss);
+    chunk.index = 0;
+    chunk.length = pa_memblock_get_length(chunk.memblock);
+
+    d = pa_memblock_acquire(chunk.memblock);
+    for (c = 0; c < ss.channels; c++)
+        for (f = 0; f < 8; f++)
+            d[c * 8 + f] = (float) (c * 100 + f);
+    pa_memblock_release(chunk.memblock);
+
+    bq = pa_memblockq_new("test memblockq", 0, 200, 0, &ss, 0, 0, 0, NULL);
+    fail_unless(bq != NULL);
+
+    fail_unless(pa_memblockq_push(bq, &chunk) == 0);
+    pa_memblock_unref(chunk.memblock);
+
+    /* Slicing a planar block by frames has to keep working */
+    pa_memblockq_drop(bq, 2 * pa_frame_size(&ss));
+    fail_unless(pa_memblockq_peek(bq, &chunk) == 0);
+    fail_unless(pa_memblock_is_planar(chunk.memblock));
+    fail_unless(chunk.length == 6 * pa_frame_size(&ss));
+
+    d = pa_memblock_acquire(chunk.memblock);
+    for (c = 0; c < ss.channels; c++)
+        fail_unless(fabsf(pa_planar_channel(d, &chunk, &ss, c)[0] - (float) (c * 100 + 2)) <= 1e-6f);
+    pa_memblock_release(chunk.memblock);
+
+    chunk.length = 5 * pa_frame_size(&ss);
+    pa_memchunk_interleave(&chunk, &ss, p);
+    fail_unless(!pa_memblock_is_planar(chunk.memblock));
+    fail_unless(chunk.index == 0);
+    fail_unless(chunk.length == 5 * pa_frame_size(&ss));
+
+    d = pa_memblock_acquire(chunk.memblock);
+    for (f = 0; f < 5; f++)
+        for (c = 0; c < ss.channels; c++)
+            fail_unless(fabsf(d[f * ss.channels + c] - (float) (c * 100 + f + 2)) <= 1e-6f);
+    pa_memblock_release(chunk.memblock);
+
+    pa_memblock_unref(chunk.memblock);
+    pa_memblockq_free(bq);
+    pa_mempool_free(p);
+}
+END_TEST
+
 int main(int argc, char *argv[]) {
     int failed = 0;
     Suite *s;
@@ -223,6 +285,7 @@ int main(int argc, char *argv[]) {
     s = suite_create("Memblock Queue");
     tc = tcase_create("memblockq");
     tcase_add_test(tc, memblockq_test);
+    tcase_add_test(tc, planar_test);
     suite_add_tcase(s, tc);
 
     sr = srunner_create(s);
@@ -0,0 +1,211 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pulse/pulseaudio.h>
+#include <pulse/mainloop.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/macro.h>
+
+/* Number of queries of every kind timed with and without the cache */
+#define N_QUERIES 1000
+
+#define TEST_SINK_NAME "object-cache-test"
+
+static pa_mainloop *mainloop = NULL;
+static pa_context *context = NULL;
+
+static unsigned n_sinks;
+static uint32_t sink_index;
+static char *sink_name;
+static bool sink_found;
+static uint32_t found_index;
+static uint32_t module_index;
+static uint32_t removed_sink = PA_INVALID_INDEX;
+
+static void wait_for(pa_operation *o) {
+    fail_unless(o != NULL);
+
+    while (pa_operation_get_state(o) == PA_OPERATION_RUNNING)
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+
+    fail_unless(pa_operation_get_state(o) == PA_OPERATION_DONE);
+    pa_operation_unref(o);
+}
+
+static void success_cb(pa_context *c, int success, void *userdata) {
+    fail_unless(success);
+}
+
+static void index_cb(pa_context *c, uint32_t idx, void *userdata) {
+    fail_unless(idx != PA_INVALID_INDEX);
+    module_index = idx;
+}
+
+static void sink_list_cb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    if (eol) {
+        fail_unless(eol > 0);
+        return;
+    }
+
+    if (n_sinks++ == 0) {
+        sink_index = i->index;
+        pa_xfree(sink_name);
+        sink_name = pa_xstrdup(i->name);
+    }
+}
+
+static void sink_cb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    if (eol)
+        return;
+
+    fail_unless(!sink_found);
+    sink_found = true;
+    found_index = i->index;
+
+    if (userdata)
+        fail_unless(pa_streq(i->name, userdata));
+}
+
+static void subscribe_cb(pa_context *c, pa_subscription_event_type_t t, uint32_t idx, void *userdata) {
+    if ((t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) == PA_SUBSCRIPTION_EVENT_SINK &&
+        (t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+        removed_sink = idx;
+}
+
+/* Runs N_QUERIES list and lookup queries, returns how long that took */
+static pa_usec_t run_queries(void) {
+    pa_usec_t start;
+    unsigned i, n;
+
+    n_sinks = 0;
+    wait_for(pa_context_get_sink_info_list(context, sink_list_cb, NULL));
+    fail_unless(n_sinks > 0);
+    n = n_sinks;
+
+    start = pa_rtclock_now();
+
+    for (i = 0; i < N_QUERIES; i++) {
+        n_sinks = 0;
+        wait_for(pa_context_get_sink_info_list(context, sink_list_cb, NULL));
+        fail_unless(n_sinks == n);
+
+        sink_found = false;
+        wait_for(pa_context_get_sink_info_by_index(context, sink_index, sink_cb, sink_name));
+        fail_unless(sink_found);
+
+        sink_found = false;
+        wait_for(pa_context_get_sink_info_by_name(context, sink_name, sink_cb, sink_name));
+        fail_unless(sink_found);
+    }
+
+    return pa_rtclock_now() - start;
+}
+
+START_TEST (object_cache_test) {
+    pa_usec_t t_server, t_cache;
+    uint32_t generation;
+
+    fail_unless((mainloop = pa_mainloop_new()) != NULL);
+    fail_unless((context = pa_context_new(pa_mainloop_get_api(mainloop), "object-cache-test")) != NULL);
+    fail_unless(pa_context_connect(context, NULL, 0, NULL) >= 0);
+
+    while (pa_context_get_state(context) != PA_CONTEXT_READY) {
+        fail_unless(PA_CONTEXT_IS_GOOD(pa_context_get_state(context)));
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+    }
+
+    t_server = run_queries();
+
+    fail_unless(pa_context_get_object_cache_generation(context) == 0);
+    wait_for(pa_context_enable_object_cache(context, success_cb, NULL));
+    fail_unless((generation = pa_context_get_object_cache_generation(context)) != 0);
+
+    t_cache = run_queries();
+
+    fprintf(stderr, "%u queries: %0.2f ms from the server, %0.2f ms from the cache.\n",
+            N_QUERIES * 3,
+            (double) t_server / PA_USEC_PER_MSEC,
+            (double) t_cache / PA_USEC_PER_MSEC);
+
+    /* New objects must show up in lookups... */
+    wait_for(pa_context_load_module(context, "module-null-sink", "sink_name=" TEST_SINK_NAME, index_cb, NULL));
+
+    sink_found = false;
+    wait_for(pa_context_get_sink_info_by_name(context, TEST_SINK_NAME, sink_cb, (void *) TEST_SINK_NAME));
+    fail_unless(sink_found);
+
+    /* The event may still be on its way */
+    while (pa_context_get_object_cache_generation(context) == generation)
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+
+    /* ...and removed ones must be gone once the removal was seen. The
+     * cache sees every event before the subscribe callback does. Other
+     * events, e.g. for the monitor source, may come first. */
+    pa_context_set_subscribe_callback(context, subscribe_cb, NULL);
+    wait_for(pa_context_subscribe(context, PA_SUBSCRIPTION_MASK_SINK, success_cb, NULL));
+
+    wait_for(pa_context_unload_module(context, module_index, success_cb, NULL));
+
+    while (removed_sink != found_index)
+        fail_unless(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+
+    sink_found = false;
+    wait_for(pa_context_get_sink_info_by_name(context, TEST_SINK_NAME, sink_cb, NULL));
+    fail_unless(!sink_found);
+
+    pa_context_disable_object_cache(context);
+    fail_unless(pa_context_get_object_cache_generation(context) == 0);
+
+    pa_xfree(sink_name);
+    sink_name = NULL;
+
+    pa_context_disconnect(context);
+    pa_context_unref(context);
+    pa_mainloop_free(mainloop);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    s = suite_create("Object Cache");
+    tc = tcase_create("object-cache");
+    tcase_add_test(tc, object_cache_test);
+    tcase_set_timeout(tc, 120);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
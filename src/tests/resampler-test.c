@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <getopt.h>
 #include <locale.h>
+#include <math.h>
 
 #include <pulse/pulseaudio.h>
 
@@ -39,6 +40,7 @@
 #include <pulsecore/memblock.h>
 #include <pulsecore/sample-util.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/sinc.h>
 
 static void dump_block(const char *label, const pa_sample_spec *ss, const pa_memchunk *chunk) {
     void *d;
@@ -253,6 +255,212 @@ static pa_memblock* generate_block(pa_mempool *pool, const pa_sample_spec *ss) {
     return r;
 }
 
+#define REWIND_BLOCK_FRAMES 1024U
+#define REWIND_N_BLOCKS 16U
+
+/* Append the output of pa_resampler_run() to a float buffer */
+static void append_output(float **buf, size_t *n, pa_memchunk *chunk) {
+    float *d;
+
+    if (!chunk->memblock)
+        return;
+
+    *buf = pa_xrealloc(*buf, *n * sizeof(float) + chunk->length);
+
+    d = pa_memblock_acquire_chunk(chunk);
+    memcpy(*buf + *n, d, chunk->length);
+    pa_memblock_release(chunk->memblock);
+
+    *n += chunk->length / sizeof(float);
+    pa_memblock_unref(chunk->memblock);
+}
+
+/* Feed the frames [from, to) of the input block */
+static void feed(pa_resampler *r, pa_memblock *in, size_t fs, unsigned from, unsigned to, float **buf, size_t *n) {
+    while (from < to) {
+        pa_memchunk i, o;
+        unsigned l = PA_MIN(to - from, REWIND_BLOCK_FRAMES);
+
+        i.memblock = in;
+        i.index = from * fs;
+        i.length = l * fs;
+
+        pa_resampler_run(r, &i, &o);
+        append_output(buf, n, &o);
+
+        from += l;
+    }
+}
+
+static bool src_method(pa_resample_method_t method) {
+    return method >= PA_RESAMPLER_SRC_SINC_BEST_QUALITY && method <= PA_RESAMPLER_SRC_LINEAR;
+}
+
+/* Compares the output of a resampler that is rewound in the middle of
+ * the stream with the output of straight-through rendering. Both end
+ * at the same position of the input, hence the tail of the straight
+ * output has to match the output after the rewind if the resampler
+ * state was restored exactly. */
+static void test_rewind(pa_mempool *pool, uint32_t from_rate, uint32_t to_rate, pa_resample_method_t method) {
+    pa_sample_spec a, b;
+    pa_resampler *straight, *rewound;
+    pa_memblock *in;
+    float *d, *s_buf = NULL, *r_buf = NULL;
+    size_t s_n = 0, r_n = 0, fs, k;
+    unsigned i, n_frames, rewind_frames, rewind_at;
+    float max_diff = 0;
+    pa_usec_t ts, rewind_time;
+    bool exact, identical;
+
+    a.format = b.format = PA_SAMPLE_FLOAT32NE;
+    a.channels = b.channels = 2;
+    a.rate = from_rate;
+    b.rate = to_rate;
+
+    fs = pa_frame_size(&a);
+    n_frames = REWIND_BLOCK_FRAMES * REWIND_N_BLOCKS;
+
+    /* Rewind by one and a half blocks, after two thirds of the stream */
+    rewind_at = REWIND_BLOCK_FRAMES * (REWIND_N_BLOCKS * 2 / 3);
+    rewind_frames = REWIND_BLOCK_FRAMES * 3 / 2;
+
+    pa_assert_se(in = pa_memblock_new(pool, n_frames * fs));
+    d = pa_memblock_acquire(in);
+    for (i = 0; i < n_frames; i++) {
+        d[2*i] = 0.5f * sinf(2.0f * (float) M_PI * 440.0f * i / a.rate);
+        d[2*i+1] = 0.5f * sinf(2.0f * (float) M_PI * 3000.0f * i / a.rate);
+    }
+    pa_memblock_release(in);
+
+    pa_assert_se(straight = pa_resampler_new(pool, &a, NULL, &b, NULL, method, 0));
+    pa_assert_se(rewound = pa_resampler_new(pool, &a, NULL, &b, NULL, method, 0));
+    pa_resampler_set_max_rewind(rewound, 4 * REWIND_BLOCK_FRAMES * fs);
+
+    feed(straight, in, fs, 0, n_frames, &s_buf, &s_n);
+
+    feed(rewound, in, fs, 0, rewind_at, &r_buf, &r_n);
+
+    ts = pa_rtclock_now();
+    exact = pa_resampler_rewind(rewound, rewind_frames * fs);
+    rewind_time = pa_rtclock_now() - ts;
+
+    r_n = 0;
+    feed(rewound, in, fs, rewind_at - rewind_frames, n_frames, &r_buf, &r_n);
+
+    pa_assert_se(r_n <= s_n);
+
+    for (k = 0; k < r_n; k++) {
+        float diff = fabsf(r_buf[k] - s_buf[s_n - r_n + k]);
+
+        if (diff > max_diff)
+            max_diff = diff;
+    }
+
+    pa_log_info("=== rewind %s %u -> %u Hz: state %s, max deviation from straight rendering %g, rewind took %llu usec",
+                pa_resample_method_to_string(pa_resampler_get_method(rewound)), a.rate, b.rate,
+                exact ? "restored" : "reset", max_diff, (unsigned long long) rewind_time);
+
+    /* Only libsamplerate cannot restore its state, and the rewind stays
+     * well within the history. If the state was restored, the output
+     * has to be identical, bit for bit */
+    if (!src_method(pa_resampler_get_method(rewound)))
+        pa_assert_se(exact);
+
+    identical = memcmp(r_buf, s_buf + s_n - r_n, r_n * sizeof(float)) == 0;
+    pa_assert_se(!exact || identical);
+
+    pa_xfree(s_buf);
+    pa_xfree(r_buf);
+    pa_memblock_unref(in);
+    pa_resampler_free(straight);
+    pa_resampler_free(rewound);
+}
+
+#define BENCHMARK_SECONDS 2
+
+/* Measures the CPU time needed to resample a stereo tone of frequency f
+ * and how far everything that is not that tone is attenuated. For
+ * downsampling, f is picked in the stop band, so that all of the output
+ * is alias. For upsampling, everything above the input band is image.
+ * Returns the stop-band rejection in dB. */
+static double benchmark_integer_ratio(pa_mempool *pool, uint32_t from_rate, uint32_t to_rate, pa_resample_method_t method) {
+    pa_sample_spec a, b;
+    pa_resampler *r;
+    pa_memblock *in;
+    float *d, *buf = NULL;
+    size_t n = 0, fs, k, skip;
+    unsigned i, n_frames;
+    double f, tone, residual = 0, s = 0, c = 0, rejection;
+    pa_usec_t ts, t = 0;
+
+    a.format = b.format = PA_SAMPLE_FLOAT32NE;
+    a.channels = b.channels = 2;
+    a.rate = from_rate;
+    b.rate = to_rate;
+
+    fs = pa_frame_size(&a);
+    n_frames = REWIND_BLOCK_FRAMES;
+
+    f = to_rate < from_rate ? 0.75 * to_rate : 0.25 * from_rate;
+
+    pa_assert_se(in = pa_memblock_new(pool, n_frames * fs));
+    pa_assert_se(r = pa_resampler_new(pool, &a, NULL, &b, NULL, method, 0));
+
+    for (i = 0; i < BENCHMARK_SECONDS * from_rate / n_frames; i++) {
+        pa_memchunk ic, oc;
+        unsigned j;
+
+        d = pa_memblock_acquire(in);
+        for (j = 0; j < n_frames; j++)
+            d[2*j] = d[2*j+1] = 0.5f * (float) sin(2.0 * M_PI * f * (i * n_frames + j) / from_rate);
+        pa_memblock_release(in);
+
+        ic.memblock = in;
+        ic.index = 0;
+        ic.length = n_frames * fs;
+
+        ts = pa_rtclock_now();
+        pa_resampler_run(r, &ic, &oc);
+        t += pa_rtclock_now() - ts;
+
+        append_output(&buf, &n, &oc);
+    }
+
+    /* Skip the start up, then remove the tone from the output if it
+     * is within the output band */
+    skip = n / 10 & ~(size_t) 1;
+
+    if (f < to_rate / 2.0) {
+        for (k = skip; k < n; k += 2) {
+            s += buf[k] * sin(2.0 * M_PI * f * (k / 2) / to_rate);
+            c += buf[k] * cos(2.0 * M_PI * f * (k / 2) / to_rate);
+        }
+
+        s = s * 2 / ((n - skip) / 2);
+        c = c * 2 / ((n - skip) / 2);
+    }
+
+    for (k = skip; k < n; k += 2) {
+        double e = buf[k] - s * sin(2.0 * M_PI * f * (k / 2) / to_rate) - c * cos(2.0 * M_PI * f * (k / 2) / to_rate);
+
+        residual += e * e;
+    }
+
+    tone = 0.5 * 0.5 / 2;
+    residual /= (n - skip) / 2;
+    rejection = 10.0 * log10(tone / (residual + 1e-20));
+
+    pa_log_info("=== %s %u -> %u Hz: %llu usec per second of audio, stop-band rejection %.1f dB",
+                pa_resample_method_to_string(pa_resampler_get_method(r)), from_rate, to_rate,
+                (unsigned long long) (t / BENCHMARK_SECONDS), rejection);
+
+    pa_xfree(buf);
+    pa_memblock_unref(in);
+    pa_resampler_free(r);
+
+    return rejection;
+}
+
 static void help(const char *argv0) {
     printf(_("%s [options]\n\n"
              "-h, --help                            Show this help\n"
@@ -438,6 +646,9 @@ int main(int argc, char *argv[]) {
 
         pa_resampler_free(resampler);
 
+        if (a.rate != b.rate)
+            test_rewind(pool, a.rate, b.rate, method);
+
         goto quit;
     }
 
@@ -473,6 +684,46 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    for (method = 0; method < PA_RESAMPLER_MAX; method++) {
+        if (method == PA_RESAMPLER_AUTO || method == PA_RESAMPLER_COPY || method == PA_RESAMPLER_PEAKS)
+            continue;
+
+        if (!pa_resample_method_supported(method))
+            continue;
+
+        if (method >= PA_RESAMPLER_HALFBAND_BASE && method <= PA_RESAMPLER_HALFBAND_MAX) {
+            test_rewind(pool, 48000, 96000, method);
+            test_rewind(pool, 48000, 16000, method);
+            test_rewind(pool, 192000, 48000, method);
+            continue;
+        }
+
+        test_rewind(pool, 44100, 48000, method);
+        test_rewind(pool, 48000, 44100, method);
+    }
+
+    {
+        static const uint32_t rates[][2] = {
+            { 48000, 96000 },
+            { 44100, 88200 },
+            { 48000, 16000 },
+            { 96000, 48000 },
+            { 48000, 192000 }
+        };
+        unsigned n;
+
+        for (n = 0; n < PA_ELEMENTSOF(rates); n++) {
+            /* The filters have to achieve the rejection they are
+             * designed for */
+            pa_assert_se(benchmark_integer_ratio(pool, rates[n][0], rates[n][1], PA_RESAMPLER_HALFBAND_BASE + 1) >= pa_sinc_quality_attenuation(1));
+
+            if (pa_resample_method_supported(PA_RESAMPLER_SPEEX_FLOAT_BASE + 1))
+                benchmark_integer_ratio(pool, rates[n][0], rates[n][1], PA_RESAMPLER_SPEEX_FLOAT_BASE + 1);
+            else
+                benchmark_integer_ratio(pool, rates[n][0], rates[n][1], PA_RESAMPLER_SINC_BASE + 1);
+        }
+    }
+
  quit:
     if (pool)
         pa_mempool_free(pool);
@@ -0,0 +1,334 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdlib.h>
+
+#include <pulse/mainloop.h>
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
+
+#include <pulsecore/core.h>
+#include <pulsecore/core-subscribe.h>
+#include <pulsecore/hashmap.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/packet.h>
+#include <pulsecore/tagstruct.h>
+
+/* Number of subscribed clients and events posted in the benchmark */
+#define N_CLIENTS 300
+#define N_EVENTS 1000
+
+/* Stands in for the send queue of a client connection */
+struct client {
+    pa_packet *packets[N_EVENTS];
+    unsigned n_packets;
+};
+
+static struct client clients[N_CLIENTS];
+
+static void client_flush(struct client *cl) {
+    unsigned i;
+
+    for (i = 0; i < cl->n_packets; i++)
+        pa_packet_unref(cl->packets[i]);
+
+    cl->n_packets = 0;
+}
+
+/* What every connection used to do: serialize the event on its own */
+static void serialize_cb(pa_core *c, pa_subscription_event_type_t e, uint32_t idx, void *userdata) {
+    struct client *cl = userdata;
+    pa_tagstruct *t;
+    uint8_t *data;
+    size_t length;
+
+    t = pa_tagstruct_new(NULL, 0);
+    pa_tagstruct_putu32(t, PA_COMMAND_SUBSCRIBE_EVENT);
+    pa_tagstruct_putu32(t, (uint32_t) -1);
+    pa_tagstruct_putu32(t, e);
+    pa_tagstruct_putu32(t, idx);
+
+    pa_assert_se(data = pa_tagstruct_free_data(t, &length));
+    cl->packets[cl->n_packets++] = pa_packet_new_dynamic(data, length);
+}
+
+static void packet_cb(pa_core *c, pa_subscription_event_type_t e, uint32_t idx, pa_packet *packet, void *userdata) {
+    struct client *cl = userdata;
+
+    cl->packets[cl->n_packets++] = pa_packet_ref(packet);
+}
+
+static void check_packet(pa_packet *packet, pa_subscription_event_type_t e, uint32_t idx) {
+    pa_tagstruct *t;
+    uint32_t command, tag, type, index;
+
+    t = pa_tagstruct_new(packet->data, packet->length);
+
+    fail_unless(pa_tagstruct_getu32(t, &command) == 0);
+    fail_unless(pa_tagstruct_getu32(t, &tag) == 0);
+    fail_unless(pa_tagstruct_getu32(t, &type) == 0);
+    fail_unless(pa_tagstruct_getu32(t, &index) == 0);
+    fail_unless(pa_tagstruct_eof(t));
+
+    fail_unless(command == PA_COMMAND_SUBSCRIBE_EVENT);
+    fail_unless(tag == (uint32_t) -1);
+    fail_unless(type == e);
+    fail_unless(index == idx);
+
+    pa_tagstruct_free(t);
+}
+
+/* Posts N_EVENTS events to N_CLIENTS subscribers, returns how long it
+ * took to dispatch them */
+static pa_usec_t run(pa_mainloop *m, pa_core *c, bool shared) {
+    pa_subscription *subscriptions[N_CLIENTS];
+    pa_usec_t start, stop;
+    unsigned i;
+
+    for (i = 0; i < N_CLIENTS; i++) {
+        if (shared)
+            subscriptions[i] = pa_subscription_new_packet(c, PA_SUBSCRIPTION_MASK_ALL, packet_cb, &clients[i]);
+        else
+            subscriptions[i] = pa_subscription_new(c, PA_SUBSCRIPTION_MASK_ALL, serialize_cb, &clients[i]);
+    }
+
+    start = pa_rtclock_now();
+
+    /* Every event is for another object so that nothing is merged */
+    for (i = 0; i < N_EVENTS; i++)
+        pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_CHANGE, i);
+
+    while (c->subscription_event_queue)
+        pa_mainloop_iterate(m, 0, NULL);
+
+    stop = pa_rtclock_now();
+
+    for (i = 0; i < N_CLIENTS; i++) {
+        unsigned j;
+
+        fail_unless(clients[i].n_packets == N_EVENTS);
+
+        for (j = 0; j < N_EVENTS; j++) {
+            /* With shared packets every client queues the same one */
+            if (shared)
+                fail_unless(clients[i].packets[j] == clients[0].packets[j]);
+
+            if (i == 0)
+                check_packet(clients[i].packets[j], PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_CHANGE, j);
+        }
+    }
+
+    for (i = 0; i < N_CLIENTS; i++) {
+        client_flush(&clients[i]);
+        pa_subscription_free(subscriptions[i]);
+    }
+
+    /* Let the dead subscriptions be cleaned up */
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SERVER|PA_SUBSCRIPTION_EVENT_CHANGE, 0);
+    pa_mainloop_iterate(m, 0, NULL);
+
+    return stop - start;
+}
+
+START_TEST (subscribe_test) {
+    pa_mainloop *m;
+    pa_core *c;
+    pa_usec_t t_serialize, t_shared;
+
+    pa_assert_se(m = pa_mainloop_new());
+    pa_assert_se(c = pa_core_new(pa_mainloop_get_api(m), false, 0));
+
+    t_serialize = run(m, c, false);
+    t_shared = run(m, c, true);
+
+    pa_log_info("%u events to %u clients: %0.2f ms serializing per client, %0.2f ms with a shared packet.",
+                N_EVENTS, N_CLIENTS,
+                (double) t_serialize / PA_USEC_PER_MSEC,
+                (double) t_shared / PA_USEC_PER_MSEC);
+
+    fail_unless(c->subscription_stats.n_queued == 0);
+
+    pa_core_unref(c);
+    pa_mainloop_free(m);
+}
+END_TEST
+
+/* Records the events dispatched to a subscriber */
+struct recorder {
+    pa_subscription_event_type_t types[16];
+    uint32_t indexes[16];
+    pa_usec_t times[16];
+    unsigned n;
+};
+
+static void record_cb(pa_core *c, pa_subscription_event_type_t e, uint32_t idx, void *userdata) {
+    struct recorder *r = userdata;
+
+    fail_unless(r->n < PA_ELEMENTSOF(r->types));
+
+    r->types[r->n] = e;
+    r->indexes[r->n] = idx;
+    r->times[r->n] = pa_rtclock_now();
+    r->n++;
+}
+
+static void check_event(struct recorder *r, unsigned i, pa_subscription_event_type_t e, uint32_t idx) {
+    fail_unless(i < r->n);
+    fail_unless(r->types[i] == e);
+    fail_unless(r->indexes[i] == idx);
+}
+
+START_TEST (coalesce_test) {
+    pa_mainloop *m;
+    pa_core *c;
+    pa_subscription *s;
+    struct recorder r;
+
+    pa_assert_se(m = pa_mainloop_new());
+    pa_assert_se(c = pa_core_new(pa_mainloop_get_api(m), false, 0));
+
+    pa_zero(r);
+    s = pa_subscription_new(c, PA_SUBSCRIPTION_MASK_ALL, record_cb, &r);
+
+    /* A change is merged into the new event that is still queued */
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_NEW, 1);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, 1);
+
+    /* The same index of another facility is another object */
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SOURCE|PA_SUBSCRIPTION_EVENT_CHANGE, 1);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, 1);
+
+    /* A remove drops everything that is queued for the object */
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_NEW, 7);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_CHANGE, 7);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_REMOVE, 7);
+
+    while (c->subscription_event_queue)
+        pa_mainloop_iterate(m, 0, NULL);
+
+    fail_unless(r.n == 3);
+    check_event(&r, 0, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_NEW, 1);
+    check_event(&r, 1, PA_SUBSCRIPTION_EVENT_SOURCE|PA_SUBSCRIPTION_EVENT_CHANGE, 1);
+    check_event(&r, 2, PA_SUBSCRIPTION_EVENT_SINK_INPUT|PA_SUBSCRIPTION_EVENT_REMOVE, 7);
+
+    fail_unless(c->subscription_stats.n_merged == 3);
+    fail_unless(c->subscription_stats.n_dropped == 1);
+    fail_unless(c->subscription_stats.n_dispatched == 3);
+    fail_unless(c->subscription_stats.n_queued == 0);
+
+    pa_subscription_free(s);
+    pa_core_unref(c);
+    pa_mainloop_free(m);
+}
+END_TEST
+
+#define CHANGE_INTERVAL (50 * PA_USEC_PER_MSEC)
+
+START_TEST (rate_limit_test) {
+    pa_mainloop *m;
+    pa_core *c;
+    pa_subscription *s;
+    struct recorder r;
+    unsigned i;
+
+    pa_assert_se(m = pa_mainloop_new());
+    pa_assert_se(c = pa_core_new(pa_mainloop_get_api(m), false, 0));
+    pa_subscription_set_change_interval(c, CHANGE_INTERVAL);
+
+    pa_zero(r);
+    s = pa_subscription_new(c, PA_SUBSCRIPTION_MASK_ALL, record_cb, &r);
+
+    /* The first change of every object goes out right away */
+    for (i = 1; i <= 3; i++)
+        pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, i);
+
+    while (c->subscription_event_queue)
+        pa_mainloop_iterate(m, 0, NULL);
+
+    fail_unless(r.n == 3);
+
+    /* The next ones have to wait for the interval. They become due at
+     * the same time and have to keep their order. */
+    for (i = 1; i <= 3; i++)
+        pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, i);
+
+    /* Merged into the delayed one */
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, 2);
+
+    fail_unless(c->subscription_stats.n_delayed == 3);
+    fail_unless(c->subscription_stats.n_merged == 1);
+
+    while (c->subscription_delayed_queue || c->subscription_event_queue)
+        pa_mainloop_iterate(m, 1, NULL);
+
+    fail_unless(r.n == 6);
+
+    for (i = 0; i < 3; i++) {
+        check_event(&r, 3 + i, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_CHANGE, i + 1);
+        fail_unless(r.times[3 + i] >= r.times[i] + CHANGE_INTERVAL);
+    }
+
+    /* The dispatch times are forgotten when objects are removed, even
+     * if no one is listening anymore */
+    fail_unless(pa_hashmap_size(c->subscription_change_times) == 3);
+
+    pa_subscription_free(s);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_REMOVE, 1);
+    pa_mainloop_iterate(m, 0, NULL);
+    fail_unless(!c->subscriptions);
+
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_REMOVE, 2);
+    pa_subscription_post(c, PA_SUBSCRIPTION_EVENT_SINK|PA_SUBSCRIPTION_EVENT_REMOVE, 3);
+    fail_unless(pa_hashmap_size(c->subscription_change_times) == 0);
+
+    pa_core_unref(c);
+    pa_mainloop_free(m);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_INFO);
+
+    s = suite_create("Subscribe");
+    tc = tcase_create("subscribe");
+    tcase_add_test(tc, subscribe_test);
+    tcase_add_test(tc, coalesce_test);
+    tcase_add_test(tc, rate_limit_test);
+    tcase_set_timeout(tc, 120);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,197 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <check.h>
+#include <stdlib.h>
+
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
+
+#include <pulsecore/atomic.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/thread.h>
+#include <pulsecore/timing-page.h>
+
+#define STREAM_INDEX 7
+
+/* Number of reads done while the writer is busy */
+#define N_READS 1000000
+
+static pa_timing_page *page;
+static uint32_t slot;
+static pa_atomic_t stop = PA_ATOMIC_INIT(0);
+
+static void fill(pa_timing_snapshot *s, uint64_t n) {
+    s->stream_index = STREAM_INDEX;
+    s->playing = !!(n & 1);
+    s->read_index = (int64_t) n;
+    s->write_index = (int64_t) n;
+    s->sink_usec = n;
+    s->timestamp = n;
+    s->underrun_for = n;
+    s->playing_for = n;
+}
+
+static void writer(void *userdata) {
+    pa_timing_snapshot s;
+    uint64_t n = 1;
+
+    while (!pa_atomic_load(&stop)) {
+        fill(&s, n++);
+        pa_timing_page_write(page, slot, &s);
+    }
+}
+
+START_TEST (timing_page_test) {
+    pa_timing_page *reader;
+    pa_timing_snapshot s, r;
+    pa_thread *thread;
+    pa_usec_t start;
+    unsigned i, n_torn = 0, n_failed = 0;
+
+    if (!(page = pa_timing_page_new())) {
+        pa_log_warn("No shared memory, skipping.");
+        return;
+    }
+
+    fail_unless((slot = pa_timing_page_alloc_slot(page, STREAM_INDEX)) != PA_INVALID_INDEX);
+    fail_unless((reader = pa_timing_page_attach(pa_timing_page_get_id(page))) != NULL);
+
+    /* Nothing written yet */
+    fail_unless(pa_timing_page_read(reader, slot, STREAM_INDEX, &r) < 0);
+
+    fill(&s, 42);
+    pa_timing_page_write(page, slot, &s);
+
+    fail_unless(pa_timing_page_read(reader, slot, STREAM_INDEX, &r) == 0);
+    fail_unless(r.read_index == 42 && r.sink_usec == 42 && r.playing_for == 42 && !r.playing);
+
+    /* Slots belong to one stream */
+    fail_unless(pa_timing_page_read(reader, slot, STREAM_INDEX + 1, &r) < 0);
+
+    /* Every copy must be consistent while the writer is busy */
+    fail_unless((thread = pa_thread_new("writer", writer, NULL)) != NULL);
+
+    start = pa_rtclock_now();
+
+    for (i = 0; i < N_READS; i++) {
+        if (pa_timing_page_read(reader, slot, STREAM_INDEX, &r) < 0) {
+            n_failed++;
+            continue;
+        }
+
+        if (r.write_index != r.read_index ||
+            r.sink_usec != (uint64_t) r.read_index ||
+            r.timestamp != (uint64_t) r.read_index ||
+            r.underrun_for != (uint64_t) r.read_index ||
+            r.playing_for != (uint64_t) r.read_index ||
+            r.playing != !!(r.read_index & 1))
+            n_torn++;
+    }
+
+    pa_log_info("%u reads in %0.2f ms, %u gave up.",
+                N_READS, (double) (pa_rtclock_now() - start) / PA_USEC_PER_MSEC, n_failed);
+
+    pa_atomic_store(&stop, 1);
+    pa_thread_free(thread);
+
+    fail_unless(n_torn == 0);
+
+    pa_timing_page_free_slot(page, slot);
+    fail_unless(pa_timing_page_read(reader, slot, STREAM_INDEX, &r) < 0);
+
+    pa_timing_page_free(reader);
+    pa_timing_page_free(page);
+}
+END_TEST
+
+/* What the server publishes from the first pop() after an underrun,
+ * before the sink input queued the chunk */
+START_TEST (timing_page_first_pop_test) {
+    pa_timing_page *reader;
+    pa_timing_snapshot s, r;
+    pa_sample_spec ss = { PA_SAMPLE_S16NE, 44100, 2 };
+    size_t chunk_length = 4410 * 4;
+
+    if (!(page = pa_timing_page_new())) {
+        pa_log_warn("No shared memory, skipping.");
+        return;
+    }
+
+    fail_unless((slot = pa_timing_page_alloc_slot(page, STREAM_INDEX)) != PA_INVALID_INDEX);
+    fail_unless((reader = pa_timing_page_attach(pa_timing_page_get_id(page))) != NULL);
+
+    s.stream_index = STREAM_INDEX;
+    s.read_index = (int64_t) chunk_length;
+    s.write_index = 10 * (int64_t) chunk_length;
+    s.sink_usec = 20 * PA_USEC_PER_MSEC;
+    s.timestamp = pa_rtclock_now();
+    s.underrun_for = (uint64_t) -1;
+    s.playing_for = 0;
+    s.playing = false;
+
+    pa_timing_snapshot_add_pending(&s, chunk_length, pa_bytes_to_usec(chunk_length, &ss));
+    pa_timing_page_write(page, slot, &s);
+
+    fail_unless(pa_timing_page_read(reader, slot, STREAM_INDEX, &r) == 0);
+
+    /* The chunk just handed out is still to be played */
+    fail_unless(r.sink_usec == 120 * PA_USEC_PER_MSEC);
+    fail_unless(r.playing);
+    fail_unless(r.underrun_for == 0);
+    fail_unless(r.playing_for == chunk_length);
+
+    /* Nothing pending changes nothing */
+    pa_timing_snapshot_add_pending(&r, 0, 0);
+    fail_unless(r.sink_usec == 120 * PA_USEC_PER_MSEC && r.playing_for == chunk_length);
+
+    pa_timing_page_free_slot(page, slot);
+    pa_timing_page_free(reader);
+    pa_timing_page_free(page);
+}
+END_TEST
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    Suite *s;
+    TCase *tc;
+    SRunner *sr;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_INFO);
+
+    s = suite_create("Timing Page");
+    tc = tcase_create("timing-page");
+    tcase_add_test(tc, timing_page_test);
+    tcase_add_test(tc, timing_page_first_pop_test);
+    tcase_set_timeout(tc, 120);
+    suite_add_tcase(s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
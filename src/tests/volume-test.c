@@ -22,14 +22,21 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <check.h>
 
+#include <pulse/rtclock.h>
 #include <pulse/volume.h>
+#include <pulse/xmalloc.h>
 
+#include <pulsecore/cpu-x86.h>
+#include <pulsecore/endianmacros.h>
 #include <pulsecore/log.h>
 #include <pulsecore/macro.h>
+#include <pulsecore/random.h>
+#include <pulsecore/sample-util.h>
 
 START_TEST (volume_test) {
     pa_volume_t v;
@@ -142,6 +149,93 @@ START_TEST (volume_test) {
 }
 END_TEST
 
+#if defined (__i386__) || defined (__amd64__)
+#define THROUGHPUT_FRAMES 4800
+#define THROUGHPUT_CHANNELS 2
+#define THROUGHPUT_RUNS 200
+
+/* Alternates between two volumes, so that the samples neither decay to
+ * denormals nor all clip */
+static double measure_volume(pa_do_volume_func_t func, void *samples, size_t length, const void *down, const void *up) {
+    pa_usec_t start, stop;
+    unsigned i;
+
+    start = pa_rtclock_now();
+    for (i = 0; i < THROUGHPUT_RUNS; i++)
+        func(samples, (i & 1) ? up : down, THROUGHPUT_CHANNELS, length);
+    stop = pa_rtclock_now();
+
+    /* Million samples per second */
+    return (double) THROUGHPUT_FRAMES * THROUGHPUT_CHANNELS * THROUGHPUT_RUNS / PA_MAX(stop - start, 1U);
+}
+
+START_TEST (volume_throughput_test) {
+    static const pa_sample_format_t formats[] = {
+        PA_SAMPLE_S16NE, PA_SAMPLE_FLOAT32NE, PA_SAMPLE_FLOAT32RE, PA_SAMPLE_S32NE,
+        PA_SAMPLE_S32RE, PA_SAMPLE_S24NE, PA_SAMPLE_S24_32NE, PA_SAMPLE_S24_32RE
+    };
+    pa_do_volume_func_t orig[PA_ELEMENTSOF(formats)];
+    int32_t ivolumes[2][THROUGHPUT_CHANNELS + 32];
+    float fvolumes[2][THROUGHPUT_CHANNELS + 32];
+    pa_cpu_x86_flag_t flags = 0;
+    void *samples, *samples_ref;
+    unsigned i;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    /* -3 dB and +3 dB, padded like mix.c does */
+    for (i = 0; i < THROUGHPUT_CHANNELS + 32; i++) {
+        fvolumes[0][i] = (float) pa_sw_volume_to_linear(pa_sw_volume_from_dB(-3.0));
+        fvolumes[1][i] = (float) pa_sw_volume_to_linear(pa_sw_volume_from_dB(3.0));
+        ivolumes[0][i] = (int32_t) lrint(fvolumes[0][i] * 0x10000);
+        ivolumes[1][i] = (int32_t) lrint(fvolumes[1][i] * 0x10000);
+    }
+
+    for (i = 0; i < PA_ELEMENTSOF(formats); i++)
+        orig[i] = pa_get_volume_func(formats[i]);
+
+    pa_cpu_init_x86(&flags);
+
+    samples = pa_xmalloc(THROUGHPUT_FRAMES * THROUGHPUT_CHANNELS * 4);
+    samples_ref = pa_xmalloc(THROUGHPUT_FRAMES * THROUGHPUT_CHANNELS * 4);
+
+    for (i = 0; i < PA_ELEMENTSOF(formats); i++) {
+        size_t length = THROUGHPUT_FRAMES * THROUGHPUT_CHANNELS * pa_sample_size_of_format(formats[i]);
+        bool is_float = formats[i] == PA_SAMPLE_FLOAT32NE || formats[i] == PA_SAMPLE_FLOAT32RE;
+        const void *down = is_float ? (const void *) fvolumes[0] : (const void *) ivolumes[0];
+        const void *up = is_float ? (const void *) fvolumes[1] : (const void *) ivolumes[1];
+        double c, simd;
+
+        if (is_float) {
+            unsigned k;
+
+            for (k = 0; k < THROUGHPUT_FRAMES * THROUGHPUT_CHANNELS; k++) {
+                float v = (float) (k % 199) / 100.0f - 1.0f;
+                ((float *) samples)[k] = formats[i] == PA_SAMPLE_FLOAT32NE ? v : PA_FLOAT32_SWAP(v);
+            }
+        } else
+            pa_random(samples, length);
+
+        memcpy(samples_ref, samples, length);
+
+        c = measure_volume(orig[i], samples_ref, length, down, up);
+        simd = measure_volume(pa_get_volume_func(formats[i]), samples, length, down, up);
+
+        pa_log_info("%-10s C: %7.1f Msamples/s, optimized: %7.1f Msamples/s (%.1fx)",
+                    pa_sample_format_to_string(formats[i]), c, simd, simd / c);
+
+        /* Both went through the same volume sequence, the optimized
+         * functions are bit exact with the C ones */
+        fail_unless(memcmp(samples, samples_ref, length) == 0);
+    }
+
+    pa_xfree(samples);
+    pa_xfree(samples_ref);
+}
+END_TEST
+#endif /* defined (__i386__) || defined (__amd64__) */
+
 int main(int argc, char *argv[]) {
     int failed = 0;
     Suite *s;
@@ -151,6 +245,9 @@ int main(int argc, char *argv[]) {
     s = suite_create("Volume");
     tc = tcase_create("volume");
     tcase_add_test(tc, volume_test);
+#if defined (__i386__) || defined (__amd64__)
+    tcase_add_test(tc, volume_throughput_test);
+#endif
     tcase_set_timeout(tc, 120);
     suite_add_tcase(s, tc);
 